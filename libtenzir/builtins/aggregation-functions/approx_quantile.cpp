@@ -0,0 +1,145 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <tenzir/aggregation_function.hpp>
+#include <tenzir/arrow_table_slice.hpp>
+#include <tenzir/detail/overload.hpp>
+#include <tenzir/detail/string_literal.hpp>
+#include <tenzir/detail/type_traits.hpp>
+#include <tenzir/plugin.hpp>
+#include <tenzir/sketch/t_digest.hpp>
+
+#include <cmath>
+
+namespace tenzir::plugins::approx_quantile {
+
+namespace {
+
+template <class Type>
+concept quantile_type
+  = detail::is_any_v<Type, int64_type, uint64_type, double_type,
+                     duration_type, time_type>;
+
+/// Converts a value to the number that the t-digest tracks.
+template <class Type>
+auto to_double(view<type_to_data_t<Type>> value) -> double {
+  if constexpr (std::is_same_v<Type, duration_type>)
+    return static_cast<double>(value.count());
+  else if constexpr (std::is_same_v<Type, time_type>)
+    return static_cast<double>(value.time_since_epoch().count());
+  else
+    return static_cast<double>(value);
+}
+
+template <quantile_type Type>
+class approx_quantile_function final : public aggregation_function {
+public:
+  approx_quantile_function(type input_type, double quantile) noexcept
+    : aggregation_function(std::move(input_type)), quantile_{quantile} {
+    // nop
+  }
+
+private:
+  [[nodiscard]] auto output_type() const -> type override {
+    // Integral values have no meaningful integral quantile, but durations and
+    // times do, so we only widen the former to double.
+    if constexpr (std::is_same_v<Type, duration_type>
+                  || std::is_same_v<Type, time_type>)
+      return input_type();
+    else
+      return type{double_type{}};
+  }
+
+  void add(const data_view& view) override {
+    using view_type = tenzir::view<type_to_data_t<Type>>;
+    if (caf::holds_alternative<caf::none_t>(view))
+      return;
+    add_value(caf::get<view_type>(view));
+  }
+
+  void add(const arrow::Array& array) override {
+    const auto& type = caf::get<Type>(input_type());
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    for (auto row = int64_t{0}; row < values.length(); ++row)
+      if (values.IsValid(row))
+        add_value(value_at(type, values, row));
+  }
+
+  void add_value(view<type_to_data_t<Type>> value) {
+    const auto x = to_double<Type>(value);
+    // NaN has no place in an order, so we skip it like a null value.
+    if (!std::isnan(x))
+      digest_.add(x);
+  }
+
+  [[nodiscard]] auto finish() && -> caf::expected<data> override {
+    const auto result = digest_.quantile(quantile_);
+    if (!result)
+      return data{};
+    if constexpr (std::is_same_v<Type, duration_type>)
+      return data{duration{static_cast<duration::rep>(std::llround(*result))}};
+    else if constexpr (std::is_same_v<Type, time_type>)
+      return data{
+        time{duration{static_cast<duration::rep>(std::llround(*result))}}};
+    else
+      return data{*result};
+  }
+
+  double quantile_ = {};
+  sketch::t_digest digest_ = {};
+};
+
+/// A plugin for a fixed quantile, given in percent.
+template <detail::string_literal Name, uint64_t Percent>
+class approx_quantile_plugin final
+  : public virtual aggregation_function_plugin {
+  auto initialize([[maybe_unused]] const record& plugin_config,
+                  [[maybe_unused]] const record& global_config)
+    -> caf::error override {
+    return {};
+  }
+
+  [[nodiscard]] auto name() const -> std::string override {
+    return std::string{Name.str()};
+  };
+
+  [[nodiscard]] auto make_aggregation_function(const type& input_type) const
+    -> caf::expected<std::unique_ptr<aggregation_function>> override {
+    auto f = detail::overload{
+      [&]<quantile_type Type>(
+        const Type&) -> caf::expected<std::unique_ptr<aggregation_function>> {
+        return std::make_unique<approx_quantile_function<Type>>(
+          input_type, static_cast<double>(Percent) / 100.0);
+      },
+      [&]<concrete_type Type>(const Type& type)
+        -> caf::expected<std::unique_ptr<aggregation_function>>
+        requires(!quantile_type<Type>)
+      {
+        return caf::make_error(ec::invalid_configuration,
+                               fmt::format("{} aggregation function does not "
+                                           "support type {}",
+                                           Name.str(), type));
+      },
+    };
+    return caf::visit(f, input_type);
+  }
+};
+
+using approx_median_plugin = approx_quantile_plugin<"approx_median", 50>;
+using approx_p90_plugin = approx_quantile_plugin<"approx_p90", 90>;
+using approx_p95_plugin = approx_quantile_plugin<"approx_p95", 95>;
+using approx_p99_plugin = approx_quantile_plugin<"approx_p99", 99>;
+
+} // namespace
+
+} // namespace tenzir::plugins::approx_quantile
+
+TENZIR_REGISTER_PLUGIN(tenzir::plugins::approx_quantile::approx_median_plugin)
+TENZIR_REGISTER_PLUGIN(tenzir::plugins::approx_quantile::approx_p90_plugin)
+TENZIR_REGISTER_PLUGIN(tenzir::plugins::approx_quantile::approx_p95_plugin)
+TENZIR_REGISTER_PLUGIN(tenzir::plugins::approx_quantile::approx_p99_plugin)
@@ -0,0 +1,102 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <tenzir/aggregation_function.hpp>
+#include <tenzir/arrow_table_slice.hpp>
+#include <tenzir/detail/narrow.hpp>
+#include <tenzir/hash/hash_array.hpp>
+#include <tenzir/plugin.hpp>
+#include <tenzir/sketch/heavy_hitters.hpp>
+
+namespace tenzir::plugins::approx_top {
+
+namespace {
+
+template <concrete_type Type>
+class approx_top_function final : public aggregation_function {
+public:
+  explicit approx_top_function(type input_type) noexcept
+    : aggregation_function(std::move(input_type)) {
+    // nop
+  }
+
+private:
+  [[nodiscard]] auto output_type() const -> type override {
+    return type{list_type{record_type{
+      {"value", input_type()},
+      {"count", uint64_type{}},
+    }}};
+  }
+
+  void add(const data_view& view) override {
+    using view_type = tenzir::view<type_to_data_t<Type>>;
+    if (caf::holds_alternative<caf::none_t>(view))
+      return;
+    const auto& typed_view = caf::get<view_type>(view);
+    sketch_.add(hash_as_data_view(typed_view), typed_view);
+  }
+
+  void add(const arrow::Array& array) override {
+    digests_.resize(detail::narrow_cast<size_t>(array.length()));
+    hash_array(input_type(), array, digests_);
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    if constexpr (arrow::is_extension_type<type_to_arrow_type_t<Type>>::value)
+      add_values(*values.storage());
+    else
+      add_values(values);
+  }
+
+  void add_values(const type_to_arrow_array_storage_t<Type>& values) {
+    const auto& type = caf::get<Type>(input_type());
+    for (auto row = int64_t{0}; row < values.length(); ++row)
+      if (values.IsValid(row))
+        sketch_.add(digests_[row], value_at(type, values, row));
+  }
+
+  [[nodiscard]] auto finish() && -> caf::expected<data> override {
+    auto entries = sketch_.top();
+    auto result = list{};
+    result.reserve(entries.size());
+    for (auto& entry : entries)
+      result.emplace_back(record{
+        {"value", std::move(entry.value)},
+        {"count", entry.count},
+      });
+    return data{std::move(result)};
+  }
+
+  sketch::heavy_hitters sketch_ = {};
+  std::vector<array_digest> digests_ = {};
+};
+
+class plugin : public virtual aggregation_function_plugin {
+  auto initialize([[maybe_unused]] const record& plugin_config,
+                  [[maybe_unused]] const record& global_config)
+    -> caf::error override {
+    return {};
+  }
+
+  [[nodiscard]] auto name() const -> std::string override {
+    return "approx_top";
+  };
+
+  [[nodiscard]] auto make_aggregation_function(const type& input_type) const
+    -> caf::expected<std::unique_ptr<aggregation_function>> override {
+    auto f = [&]<concrete_type Type>(
+               const Type&) -> std::unique_ptr<aggregation_function> {
+      return std::make_unique<approx_top_function<Type>>(input_type);
+    };
+    return caf::visit(f, input_type);
+  }
+};
+
+} // namespace
+
+} // namespace tenzir::plugins::approx_top
+
+TENZIR_REGISTER_PLUGIN(tenzir::plugins::approx_top::plugin)
@@ -7,8 +7,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/aggregation_function.hpp>
+#include <tenzir/arrow_table_slice.hpp>
+#include <tenzir/detail/narrow.hpp>
 #include <tenzir/detail/passthrough.hpp>
-#include <tenzir/hash/hash.hpp>
+#include <tenzir/hash/hash_array.hpp>
 #include <tenzir/plugin.hpp>
 
 #include <tsl/robin_set.h>
@@ -17,13 +19,15 @@ namespace tenzir::plugins::distinct {
 
 namespace {
 
+/// Hashes values like `hash_array`, which allows for probing the set with the
+/// digests computed for an entire array at once.
 template <concrete_type Type>
 struct heterogeneous_data_hash {
   using is_transparent = void;
 
   [[nodiscard]] auto operator()(view<type_to_data_t<Type>> value) const
     -> size_t {
-    return hash(value);
+    return hash_as_data_view(value);
   }
 
   [[nodiscard]] auto
@@ -31,7 +35,7 @@ struct heterogeneous_data_hash {
   operator()(const type_to_data_t<Type>& value) const -> size_t
     requires(!std::is_same_v<view<type_to_data_t<Type>>, type_to_data_t<Type>>)
   {
-    return hash(make_view(value));
+    return hash_as_data_view(make_view(value));
   }
 };
 
@@ -76,6 +80,31 @@ private:
     }
   }
 
+  void add(const arrow::Array& array) override {
+    // We reuse the digest buffer across calls, as summarize often adds many
+    // short slices of the same array.
+    digests_.resize(detail::narrow_cast<size_t>(array.length()));
+    hash_array(input_type(), array, digests_);
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    if constexpr (arrow::is_extension_type<type_to_arrow_type_t<Type>>::value)
+      add_values(*values.storage());
+    else
+      add_values(values);
+  }
+
+  void add_values(const type_to_arrow_array_storage_t<Type>& values) {
+    const auto& type = caf::get<Type>(input_type());
+    for (auto row = int64_t{0}; row < values.length(); ++row) {
+      if (values.IsNull(row))
+        continue;
+      const auto value = value_at(type, values, row);
+      if (!distinct_.contains(value, digests_[row])) {
+        const auto [it, inserted] = distinct_.insert(materialize(value));
+        TENZIR_ASSERT(inserted);
+      }
+    }
+  }
+
   [[nodiscard]] auto finish() && -> caf::expected<data> override {
     auto result = list{};
     result.reserve(distinct_.size());
@@ -88,6 +117,7 @@ private:
   tsl::robin_set<type_to_data_t<Type>, heterogeneous_data_hash<Type>,
                  heterogeneous_data_equal<Type>>
     distinct_ = {};
+  std::vector<array_digest> digests_ = {};
 };
 
 class plugin : public virtual aggregation_function_plugin {
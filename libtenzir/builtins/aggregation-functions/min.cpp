@@ -7,6 +7,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/aggregation_function.hpp>
+#include <tenzir/arrow_table_slice.hpp>
 #include <tenzir/plugin.hpp>
 
 namespace tenzir::plugins::min {
@@ -35,6 +36,32 @@ private:
       min_ = materialize(caf::get<view_type>(view));
   }
 
+  void add(const arrow::Array& array) override {
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    if constexpr (arrow::is_extension_type<type_to_arrow_type_t<Type>>::value)
+      add_values(*values.storage());
+    else
+      add_values(values);
+  }
+
+  /// Compares views of all values and materializes only the result, so that
+  /// we don't copy every intermediate minimum.
+  void add_values(const type_to_arrow_array_storage_t<Type>& values) {
+    const auto& type = caf::get<Type>(input_type());
+    auto result = std::optional<view<type_to_data_t<Type>>>{};
+    if (min_)
+      result = make_view(*min_);
+    for (auto row = int64_t{0}; row < values.length(); ++row) {
+      if (values.IsNull(row))
+        continue;
+      const auto value = value_at(type, values, row);
+      if (!result || value < *result)
+        result = value;
+    }
+    if (result)
+      min_ = materialize(*result);
+  }
+
   [[nodiscard]] caf::expected<data> finish() && override {
     return data{min_};
   }
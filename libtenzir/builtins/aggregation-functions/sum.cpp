@@ -7,6 +7,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/aggregation_function.hpp>
+#include <tenzir/arrow_table_slice.hpp>
 #include <tenzir/plugin.hpp>
 
 namespace tenzir::plugins::sum {
@@ -37,6 +38,19 @@ private:
       sum_ = *sum_ + materialize(caf::get<view_type>(view));
   }
 
+  void add(const arrow::Array& array) override {
+    const auto& type = caf::get<Type>(input_type());
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    auto sum = sum_;
+    for (auto row = int64_t{0}; row < values.length(); ++row) {
+      if (values.IsNull(row))
+        continue;
+      const auto value = materialize(value_at(type, values, row));
+      sum = sum ? *sum + value : value;
+    }
+    sum_ = sum;
+  }
+
   [[nodiscard]] caf::expected<data> finish() && override {
     return data{sum_};
   }
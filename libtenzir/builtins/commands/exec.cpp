@@ -141,6 +141,10 @@ auto format_metric(const metric& metric) {
       static_cast<double>(metric.inbound_measurement.num_elements)
         / static_cast<double>(metric.inbound_measurement.num_batches),
       metric.inbound_measurement.unit);
+    it = fmt::format_to(it, locale, "{}{}demand: {:L} {} within {}\n", indent,
+                        indent, metric.demand_batch_size,
+                        metric.inbound_measurement.unit,
+                        data{metric.demand_batch_timeout});
   }
   if (metric.outbound_measurement.unit != "void") {
     it = fmt::format_to(it, "{}outbound:\n", indent);
@@ -7,29 +7,290 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/argument_parser.hpp>
-#include <tenzir/concept/parseable/tenzir/pipeline.hpp>
+#include <tenzir/blocking_executor.hpp>
+#include <tenzir/concept/parseable/numeric/integral.hpp>
+#include <tenzir/concept/parseable/tenzir/time.hpp>
+#include <tenzir/concept/parseable/to.hpp>
+#include <tenzir/detail/posix.hpp>
+#include <tenzir/detail/string.hpp>
 #include <tenzir/diagnostics.hpp>
+#include <tenzir/logger.hpp>
 #include <tenzir/plugin.hpp>
-#include <tenzir/tql/parser.hpp>
 
+#include <caf/actor_system_config.hpp>
 #include <caf/error.hpp>
 
+#include <condition_variable>
+#include <cstdio>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <system_error>
+#include <vector>
 
 namespace tenzir::plugins::directory {
 
+namespace {
+
+/// The number of bytes that may wait for the writer pool before savers block.
+constexpr auto max_pending_bytes = size_t{64} << 20;
+
+/// Renders a partition value as a directory name in the style of Hive, i.e.,
+/// escapes all characters that are not allowed or ambiguous in path segments.
+auto format_partition_value(const data& value) -> std::string {
+  if (caf::holds_alternative<caf::none_t>(value)) {
+    return "__HIVE_DEFAULT_PARTITION__";
+  }
+  const auto* str = caf::get_if<std::string>(&value);
+  const auto unescaped = str ? *str : fmt::to_string(value);
+  auto result = std::string{};
+  result.reserve(unescaped.size());
+  for (auto c : unescaped) {
+    const auto byte = static_cast<unsigned char>(c);
+    if (byte < 0x20 or byte == 0x7f or c == '/' or c == '\\' or c == '%'
+        or c == '=') {
+      fmt::format_to(std::back_inserter(result), "%{:02X}", byte);
+    } else {
+      result.push_back(c);
+    }
+  }
+  if (result.empty() or result == "." or result == "..") {
+    result.insert(0, "%");
+    result.insert(1, "00");
+  }
+  return result;
+}
+
+/// A file that the writer pool writes to. All members except for `path` and
+/// `handle` are guarded by the mutex of the pool.
+struct output_file {
+  std::filesystem::path path;
+  bool appending = {};
+  std::FILE* handle = {};
+  bool opened = {};
+  bool scheduled = {};
+  bool closing = {};
+  std::vector<chunk_ptr> pending = {};
+  size_t pending_bytes = {};
+
+  /// The first error that occurred while writing the file, and whether it was
+  /// already returned to the saver.
+  caf::error error = {};
+  bool error_reported = {};
+};
+
+/// Writes chunks to files as work of the blocking executor. Chunks for the
+/// same file are written in order and by one task at a time, while writes to
+/// distinct files proceed concurrently.
+class writer_pool : public std::enable_shared_from_this<writer_pool> {
+public:
+  writer_pool(blocking_executor& executor, bool real_time)
+    : executor_{executor}, real_time_{real_time} {
+  }
+
+  writer_pool(const writer_pool&) = delete;
+  auto operator=(const writer_pool&) -> writer_pool& = delete;
+  writer_pool(writer_pool&&) = delete;
+  auto operator=(writer_pool&&) -> writer_pool& = delete;
+  ~writer_pool() noexcept = default;
+
+  /// Queues a chunk for writing. Blocks while too many bytes are pending.
+  /// @returns An error if writing the file failed earlier.
+  auto submit(const std::shared_ptr<output_file>& file, chunk_ptr chunk)
+    -> caf::error {
+    auto lock = std::unique_lock{mutex_};
+    work_done_.wait(lock, [&] {
+      return pending_bytes_ < max_pending_bytes or file->error;
+    });
+    if (file->error) {
+      return take_error(*file);
+    }
+    if (chunk and chunk->size() > 0) {
+      file->pending_bytes += chunk->size();
+      pending_bytes_ += chunk->size();
+      file->pending.push_back(std::move(chunk));
+    }
+    schedule(file, lock);
+    return {};
+  }
+
+  /// Closes a file once all chunks queued for it are written, and waits until
+  /// the file is closed.
+  /// @returns An error if writing, flushing, or closing the file failed and
+  /// the error was not yet returned from `submit`.
+  auto close(const std::shared_ptr<output_file>& file) -> caf::error {
+    auto lock = std::unique_lock{mutex_};
+    file->closing = true;
+    schedule(file, lock);
+    lock.lock();
+    work_done_.wait(lock, [&] {
+      return not file->scheduled;
+    });
+    return take_error(*file);
+  }
+
+private:
+  /// Submits a task for a file unless one is already running for it. The task
+  /// keeps the pool alive.
+  /// @post `lock` is unlocked.
+  auto schedule(const std::shared_ptr<output_file>& file,
+                std::unique_lock<std::mutex>& lock) -> void {
+    if (file->scheduled) {
+      lock.unlock();
+      return;
+    }
+    file->scheduled = true;
+    lock.unlock();
+    executor_.submit([self = shared_from_this(), file] {
+      self->write(*file);
+    });
+  }
+
+  static auto take_error(output_file& file) -> caf::error {
+    if (file.error_reported) {
+      return {};
+    }
+    file.error_reported = static_cast<bool>(file.error);
+    return file.error;
+  }
+
+  /// Writes the pending chunks of a file until none are left.
+  auto write(output_file& file) -> void {
+    auto lock = std::unique_lock{mutex_};
+    while (true) {
+      auto chunks = std::exchange(file.pending, {});
+      const auto bytes = std::exchange(file.pending_bytes, 0);
+      const auto closing = file.closing;
+      // We open a file when it is first scheduled, so that it exists even if
+      // nothing is written to it.
+      const auto needs_open = not file.opened;
+      file.opened = true;
+      const auto failed = static_cast<bool>(file.error);
+      lock.unlock();
+      auto error = caf::error{};
+      if (needs_open) {
+        file.handle
+          = std::fopen(file.path.c_str(), file.appending ? "ab" : "wb");
+        if (not file.handle) {
+          error = caf::make_error(ec::filesystem_error,
+                                  fmt::format("failed to open {}: {}",
+                                              file.path,
+                                              detail::describe_errno()));
+        }
+      }
+      for (const auto& chunk : chunks) {
+        if (failed or error or not file.handle) {
+          break;
+        }
+        if (std::fwrite(chunk->data(), 1, chunk->size(), file.handle)
+            != chunk->size()) {
+          error = caf::make_error(ec::filesystem_error,
+                                  fmt::format("failed to write to {}: {}",
+                                              file.path,
+                                              detail::describe_errno()));
+        }
+      }
+      if (not error and real_time_ and file.handle
+          and std::fflush(file.handle) != 0) {
+        error = caf::make_error(ec::filesystem_error,
+                                fmt::format("failed to flush {}: {}",
+                                            file.path,
+                                            detail::describe_errno()));
+      }
+      // Closing flushes the buffer of the file, so this is where most write
+      // errors surface for files that are not written in real time.
+      if (closing and file.handle) {
+        auto close_failed = std::fclose(file.handle) != 0;
+        file.handle = nullptr;
+        if (close_failed and not error) {
+          error = caf::make_error(ec::filesystem_error,
+                                  fmt::format("failed to close {}: {}",
+                                              file.path,
+                                              detail::describe_errno()));
+        }
+      }
+      chunks.clear();
+      lock.lock();
+      pending_bytes_ -= bytes;
+      if (error and not file.error) {
+        file.error = std::move(error);
+      }
+      work_done_.notify_all();
+      if (file.pending.empty() and file.closing == closing) {
+        file.scheduled = false;
+        return;
+      }
+    }
+  }
+
+  blocking_executor& executor_;
+  const bool real_time_;
+  std::mutex mutex_;
+  std::condition_variable work_done_;
+  size_t pending_bytes_ = {};
+};
+
+/// Closes a file of the writer pool when the saver instance that writes to it
+/// goes away, and reports the errors that occurred until then.
+class file_handle {
+public:
+  file_handle(operator_control_plane& ctrl, std::shared_ptr<writer_pool> pool,
+              std::shared_ptr<output_file> file, bool resumed)
+    : ctrl_{ctrl},
+      pool_{std::move(pool)},
+      file_{std::move(file)},
+      resumed_{resumed} {
+  }
+
+  file_handle(const file_handle&) = delete;
+  auto operator=(const file_handle&) -> file_handle& = delete;
+  file_handle(file_handle&&) = delete;
+  auto operator=(file_handle&&) -> file_handle& = delete;
+
+  ~file_handle() noexcept {
+    if (auto error = pool_->close(file_)) {
+      ctrl_.abort(std::move(error));
+    }
+    // We also print this when the operator fails at runtime, but then again
+    // this also means that we did create the file, so that's probably alright.
+    // An instance that resumes writing to a file does not print it again.
+    if (not resumed_) {
+      fmt::print(stdout, "{}\n", file_->path.string());
+    }
+  }
+
+  auto write(chunk_ptr chunk) -> caf::error {
+    return pool_->submit(file_, std::move(chunk));
+  }
+
+private:
+  operator_control_plane& ctrl_;
+  std::shared_ptr<writer_pool> pool_;
+  std::shared_ptr<output_file> file_;
+  bool resumed_ = {};
+};
+
+} // namespace
+
 struct saver_args {
   std::string path;
   bool appending;
   bool real_time;
+  std::vector<std::string> partition_by;
+  std::optional<uint64_t> max_file_size;
+  std::optional<duration> roll_after;
+  uint64_t max_open_files = 256;
 
   template <class Inspector>
   friend auto inspect(Inspector& f, saver_args& x) -> bool {
     return f.object(x)
       .pretty_name("saver_args")
       .fields(f.field("path", x.path), f.field("appending", x.appending),
-              f.field("real_time", x.real_time));
+              f.field("real_time", x.real_time),
+              f.field("partition_by", x.partition_by),
+              f.field("max_file_size", x.max_file_size),
+              f.field("roll_after", x.roll_after),
+              f.field("max_open_files", x.max_open_files));
   }
 };
 
@@ -53,6 +314,13 @@ public:
                              "directory write ...`");
     }
     auto dir_path = std::filesystem::path(args_.path);
+    for (const auto& field : args_.partition_by) {
+      auto it = info->partition.find(field);
+      dir_path /= fmt::format(
+        "{}={}", field,
+        format_partition_value(it != info->partition.end() ? it->second
+                                                           : data{}));
+    }
     std::error_code ec{};
     std::filesystem::create_directories(dir_path, ec);
     if (ec) {
@@ -60,44 +328,43 @@ public:
                              fmt::format("creating directory {} failed: {}",
                                          dir_path, ec.message()));
     }
+    // Files carry a sequence number if more than one file may exist for the
+    // same schema and partition, i.e., when rolling over, or when the `to`
+    // operator had to finish an instance to make room for others and the
+    // printer's output cannot be continued.
+    const auto numbered = args_.max_file_size or args_.roll_after
+                          or info->sequence_number > 0;
     auto file_path
       = dir_path
-        / fmt::format("{}.{}.{}", info->input_schema.name(),
-                      info->input_schema.make_fingerprint(), info->format);
-    auto const* p = plugins::find<saver_parser_plugin>("file");
-    if (!p) {
-      return caf::make_error(ec::unspecified, "could not find `file` saver");
-    }
-    auto diag = null_diagnostic_handler{};
-    auto file_pipeline = escape_operator_arg(file_path.string());
-    if (args_.appending)
-      file_pipeline += " --appending";
-    if (args_.real_time)
-      file_pipeline += " --real-time";
-    // TODO: We should probably use a better mechanism here than escaping and
-    // re-parsing.
-    auto pi = tql::make_parser_interface(std::move(file_pipeline), diag);
-    auto parsed = std::unique_ptr<plugin_saver>{};
-    try {
-      parsed = p->parse_saver(*pi);
-    } catch (diagnostic& d) {
-      return caf::make_error(ec::unspecified, fmt::to_string(d));
-    }
-    auto file_saver = parsed->instantiate(ctrl, std::move(info));
-    if (not file_saver)
-      return std::move(file_saver.error());
-    auto guard = caf::detail::make_scope_guard([=] {
-      // We also print this when the operator fails at runtime, but
-      // then again this also means that we did create the file, so
-      // that's probably alright.
-      fmt::print(stdout, "{}\n", file_path.string());
-    });
-    return [file_saver = std::move(*file_saver),
-            guard = std::make_shared<decltype(guard)>(std::move(guard))](
-             chunk_ptr input) {
-      (void)guard;
-      // TODO: handle overwrite semantics
-      return file_saver(std::move(input));
+        / (numbered
+             ? fmt::format("{}.{}.{}.{}", info->input_schema.name(),
+                           info->input_schema.make_fingerprint(),
+                           info->sequence_number, info->format)
+             : fmt::format("{}.{}.{}", info->input_schema.name(),
+                           info->input_schema.make_fingerprint(),
+                           info->format));
+    // The pool lives as long as any saver instance or write task uses it, so
+    // that all files are written completely once the last instance is gone.
+    auto pool = pool_.lock();
+    if (not pool) {
+      pool = std::make_shared<writer_pool>(
+        blocking_executor::instance(content(ctrl.self().config())),
+        args_.real_time);
+      pool_ = pool;
+    }
+    auto file = std::make_shared<output_file>();
+    file->path = std::move(file_path);
+    file->appending = args_.appending or info->resumed;
+    // Open the file eagerly so that it exists even if we never write to it.
+    if (auto error = pool->submit(file, nullptr)) {
+      return error;
+    }
+    auto handle = std::make_shared<file_handle>(ctrl, std::move(pool),
+                                                std::move(file), info->resumed);
+    return [&ctrl, handle = std::move(handle)](chunk_ptr input) {
+      if (auto error = handle->write(std::move(input))) {
+        ctrl.abort(std::move(error));
+      }
     };
   }
 
@@ -105,6 +372,15 @@ public:
     return false;
   }
 
+  auto partitioning() const -> saver_partitioning override {
+    return {
+      .fields = args_.partition_by,
+      .max_bytes = args_.max_file_size,
+      .max_age = args_.roll_after,
+      .max_instances = args_.max_open_files,
+    };
+  }
+
   auto default_printer() const -> std::string override {
     return "json";
   }
@@ -115,6 +391,7 @@ public:
 
 private:
   saver_args args_;
+  std::weak_ptr<writer_pool> pool_;
 };
 
 class plugin : public virtual saver_plugin<directory_saver> {
@@ -124,10 +401,52 @@ public:
     auto parser = argument_parser{name(), "https://docs.tenzir.com/next/"
                                           "connectors/directory"};
     auto args = saver_args{};
+    auto partition_by = std::optional<located<std::string>>{};
+    auto max_file_size = std::optional<located<uint64_t>>{};
+    auto roll_after = std::optional<located<duration>>{};
+    auto max_open_files = std::optional<located<uint64_t>>{};
     parser.add(args.path, "<path>");
     parser.add("-a,--appending", args.appending);
     parser.add("-r,--real-time", args.real_time);
+    parser.add("--partition-by", partition_by, "<fields>");
+    parser.add("--max-file-size", max_file_size, "<bytes>");
+    parser.add("--roll-after", roll_after, "<duration>");
+    parser.add("--max-open-files", max_open_files, "<n>");
     parser.parse(p);
+    if (partition_by) {
+      for (auto field : detail::split(partition_by->inner, ",")) {
+        if (field.empty()) {
+          diagnostic::error("partitioning field must not be empty")
+            .primary(partition_by->source)
+            .throw_();
+        }
+        args.partition_by.emplace_back(field);
+      }
+    }
+    if (max_file_size) {
+      if (max_file_size->inner == 0) {
+        diagnostic::error("maximum file size must not be 0")
+          .primary(max_file_size->source)
+          .throw_();
+      }
+      args.max_file_size = max_file_size->inner;
+    }
+    if (roll_after) {
+      if (roll_after->inner <= duration::zero()) {
+        diagnostic::error("roll-over interval must be positive")
+          .primary(roll_after->source)
+          .throw_();
+      }
+      args.roll_after = roll_after->inner;
+    }
+    if (max_open_files) {
+      if (max_open_files->inner == 0) {
+        diagnostic::error("maximum number of open files must not be 0")
+          .primary(max_open_files->source)
+          .throw_();
+      }
+      args.max_open_files = max_open_files->inner;
+    }
     return std::make_unique<directory_saver>(std::move(args));
   }
 };
@@ -496,11 +496,11 @@ auto get_schemas(bool try_find_schema, operator_control_plane& ctrl,
   return ret;
 }
 
-auto unflatten_if_needed(std::string_view separator, table_slice slice)
-  -> table_slice {
-  if (separator.empty())
+auto unflatten_if_needed(std::optional<unflattener>& unflatten,
+                         table_slice slice) -> table_slice {
+  if (not unflatten)
     return slice;
-  return unflatten(slice, separator);
+  return (*unflatten)(slice);
 }
 
 [[nodiscard]] auto activate_unknown_entry(parser_state& state)
@@ -799,6 +799,9 @@ auto make_parser(generator<GeneratorValue> json_chunk_generator,
                  std::optional<type> schema, bool preserve_order,
                  auto parser_impl) -> generator<table_slice> {
   auto state = parser_state{ctrl, preserve_order};
+  auto unflatten = std::optional<unflattener>{};
+  if (not separator.empty())
+    unflatten.emplace(std::move(separator));
   if (schema) {
     // TODO: What about `infer_types`?
     state.active_entry = state.add_entry(schema->name(), *schema);
@@ -813,7 +816,7 @@ auto make_parser(generator<GeneratorValue> json_chunk_generator,
       auto& entry = entry_ref.get();
       if (now > entry.flushed + defaults::import::batch_timeout) {
         for (auto& slice : entry.flush()) {
-          co_yield unflatten_if_needed(separator, std::move(slice));
+          co_yield unflatten_if_needed(unflatten, std::move(slice));
         }
       }
     }
@@ -823,7 +826,7 @@ auto make_parser(generator<GeneratorValue> json_chunk_generator,
     }
     // This also flushes the builder if they grow over the threshold.
     for (auto slice : parser_impl.parse(*chnk, state)) {
-      co_yield unflatten_if_needed(separator, std::move(slice));
+      co_yield unflatten_if_needed(unflatten, std::move(slice));
     }
     if (state.abort_requested) {
       co_return;
@@ -836,7 +839,7 @@ auto make_parser(generator<GeneratorValue> json_chunk_generator,
   // Flush all entries.
   for (auto&& entry : non_empty_entries(state)) {
     for (auto& slice : entry.get().flush()) {
-      co_yield unflatten_if_needed(separator, std::move(slice));
+      co_yield unflatten_if_needed(unflatten, std::move(slice));
     }
   }
 }
@@ -8,12 +8,11 @@
 
 #include "tenzir/argument_parser.hpp"
 #include "tenzir/arrow_table_slice.hpp"
-#include "tenzir/concept/parseable/string/quoted_string.hpp"
 #include "tenzir/concept/parseable/tenzir/data.hpp"
 #include "tenzir/concept/printable/tenzir/json.hpp"
+#include "tenzir/detail/overload.hpp"
 #include "tenzir/detail/string_literal.hpp"
 #include "tenzir/detail/to_xsv_sep.hpp"
-#include "tenzir/detail/zip_iterator.hpp"
 #include "tenzir/parser_interface.hpp"
 #include "tenzir/plugin.hpp"
 #include "tenzir/series_builder.hpp"
@@ -27,7 +26,11 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <deque>
 #include <iterator>
+#include <string_view>
+#include <vector>
 
 namespace tenzir::plugins::xsv {
 namespace {
@@ -159,6 +162,216 @@ struct xsv_printer_impl {
   std::string null{};
 };
 
+/// Unescapes a quoted field at the beginning of a line.
+/// @returns The unescaped contents and the number of consumed characters, or
+/// nothing if the quote is unterminated.
+auto unquote(std::string_view line)
+  -> std::optional<std::pair<std::string, size_t>> {
+  TENZIR_ASSERT(line.starts_with('"'));
+  auto result = std::string{};
+  for (auto i = size_t{1}; i < line.size(); ++i) {
+    const auto c = line[i];
+    if (c == '"') {
+      return std::pair{std::move(result), i + 1};
+    }
+    if (c == '\\' and i + 1 < line.size()) {
+      // We unescape quotes and backslashes, and drop all other escape
+      // sequences.
+      const auto next = line[++i];
+      if (next == '"' or next == '\\') {
+        result.push_back(next);
+      }
+      continue;
+    }
+    result.push_back(c);
+  }
+  return std::nullopt;
+}
+
+/// Splits a line into its fields. A field is either a non-empty quoted string
+/// that is followed by a separator or the end of the line, or a non-empty
+/// sequence of characters other than the separator.
+/// @param line The line to split.
+/// @param sep The field separator.
+/// @param fields The fields of the line.
+/// @param unescaped The storage for unescaped quoted fields.
+/// @returns `false` if the line contains an empty field.
+auto split_line(std::string_view line, char sep,
+                std::vector<std::string_view>& fields,
+                std::deque<std::string>& unescaped) -> bool {
+  fields.clear();
+  unescaped.clear();
+  // We only need to look at individual characters for fields that begin with
+  // a quote. For all other fields, memchr finds the next separator, which is
+  // vectorized in all relevant standard library implementations.
+  while (true) {
+    if (line.starts_with('"')) {
+      if (auto quoted = unquote(line)) {
+        auto& [value, length] = *quoted;
+        if (not value.empty()
+            and (length == line.size() or line[length] == sep)) {
+          fields.emplace_back(unescaped.emplace_back(std::move(value)));
+          if (length == line.size()) {
+            return true;
+          }
+          line.remove_prefix(length + 1);
+          continue;
+        }
+      }
+    }
+    const auto* pos = static_cast<const char*>(
+      std::memchr(line.data(), sep, line.size()));
+    const auto length
+      = pos ? static_cast<size_t>(pos - line.data()) : line.size();
+    if (length == 0) {
+      return false;
+    }
+    fields.push_back(line.substr(0, length));
+    if (not pos) {
+      return true;
+    }
+    line.remove_prefix(length + 1);
+  }
+}
+
+/// The type of the last typed value in a column, which determines the parser
+/// that we try first for the next value of the column.
+enum class column_kind {
+  unknown,
+  boolean,
+  uint64,
+  int64,
+  real,
+  duration,
+  time,
+  ip,
+  subnet,
+};
+
+/// Determines the kind of a column from a value of the generic data parser.
+/// Null values leave the kind of the column unchanged.
+auto infer_kind(const data& value, column_kind previous) -> column_kind {
+  auto f = detail::overload{
+    [&](caf::none_t) {
+      return previous;
+    },
+    [](bool) {
+      return column_kind::boolean;
+    },
+    [](uint64_t) {
+      return column_kind::uint64;
+    },
+    [](int64_t) {
+      return column_kind::int64;
+    },
+    [](double) {
+      return column_kind::real;
+    },
+    [](duration) {
+      return column_kind::duration;
+    },
+    [](time) {
+      return column_kind::time;
+    },
+    [](const ip&) {
+      return column_kind::ip;
+    },
+    [](const subnet&) {
+      return column_kind::subnet;
+    },
+    [](const auto&) {
+      // Strings only come out of the data parser if they were quoted, and
+      // for nested values we always need the full data parser.
+      return column_kind::unknown;
+    },
+  };
+  return caf::visit(f, value);
+}
+
+/// Parses a value with the parser of a given type, and adds it to a field if
+/// the parser consumes the entire value.
+template <class Type, class Parser>
+auto try_add(builder_ref field, std::string_view value, const Parser& parser)
+  -> std::optional<caf::expected<void>> {
+  auto result = Type{};
+  if (not parser(value, result)) {
+    return std::nullopt;
+  }
+  return field.try_data(result);
+}
+
+/// Checks whether the generic data parser reads the beginning of a value as an
+/// integer, i.e., whether the value starts with digits that are not followed
+/// by a decimal point. The parser does not backtrack from there, even if the
+/// value as a whole is a real number such as `1e5`.
+auto starts_with_integer(std::string_view value) -> bool {
+  if (value.starts_with('+') or value.starts_with('-')) {
+    value.remove_prefix(1);
+  }
+  const auto digits = static_cast<size_t>(
+    std::find_if_not(value.begin(), value.end(),
+                     [](char c) {
+                       return std::isdigit(static_cast<unsigned char>(c));
+                     })
+    - value.begin());
+  return digits > 0 and (digits == value.size() or value[digits] != '.');
+}
+
+/// Parses a value and adds it to a field. Once the kind of a column is known,
+/// we try the parser for that kind first, and fall back to the generic data
+/// parser only if that fails. The typed parsers only accept values that the
+/// generic data parser reads as the same type, so the result is the same as
+/// with the generic data parser alone. Values that the generic data parser
+/// cannot parse are added as strings, and leave the kind of the column
+/// unchanged, so that a single string does not slow down the rest of the
+/// column.
+auto add_value(builder_ref field, std::string_view value, column_kind& kind)
+  -> caf::expected<void> {
+  auto result = std::optional<caf::expected<void>>{};
+  switch (kind) {
+    case column_kind::unknown:
+      break;
+    case column_kind::boolean:
+      result = try_add<bool>(field, value, parsers::boolean);
+      break;
+    case column_kind::uint64:
+      result = try_add<uint64_t>(field, value, parsers::count);
+      break;
+    case column_kind::int64:
+      // Non-negative integers are unsigned for the generic data parser.
+      if (value.starts_with('-')) {
+        result = try_add<int64_t>(field, value, parsers::integer);
+      }
+      break;
+    case column_kind::real:
+      if (not starts_with_integer(value)) {
+        result = try_add<double>(field, value, parsers::real);
+      }
+      break;
+    case column_kind::duration:
+      result = try_add<duration>(field, value, parsers::duration);
+      break;
+    case column_kind::time:
+      result = try_add<time>(field, value, parsers::time);
+      break;
+    case column_kind::ip:
+      result = try_add<ip>(field, value, parsers::ip);
+      break;
+    case column_kind::subnet:
+      result = try_add<subnet>(field, value, parsers::net);
+      break;
+  }
+  if (result) {
+    return std::move(*result);
+  }
+  auto parsed = data{};
+  if (not(parsers::data - parsers::pattern)(value, parsed)) {
+    return field.try_data(value);
+  }
+  kind = infer_kind(parsed, kind);
+  return field.try_data(parsed);
+}
+
 } // namespace
 
 auto parse_impl(generator<std::optional<std::string_view>> lines,
@@ -181,43 +394,17 @@ auto parse_impl(generator<std::optional<std::string_view>> lines,
   }
   if (!header || header->empty())
     co_return;
-  auto split_parser
-    = (((parsers::qqstr
-           .then([](std::string in) {
-             static auto unescaper = [](auto& f, auto l, auto out) {
-               if (*f != '\\') { // Skip every non-escape character.
-                 *out++ = *f++;
-                 return true;
-               }
-               if (l - f < 2)
-                 return false;
-               switch (auto c = *++f) {
-                 case '\\':
-                   *out++ = '\\';
-                   break;
-                 case '"':
-                   *out++ = '"';
-                   break;
-               }
-               ++f;
-               return true;
-             };
-             return detail::unescape(in, unescaper);
-           })
-           .with([](const std::string& in) {
-             return !in.empty();
-           })
-         >> &(sep | parsers::eoi))
-        | +(parsers::any - sep))
-       % sep);
-  auto fields = std::vector<std::string>{};
-  if (!split_parser(*header, fields)) {
+  auto values = std::vector<std::string_view>{};
+  auto unescaped = std::deque<std::string>{};
+  if (!split_line(*header, sep, values, unescaped)) {
     ctrl.abort(
       caf::make_error(ec::parse_error, fmt::format("{0} parser failed to parse "
                                                    "header of {0} input",
                                                    name)));
     co_return;
   }
+  const auto fields = std::vector<std::string>(values.begin(), values.end());
+  auto kinds = std::vector<column_kind>(fields.size(), column_kind::unknown);
   auto b = series_builder{};
   for (; it != lines.end(); ++it) {
     auto line = *it;
@@ -239,8 +426,7 @@ auto parse_impl(generator<std::optional<std::string_view>> lines,
     if (line->empty()) {
       continue;
     }
-    auto values = std::vector<std::string>{};
-    if (!split_parser(*line, values)) {
+    if (!split_line(*line, sep, values, unescaped)) {
       ctrl.warn(
         caf::make_error(ec::parse_error, fmt::format("{} parser skipped line: "
                                                      "parsing line failed",
@@ -256,12 +442,8 @@ auto parse_impl(generator<std::optional<std::string_view>> lines,
       continue;
     }
     auto row = b.record();
-    for (const auto& [field, value] : detail::zip(fields, values)) {
-      auto parsed = data{};
-      if (not(parsers::data - parsers::pattern)(value, parsed)) {
-        parsed = value;
-      }
-      auto result = row.field(field).try_data(parsed);
+    for (size_t i = 0; i < fields.size(); ++i) {
+      auto result = add_value(row.field(fields[i]), values[i], kinds[i]);
       if (not result) {
         ctrl.warn(result.error());
       }
@@ -15,9 +15,11 @@
 #include "tenzir/concept/printable/tenzir/json.hpp"
 #include "tenzir/concept/printable/to_string.hpp"
 #include "tenzir/data.hpp"
+#include "tenzir/detail/narrow.hpp"
 #include "tenzir/detail/string.hpp"
 #include "tenzir/detail/string_literal.hpp"
 #include "tenzir/detail/to_xsv_sep.hpp"
+#include "tenzir/detail/type_traits.hpp"
 #include "tenzir/detail/zeekify.hpp"
 #include "tenzir/detail/zip_iterator.hpp"
 #include "tenzir/generator.hpp"
@@ -36,7 +38,9 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -44,109 +48,200 @@ namespace tenzir::plugins::zeek_tsv {
 
 namespace {
 
+/// Parses a single Zeek value of a basic type and appends it to a builder.
+/// @returns `false` if the value is invalid.
 template <concrete_type Type>
-struct zeek_parser {
-  auto operator()(const Type&, char, const std::string&) const
-    -> rule<std::string_view::const_iterator, type_to_data_t<Type>> {
-    die("unexpected type");
+auto append_value(const Type& type, type_to_arrow_builder_t<Type>& builder,
+                  std::string_view value) -> bool {
+  auto append = [&](const auto& x) {
+    const auto status = append_builder(type, builder, x);
+    TENZIR_ASSERT(status.ok(), status.ToString().c_str());
+    return true;
+  };
+  auto parse = [&](const auto& parser, auto& x) {
+    return parser(value, x);
+  };
+  if constexpr (std::is_same_v<Type, string_type>) {
+    if (value.empty()) {
+      return false;
+    }
+    // We only need to copy strings that contain escape sequences; all others
+    // are appended straight from the input.
+    if (value.find('\\') == std::string_view::npos) {
+      return append(value);
+    }
+    const auto unescaped = detail::byte_unescape(value);
+    return append(std::string_view{unescaped});
+  } else if constexpr (detail::is_any_v<Type, duration_type, time_type>) {
+    auto seconds = double{};
+    if (not parse(parsers::real, seconds)) {
+      return false;
+    }
+    const auto x
+      = std::chrono::duration_cast<duration>(double_seconds(seconds));
+    if constexpr (std::is_same_v<Type, time_type>) {
+      return append(time{} + x);
+    } else {
+      return append(x);
+    }
+  } else {
+    auto x = type_to_data_t<Type>{};
+    auto ok = false;
+    if constexpr (std::is_same_v<Type, bool_type>) {
+      ok = parse(parsers::tf, x);
+    } else if constexpr (std::is_same_v<Type, int64_type>) {
+      ok = parse(parsers::i64, x);
+    } else if constexpr (std::is_same_v<Type, uint64_type>) {
+      ok = parse(parsers::u64, x);
+    } else if constexpr (std::is_same_v<Type, double_type>) {
+      ok = parse(parsers::real, x);
+    } else if constexpr (std::is_same_v<Type, ip_type>) {
+      ok = parse(parsers::ip, x);
+    } else if constexpr (std::is_same_v<Type, subnet_type>) {
+      ok = parse(parsers::net, x);
+    } else {
+      static_assert(detail::always_false_v<Type>, "unexpected Zeek type");
+    }
+    return ok and append(x);
   }
-};
+}
 
-template <>
-struct zeek_parser<bool_type> {
-  auto operator()(const bool_type&, char, const std::string&) const {
-    return parsers::tf;
-  }
+/// The types that can occur in Zeek logs, either as a column or as the
+/// element of a list column.
+template <class Type>
+concept zeek_basic_type
+  = detail::is_any_v<Type, bool_type, int64_type, uint64_type, double_type,
+                     duration_type, time_type, string_type, ip_type,
+                     subnet_type>;
+
+/// Decodes the values of a single column of a Zeek log into an Arrow builder.
+class column_decoder {
+public:
+  virtual ~column_decoder() noexcept = default;
+
+  /// Appends a value given in its Zeek representation.
+  /// @returns `false` if the value is invalid.
+  virtual auto append(std::string_view value) -> bool = 0;
+
+  /// Appends a value that is marked as unset.
+  virtual auto append_unset() -> void = 0;
+
+  /// Appends a value that is marked as empty.
+  virtual auto append_empty() -> void = 0;
+
+  /// Returns all appended values and resets the decoder.
+  virtual auto finish() -> std::shared_ptr<arrow::Array> = 0;
 };
 
-template <>
-struct zeek_parser<int64_type> {
-  auto operator()(const int64_type&, char, const std::string&) const {
-    return parsers::i64;
+template <zeek_basic_type Type>
+class basic_column_decoder final : public column_decoder {
+public:
+  explicit basic_column_decoder(Type type)
+    : type_{std::move(type)},
+      builder_{type_.make_arrow_builder(arrow::default_memory_pool())} {
   }
-};
 
-template <>
-struct zeek_parser<uint64_type> {
-  auto operator()(const uint64_type&, char, const std::string&) const {
-    return parsers::u64;
+  auto append(std::string_view value) -> bool override {
+    return append_value(type_, *builder_, value);
   }
-};
 
-template <>
-struct zeek_parser<double_type> {
-  auto operator()(const double_type&, char, const std::string&) const {
-    return parsers::real.then([](double x) {
-      return x;
-    });
+  auto append_unset() -> void override {
+    const auto status = builder_->AppendNull();
+    TENZIR_ASSERT(status.ok(), status.ToString().c_str());
   }
-};
 
-template <>
-struct zeek_parser<duration_type> {
-  auto operator()(const duration_type&, char, const std::string&) const {
-    return parsers::real.then([](double x) {
-      return std::chrono::duration_cast<duration>(double_seconds(x));
-    });
+  auto append_empty() -> void override {
+    const auto empty = type_.construct();
+    const auto status = append_builder(type_, *builder_, make_view(empty));
+    TENZIR_ASSERT(status.ok(), status.ToString().c_str());
   }
-};
 
-template <>
-struct zeek_parser<time_type> {
-  auto operator()(const time_type&, char, const std::string&) const {
-    return parsers::real.then([](double x) {
-      return time{} + std::chrono::duration_cast<duration>(double_seconds(x));
-    });
+  auto finish() -> std::shared_ptr<arrow::Array> override {
+    return builder_->Finish().ValueOrDie();
   }
+
+private:
+  Type type_;
+  std::shared_ptr<type_to_arrow_builder_t<Type>> builder_;
 };
 
-template <>
-struct zeek_parser<string_type> {
-  auto operator()(const string_type&, char separator,
-                  const std::string& set_separator) const
-    -> rule<std::string_view::const_iterator, std::string> {
-    if (set_separator.empty()) {
-      return (+(parsers::any - separator)).then([](std::string x) {
-        return detail::byte_unescape(x);
-      });
+template <zeek_basic_type ElementType>
+class list_column_decoder final : public column_decoder {
+public:
+  list_column_decoder(const list_type& type, ElementType element_type,
+                      std::string set_separator)
+    : element_type_{std::move(element_type)},
+      set_separator_{std::move(set_separator)},
+      builder_{type.make_arrow_builder(arrow::default_memory_pool())},
+      values_{static_cast<type_to_arrow_builder_t<ElementType>&>(
+        *builder_->value_builder())} {
+  }
+
+  auto append(std::string_view value) -> bool override {
+    const auto status = builder_->Append();
+    TENZIR_ASSERT(status.ok(), status.ToString().c_str());
+    // We parse the elements straight into the value builder of the list.
+    while (true) {
+      const auto pos = set_separator_.empty()
+                         ? std::string_view::npos
+                         : value.find(set_separator_);
+      if (not append_value(element_type_, values_, value.substr(0, pos))) {
+        return false;
+      }
+      if (pos == std::string_view::npos) {
+        return true;
+      }
+      value.remove_prefix(pos + set_separator_.size());
     }
-    return (+(parsers::any - separator - set_separator)).then([](std::string x) {
-      return detail::byte_unescape(x);
-    });
   }
-};
 
-template <>
-struct zeek_parser<ip_type> {
-  auto operator()(const ip_type&, char, const std::string&) const {
-    return parsers::ip;
+  auto append_unset() -> void override {
+    const auto status = builder_->AppendNull();
+    TENZIR_ASSERT(status.ok(), status.ToString().c_str());
   }
-};
 
-template <>
-struct zeek_parser<subnet_type> {
-  auto operator()(const subnet_type&, char, const std::string&) const {
-    return parsers::ip;
+  auto append_empty() -> void override {
+    const auto status = builder_->AppendEmptyValue();
+    TENZIR_ASSERT(status.ok(), status.ToString().c_str());
   }
-};
 
-template <>
-struct zeek_parser<list_type> {
-  auto operator()(const list_type& lt, char separator,
-                  const std::string& set_separator) const {
-    auto f
-      = [&]<concrete_type Type>(
-          const Type& type) -> rule<std::string_view::const_iterator, list> {
-      return (zeek_parser<Type>{}(type, separator, set_separator)
-                .then([](type_to_data_t<Type> value) {
-                  return data{value};
-                })
-              % set_separator);
-    };
-    return caf::visit(f, lt.value_type());
+  auto finish() -> std::shared_ptr<arrow::Array> override {
+    return builder_->Finish().ValueOrDie();
   }
+
+private:
+  ElementType element_type_;
+  std::string set_separator_;
+  std::shared_ptr<type_to_arrow_builder_t<list_type>> builder_;
+  type_to_arrow_builder_t<ElementType>& values_;
 };
 
+/// Creates the decoder for a column of a Zeek log.
+auto make_column_decoder(const type& column_type,
+                         const std::string& set_separator)
+  -> std::unique_ptr<column_decoder> {
+  auto f = [&]<concrete_type Type>(
+             const Type& type) -> std::unique_ptr<column_decoder> {
+    if constexpr (zeek_basic_type<Type>) {
+      return std::make_unique<basic_column_decoder<Type>>(type);
+    } else if constexpr (std::is_same_v<Type, list_type>) {
+      auto g = [&]<concrete_type ElementType>(const ElementType& element_type)
+        -> std::unique_ptr<column_decoder> {
+        if constexpr (zeek_basic_type<ElementType>) {
+          return std::make_unique<list_column_decoder<ElementType>>(
+            type, element_type, set_separator);
+        } else {
+          die("unexpected Zeek list element type");
+        }
+      };
+      return caf::visit(g, type.value_type());
+    } else {
+      die("unexpected Zeek type");
+    }
+  };
+  return caf::visit(f, column_type);
+}
+
 // Creates a Tenzir type from an ASCII Zeek type in a log header.
 auto parse_type(std::string_view zeek_type) -> caf::expected<type> {
   type t;
@@ -450,9 +545,10 @@ struct zeek_document {
   std::vector<std::string> fields = {};
   std::vector<std::string> types = {};
 
-  /// A builder generated from the above metadata.
-  std::optional<table_slice_builder> builder = {};
-  std::vector<rule<std::string_view::const_iterator, bool>> parsers = {};
+  /// The schema and column decoders generated from the above metadata.
+  type schema = {};
+  std::vector<std::unique_ptr<column_decoder>> columns = {};
+  int64_t rows = {};
   type target_schema = {};
 };
 
@@ -461,9 +557,18 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
   auto document = zeek_document{};
   auto last_finish = std::chrono::steady_clock::now();
   auto line_nr = size_t{0};
+  auto unflatten = unflattener{"."};
   // Helper for finishing and casting.
   auto finish = [&] {
-    auto slice = unflatten(document.builder->finish(), ".");
+    auto arrays = arrow::ArrayVector{};
+    arrays.reserve(document.columns.size());
+    for (auto& column : document.columns) {
+      arrays.push_back(column->finish());
+    }
+    auto batch = arrow::RecordBatch::Make(document.schema.to_arrow_schema(),
+                                          document.rows, std::move(arrays));
+    document.rows = 0;
+    auto slice = unflatten(table_slice{batch, document.schema});
     if (document.target_schema
         and can_cast(slice.schema(), document.target_schema)) {
       return cast(std::move(slice), document.target_schema);
@@ -474,8 +579,9 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
   for (auto&& line : lines) {
     const auto now = std::chrono::steady_clock::now();
     // Yield at chunk boundaries.
-    if (document.builder
-        and (document.builder->rows() >= defaults::import::table_slice_size
+    if (document.rows > 0
+        and (detail::narrow_cast<uint64_t>(document.rows)
+               >= defaults::import::table_slice_size
              or last_finish + defaults::import::batch_timeout < now)) {
       last_finish = now;
       co_yield finish();
@@ -509,7 +615,7 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
             (void)close;
           });
       if (close_parser(header, unused)) {
-        if (document.builder) {
+        if (document.schema) {
           last_finish = now;
           co_yield finish();
           document = {};
@@ -520,7 +626,7 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
       // builder anymore. If that's the case then we have a bug in the data,
       // but we can just handle that gracefully and tell the user that they
       // were missing a closing tag.
-      if (document.builder) {
+      if (document.schema) {
         last_finish = now;
         co_yield finish();
         document = {};
@@ -586,11 +692,12 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
       }
       continue;
     }
-    // If we don't have a builder yet, then we create one lazily.
-    if (not document.builder) {
-      // We parse the header into three things:
-      // 1. A schema that we create the builder with.
-      // 2. A rule that parses lines according to the schema.
+    // If we don't have column decoders yet, then we create them lazily.
+    if (not document.schema) {
+      // We compile the header into two things:
+      // 1. A schema for the resulting table slices.
+      // 2. A decoder per column that appends values directly to an Arrow
+      //    builder.
       if (document.path.empty()) {
         diagnostic::error("failed to parse Zeek document: missing #path")
           .note("line {}", line_nr)
@@ -612,8 +719,8 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
           .emit(ctrl.diagnostics());
         co_return;
       }
-      // Now we create the schema and the parser rule.
-      document.parsers.reserve(document.fields.size());
+      // Now we create the schema and the column decoders.
+      document.columns.reserve(document.fields.size());
       auto record_fields = std::vector<record_type::field_view>{};
       record_fields.reserve(document.fields.size());
       for (const auto& [field, zeek_type] :
@@ -626,39 +733,12 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
             .emit(ctrl.diagnostics());
           parsed_type = type{string_type{}};
         }
-        const auto make_unset_parser = [&]() {
-          return ignore(parsers::str{document.unset_field}
-                        >> &(parsers::chr{document.separator} | parsers::eoi))
-            .then([&]() {
-              return document.builder->add(caf::none);
-            });
-        };
-        const auto make_empty_parser
-          = [&]<concrete_type Type>(const Type& type) {
-              return ignore(parsers::str{document.empty_field} >> &(
-                              parsers::chr{document.separator} | parsers::eoi))
-                .then([&]() {
-                  return document.builder->add(type.construct());
-                });
-            };
-        auto make_field_parser =
-          [&]<concrete_type Type>(
-            const Type& type) -> rule<std::string_view::const_iterator, bool> {
-          return make_unset_parser() | make_empty_parser(type)
-                 | zeek_parser<Type>{}(type, document.separator,
-                                       std::is_same_v<Type, list_type>
-                                         ? document.set_separator
-                                         : std::string{})
-                     .then([&](type_to_data_t<Type> value) {
-                       return document.builder->add(value);
-                     });
-        };
-        document.parsers.push_back(caf::visit(make_field_parser, *parsed_type));
+        document.columns.push_back(
+          make_column_decoder(*parsed_type, document.set_separator));
         record_fields.push_back({field, std::move(*parsed_type)});
       }
       const auto schema_name = fmt::format("zeek.{}", document.path);
-      auto schema = type{schema_name, record_type{record_fields}};
-      document.builder = table_slice_builder{std::move(schema)};
+      document.schema = type{schema_name, record_type{record_fields}};
       // If there is a schema with the exact matching name, then we set it as a
       // target schema and use that for casting.
       auto target_schema = std::find_if(
@@ -672,51 +752,49 @@ auto parser_impl(generator<std::optional<std::string_view>> lines,
         });
       document.target_schema
         = target_schema == ctrl.schemas().end() ? type{} : *target_schema;
-      // We intentionally fall through here; we create the builder lazily
+      // We intentionally fall through here; we create the decoders lazily
       // when we encounter the first event, but that we still need to parse
       // now.
     }
-    // Lastly, we can apply our rules and parse the builder.
-    auto f = line->begin();
-    const auto l = line->end();
-    auto add_ok = false;
-    const auto separator = ignore(parsers::chr{document.separator});
-    for (size_t i = 0; i < document.parsers.size() - 1; ++i) {
-      const auto parse_ok = document.parsers[i](f, l, add_ok);
-      if (not parse_ok) [[unlikely]] {
+    // Lastly, we split the line at the separators and decode all fields. The
+    // last field extends up to the next separator, if any.
+    auto remainder = *line;
+    for (size_t i = 0; i < document.columns.size(); ++i) {
+      const auto* pos = static_cast<const char*>(
+        std::memchr(remainder.data(), document.separator, remainder.size()));
+      if (not pos and i + 1 < document.columns.size()) [[unlikely]] {
+        diagnostic::error("failed to parse Zeek separator at index {} in `{}`",
+                          i, *line)
+          .note("line {}", line_nr)
+          .emit(ctrl.diagnostics());
+        co_return;
+      }
+      const auto length
+        = pos ? static_cast<size_t>(pos - remainder.data()) : remainder.size();
+      const auto value = remainder.substr(0, length);
+      auto& column = *document.columns[i];
+      if (value == document.unset_field) {
+        column.append_unset();
+      } else if (value == document.empty_field) {
+        column.append_empty();
+      } else if (not column.append(value)) [[unlikely]] {
         diagnostic::error("failed to parse Zeek value at index {} in `{}`", i,
                           *line)
           .note("line {}", line_nr)
           .emit(ctrl.diagnostics());
         co_return;
       }
-      TENZIR_ASSERT_EXPENSIVE(add_ok);
-      const auto separator_ok = separator(f, l, unused);
-      if (not separator_ok) [[unlikely]] {
-        diagnostic::error("failed to parse Zeek separator at index {} in `{}`",
-                          i, *line)
+      remainder.remove_prefix(pos ? length + 1 : length);
+      if (pos and i + 1 == document.columns.size()) [[unlikely]] {
+        diagnostic::warning("unparsed values at end of Zeek line: `{}`",
+                            line->substr(pos - line->data()))
           .note("line {}", line_nr)
           .emit(ctrl.diagnostics());
-        co_return;
       }
     }
-    const auto parse_ok = document.parsers.back()(f, l, add_ok);
-    if (not parse_ok) [[unlikely]] {
-      diagnostic::error("failed to parse Zeek value at index {} in `{}`",
-                        document.parsers.size() - 1, *line)
-        .note("line {}", line_nr)
-        .emit(ctrl.diagnostics());
-      co_return;
-    }
-    const auto eoi_ok = parsers::eoi(f, l, unused);
-    if (not eoi_ok) [[unlikely]] {
-      diagnostic::warning("unparsed values at end of Zeek line: `{}`",
-                          std::string_view{f, l})
-        .note("line {}", line_nr)
-        .emit(ctrl.diagnostics());
-    }
+    ++document.rows;
   }
-  if (document.builder and document.builder->rows() > 0) {
+  if (document.rows > 0) {
     co_yield finish();
   }
 }
@@ -9,6 +9,7 @@
 #include <tenzir/argument_parser.hpp>
 #include <tenzir/concept/parseable/string/char_class.hpp>
 #include <tenzir/concept/parseable/tenzir/pipeline.hpp>
+#include <tenzir/detail/compressed_frames.hpp>
 #include <tenzir/error.hpp>
 #include <tenzir/logger.hpp>
 #include <tenzir/pipeline.hpp>
@@ -17,6 +18,14 @@
 #include <arrow/type.h>
 #include <arrow/util/compression.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <span>
+#include <thread>
+
 namespace tenzir::plugins::compress_decompress {
 
 namespace {
@@ -63,9 +72,10 @@ public:
         buffer_ = std::move(chunk);
       },
       [&](std::vector<uint8_t>& buffer) {
-        buffer.reserve(buffer.size() + chunk->size());
-        std::copy_n(reinterpret_cast<const uint8_t*>(chunk->data()),
-                    chunk->size(), std::back_inserter(buffer));
+        // Inserting instead of reserving the exact size keeps the growth of
+        // the buffer geometric, which matters when we buffer entire frames.
+        const auto* data = reinterpret_cast<const uint8_t*>(chunk->data());
+        buffer.insert(buffer.end(), data, data + chunk->size());
       },
       [&](const chunk_ptr& buffer) {
         TENZIR_ASSERT(buffer);
@@ -107,6 +117,21 @@ public:
     return std::visit(f, buffer_);
   }
 
+  /// Removes the first `size` bytes from the buffer and returns them, without
+  /// copying if the buffer refers to a single chunk.
+  auto take_front_n(int64_t size) -> chunk_ptr {
+    TENZIR_ASSERT(size <= this->size());
+    auto result = chunk_ptr{};
+    if (const auto* buffer = std::get_if<chunk_ptr>(&buffer_)) {
+      result = (*buffer)->slice(0, size);
+    } else {
+      result
+        = chunk::copy(as_bytes(data(), detail::narrow_cast<size_t>(size)));
+    }
+    drop_front_n(size);
+    return result;
+  }
+
 private:
   std::variant<std::monostate, std::vector<uint8_t>, chunk_ptr> buffer_ = {};
 };
@@ -114,15 +139,31 @@ private:
 struct operator_args {
   located<std::string> type = {};
   std::optional<located<int>> level = {};
+  std::optional<located<uint64_t>> block_size = {};
+  std::optional<located<uint64_t>> threads = {};
   // TODO: gzip has some further options, which we should also cover.
 
   friend auto inspect(auto& f, operator_args& x) -> bool {
     return f.object(x)
       .pretty_name("operator_args")
-      .fields(f.field("type", x.type), f.field("level", x.level));
+      .fields(f.field("type", x.type), f.field("level", x.level),
+              f.field("block_size", x.block_size),
+              f.field("threads", x.threads));
   }
 };
 
+/// The size of the blocks that are compressed into independent frames unless
+/// specified otherwise.
+constexpr auto default_block_size = uint64_t{4} << 20;
+
+/// The number of bytes after which we stop looking for the end of a frame,
+/// and instead decompress the remaining input as a stream.
+constexpr auto max_frame_size = int64_t{64} << 20;
+
+auto default_threads() -> uint64_t {
+  return std::max(uint64_t{1}, uint64_t{std::thread::hardware_concurrency()});
+}
+
 auto codec_from_args(const operator_args& args)
   -> arrow::Result<std::shared_ptr<arrow::util::Codec>> {
   auto compression_type
@@ -142,6 +183,204 @@ auto codec_from_args(const operator_args& args)
   return codec;
 }
 
+/// Compresses a block into a self-contained frame.
+auto compress_block(const operator_args& args, const chunk_ptr& block)
+  -> arrow::Result<chunk_ptr> {
+  ARROW_ASSIGN_OR_RAISE(auto codec, codec_from_args(args));
+  ARROW_ASSIGN_OR_RAISE(auto compressor, codec->MakeCompressor());
+  const auto* input = reinterpret_cast<const uint8_t*>(block->data());
+  const auto input_size = detail::narrow_cast<int64_t>(block->size());
+  auto output = std::vector<uint8_t>{};
+  output.resize(detail::narrow_cast<size_t>(
+    std::max(codec->MaxCompressedLen(input_size, input), int64_t{1} << 16)));
+  auto bytes_read = int64_t{0};
+  auto bytes_written = int64_t{0};
+  auto available = [&] {
+    return detail::narrow_cast<int64_t>(output.size()) - bytes_written;
+  };
+  while (bytes_read < input_size) {
+    ARROW_ASSIGN_OR_RAISE(auto result,
+                          compressor->Compress(input_size - bytes_read,
+                                               input + bytes_read, available(),
+                                               output.data() + bytes_written));
+    bytes_read += result.bytes_read;
+    bytes_written += result.bytes_written;
+    if (result.bytes_read == 0) {
+      output.resize(output.size() * 2);
+    }
+  }
+  while (true) {
+    ARROW_ASSIGN_OR_RAISE(
+      auto result, compressor->End(available(), output.data() + bytes_written));
+    bytes_written += result.bytes_written;
+    if (not result.should_retry) {
+      break;
+    }
+    output.resize(output.size() * 2);
+  }
+  output.resize(bytes_written);
+  return chunk::make(std::move(output));
+}
+
+/// Decompresses a single frame. A truncated frame, which can only occur at the
+/// end of the input, yields as much data as possible.
+auto decompress_frame(const operator_args& args, const chunk_ptr& frame)
+  -> arrow::Result<chunk_ptr> {
+  ARROW_ASSIGN_OR_RAISE(auto codec, codec_from_args(args));
+  ARROW_ASSIGN_OR_RAISE(auto decompressor, codec->MakeDecompressor());
+  const auto* input = reinterpret_cast<const uint8_t*>(frame->data());
+  const auto input_size = detail::narrow_cast<int64_t>(frame->size());
+  auto output = std::vector<uint8_t>{};
+  output.resize(std::max(frame->size() * 4, size_t{1} << 16));
+  auto bytes_read = int64_t{0};
+  auto bytes_written = int64_t{0};
+  while (not decompressor->IsFinished()) {
+    ARROW_ASSIGN_OR_RAISE(
+      auto result,
+      decompressor->Decompress(
+        input_size - bytes_read, input + bytes_read,
+        detail::narrow_cast<int64_t>(output.size()) - bytes_written,
+        output.data() + bytes_written));
+    bytes_read += result.bytes_read;
+    bytes_written += result.bytes_written;
+    if (result.need_more_output) {
+      output.resize(output.size() * 2);
+      continue;
+    }
+    if (bytes_read == input_size) {
+      if (not decompressor->IsFinished()) {
+        TENZIR_VERBOSE(
+          "decompressor is not finished, but end of input is reached");
+      }
+      break;
+    }
+    if (result.bytes_read == 0 and result.bytes_written == 0) {
+      return arrow::Status::Invalid("decompressor stopped making progress");
+    }
+  }
+  output.resize(bytes_written);
+  return chunk::make(std::move(output));
+}
+
+/// A set of threads that compresses or decompresses independent blocks, and
+/// hands out the results in the order in which the blocks were submitted.
+/// Threads are started lazily, so that inputs consisting of a single block do
+/// not spin up more than one thread.
+///
+/// Unlike most other background work, this does not run on the blocking
+/// executor: (de)compressing a block keeps a core busy instead of waiting for
+/// I/O, so it needs a bound by the number of cores rather than the executor's
+/// bound, and it must not take threads away from loaders and savers.
+class block_pool {
+public:
+  using result_type = arrow::Result<chunk_ptr>;
+
+  explicit block_pool(uint64_t max_threads)
+    : max_threads_{std::max(max_threads, uint64_t{1})} {
+  }
+
+  block_pool(const block_pool&) = delete;
+  auto operator=(const block_pool&) -> block_pool& = delete;
+  block_pool(block_pool&&) = delete;
+  auto operator=(block_pool&&) -> block_pool& = delete;
+
+  ~block_pool() noexcept {
+    {
+      auto lock = std::unique_lock{mutex_};
+      stopping_ = true;
+      // Nobody is interested in the results of jobs that did not start yet.
+      jobs_.clear();
+    }
+    work_available_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  /// Schedules a job. Callers should stop submitting jobs while the pool is
+  /// full to bound the memory held by pending blocks.
+  auto submit(std::function<result_type()> job) -> void {
+    auto task
+      = std::make_shared<std::packaged_task<result_type()>>(std::move(job));
+    results_.push_back(task->get_future());
+    {
+      auto lock = std::unique_lock{mutex_};
+      jobs_.emplace_back([task = std::move(task)] {
+        (*task)();
+      });
+    }
+    if (threads_.size() < max_threads_ and threads_.size() < results_.size()) {
+      threads_.emplace_back([this] {
+        run();
+      });
+    }
+    work_available_.notify_one();
+  }
+
+  /// Checks whether enough jobs are pending to keep all threads busy.
+  auto full() const -> bool {
+    return results_.size() >= 2 * max_threads_;
+  }
+
+  /// Returns the result of the oldest pending job, or nothing if no job is
+  /// pending. Unless `wait` is set, also returns nothing if the oldest job is
+  /// not done yet.
+  auto next(bool wait) -> std::optional<result_type> {
+    if (results_.empty()) {
+      return std::nullopt;
+    }
+    if (not wait
+        and results_.front().wait_for(std::chrono::seconds::zero())
+              != std::future_status::ready) {
+      return std::nullopt;
+    }
+    auto result = results_.front().get();
+    results_.pop_front();
+    return result;
+  }
+
+private:
+  auto run() -> void {
+    auto lock = std::unique_lock{mutex_};
+    while (true) {
+      work_available_.wait(lock, [&] {
+        return stopping_ or not jobs_.empty();
+      });
+      if (stopping_) {
+        return;
+      }
+      auto job = std::move(jobs_.front());
+      jobs_.pop_front();
+      lock.unlock();
+      job();
+      lock.lock();
+    }
+  }
+
+  const uint64_t max_threads_;
+  std::mutex mutex_ = {};
+  std::condition_variable work_available_ = {};
+  std::deque<std::function<void()>> jobs_ = {};
+  bool stopping_ = false;
+  std::deque<std::future<result_type>> results_ = {};
+  std::vector<std::thread> threads_ = {};
+};
+
+/// Looks for an independently decompressible frame at the start of a buffer.
+auto scan_frame(arrow::Compression::type type, std::span<const uint8_t> bytes)
+  -> detail::frame_info {
+  switch (type) {
+    case arrow::Compression::ZSTD:
+      return detail::scan_zstd_frame(bytes);
+    case arrow::Compression::LZ4_FRAME:
+      return detail::scan_lz4_frame(bytes);
+    case arrow::Compression::GZIP:
+      return detail::scan_bgzf_block(bytes);
+    default:
+      return {};
+  }
+}
+
 class compress_operator final : public crtp_operator<compress_operator> {
 public:
   compress_operator() = default;
@@ -159,6 +398,12 @@ public:
         .emit(ctrl.diagnostics());
       co_return;
     }
+    if (args_.block_size or args_.threads) {
+      for (auto&& frame : compress_blocks(std::move(input), ctrl)) {
+        co_yield std::move(frame);
+      }
+      co_return;
+    }
     auto compressor = codec.ValueUnsafe()->MakeCompressor();
     if (not compressor.ok()) {
       diagnostic::error("failed to create compressor: {}",
@@ -251,6 +496,60 @@ public:
   }
 
 private:
+  /// Splits the input into blocks, compresses them into independent frames on
+  /// a pool of threads, and emits the frames in order.
+  auto compress_blocks(generator<chunk_ptr> input,
+                       operator_control_plane& ctrl) const
+    -> generator<chunk_ptr> {
+    const auto block_size = detail::narrow_cast<int64_t>(
+      args_.block_size ? args_.block_size->inner : default_block_size);
+    auto pool
+      = block_pool{args_.threads ? args_.threads->inner : default_threads()};
+    auto submit = [&](chunk_ptr block) {
+      pool.submit([args = args_, block = std::move(block)] {
+        return compress_block(args, block);
+      });
+    };
+    auto in_buffer = input_buffer{};
+    for (auto&& bytes : input) {
+      const auto stalled = not bytes;
+      if (not stalled) {
+        in_buffer.consume(std::move(bytes));
+      }
+      while (true) {
+        if (in_buffer.size() >= block_size and not pool.full()) {
+          submit(in_buffer.take_front_n(block_size));
+          continue;
+        }
+        auto frame = pool.next(pool.full());
+        if (not frame) {
+          break;
+        }
+        if (not frame->ok()) {
+          diagnostic::error("failed to compress: {}",
+                            frame->status().ToString())
+            .emit(ctrl.diagnostics());
+          co_return;
+        }
+        co_yield frame->MoveValueUnsafe();
+      }
+      if (stalled) {
+        co_yield {};
+      }
+    }
+    if (in_buffer.size() > 0) {
+      submit(in_buffer.take_front_n(in_buffer.size()));
+    }
+    while (auto frame = pool.next(true)) {
+      if (not frame->ok()) {
+        diagnostic::error("failed to compress: {}", frame->status().ToString())
+          .emit(ctrl.diagnostics());
+        co_return;
+      }
+      co_yield frame->MoveValueUnsafe();
+    }
+  }
+
   operator_args args_ = {};
 };
 
@@ -278,16 +577,79 @@ public:
         .emit(ctrl.diagnostics());
       co_return;
     }
+    // If the user asks for more than one thread, and as long as we can find
+    // the boundaries of independent frames without decompressing them, we
+    // decompress the frames in parallel. Once that fails, we fall back to
+    // decompressing the remaining input as a stream.
+    const auto compression_type = codec.ValueUnsafe()->compression_type();
+    const auto threads = args_.threads ? args_.threads->inner : uint64_t{1};
+    auto splitting = threads > 1;
+    auto pool = std::unique_ptr<block_pool>{};
+    auto submit = [&](chunk_ptr frame) {
+      if (not pool) {
+        pool = std::make_unique<block_pool>(threads);
+      }
+      pool->submit([args = args_, frame = std::move(frame)] {
+        return decompress_frame(args, frame);
+      });
+    };
     auto out_buffer = std::vector<uint8_t>{};
     out_buffer.resize(1 << 20);
     auto in_buffer = input_buffer{};
     for (auto&& bytes : input) {
-      if (not bytes) {
+      const auto stalled = not bytes;
+      if (not stalled) {
+        in_buffer.consume(std::move(bytes));
+      }
+      // After we stop splitting, we still need to emit the results of all
+      // pending frames before decompressing the rest of the input.
+      while (splitting or pool) {
+        if (splitting and in_buffer.size() > 0
+            and (not pool or not pool->full())) {
+          const auto frame = scan_frame(
+            compression_type,
+            std::span{in_buffer.data(),
+                      detail::narrow_cast<size_t>(in_buffer.size())});
+          if (frame.status == detail::frame_status::complete) {
+            if (frame.skippable) {
+              in_buffer.drop_front_n(frame.size);
+            } else {
+              submit(in_buffer.take_front_n(frame.size));
+            }
+            continue;
+          }
+          // A stalled input in the middle of the first frame likely is a
+          // stream that we must not hold back, and a large incomplete frame
+          // likely is the only frame of the input.
+          if (frame.status == detail::frame_status::unsplittable
+              or (stalled and not pool)
+              or in_buffer.size() > max_frame_size) {
+            splitting = false;
+          }
+        }
+        auto result
+          = pool ? pool->next(not splitting or pool->full()) : std::nullopt;
+        if (not result) {
+          break;
+        }
+        if (not result->ok()) {
+          diagnostic::error("failed to decompress: {}",
+                            result->status().ToString())
+            .emit(ctrl.diagnostics());
+          co_return;
+        }
+        if ((*result)->size() > 0) {
+          co_yield result->MoveValueUnsafe();
+        }
+      }
+      if (not splitting) {
+        pool = nullptr;
+      }
+      if (stalled and (splitting or in_buffer.size() == 0)) {
         co_yield {};
         continue;
       }
-      in_buffer.consume(std::move(bytes));
-      while (in_buffer.size() > 0) {
+      while (not splitting and in_buffer.size() > 0) {
         auto result = decompressor.ValueUnsafe()->Decompress(
           in_buffer.size(), in_buffer.data(),
           detail::narrow_cast<int64_t>(out_buffer.size()), out_buffer.data());
@@ -331,6 +693,32 @@ public:
           }
         }
       }
+      if (stalled) {
+        co_yield {};
+      }
+    }
+    if (splitting) {
+      // Whatever remains is a truncated frame, which we decompress as far as
+      // possible.
+      if (in_buffer.size() > 0) {
+        submit(in_buffer.take_front_n(in_buffer.size()));
+      }
+      while (pool) {
+        auto result = pool->next(true);
+        if (not result) {
+          break;
+        }
+        if (not result->ok()) {
+          diagnostic::error("failed to decompress: {}",
+                            result->status().ToString())
+            .emit(ctrl.diagnostics());
+          co_return;
+        }
+        if ((*result)->size() > 0) {
+          co_yield result->MoveValueUnsafe();
+        }
+      }
+      co_return;
     }
     if (not decompressor.ValueUnsafe()->IsFinished()) {
       TENZIR_VERBOSE(
@@ -373,7 +761,31 @@ public:
     auto args = operator_args{};
     parser.add(args.type, "<type>");
     parser.add("--level", args.level, "<level>");
+    parser.add("--block-size", args.block_size, "<bytes>");
+    parser.add("--threads", args.threads, "<n>");
     parser.parse(p);
+    if (args.block_size and args.block_size->inner == 0) {
+      diagnostic::error("block size must not be 0")
+        .primary(args.block_size->source)
+        .throw_();
+    }
+    if (args.threads and args.threads->inner == 0) {
+      diagnostic::error("number of threads must not be 0")
+        .primary(args.threads->source)
+        .throw_();
+    }
+    // Concatenated Brotli streams are not a valid Brotli stream, so we cannot
+    // emit independent frames for it.
+    if (args.block_size or args.threads) {
+      const auto compression_type
+        = arrow::util::Codec::GetCompressionType(args.type.inner);
+      if (compression_type.ok()
+          and *compression_type == arrow::Compression::BROTLI) {
+        diagnostic::error("`brotli` does not support independent frames")
+          .primary(args.type.source)
+          .throw_();
+      }
+    }
     return std::make_unique<compress_operator>(std::move(args));
   }
 };
@@ -391,7 +803,13 @@ public:
                                       "transformations/decompress"};
     auto args = operator_args{};
     parser.add(args.type, "<type>");
+    parser.add("--threads", args.threads, "<n>");
     parser.parse(p);
+    if (args.threads and args.threads->inner == 0) {
+      diagnostic::error("number of threads must not be 0")
+        .primary(args.threads->source)
+        .throw_();
+    }
     return std::make_unique<decompress_operator>(std::move(args));
   }
 };
@@ -34,8 +34,9 @@ public:
   operator()(generator<table_slice> input, operator_control_plane& ctrl) const
     -> generator<table_slice> {
     auto seen = std::unordered_set<type>{};
+    auto flatten = flattener{separator_};
     for (auto&& slice : input) {
-      auto result = tenzir::flatten(slice, separator_);
+      auto result = flatten(slice);
       // We only warn once per schema that we had to rename a set of fields.
       if (seen.insert(slice.schema()).second
           && not result.renamed_fields.empty()) {
@@ -7,6 +7,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/argument_parser.hpp>
+#include <tenzir/blocking_control_plane.hpp>
 #include <tenzir/diagnostics.hpp>
 #include <tenzir/parser_interface.hpp>
 #include <tenzir/plugin.hpp>
@@ -26,14 +27,15 @@ public:
 
   auto operator()(operator_control_plane& ctrl) const
     -> caf::expected<generator<chunk_ptr>> {
-    if (auto result = loader_->instantiate(ctrl)) {
-      return std::move(*result);
+    // Loaders may block arbitrarily long, so we advance them on the blocking
+    // executor instead of giving every load operator a thread of its own.
+    auto blocking_ctrl = std::make_shared<blocking_control_plane>(ctrl);
+    auto result = loader_->instantiate(*blocking_ctrl);
+    blocking_ctrl->flush(ctrl);
+    if (not result) {
+      return caf::make_error(ec::silent, "could not instantiate loader");
     }
-    return caf::make_error(ec::silent, "could not instantiate loader");
-  }
-
-  auto detached() const -> bool override {
-    return true;
+    return advance_blocking(std::move(blocking_ctrl), std::move(*result), ctrl);
   }
 
   auto name() const -> std::string override {
@@ -15,8 +15,7 @@
 #include <tenzir/detail/inspection_common.hpp>
 #include <tenzir/detail/narrow.hpp>
 #include <tenzir/error.hpp>
-#include <tenzir/hash/default_hash.hpp>
-#include <tenzir/hash/hash_append.hpp>
+#include <tenzir/hash/hash_array.hpp>
 #include <tenzir/optional.hpp>
 #include <tenzir/plugin.hpp>
 #include <tenzir/table_slice_builder.hpp>
@@ -73,23 +72,8 @@ public:
                                std::shared_ptr<arrow::Array> array) noexcept
       -> std::vector<
         std::pair<struct record_type::field, std::shared_ptr<arrow::Array>>> {
-      auto hashes_builder
-        = string_type::make_arrow_builder(arrow::default_memory_pool());
-      if (config_.salt) {
-        for (const auto& value : values(field.type, *array)) {
-          const auto digest = tenzir::hash(value, *config_.salt);
-          const auto append_result
-            = hashes_builder->Append(fmt::format("{:x}", digest));
-          TENZIR_ASSERT(append_result.ok(), append_result.ToString().c_str());
-        }
-      } else {
-        for (const auto& value : values(field.type, *array)) {
-          const auto digest = tenzir::hash(value);
-          const auto append_result
-            = hashes_builder->Append(fmt::format("{:x}", digest));
-          TENZIR_ASSERT(append_result.ok(), append_result.ToString().c_str());
-        }
-      }
+      const auto digests = hash_array(field.type, *array, config_.salt);
+      auto hashes = make_hex_digest_array(digests);
       return {
         {
           std::move(field),
@@ -100,7 +84,7 @@ public:
             config_.out,
             string_type{},
           },
-          hashes_builder->Finish().ValueOrDie(),
+          std::move(hashes),
         },
       };
     };
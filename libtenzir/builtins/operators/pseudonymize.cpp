@@ -60,18 +60,24 @@ public:
   auto initialize(const type& schema, operator_control_plane&) const
     -> caf::expected<state_type> override {
     std::vector<indexed_transformation> transformations;
-    auto transformation = [&](struct record_type::field field,
-                              std::shared_ptr<arrow::Array> array) noexcept
+    // All fields of a schema share one pseudonymizer, so that addresses that
+    // share a prefix with previously seen addresses get pseudonymized faster.
+    auto pseudonymizer
+      = std::make_shared<tenzir::ip_pseudonymizer>(config_.seed_bytes);
+    auto transformation = [pseudonymizer](
+                            struct record_type::field field,
+                            std::shared_ptr<arrow::Array> array) noexcept
       -> std::vector<
         std::pair<struct record_type::field, std::shared_ptr<arrow::Array>>> {
       auto builder = ip_type::make_arrow_builder(arrow::default_memory_pool());
+      auto reserve_status = builder->Reserve(array->length());
+      TENZIR_ASSERT(reserve_status.ok(), reserve_status.ToString().c_str());
       auto address_view_generator
         = values(ip_type{}, caf::get<type_to_arrow_array_t<ip_type>>(*array));
       for (const auto& address : address_view_generator) {
         auto append_status = arrow::Status{};
         if (address) {
-          auto pseudonymized_address
-            = tenzir::ip::pseudonymize(*address, config_.seed_bytes);
+          auto pseudonymized_address = (*pseudonymizer)(*address);
           append_status
             = append_builder(ip_type{}, *builder, pseudonymized_address);
         } else {
@@ -94,7 +100,7 @@ public:
                        field_name, index_type.name());
           continue;
         }
-        transformations.push_back({index, std::move(transformation)});
+        transformations.push_back({index, transformation});
       }
     }
     std::sort(transformations.begin(), transformations.end());
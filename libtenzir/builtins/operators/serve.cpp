@@ -21,6 +21,11 @@
 // The /serve endpoint allows for fetching events from a pipeline that ended in
 // the serve operator incrementally.
 //
+// The endpoint optionally responds with Arrow IPC instead of JSON, and can
+// stream all batches as chunks of a single response. For the latter, the web
+// server issues the follow-up requests with the next continuation token on
+// behalf of the client whenever the client received a chunk.
+//
 // SERVE-MANAGER COMPONENT
 //
 // The serve-manager component is invisible to the user. It is responsible for
@@ -65,6 +70,8 @@
 #include <tenzir/status.hpp>
 #include <tenzir/table_slice.hpp>
 
+#include <arrow/io/memory.h>
+#include <arrow/ipc/writer.h>
 #include <arrow/record_batch.h>
 #include <caf/stateful_actor.hpp>
 #include <caf/typed_event_based_actor.hpp>
@@ -107,6 +114,15 @@ constexpr auto SPEC_V0 = R"_(
                 example: "100ms"
                 default: "100ms"
                 description: The maximum amount of time spent on the request. Hitting the timeout is not an error. The timeout must not be greater than 5 seconds.
+              format:
+                type: string
+                enum: [json, arrow]
+                default: json
+                description: The format of the response. With `arrow`, the response body is a sequence of Arrow IPC streams, one per consecutive run of events with the same schema, and the next continuation token is in the `X-Tenzir-Continuation-Token` header.
+              stream:
+                type: boolean
+                default: false
+                description: Keep the connection open and push every batch of events as a separate chunk of a chunked response as soon as it is available, until the pipeline completes. The `max_events` and `timeout` parameters apply to every chunk. With the `json` format, every chunk is a single JSON document terminated by a newline.
     responses:
       200:
         description: Success.
@@ -196,11 +212,19 @@ using serve_manager_actor = typed_actor_fwd<
   // Conform to the protocol of the COMPONENT PLUGIN actor interface.
   ::extend_with<component_plugin_actor>::unwrap;
 
+/// The format of the /serve response body.
+enum class serve_format {
+  json,
+  arrow,
+};
+
 struct serve_request {
   std::string serve_id = {};
   std::string continuation_token = {};
   uint64_t limit = defaults::api::serve::max_events;
   duration timeout = defaults::api::serve::timeout;
+  serve_format format = serve_format::json;
+  bool stream = false;
 };
 
 /// A single serve operator as observed by the serve-manager.
@@ -620,6 +644,35 @@ struct serve_handler_state {
       }
       result.timeout = **timeout;
     }
+    auto format = try_get<std::string>(params, "format");
+    if (not format) {
+      return parse_error{
+        .message = "failed to read format parameter",
+        .detail = caf::make_error(ec::invalid_argument,
+                                  fmt::format("{}; got params {}",
+                                              format.error(), params))};
+    }
+    if (*format) {
+      if (**format == "arrow") {
+        result.format = serve_format::arrow;
+      } else if (**format != "json") {
+        return parse_error{
+          .message = "format must be either json or arrow",
+          .detail = caf::make_error(ec::invalid_argument,
+                                    fmt::format("got format {}", **format))};
+      }
+    }
+    auto stream = try_get<bool>(params, "stream");
+    if (not stream) {
+      return parse_error{
+        .message = "failed to read stream parameter",
+        .detail = caf::make_error(ec::invalid_argument,
+                                  fmt::format("{}; got params {}",
+                                              stream.error(), params))};
+    }
+    if (*stream) {
+      result.stream = **stream;
+    }
     return result;
   }
 
@@ -681,6 +734,89 @@ struct serve_handler_state {
     return result;
   }
 
+  /// Writes the results as a sequence of Arrow IPC streams, starting a new
+  /// stream whenever the schema changes. This avoids rendering every event as
+  /// JSON for clients that can consume Arrow directly.
+  static auto create_arrow_response(const std::vector<table_slice>& results)
+    -> caf::expected<std::string> {
+    auto sink = arrow::io::BufferOutputStream::Create();
+    if (not sink.ok()) {
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to create IPC output stream: "
+                                         "{}",
+                                         sink.status().ToString()));
+    }
+    auto writer = std::shared_ptr<arrow::ipc::RecordBatchWriter>{};
+    auto schema = type{};
+    for (const auto& slice : results) {
+      if (slice.rows() == 0)
+        continue;
+      const auto batch = to_record_batch(slice);
+      if (not writer or slice.schema() != schema) {
+        if (writer) {
+          if (auto status = writer->Close(); not status.ok()) {
+            return caf::make_error(ec::system_error,
+                                   fmt::format("failed to close IPC stream: "
+                                               "{}",
+                                               status.ToString()));
+          }
+        }
+        auto new_writer = arrow::ipc::MakeStreamWriter(*sink, batch->schema());
+        if (not new_writer.ok()) {
+          return caf::make_error(ec::system_error,
+                                 fmt::format("failed to create IPC stream "
+                                             "writer: {}",
+                                             new_writer.status().ToString()));
+        }
+        writer = new_writer.MoveValueUnsafe();
+        schema = slice.schema();
+      }
+      if (auto status = writer->WriteRecordBatch(*batch); not status.ok()) {
+        return caf::make_error(ec::system_error,
+                               fmt::format("failed to write record batch: {}",
+                                           status.ToString()));
+      }
+    }
+    if (writer) {
+      if (auto status = writer->Close(); not status.ok()) {
+        return caf::make_error(ec::system_error,
+                               fmt::format("failed to close IPC stream: {}",
+                                           status.ToString()));
+      }
+    }
+    auto buffer = (*sink)->Finish();
+    if (not buffer.ok()) {
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to finish IPC output stream: "
+                                         "{}",
+                                         buffer.status().ToString()));
+    }
+    return (*buffer)->ToString();
+  }
+
+  static auto make_response(const serve_request& request,
+                            const std::string& next_continuation_token,
+                            const std::vector<table_slice>& results)
+    -> rest_response {
+    if (request.format == serve_format::json) {
+      return rest_response::from_json_string(
+        create_response(next_continuation_token, results));
+    }
+    auto body = create_arrow_response(results);
+    if (not body) {
+      return rest_response::make_error(500, "failed to write Arrow IPC stream",
+                                       std::move(body.error()));
+    }
+    auto result = rest_response::from_binary(std::move(*body),
+                                             http_content_type::arrow_ipc);
+    if (not next_continuation_token.empty()
+        and next_continuation_token != FINAL_CONTINUATION_TOKEN) {
+      result.add_header("X-Tenzir-Continuation-Token",
+                        next_continuation_token);
+    }
+    return result;
+  }
+
   auto http_request(uint64_t endpoint_id, tenzir::record params) const
     -> caf::result<rest_response> {
     if (endpoint_id != SERVE_ENDPOINT_ID) {
@@ -701,10 +837,24 @@ struct serve_handler_state {
       ->request(serve_manager, caf::infinite, atom::get_v, request.serve_id,
                 request.continuation_token, request.limit, request.timeout)
       .then(
-        [rp](const std::tuple<std::string, std::vector<table_slice>>&
-               result) mutable {
-          rp.deliver(rest_response::from_json_string(
-            create_response(std::get<0>(result), std::get<1>(result))));
+        [rp, request, params = std::move(params)](
+          const std::tuple<std::string, std::vector<table_slice>>&
+            result) mutable {
+          const auto& [next_continuation_token, results] = result;
+          auto response
+            = make_response(request, next_continuation_token, results);
+          // For streamed responses, the web server requests the next batch
+          // with the next continuation token on its own once the client
+          // received this one. This leaves throttling of the serve operator
+          // to the serve-manager, just like for individual requests.
+          const auto done = next_continuation_token.empty()
+                            or next_continuation_token
+                                 == FINAL_CONTINUATION_TOKEN;
+          if (request.stream and not done and not response.is_error()) {
+            params["continuation_token"] = next_continuation_token;
+            response.set_follow_up(std::move(params));
+          }
+          rp.deliver(std::move(response));
         },
         [rp](caf::error& err) mutable {
           // TODO: Use a struct with distinct fields for user-facing
@@ -892,6 +1042,8 @@ public:
           {"continuation_token", string_type{}},
           {"max_events", uint64_type{}},
           {"timeout", duration_type{}},
+          {"format", string_type{}},
+          {"stream", bool_type{}},
         },
         .version = api_version::v0,
         .content_type = http_content_type::json,
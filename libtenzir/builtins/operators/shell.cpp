@@ -11,6 +11,7 @@
 #include <tenzir/chunk.hpp>
 #include <tenzir/concept/parseable/string/quoted_string.hpp>
 #include <tenzir/concept/parseable/tenzir/pipeline.hpp>
+#include <tenzir/detail/posix.hpp>
 #include <tenzir/error.hpp>
 #include <tenzir/logger.hpp>
 #include <tenzir/pipeline.hpp>
@@ -21,9 +22,15 @@
 #include <boost/process.hpp>
 #include <caf/detail/scope_guard.hpp>
 
-#include <mutex>
-#include <queue>
-#include <thread>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <optional>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 namespace bp = boost::process;
 
@@ -31,13 +38,30 @@ namespace tenzir::plugins::shell {
 namespace {
 
 using namespace tenzir::binary_byte_literals;
+using namespace std::chrono_literals;
+
+/// The size of the blocks that we read the child's stdout into. Tools with a
+/// high throughput fill large blocks in a single read, which reduces both the
+/// number of system calls and the number of yielded chunks.
+constexpr auto block_size = size_t{1_MiB};
+
+/// The minimum space that must be left in the current block for reading more
+/// output into it.
+constexpr auto min_read_size = size_t{64_KiB};
+
+/// The capacity that we request for the pipes to and from the child, which
+/// reduces the number of context switches between the operator and the child.
+constexpr auto pipe_capacity = int{1_MiB};
 
-/// The block size when reading from the child's stdin.
-constexpr auto block_size = 16_KiB;
+/// The maximum time to wait for the child before yielding control back to the
+/// executor.
+constexpr auto poll_timeout = 100ms;
 
 enum class stdin_mode { none, inherit, pipe };
 
-/// Wraps the logic for interacting with a child's stdin and stdout.
+/// Wraps the logic for interacting with a child's stdin and stdout. All I/O
+/// with the child is non-blocking, so that a single thread can feed the child's
+/// stdin and drain its stdout at the same time without deadlocking.
 class child {
 public:
   static auto make(std::string command, stdin_mode mode)
@@ -83,28 +107,98 @@ public:
     } catch (const bp::process_error& e) {
       return caf::make_error(ec::filesystem_error, e.what());
     }
+    if (auto err = result.prepare_pipe(result.stdout_.native_source()))
+      return err;
+    if (mode == stdin_mode::pipe) {
+      if (auto err = result.prepare_pipe(result.stdin_.native_sink()))
+        return err;
+    }
     return result;
   }
 
-  auto read(std::span<std::byte> buffer) -> caf::expected<size_t> {
+  /// Reads from the child's stdout without blocking.
+  /// @returns The number of bytes read, 0 on EOF, or `std::nullopt` if no
+  /// data is available right now.
+  auto try_read(std::span<std::byte> buffer)
+    -> caf::expected<std::optional<size_t>> {
     TENZIR_ASSERT(!buffer.empty());
-    TENZIR_DEBUG("trying to read {} bytes", buffer.size());
-    auto* data = reinterpret_cast<char*>(buffer.data());
-    auto size = detail::narrow<int>(buffer.size());
-    auto bytes_read = stdout_.read(data, size);
-    TENZIR_DEBUG("read {} bytes", bytes_read);
-    return detail::narrow<size_t>(bytes_read);
+    while (true) {
+      auto bytes_read
+        = ::read(stdout_.native_source(), buffer.data(), buffer.size());
+      if (bytes_read >= 0)
+        return detail::narrow<size_t>(bytes_read);
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN or errno == EWOULDBLOCK)
+        return std::nullopt;
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to read from child's stdout: "
+                                         "{}",
+                                         detail::describe_errno()));
+    }
   }
 
-  auto write(std::span<const std::byte> buffer) -> caf::error {
+  /// Writes to the child's stdin without blocking.
+  /// @returns The number of bytes written, which is 0 if the pipe is full, or
+  /// `std::nullopt` if the child closed its stdin.
+  auto try_write(std::span<const std::byte> buffer)
+    -> caf::expected<std::optional<size_t>> {
     TENZIR_ASSERT(!buffer.empty());
-    TENZIR_DEBUG("writing {} bytes to child's stdin", buffer.size());
-    const auto* data = reinterpret_cast<const char*>(buffer.data());
-    auto size = detail::narrow_cast<std::streamsize>(buffer.size());
-    if (not stdin_.write(data, size))
-      return caf::make_error(ec::unspecified,
-                             "failed to write into child's stdin");
-    return caf::none;
+    // A child that stops reading its stdin early, e.g., `head -n 10`, is not
+    // an error. We block SIGPIPE for the duration of the write so that this
+    // surfaces as EPIPE instead of terminating the process.
+    auto blocked = sigset_t{};
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGPIPE);
+    auto previous = sigset_t{};
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    auto restore = caf::detail::make_scope_guard([&] {
+      pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    });
+    while (true) {
+      auto written
+        = ::write(stdin_.native_sink(), buffer.data(), buffer.size());
+      if (written >= 0)
+        return detail::narrow<size_t>(written);
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN or errno == EWOULDBLOCK)
+        return size_t{0};
+      if (errno == EPIPE) {
+        // Consume the pending signal before unblocking it again.
+        auto timeout = timespec{};
+        sigtimedwait(&blocked, nullptr, &timeout);
+        return std::nullopt;
+      }
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to write into child's stdin: "
+                                         "{}",
+                                         detail::describe_errno()));
+    }
+  }
+
+  /// Waits until the child's stdout is readable or, if requested, its stdin
+  /// is writable.
+  /// @returns Whether the child is ready before the timeout expired.
+  auto wait_for_io(bool want_read, bool want_write,
+                   std::chrono::milliseconds timeout) -> caf::expected<bool> {
+    auto fds = std::array<pollfd, 2>{};
+    auto num_fds = nfds_t{0};
+    if (want_read)
+      fds[num_fds++] = {stdout_.native_source(), POLLIN, 0};
+    if (want_write)
+      fds[num_fds++] = {stdin_.native_sink(), POLLOUT, 0};
+    TENZIR_ASSERT(num_fds > 0);
+    auto result = ::poll(fds.data(), num_fds,
+                         detail::narrow_cast<int>(timeout.count()));
+    if (result == -1) {
+      if (errno == EINTR)
+        return false;
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to poll child's pipes: {}",
+                                         detail::describe_errno()));
+    }
+    return result > 0;
   }
 
   void close_stdin() {
@@ -142,12 +236,88 @@ private:
     TENZIR_ASSERT(!command_.empty());
   }
 
+  /// Switches our end of a pipe to non-blocking mode, and enlarges the pipe
+  /// where the platform supports it.
+  static auto prepare_pipe(int fd) -> caf::error {
+    auto flags = ::fcntl(fd, F_GETFL);
+    if (flags == -1 or ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to make pipe non-blocking: "
+                                         "{}",
+                                         detail::describe_errno()));
+    }
+#ifdef F_SETPIPE_SZ
+    // This fails for unprivileged users if the capacity exceeds
+    // /proc/sys/fs/pipe-max-size, in which case the default capacity remains.
+    if (::fcntl(fd, F_SETPIPE_SZ, pipe_capacity) == -1) {
+      TENZIR_DEBUG("failed to resize pipe: {}", detail::describe_errno());
+    }
+#endif
+    return {};
+  }
+
   std::string command_;
   bp::child child_;
   bp::pipe stdout_;
   bp::pipe stdin_;
 };
 
+/// Collects the output of the child in large blocks. Every read appends to the
+/// current block, and the chunks handed out are views into the block that
+/// share its ownership, so output is never copied. A block is released once
+/// all chunks that point into it are gone.
+class output_buffer {
+public:
+  /// Reads all output that is currently available, up to the end of the
+  /// current block.
+  /// @returns Whether the child's stdout reached EOF.
+  auto fill(child& c) -> caf::expected<bool> {
+    while (end_ < block_size) {
+      auto bytes_read
+        = c.try_read(std::span{block_.get() + end_, block_size - end_});
+      if (not bytes_read)
+        return std::move(bytes_read.error());
+      if (not *bytes_read)
+        return false;
+      if (**bytes_read == 0)
+        return true;
+      end_ += **bytes_read;
+    }
+    return false;
+  }
+
+  [[nodiscard]] auto empty() const -> bool {
+    return begin_ == end_;
+  }
+
+  /// Hands out the output collected since the last call as a chunk.
+  auto take() -> chunk_ptr {
+    TENZIR_ASSERT(not empty());
+    auto result = chunk::make(block_.get() + begin_, end_ - begin_,
+                              [block = block_]() noexcept {
+                                static_cast<void>(block);
+                              });
+    begin_ = end_;
+    // Start a new block once the current one has too little space left for
+    // the next read to be worthwhile.
+    if (block_size - end_ < min_read_size) {
+      block_ = make_block();
+      begin_ = 0;
+      end_ = 0;
+    }
+    return result;
+  }
+
+private:
+  static auto make_block() -> std::shared_ptr<std::byte[]> {
+    return std::shared_ptr<std::byte[]>{new std::byte[block_size]};
+  }
+
+  std::shared_ptr<std::byte[]> block_ = make_block();
+  size_t begin_ = 0;
+  size_t end_ = 0;
+};
+
 class shell_operator final : public crtp_operator<shell_operator> {
 public:
   shell_operator() = default;
@@ -162,23 +332,30 @@ public:
       ctrl.abort(child.error());
       co_return;
     }
-    // We yield once because reading below is blocking, but we want to
-    // directly signal that our initialization is complete.
+    // We yield once because waiting for the child below is blocking, but we
+    // want to directly signal that our initialization is complete.
     co_yield {};
-    auto buffer = std::vector<char>(block_size);
+    auto output = output_buffer{};
     while (true) {
-      auto bytes_read = child->read(as_writeable_bytes(buffer));
-      if (not bytes_read) {
-        ctrl.abort(std::move(bytes_read.error()));
+      auto eof = output.fill(*child);
+      if (not eof) {
+        ctrl.abort(std::move(eof.error()));
         co_return;
       }
-      if (*bytes_read == 0) {
-        // Reading 0 bytes indicates EOF.
+      if (not output.empty()) {
+        auto chk = output.take();
+        TENZIR_DEBUG("yielding chunk with {} bytes", chk->size());
+        co_yield std::move(chk);
+      }
+      if (*eof)
         break;
+      auto ready = child->wait_for_io(true, false, poll_timeout);
+      if (not ready) {
+        ctrl.abort(std::move(ready.error()));
+        co_return;
       }
-      auto chk = chunk::copy(std::span{buffer.data(), *bytes_read});
-      TENZIR_DEBUG("yielding chunk with {} bytes", chk->size());
-      co_yield chk;
+      if (not *ready)
+        co_yield {};
     }
     if (auto error = child->wait()) {
       ctrl.abort(std::move(error));
@@ -193,84 +370,99 @@ public:
       ctrl.abort(child.error());
       co_return;
     }
-    // Read from child in separate thread because coroutine-based async
-    // I/O is not (yet) feasible. The thread writes the chunks into a
-    // queue such that to this coroutine can yield them.
-    auto chunks = std::queue<chunk_ptr>{};
-    auto chunks_mutex = std::mutex{};
-    auto thread = std::thread([&child, &chunks, &chunks_mutex, &ctrl] {
-      auto buffer = std::vector<char>(block_size);
-      while (true) {
-        auto bytes_read = child->read(as_writeable_bytes(buffer));
-        if (not bytes_read) {
-          ctrl.abort(std::move(bytes_read.error()));
-          return;
-        }
-        if (*bytes_read == 0) {
-          // Reading 0 bytes indicates EOF.
-          break;
-        }
-        auto chk = chunk::copy(std::span{buffer.data(), *bytes_read});
-        auto lock = std::lock_guard{chunks_mutex};
-        chunks.push(std::move(chk));
-      }
+    // Coroutines require RAII-style exit handling.
+    auto unplanned_exit = caf::detail::make_scope_guard([&] {
+      child->terminate();
     });
-    {
-      // Coroutines require RAII-style exit handling.
-      auto unplanned_exit = caf::detail::make_scope_guard([&] {
-        child->terminate();
-        TENZIR_DEBUG("joining thread");
-        thread.join();
-      });
-      // Loop over input chunks.
-      for (auto&& chunk : input) {
-        auto stalled = not chunk or chunk->size() == 0;
-        if (not stalled) {
-          // Pass operator input to the child's stdin.
-          // TODO: If the reading end of the pipe to the child's stdin is
-          // already closed, this will generate a SIGPIPE.
-          if (auto err = child->write(as_bytes(*chunk))) {
-            ctrl.abort(err);
+    // We feed the child's stdin and drain its stdout in the same loop. We only
+    // pull the next input chunk once the child accepted the previous one, and
+    // we only read more output once the previous output was consumed, which
+    // propagates backpressure in both directions.
+    auto output = output_buffer{};
+    auto stdin_open = true;
+    auto stdout_eof = false;
+    auto drain = [&]() -> caf::expected<std::optional<chunk_ptr>> {
+      if (stdout_eof)
+        return std::nullopt;
+      auto eof = output.fill(*child);
+      if (not eof)
+        return std::move(eof.error());
+      stdout_eof = *eof;
+      if (output.empty())
+        return std::nullopt;
+      return output.take();
+    };
+    for (auto&& chunk : input) {
+      auto stalled = not chunk or chunk->size() == 0;
+      auto pending = stalled ? std::span<const std::byte>{} : as_bytes(*chunk);
+      auto yielded = false;
+      while (true) {
+        if (stdin_open and not pending.empty()) {
+          auto written = child->try_write(pending);
+          if (not written) {
+            ctrl.abort(std::move(written.error()));
             co_return;
           }
-        }
-        // Try yielding so far accumulated child output.
-        auto lock = std::unique_lock{chunks_mutex, std::try_to_lock};
-        if (lock.owns_lock()) {
-          auto i = size_t{0};
-          auto total = chunks.size();
-          while (not chunks.empty()) {
-            auto chk = chunks.front();
-            TENZIR_DEBUG("yielding chunk {}/{} with {} bytes", ++i, total,
-                         chk->size());
-            co_yield std::move(chk);
-            chunks.pop();
-          }
-          if (stalled) {
-            co_yield {};
+          if (not *written) {
+            TENZIR_DEBUG("child closed its stdin; discarding further input");
+            stdin_open = false;
+          } else {
+            pending = pending.subspan(**written);
           }
-        } else {
+        }
+        auto chk = drain();
+        if (not chk) {
+          ctrl.abort(std::move(chk.error()));
+          co_return;
+        }
+        if (*chk) {
+          TENZIR_DEBUG("yielding chunk with {} bytes", (**chk)->size());
+          co_yield std::move(**chk);
+          yielded = true;
+          continue;
+        }
+        if (not stdin_open or pending.empty())
+          break;
+        // The child's stdin is full and there is no output yet, so we wait
+        // until the child made progress.
+        auto ready = child->wait_for_io(not stdout_eof, true, poll_timeout);
+        if (not ready) {
+          ctrl.abort(std::move(ready.error()));
+          co_return;
+        }
+        if (not *ready) {
           co_yield {};
+          yielded = true;
         }
       }
-      unplanned_exit.disable();
-      child->close_stdin();
-      thread.join();
-      if (auto error = child->wait()) {
-        ctrl.abort(std::move(error));
+      if (stalled and not yielded)
+        co_yield {};
+    }
+    child->close_stdin();
+    while (not stdout_eof) {
+      auto chk = drain();
+      if (not chk) {
+        ctrl.abort(std::move(chk.error()));
         co_return;
       }
+      if (*chk) {
+        TENZIR_DEBUG("yielding chunk with {} bytes", (**chk)->size());
+        co_yield std::move(**chk);
+        continue;
+      }
+      if (stdout_eof)
+        break;
+      auto ready = child->wait_for_io(true, false, poll_timeout);
+      if (not ready) {
+        ctrl.abort(std::move(ready.error()));
+        co_return;
+      }
+      if (not *ready)
+        co_yield {};
     }
-    // Yield all accumulated child output.
-    auto lock = std::lock_guard{chunks_mutex};
-    auto i = size_t{0};
-    auto total = chunks.size();
-    while (not chunks.empty()) {
-      auto& chk = chunks.front();
-      TENZIR_DEBUG("yielding chunk {}/{} with {} bytes", ++i, total,
-                   chk->size());
-      co_yield std::move(chk);
-      chunks.pop();
+    unplanned_exit.disable();
+    if (auto error = child->wait()) {
+      ctrl.abort(std::move(error));
     }
   }
 
@@ -15,7 +15,9 @@
 #include <tenzir/concept/parseable/tenzir/time.hpp>
 #include <tenzir/detail/zip_iterator.hpp>
 #include <tenzir/error.hpp>
+#include <tenzir/hash/hash.hpp>
 #include <tenzir/hash/hash_append.hpp>
+#include <tenzir/hash/hash_array.hpp>
 #include <tenzir/operator_control_plane.hpp>
 #include <tenzir/parser_interface.hpp>
 #include <tenzir/plugin.hpp>
@@ -29,6 +31,7 @@
 #include <tsl/robin_map.h>
 
 #include <algorithm>
+#include <map>
 #include <utility>
 
 namespace tenzir::plugins::summarize {
@@ -121,6 +124,31 @@ struct configuration {
     }
   };
 
+  /// The configuration of time-based windows.
+  struct window_configuration {
+    /// The length of every window.
+    duration size = {};
+
+    /// The distance between the starts of consecutive windows. Equal to the
+    /// size for tumbling windows, and a divisor of the size for sliding
+    /// windows.
+    duration slide = {};
+
+    /// Unresolved extractor for the event time, or ingest time if not set.
+    std::optional<std::string> time_field = {};
+
+    /// How far the watermark lags behind the latest event time, i.e., for how
+    /// long windows accept out-of-order events after their end.
+    duration delay = {};
+
+    friend auto inspect(auto& f, window_configuration& x) -> bool {
+      return f.object(x).fields(f.field("size", x.size),
+                                f.field("slide", x.slide),
+                                f.field("time_field", x.time_field),
+                                f.field("delay", x.delay));
+    }
+  };
+
   /// Unresolved group-by extractors.
   std::vector<std::string> group_by_extractors = {};
 
@@ -130,11 +158,16 @@ struct configuration {
   /// Configuration for aggregation columns.
   std::vector<aggregation> aggregations = {};
 
+  /// Configuration for windowed aggregation, which emits results per window
+  /// instead of once at the end of the input.
+  std::optional<window_configuration> window = {};
+
   friend auto inspect(auto& f, configuration& x) -> bool {
     return f.object(x).fields(f.field("group_by_extractors",
                                       x.group_by_extractors),
                               f.field("time_resolution", x.time_resolution),
-                              f.field("aggregations", x.aggregations));
+                              f.field("aggregations", x.aggregations),
+                              f.field("window", x.window));
   }
 };
 
@@ -161,19 +194,21 @@ struct group_by_key_view : std::vector<data_view> {
 };
 
 /// The hash functor for enabling use of *group_by_key* as a key in unordered
-/// map data structures with transparent lookup.
+/// map data structures with transparent lookup. The hash of a key combines the
+/// digests of its values, so that lookups can reuse digests computed for entire
+/// columns with `hash_array`.
 struct group_by_key_hash {
   size_t operator()(const group_by_key& x) const noexcept {
     auto hasher = xxh64{};
     for (const auto& value : x)
-      hash_append(hasher, make_view(value));
+      hash_append(hasher, hash(make_view(value)));
     return hasher.finish();
   }
 
   size_t operator()(const group_by_key_view& x) const noexcept {
     auto hasher = xxh64{};
     for (const auto& value : x)
-      hash_append(hasher, value);
+      hash_append(hasher, hash(value));
     return hasher.finish();
   }
 };
@@ -361,13 +396,28 @@ public:
     auto batch = to_record_batch(slice);
     auto group_by_arrays = bound.make_group_by_arrays(*batch, config);
     auto aggregation_arrays = bound.make_aggregation_arrays(*batch);
+    // Hash all group-by columns up front. Missing columns are all null.
+    const auto null_digest = hash(data_view{});
+    auto group_by_digests = std::vector<std::vector<array_digest>>{};
+    group_by_digests.reserve(bound.group_by_columns.size());
+    for (size_t col = 0; col < bound.group_by_columns.size(); ++col) {
+      if (bound.group_by_columns[col]) {
+        TENZIR_ASSERT(group_by_arrays[col].has_value());
+        group_by_digests.push_back(hash_array(
+          bound.group_by_columns[col]->type, **group_by_arrays[col]));
+      } else {
+        group_by_digests.emplace_back(batch->num_rows(), null_digest);
+      }
+    }
     // A key view used to determine the bucket for a single row.
     auto reusable_key_view = group_by_key_view{};
     reusable_key_view.resize(bound.group_by_columns.size(), {});
     // Returns the group that the given row belongs to, creating new groups
     // whenever necessary.
     auto find_or_create_bucket = [&](int64_t row) -> bucket* {
+      auto hasher = xxh64{};
       for (size_t col = 0; col < bound.group_by_columns.size(); ++col) {
+        hash_append(hasher, group_by_digests[col][row]);
         if (bound.group_by_columns[col]) {
           TENZIR_ASSERT(group_by_arrays[col].has_value());
           reusable_key_view[col] = value_at(bound.group_by_columns[col]->type,
@@ -377,7 +427,9 @@ public:
           reusable_key_view[col] = caf::none;
         }
       }
-      if (auto it = buckets.find(reusable_key_view); it != buckets.end()) {
+      const auto digest = hasher.finish();
+      if (auto it = buckets.find(reusable_key_view, digest);
+          it != buckets.end()) {
         auto&& bucket = *it->second;
         // Check that the group-by values also have matching types.
         for (auto [existing, other] :
@@ -536,8 +588,13 @@ public:
   }
 
   /// Returns the summarization results after the input is done.
-  auto finish(
-    const configuration& config) && -> generator<caf::expected<table_slice>> {
+  /// @param config The configuration of the operator.
+  /// @param window The bounds of the window that this aggregation belongs to,
+  /// which get prepended as `window_start` and `window_end` fields.
+  auto finish(const configuration& config,
+              std::optional<std::pair<time, time>> window
+              = {}) && -> generator<caf::expected<table_slice>> {
+    const auto window_fields = window ? size_t{2} : size_t{0};
     // Most summarizations yield events with equal output schemas. Hence, we
     // first "group the groups" by their output schema, and then create one
     // builder with potentially multiple rows for each output schema.
@@ -550,8 +607,12 @@ public:
       // associated column was not present in the input schema. This is because
       // we have to pick a type for the `null` values.
       auto fields = std::vector<record_type::field_view>{};
-      fields.reserve(config.group_by_extractors.size()
+      fields.reserve(window_fields + config.group_by_extractors.size()
                      + config.aggregations.size());
+      if (window) {
+        fields.emplace_back("window_start", type{time_type{}});
+        fields.emplace_back("window_end", type{time_type{}});
+      }
       for (auto&& [extractor, group] :
            zip_equal(config.group_by_extractors, bucket->group_by_types)) {
         // Since there is no `null` type, we use `string` as a fallback here.
@@ -583,10 +644,28 @@ public:
                                                status.ToString()));
           co_return;
         }
+        // Assign the window bounds.
+        if (window) {
+          for (auto [col, bound] : {std::pair{0, window->first},
+                                    std::pair{1, window->second}}) {
+            status = append_builder(type{time_type{}},
+                                    *builder->field_builder(col),
+                                    data_view{bound});
+            if (!status.ok()) {
+              co_yield caf::make_error(
+                ec::system_error, fmt::format("failed to append window "
+                                              "bound: {}",
+                                              status.ToString()));
+              co_return;
+            }
+          }
+        }
         // Assign data of group-by fields.
         for (auto i = size_t{0}; i < group.size(); ++i) {
-          auto col = detail::narrow<int>(i);
-          auto ty = caf::get<record_type>(output_schema).field(i).type;
+          auto col = detail::narrow<int>(window_fields + i);
+          auto ty = caf::get<record_type>(output_schema)
+                      .field(window_fields + i)
+                      .type;
           status = append_builder(ty, *builder->field_builder(col),
                                   make_data_view(group[i]));
           if (!status.ok()) {
@@ -598,7 +677,7 @@ public:
         }
         // Assign data of aggregations.
         for (auto i = size_t{0}; i < bucket->aggregations.size(); ++i) {
-          auto col = detail::narrow<int>(group.size() + i);
+          auto col = detail::narrow<int>(window_fields + group.size() + i);
           if (bucket->aggregations[i].is_active()) {
             auto& func = bucket->aggregations[i].get_active();
             auto output_type = func->output_type();
@@ -740,6 +819,190 @@ private:
     buckets = {};
 };
 
+/// Splits the input into time-based windows that each have their own
+/// aggregation, and emits every window once the watermark passes its end.
+class windowed_implementation {
+public:
+  /// Adds a slice to all open windows that its events fall into.
+  void add(const table_slice& slice, const configuration& config,
+           diagnostic_handler& diag) {
+    TENZIR_ASSERT(config.window);
+    const auto& window = *config.window;
+    if (!window.time_field) {
+      // With ingest time, all events of a slice arrive at the same time.
+      add_to_windows(slice, pane_of(time::clock::now(), window.slide), config,
+                     diag);
+      return;
+    }
+    auto it = time_columns_.find(slice.schema());
+    if (it == time_columns_.end()) {
+      it = time_columns_.try_emplace(
+        it, slice.schema(),
+        resolve_time_column(slice.schema(), *window.time_field, diag));
+    }
+    if (!it->second) {
+      // We already warned about the missing column for this schema.
+      return;
+    }
+    auto batch = to_record_batch(slice);
+    auto array = it->second->get(*batch);
+    const auto& times = caf::get<type_to_arrow_array_t<time_type>>(*array);
+    // Consecutive rows in the same pane belong to the same windows, so we add
+    // them as a single subslice.
+    auto run_begin = int64_t{0};
+    auto run_pane = std::optional<int64_t>{};
+    auto add_run = [&](int64_t run_end) {
+      if (run_pane && run_end > run_begin)
+        add_to_windows(subslice(slice, detail::narrow<size_t>(run_begin),
+                                detail::narrow<size_t>(run_end)),
+                       *run_pane, config, diag);
+    };
+    for (auto row = int64_t{0}; row < times.length(); ++row) {
+      if (times.IsNull(row)) {
+        add_run(row);
+        run_pane = std::nullopt;
+        run_begin = row + 1;
+        ++num_without_time_;
+        continue;
+      }
+      const auto event_time = value_at(time_type{}, times, row);
+      max_event_time_ = max_event_time_
+                          ? std::max(*max_event_time_, event_time)
+                          : event_time;
+      const auto pane = pane_of(event_time, window.slide);
+      if (pane == run_pane)
+        continue;
+      add_run(row);
+      run_pane = pane;
+      run_begin = row;
+    }
+    add_run(times.length());
+  }
+
+  /// Moves the watermark forward, which closes all windows that end before
+  /// it. The watermark follows the latest event time minus the configured
+  /// delay, or the wall clock for ingest time.
+  void advance(const configuration& config) {
+    TENZIR_ASSERT(config.window);
+    const auto& window = *config.window;
+    auto latest = window.time_field ? max_event_time_
+                                    : std::optional<time>{time::clock::now()};
+    if (!latest)
+      return;
+    const auto candidate = *latest - window.delay;
+    watermark_ = watermark_ ? std::max(*watermark_, candidate) : candidate;
+  }
+
+  /// Emits and evicts closed windows in the order of their start.
+  /// @param config The configuration of the operator.
+  /// @param all Whether to emit all windows, e.g., at the end of the input.
+  auto flush(const configuration& config, bool all)
+    -> generator<caf::expected<table_slice>> {
+    TENZIR_ASSERT(config.window);
+    while (!windows_.empty()) {
+      auto it = windows_.begin();
+      const auto start = it->first;
+      const auto end = start + config.window->size;
+      if (!all && (!watermark_ || end > *watermark_))
+        break;
+      auto impl = std::move(it->second);
+      windows_.erase(it);
+      for (auto&& result : std::move(impl).finish(config, std::pair{start, end}))
+        co_yield std::move(result);
+    }
+  }
+
+  /// Warns about events that did not make it into any window since the last
+  /// call.
+  void report_dropped(const configuration& config, diagnostic_handler& diag) {
+    TENZIR_ASSERT(config.window);
+    if (num_late_ > 0) {
+      diagnostic::warning("summarize dropped {} events that arrived after "
+                          "their window closed",
+                          num_late_)
+        .hint("increase the `delay` to accept more out-of-order events")
+        .emit(diag);
+      num_late_ = 0;
+    }
+    if (num_without_time_ > 0) {
+      diagnostic::warning("summarize dropped {} events where `{}` is null",
+                          num_without_time_, *config.window->time_field)
+        .emit(diag);
+      num_without_time_ = 0;
+    }
+  }
+
+private:
+  /// Returns the index of the slide-sized pane that contains a point in time.
+  static auto pane_of(time x, duration slide) -> int64_t {
+    const auto ticks = x.time_since_epoch().count();
+    const auto pane = ticks / slide.count();
+    // Round towards negative infinity for times before the epoch.
+    return ticks % slide.count() < 0 ? pane - 1 : pane;
+  }
+
+  /// Resolves the event time column for a schema.
+  static auto resolve_time_column(const type& schema, const std::string& field,
+                                  diagnostic_handler& diag)
+    -> std::optional<offset> {
+    const auto& rt = caf::get<record_type>(schema);
+    auto offset = rt.resolve_key(field);
+    if (!offset) {
+      diagnostic::warning("summarize ignores events of schema `{}` because "
+                          "the window time field `{}` does not exist",
+                          schema.name(), field)
+        .emit(diag);
+      return std::nullopt;
+    }
+    const auto type = rt.field(*offset).type;
+    if (!caf::holds_alternative<time_type>(type)) {
+      diagnostic::warning("summarize ignores events of schema `{}` because "
+                          "the window time field `{}` has type `{}` instead "
+                          "of `time`",
+                          schema.name(), field, type)
+        .emit(diag);
+      return std::nullopt;
+    }
+    return offset;
+  }
+
+  /// Adds events of the same pane to all windows that contain the pane and
+  /// are still open.
+  void add_to_windows(const table_slice& slice, int64_t pane,
+                      const configuration& config, diagnostic_handler& diag) {
+    const auto& window = *config.window;
+    const auto panes_per_window = window.size / window.slide;
+    auto added = false;
+    for (auto i = int64_t{0}; i < panes_per_window; ++i) {
+      const auto start = time{(pane - i) * window.slide};
+      // Windows that start earlier end earlier, so once we hit a closed
+      // window, all remaining ones are closed as well.
+      if (watermark_ && start + window.size <= *watermark_)
+        break;
+      windows_[start].add(slice, config, diag);
+      added = true;
+    }
+    if (!added)
+      num_late_ += slice.rows();
+  }
+
+  /// The open windows, keyed by their start.
+  std::map<time, implementation> windows_ = {};
+
+  /// We cache the offset of the event time column for each schema.
+  tsl::robin_map<type, std::optional<offset>> time_columns_ = {};
+
+  /// The latest event time seen so far.
+  std::optional<time> max_event_time_ = {};
+
+  /// Windows that end at or before the watermark are closed.
+  std::optional<time> watermark_ = {};
+
+  /// The number of dropped events since the last report.
+  uint64_t num_late_ = {};
+  uint64_t num_without_time_ = {};
+};
+
 /// The summarize pipeline operator implementation.
 class summarize_operator final : public crtp_operator<summarize_operator> {
 public:
@@ -755,6 +1018,11 @@ public:
   auto
   operator()(generator<table_slice> input, operator_control_plane& ctrl) const
     -> generator<table_slice> {
+    if (config_.window) {
+      for (auto&& output : summarize_windows(std::move(input), ctrl))
+        co_yield std::move(output);
+      co_return;
+    }
     auto impl = implementation{};
     for (auto&& slice : input) {
       if (slice.rows() == 0) {
@@ -794,6 +1062,18 @@ public:
     if (config_.time_resolution) {
       result += fmt::format(" resolution {}", *config_.time_resolution);
     }
+    if (config_.window) {
+      result += fmt::format(" window {}", config_.window->size);
+      if (config_.window->slide != config_.window->size) {
+        result += fmt::format(" slide {}", config_.window->slide);
+      }
+      if (config_.window->time_field) {
+        result += fmt::format(" on {}", *config_.window->time_field);
+      }
+      if (config_.window->delay != duration::zero()) {
+        result += fmt::format(" delay {}", config_.window->delay);
+      }
+    }
     return result;
   }
 
@@ -804,7 +1084,12 @@ public:
   auto optimize(expression const& filter, event_order order) const
     -> optimize_result override {
     // Note: The `unordered` relies on commutativity of the aggregation functions.
+    // Event time windows are the exception, as reordering the input delays the
+    // watermark or makes events late.
     (void)filter, (void)order;
+    if (config_.window and config_.window->time_field) {
+      return optimize_result{std::nullopt, event_order::ordered, copy()};
+    }
     return optimize_result{std::nullopt, event_order::unordered, copy()};
   }
 
@@ -813,6 +1098,43 @@ public:
   }
 
 private:
+  /// Emits the results of every window as soon as it closes.
+  auto summarize_windows(generator<table_slice> input,
+                         operator_control_plane& ctrl) const
+    -> generator<table_slice> {
+    auto impl = windowed_implementation{};
+    for (auto&& slice : input) {
+      if (slice.rows() > 0) {
+        impl.add(slice, config_, ctrl.diagnostics());
+      }
+      // We also get here when the input stalls, which lets windows on ingest
+      // time close without new events.
+      impl.advance(config_);
+      auto emitted = false;
+      for (auto&& result : impl.flush(config_, false)) {
+        if (!result) {
+          ctrl.abort(std::move(result.error()));
+          co_return;
+        }
+        emitted = true;
+        co_yield std::move(*result);
+      }
+      if (emitted) {
+        impl.report_dropped(config_, ctrl.diagnostics());
+      } else if (slice.rows() == 0) {
+        co_yield {};
+      }
+    }
+    for (auto&& result : impl.flush(config_, true)) {
+      if (!result) {
+        ctrl.abort(std::move(result.error()));
+        co_return;
+      }
+      co_yield std::move(*result);
+    }
+    impl.report_dropped(config_, ctrl.diagnostics());
+  }
+
   /// The underlying configuration of the summary transformation.
   configuration config_ = {};
 };
@@ -827,7 +1149,7 @@ public:
   auto make_operator(std::string_view pipeline) const
     -> std::pair<std::string_view, caf::expected<operator_ptr>> override {
     using parsers::end_of_pipeline_operator, parsers::required_ws_or_comment,
-      parsers::optional_ws_or_comment, parsers::duration,
+      parsers::optional_ws_or_comment, parsers::duration, parsers::extractor,
       parsers::extractor_list, parsers::aggregation_function_list;
     const auto* f = pipeline.begin();
     const auto* const l = pipeline.end();
@@ -836,10 +1158,20 @@ public:
                         >> extractor_list)
                    >> -(required_ws_or_comment >> "resolution"
                         >> required_ws_or_comment >> duration)
+                   >> -(required_ws_or_comment >> "window"
+                        >> required_ws_or_comment >> duration)
+                   >> -(required_ws_or_comment >> "slide"
+                        >> required_ws_or_comment >> duration)
+                   >> -(required_ws_or_comment >> "on" >> required_ws_or_comment
+                        >> extractor)
+                   >> -(required_ws_or_comment >> "delay"
+                        >> required_ws_or_comment >> duration)
                    >> optional_ws_or_comment >> end_of_pipeline_operator;
     std::tuple<std::vector<std::tuple<caf::optional<std::string>, std::string,
                                       std::string>>,
-               std::vector<std::string>, std::optional<tenzir::duration>>
+               std::vector<std::string>, std::optional<tenzir::duration>,
+               std::optional<tenzir::duration>, std::optional<tenzir::duration>,
+               std::optional<std::string>, std::optional<tenzir::duration>>
       parsed_aggregations{};
     if (!p(f, l, parsed_aggregations)) {
       return {
@@ -891,6 +1223,43 @@ public:
                                           "without `by` clause"),
       };
     }
+    auto window_size = std::move(std::get<3>(parsed_aggregations));
+    auto window_slide = std::move(std::get<4>(parsed_aggregations));
+    auto window_time_field = std::move(std::get<5>(parsed_aggregations));
+    auto window_delay = std::move(std::get<6>(parsed_aggregations));
+    if (window_size) {
+      auto window = configuration::window_configuration{};
+      window.size = *window_size;
+      window.slide = window_slide.value_or(*window_size);
+      window.time_field = std::move(window_time_field);
+      window.delay = window_delay.value_or(duration::zero());
+      auto error = std::invoke([&]() -> std::optional<std::string> {
+        if (window.size <= duration::zero())
+          return "window size must be positive";
+        if (window.slide <= duration::zero())
+          return "window slide must be positive";
+        if (window.size % window.slide != duration::zero())
+          return "window size must be a multiple of the slide";
+        if (window.delay < duration::zero())
+          return "window delay must not be negative";
+        if (window.delay != duration::zero() and not window.time_field)
+          return "window delay requires an event time field via `on`";
+        return std::nullopt;
+      });
+      if (error) {
+        return {
+          std::string_view{f, l},
+          caf::make_error(ec::syntax_error, std::move(*error)),
+        };
+      }
+      config.window = std::move(window);
+    } else if (window_slide or window_time_field or window_delay) {
+      return {
+        std::string_view{f, l},
+        caf::make_error(ec::syntax_error, "found `slide`, `on`, or `delay` "
+                                          "specifier without `window` clause"),
+      };
+    }
     return {
       std::string_view{f, l},
       std::make_unique<summarize_operator>(std::move(config)),
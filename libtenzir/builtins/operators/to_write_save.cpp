@@ -7,13 +7,16 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/arrow_table_slice.hpp>
+#include <tenzir/blocking_control_plane.hpp>
 #include <tenzir/concept/convertible/data.hpp>
 #include <tenzir/concept/convertible/to.hpp>
+#include <tenzir/detail/narrow.hpp>
 #include <tenzir/element_type.hpp>
 #include <tenzir/error.hpp>
 #include <tenzir/parser_interface.hpp>
 #include <tenzir/pipeline.hpp>
 #include <tenzir/plugin.hpp>
+#include <tenzir/table_slice.hpp>
 #include <tenzir/tql/parser.hpp>
 #include <tenzir/type.hpp>
 
@@ -21,7 +24,13 @@
 #include <caf/expected.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 namespace tenzir::plugins::write_to_print_save {
@@ -55,6 +64,27 @@ namespace {
 struct write_and_save_state {
   std::unique_ptr<printer_instance> printer;
   std::function<void(chunk_ptr)> saver;
+  uint64_t sequence_number = {};
+  uint64_t bytes = {};
+  std::chrono::steady_clock::time_point created = {};
+
+  /// The position of the instance in the list of instances by last use.
+  std::list<std::pair<type, data>>::iterator lru = {};
+};
+
+/// What the operator remembers about a schema and partition after finishing
+/// its printer and saver instance.
+struct write_and_save_history {
+  uint64_t sequence_number = {};
+  uint64_t bytes = {};
+  std::chrono::steady_clock::time_point created = {};
+
+  /// Whether the instance was finished to make room for other instances
+  /// rather than because it rolled over.
+  bool evicted = {};
+
+  /// The position of the partition in the list of finished partitions.
+  std::list<std::pair<type, data>>::iterator order = {};
 };
 
 class write_operator final : public crtp_operator<write_operator> {
@@ -186,20 +216,58 @@ public:
   auto
   operator()(generator<chunk_ptr> input, operator_control_plane& ctrl) const
     -> generator<std::monostate> {
+    // Savers may block arbitrarily long, so we call them on the blocking
+    // executor instead of giving every save operator a thread of its own. The
+    // state is shared with the blocking work, which may outlive this generator.
+    struct state {
+      std::shared_ptr<blocking_control_plane> ctrl = {};
+      std::function<void(chunk_ptr)> saver = {};
+      std::exception_ptr error = {};
+    };
+    auto shared = std::make_shared<state>();
+    shared->ctrl = std::make_shared<blocking_control_plane>(ctrl);
     // TODO: Extend API to allow schema-less make_saver().
-    auto new_saver = saver_->instantiate(ctrl, std::nullopt);
+    auto new_saver = saver_->instantiate(*shared->ctrl, std::nullopt);
+    shared->ctrl->flush(ctrl);
     if (!new_saver) {
       ctrl.abort(new_saver.error());
       co_return;
     }
+    shared->saver = std::move(*new_saver);
+    const auto run = [&](std::function<void()> work) {
+      ctrl.run_blocking([shared, work = std::move(work)] {
+        try {
+          work();
+        } catch (...) {
+          shared->error = std::current_exception();
+        }
+      });
+    };
+    const auto finish = [&] {
+      shared->ctrl->flush(ctrl);
+      if (shared->error) {
+        std::rethrow_exception(std::exchange(shared->error, {}));
+      }
+    };
     for (auto&& x : input) {
-      (*new_saver)(std::move(x));
+      if (!x || x->size() == 0) {
+        shared->saver(std::move(x));
+        finish();
+        co_yield {};
+        continue;
+      }
+      run([shared, x = std::move(x)]() mutable {
+        shared->saver(std::move(x));
+      });
       co_yield {};
+      finish();
     }
-  }
-
-  auto detached() const -> bool override {
-    return true;
+    // Destroying the saver may flush and close its sink, which can block too.
+    run([shared] {
+      shared->saver = {};
+    });
+    co_yield {};
+    finish();
   }
 
   auto location() const -> operator_location override {
@@ -263,10 +331,72 @@ public:
   }
 };
 
-/// The operator for printing and saving data without joining.
+/// Splits a table slice by the values of the given fields. Fields that do not
+/// exist in the schema have a null value.
+auto split_by_partition(table_slice slice,
+                        const std::vector<std::string>& fields)
+  -> std::vector<std::pair<data, table_slice>> {
+  if (fields.empty())
+    return {{data{record{}}, std::move(slice)}};
+  const auto& schema = caf::get<record_type>(slice.schema());
+  auto columns = std::vector<std::pair<type, std::shared_ptr<arrow::Array>>>{};
+  columns.reserve(fields.size());
+  for (const auto& field : fields) {
+    if (auto index = schema.resolve_key(field))
+      columns.push_back(index->get(slice));
+    else
+      columns.emplace_back();
+  }
+  auto value_at_row = [&](size_t column, int64_t row) -> data_view {
+    const auto& [type, array] = columns[column];
+    if (not array or array->IsNull(row))
+      return caf::none;
+    return value_at(type, *array, row);
+  };
+  // Events with the same partition often arrive together, so we only look up
+  // the partition of a row if it differs from the previous row.
+  const auto offset = slice.offset() == invalid_id ? 0 : slice.offset();
+  const auto rows = detail::narrow<int64_t>(slice.rows());
+  auto partitions = std::vector<std::pair<data, ids>>{};
+  auto partition_indices = std::unordered_map<data, size_t>{};
+  auto current = size_t{0};
+  for (auto row = int64_t{0}; row < rows; ++row) {
+    auto same_partition = row > 0;
+    for (size_t i = 0; same_partition and i < columns.size(); ++i)
+      same_partition = value_at_row(i, row) == value_at_row(i, row - 1);
+    if (not same_partition) {
+      auto partition = record{};
+      for (size_t i = 0; i < columns.size(); ++i)
+        partition.emplace(fields[i], materialize(value_at_row(i, row)));
+      auto [it, inserted] = partition_indices.try_emplace(
+        data{std::move(partition)}, partitions.size());
+      if (inserted)
+        partitions.emplace_back(it->first, ids{offset, false});
+      current = it->second;
+    }
+    auto& selection = partitions[current].second;
+    selection.append_bits(false, offset + row - selection.size());
+    selection.append_bit(true);
+  }
+  auto result = std::vector<std::pair<data, table_slice>>{};
+  result.reserve(partitions.size());
+  if (partitions.size() == 1) {
+    result.emplace_back(std::move(partitions[0].first), std::move(slice));
+    return result;
+  }
+  for (auto& [partition, selection] : partitions) {
+    auto partition_slice = filter(slice, selection);
+    TENZIR_ASSERT(partition_slice);
+    result.emplace_back(std::move(partition), std::move(*partition_slice));
+  }
+  return result;
+}
+
+/// The operator for printing and saving data without joining. It uses
+/// separate printer and saver instances per schema and, if the saver asks for
+/// it, per partition.
 class write_and_save_operator final
-  : public schematic_operator<write_and_save_operator, write_and_save_state,
-                              std::monostate> {
+  : public crtp_operator<write_and_save_operator> {
 public:
   write_and_save_operator() = default;
 
@@ -275,29 +405,148 @@ public:
     : printer_{std::move(printer)}, saver_{std::move(saver)} {
   }
 
-  auto initialize(const type& schema, operator_control_plane& ctrl) const
-    -> caf::expected<state_type> override {
-    auto p = printer_->instantiate(schema, ctrl);
-    if (not p) {
-      return std::move(p.error());
-    }
-    auto s = saver_->instantiate(
-      ctrl, printer_info{.input_schema = schema, .format = printer_->name()});
-    if (not s) {
-      return std::move(s.error());
-    }
-    return write_and_save_state{
-      .printer = std::move(*p),
-      .saver = std::move(*s),
+  auto operator()(generator<table_slice> input,
+                  operator_control_plane& ctrl) const
+    -> generator<std::monostate> {
+    const auto partitioning = saver_->partitioning();
+    const auto joinable = printer_->allows_joining();
+    auto states
+      = std::unordered_map<type,
+                           std::unordered_map<data, write_and_save_state>>{};
+    // The schemas and partitions of all instances, least recently used first.
+    auto lru = std::list<std::pair<type, data>>{};
+    // A later instance for the same schema and partition continues where the
+    // previous one stopped, so we remember a few numbers per partition even
+    // after its instance is gone. We remember at most as many finished
+    // partitions as there may be instances. For the partitions that we forget,
+    // we only keep the next unused sequence number per schema, so that a
+    // later instance never overwrites the output of a forgotten one.
+    auto history
+      = std::unordered_map<type,
+                           std::unordered_map<data, write_and_save_history>>{};
+    // The schemas and partitions in the history, least recently finished first.
+    auto history_order = std::list<std::pair<type, data>>{};
+    auto forgotten_sequence_numbers = std::unordered_map<type, uint64_t>{};
+    auto forget_oldest = [&] {
+      const auto& [schema, partition] = history_order.front();
+      auto& schema_history = history[schema];
+      auto it = schema_history.find(partition);
+      TENZIR_ASSERT(it != schema_history.end());
+      auto& next = forgotten_sequence_numbers[schema];
+      next = std::max(next, it->second.sequence_number + 1);
+      schema_history.erase(it);
+      history_order.pop_front();
     };
-  }
-
-  auto process(table_slice slice, state_type& state) const
-    -> output_type override {
-    for (auto&& x : state.printer->process(std::move(slice))) {
-      state.saver(std::move(x));
+    // Finishes an instance and drops its printer and saver.
+    auto retire = [&](const type& schema, const data& partition, bool evicted) {
+      auto& schema_states = states[schema];
+      auto it = schema_states.find(partition);
+      TENZIR_ASSERT(it != schema_states.end());
+      auto& state = it->second;
+      finish(state);
+      history[schema][partition] = {
+        .sequence_number = state.sequence_number,
+        .bytes = state.bytes,
+        .created = state.created,
+        .evicted = evicted,
+        .order = history_order.emplace(history_order.end(), schema, partition),
+      };
+      // The list entry owns the keys that we were called with.
+      auto entry = state.lru;
+      schema_states.erase(it);
+      lru.erase(entry);
+      if (partitioning.max_instances
+          and history_order.size() > *partitioning.max_instances)
+        forget_oldest();
+    };
+    // Rolls over all instances that exist for too long. We check this for every
+    // input, including empty ones, so that idle instances roll over as well.
+    auto roll_over_expired = [&] {
+      if (not partitioning.max_age)
+        return;
+      const auto now = std::chrono::steady_clock::now();
+      for (auto entry = lru.begin(); entry != lru.end();) {
+        auto current = entry++;
+        const auto& state = states[current->first].at(current->second);
+        if (now - state.created >= *partitioning.max_age)
+          retire(current->first, current->second, false);
+      }
+    };
+    for (auto&& slice : input) {
+      roll_over_expired();
+      if (slice.rows() == 0) {
+        co_yield {};
+        continue;
+      }
+      const auto schema = slice.schema();
+      auto& schema_states = states[schema];
+      for (auto&& [partition, partition_slice] :
+           split_by_partition(std::move(slice), partitioning.fields)) {
+        auto it = schema_states.find(partition);
+        if (it == schema_states.end()) {
+          if (partitioning.max_instances
+              and lru.size() >= *partitioning.max_instances) {
+            const auto& [lru_schema, lru_partition] = lru.front();
+            retire(lru_schema, lru_partition, true);
+          }
+          // An evicted instance resumes its output if the printer allows
+          // joining. Otherwise, the new instance starts over.
+          auto next = write_and_save_history{};
+          auto resumed = false;
+          if (auto forgotten = forgotten_sequence_numbers.find(schema);
+              forgotten != forgotten_sequence_numbers.end())
+            next.sequence_number = forgotten->second;
+          auto& schema_history = history[schema];
+          if (auto previous = schema_history.find(partition);
+              previous != schema_history.end()) {
+            resumed = previous->second.evicted and joinable;
+            if (resumed)
+              next = previous->second;
+            else
+              next.sequence_number = previous->second.sequence_number + 1;
+            // The new instance carries the numbers from here on.
+            history_order.erase(previous->second.order);
+            schema_history.erase(previous);
+          }
+          auto state = initialize(schema, partition, next.sequence_number,
+                                  resumed, ctrl);
+          if (not state) {
+            ctrl.abort(state.error());
+            co_return;
+          }
+          if (resumed) {
+            state->bytes = next.bytes;
+            state->created = next.created;
+          }
+          state->sequence_number = next.sequence_number;
+          state->lru = lru.emplace(lru.end(), schema, partition);
+          it = schema_states.emplace(partition, std::move(*state)).first;
+        } else {
+          lru.splice(lru.end(), lru, it->second.lru);
+        }
+        auto& state = it->second;
+        auto chunks = state.printer->process(std::move(partition_slice));
+        for (auto&& chunk : chunks) {
+          if (chunk)
+            state.bytes += chunk->size();
+          state.saver(std::move(chunk));
+        }
+        const auto roll_over
+          = (partitioning.max_bytes and state.bytes >= *partitioning.max_bytes)
+            or (partitioning.max_age
+                and std::chrono::steady_clock::now() - state.created
+                      >= *partitioning.max_age);
+        if (roll_over)
+          retire(schema, partition, false);
+      }
+      co_yield {};
+    }
+    // Savers may report errors when they go away, so we finish all instances
+    // while the operator is still running.
+    while (not lru.empty()) {
+      const auto& [lru_schema, lru_partition] = lru.front();
+      retire(lru_schema, lru_partition, false);
     }
-    return {};
   }
 
   auto detached() const -> bool override {
@@ -335,6 +584,38 @@ protected:
   }
 
 private:
+  auto initialize(const type& schema, const data& partition,
+                  uint64_t sequence_number, bool resumed,
+                  operator_control_plane& ctrl) const
+    -> caf::expected<write_and_save_state> {
+    auto p = printer_->instantiate(schema, ctrl);
+    if (not p) {
+      return std::move(p.error());
+    }
+    auto s = saver_->instantiate(
+      ctrl, printer_info{
+              .input_schema = schema,
+              .format = printer_->name(),
+              .partition = caf::get<record>(partition),
+              .sequence_number = sequence_number,
+              .resumed = resumed,
+            });
+    if (not s) {
+      return std::move(s.error());
+    }
+    return write_and_save_state{
+      .printer = std::move(*p),
+      .saver = std::move(*s),
+      .created = std::chrono::steady_clock::now(),
+    };
+  }
+
+  static auto finish(write_and_save_state& state) -> void {
+    for (auto&& chunk : state.printer->finish()) {
+      state.saver(std::move(chunk));
+    }
+  }
+
   std::unique_ptr<plugin_printer> printer_;
   std::unique_ptr<plugin_saver> saver_;
 };
@@ -7,39 +7,465 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/argument_parser.hpp>
-#include <tenzir/concept/parseable/string/char_class.hpp>
-#include <tenzir/concept/parseable/tenzir/pipeline.hpp>
-#include <tenzir/detail/string_literal.hpp>
+#include <tenzir/arrow_table_slice.hpp>
+#include <tenzir/detail/narrow.hpp>
 #include <tenzir/error.hpp>
+#include <tenzir/hash/hash_array.hpp>
 #include <tenzir/location.hpp>
 #include <tenzir/logger.hpp>
 #include <tenzir/pipeline.hpp>
 #include <tenzir/plugin.hpp>
+#include <tenzir/sketch/heavy_hitters.hpp>
+#include <tenzir/table_slice_builder.hpp>
+
+#include <arrow/record_batch.h>
+#include <tsl/robin_map.h>
+
+#include <algorithm>
+#include <span>
 
 namespace tenzir::plugins::top_rare {
 
 namespace {
 
-template <detail::string_literal Name, detail::string_literal SortOrder>
-class top_rare_plugin final : public virtual operator_parser_plugin {
+enum class mode {
+  top,
+  rare,
+};
+
+constexpr auto operator_name(enum mode mode) -> std::string_view {
+  switch (mode) {
+    case mode::top:
+      return "top";
+    case mode::rare:
+      return "rare";
+  }
+  return "<unknown>";
+}
+
+/// The parsed configuration.
+struct configuration {
+  /// The field whose values to count.
+  std::string field = {};
+
+  /// The name of the output field for the counts.
+  std::string count_field = {};
+
+  /// The maximum number of values to emit, or all values if not set.
+  std::optional<uint64_t> limit = {};
+
+  /// Whether to count with a bounded-memory sketch.
+  bool approximate = {};
+
+  friend auto inspect(auto& f, configuration& x) -> bool {
+    return f.object(x).fields(f.field("field", x.field),
+                              f.field("count_field", x.count_field),
+                              f.field("limit", x.limit),
+                              f.field("approximate", x.approximate));
+  }
+};
+
+/// Whether a value with its count ranks before another one in the output.
+/// Ties are broken by value, which makes the output deterministic.
+template <mode Mode, class T>
+auto ranks_before(uint64_t lhs_count, const T& lhs, uint64_t rhs_count,
+                  const T& rhs) -> bool {
+  if (lhs_count != rhs_count) {
+    return Mode == mode::top ? lhs_count > rhs_count : lhs_count < rhs_count;
+  }
+  return lhs < rhs;
+}
+
+/// A counted value that is a candidate for the output.
+struct entry {
+  data value = {};
+  uint64_t count = {};
+
+  /// The index of the counter that the value belongs to.
+  size_t counter = {};
+};
+
+/// Counts the values of a single type.
+class counter {
+public:
+  virtual ~counter() noexcept = default;
+
+  /// Counts all non-null values of an array.
+  virtual void add(const arrow::Array& array) = 0;
+
+  /// Appends the values that rank first to *result*.
+  /// @param limit The maximum number of values to append.
+  /// @param index The index of this counter.
+  /// @param result The output entries.
+  virtual void select(std::optional<uint64_t> limit, size_t index,
+                      std::vector<entry>& result) const
+    = 0;
+
+  /// Returns the type of the counted values.
+  auto value_type() const -> const type& {
+    return value_type_;
+  }
+
+protected:
+  explicit counter(type value_type) : value_type_{std::move(value_type)} {
+    // nop
+  }
+
+  /// Computes the digests of an array, which we reuse across calls.
+  auto compute_digests(const arrow::Array& array)
+    -> std::span<const array_digest> {
+    digests_.resize(detail::narrow_cast<size_t>(array.length()));
+    hash_array(value_type_, array, digests_);
+    return digests_;
+  }
+
+private:
+  type value_type_ = {};
+  std::vector<array_digest> digests_ = {};
+};
+
+/// Hashes values like `hash_array`, which allows for probing the map with the
+/// digests computed for an entire array at once.
+template <concrete_type Type>
+struct heterogeneous_data_hash {
+  using is_transparent = void;
+
+  [[nodiscard]] auto operator()(view<type_to_data_t<Type>> value) const
+    -> size_t {
+    return hash_as_data_view(value);
+  }
+
+  [[nodiscard]] auto operator()(const type_to_data_t<Type>& value) const
+    -> size_t
+    requires(!std::is_same_v<view<type_to_data_t<Type>>, type_to_data_t<Type>>)
+  {
+    return hash_as_data_view(make_view(value));
+  }
+};
+
+template <concrete_type Type>
+struct heterogeneous_data_equal {
+  using is_transparent = void;
+
+  [[nodiscard]] auto operator()(const type_to_data_t<Type>& lhs,
+                                const type_to_data_t<Type>& rhs) const -> bool {
+    return lhs == rhs;
+  }
+
+  [[nodiscard]] auto operator()(const type_to_data_t<Type>& lhs,
+                                view<type_to_data_t<Type>> rhs) const -> bool
+    requires(!std::is_same_v<view<type_to_data_t<Type>>, type_to_data_t<Type>>)
+  {
+    return make_view(lhs) == rhs;
+  }
+};
+
+/// Counts every distinct value exactly in a typed hash map.
+template <mode Mode, concrete_type Type>
+class exact_counter final : public counter {
+public:
+  explicit exact_counter(type value_type) : counter{std::move(value_type)} {
+    // nop
+  }
+
+  void add(const arrow::Array& array) override {
+    const auto digests = compute_digests(array);
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    if constexpr (arrow::is_extension_type<type_to_arrow_type_t<Type>>::value)
+      add_values(*values.storage(), digests);
+    else
+      add_values(values, digests);
+  }
+
+  void select(std::optional<uint64_t> limit, size_t index,
+              std::vector<entry>& result) const override {
+    using candidate = std::pair<uint64_t, const type_to_data_t<Type>*>;
+    auto ranks_first = [](const candidate& lhs, const candidate& rhs) {
+      return ranks_before<Mode>(lhs.first, *lhs.second, rhs.first,
+                                *rhs.second);
+    };
+    // With a limit, we keep the candidates in a heap whose front is the
+    // candidate that ranks last, so that selecting k out of n values takes
+    // O(n log k) time and O(k) memory.
+    auto candidates = std::vector<candidate>{};
+    for (const auto& [value, count] : counts_) {
+      candidates.emplace_back(count, &value);
+      if (not limit) {
+        continue;
+      }
+      std::push_heap(candidates.begin(), candidates.end(), ranks_first);
+      if (candidates.size() > *limit) {
+        std::pop_heap(candidates.begin(), candidates.end(), ranks_first);
+        candidates.pop_back();
+      }
+    }
+    for (const auto& [count, value] : candidates) {
+      result.push_back({data{*value}, count, index});
+    }
+  }
+
+private:
+  void add_values(const type_to_arrow_array_storage_t<Type>& values,
+                  std::span<const array_digest> digests) {
+    const auto& type = caf::get<Type>(value_type());
+    for (auto row = int64_t{0}; row < values.length(); ++row) {
+      if (values.IsNull(row)) {
+        continue;
+      }
+      const auto value = value_at(type, values, row);
+      if (auto it = counts_.find(value, digests[row]); it != counts_.end()) {
+        ++it.value();
+      } else {
+        counts_.emplace(materialize(value), 1);
+      }
+    }
+  }
+
+  tsl::robin_map<type_to_data_t<Type>, uint64_t, heterogeneous_data_hash<Type>,
+                 heterogeneous_data_equal<Type>>
+    counts_ = {};
+};
+
+/// Estimates the most frequent values with a heavy hitters sketch, which uses
+/// constant memory regardless of the number of distinct values.
+template <concrete_type Type>
+class approximate_counter final : public counter {
+public:
+  approximate_counter(type value_type, uint64_t limit)
+    : counter{std::move(value_type)} {
+    // Tracking more candidates than we report makes it less likely that a
+    // frequent value gets evicted by a burst of other values.
+    auto sketch
+      = sketch::heavy_hitters::make(detail::narrow_cast<size_t>(4 * limit));
+    TENZIR_ASSERT(sketch);
+    sketch_ = std::move(*sketch);
+  }
+
+  void add(const arrow::Array& array) override {
+    const auto digests = compute_digests(array);
+    const auto& values = caf::get<type_to_arrow_array_t<Type>>(array);
+    if constexpr (arrow::is_extension_type<type_to_arrow_type_t<Type>>::value)
+      add_values(*values.storage(), digests);
+    else
+      add_values(values, digests);
+  }
+
+  void select(std::optional<uint64_t> limit, size_t index,
+              std::vector<entry>& result) const override {
+    TENZIR_ASSERT(limit);
+    auto top = sketch_.top();
+    if (top.size() > *limit) {
+      top.resize(*limit);
+    }
+    for (auto& x : top) {
+      result.push_back({std::move(x.value), x.count, index});
+    }
+  }
+
+private:
+  void add_values(const type_to_arrow_array_storage_t<Type>& values,
+                  std::span<const array_digest> digests) {
+    const auto& type = caf::get<Type>(value_type());
+    for (auto row = int64_t{0}; row < values.length(); ++row) {
+      if (values.IsValid(row)) {
+        sketch_.add(digests[row], value_at(type, values, row));
+      }
+    }
+  }
+
+  sketch::heavy_hitters sketch_ = {};
+};
+
+template <mode Mode>
+class top_rare_operator final : public crtp_operator<top_rare_operator<Mode>> {
+public:
+  top_rare_operator() = default;
+
+  explicit top_rare_operator(configuration config) noexcept
+    : config_{std::move(config)} {
+    // nop
+  }
+
   auto name() const -> std::string override {
-    return std::string{Name.str()};
+    return std::string{operator_name(Mode)};
+  }
+
+  auto
+  operator()(generator<table_slice> input, operator_control_plane& ctrl) const
+    -> generator<table_slice> {
+    // We keep one counter per type of the value field. Types that differ only
+    // in their metadata share a counter, and the first type wins.
+    auto counters = std::vector<std::unique_ptr<counter>>{};
+    auto counter_indices = tsl::robin_map<type, size_t>{};
+    auto columns = tsl::robin_map<type, std::optional<offset>>{};
+    for (auto&& slice : input) {
+      if (slice.rows() == 0) {
+        co_yield {};
+        continue;
+      }
+      auto column = columns.find(slice.schema());
+      if (column == columns.end()) {
+        auto offset
+          = caf::get<record_type>(slice.schema()).resolve_key(config_.field);
+        if (not offset) {
+          diagnostic::warning("field `{}` does not exist for schema `{}`",
+                              config_.field, slice.schema().name())
+            .emit(ctrl.diagnostics());
+        }
+        column = columns.try_emplace(column, slice.schema(), std::move(offset));
+      }
+      if (not column->second) {
+        continue;
+      }
+      const auto& value_type
+        = caf::get<record_type>(slice.schema()).field(*column->second).type;
+      auto [index, inserted]
+        = counter_indices.try_emplace(value_type.prune(), counters.size());
+      if (inserted) {
+        counters.push_back(make_counter(value_type));
+      }
+      auto batch = to_record_batch(slice);
+      counters[index->second]->add(*column->second->get(*batch));
+    }
+    // Every counter preselects its best values, so only the final ranking
+    // needs to look at values of different types.
+    auto entries = std::vector<entry>{};
+    for (size_t i = 0; i < counters.size(); ++i) {
+      counters[i]->select(config_.limit, i, entries);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const entry& lhs, const entry& rhs) {
+                return ranks_before<Mode>(lhs.count, lhs.value, rhs.count,
+                                          rhs.value);
+              });
+    if (config_.limit and entries.size() > *config_.limit) {
+      entries.resize(detail::narrow_cast<size_t>(*config_.limit));
+    }
+    // Consecutive entries with the same type go into the same slice.
+    auto begin = entries.begin();
+    while (begin != entries.end()) {
+      auto end = std::find_if(begin, entries.end(), [&](const entry& x) {
+        return x.counter != begin->counter;
+      });
+      auto result = make_slice(counters[begin->counter]->value_type(),
+                               std::span{begin, end});
+      if (not result) {
+        ctrl.abort(std::move(result.error()));
+        co_return;
+      }
+      co_yield std::move(*result);
+      begin = end;
+    }
   }
 
+  auto to_string() const -> std::string override {
+    auto result = fmt::format("{} {} --count-field {}", operator_name(Mode),
+                              config_.field, config_.count_field);
+    if (config_.limit) {
+      result += fmt::format(" --limit {}", *config_.limit);
+    }
+    if (config_.approximate) {
+      result += " --approximate";
+    }
+    return result;
+  }
+
+  auto optimize(expression const& filter, event_order order) const
+    -> optimize_result override {
+    (void)filter, (void)order;
+    return optimize_result{std::nullopt, event_order::unordered, this->copy()};
+  }
+
+  friend auto inspect(auto& f, top_rare_operator& x) -> bool {
+    return f.apply(x.config_);
+  }
+
+private:
+  auto make_counter(const type& value_type) const -> std::unique_ptr<counter> {
+    auto f = [&]<concrete_type Type>(const Type&) -> std::unique_ptr<counter> {
+      if (config_.approximate) {
+        TENZIR_ASSERT(config_.limit);
+        return std::make_unique<approximate_counter<Type>>(value_type,
+                                                           *config_.limit);
+      }
+      return std::make_unique<exact_counter<Mode, Type>>(value_type);
+    };
+    return caf::visit(f, value_type);
+  }
+
+  auto make_slice(const type& value_type, std::span<const entry> entries) const
+    -> caf::expected<table_slice> {
+    // We keep the schema name of the former implementation on top of
+    // `summarize` for compatibility.
+    auto schema = type{
+      "tenzir.summarize",
+      record_type{
+        {config_.field, value_type},
+        {config_.count_field, uint64_type{}},
+      },
+    };
+    auto builder = caf::get<record_type>(schema).make_arrow_builder(
+      arrow::default_memory_pool());
+    TENZIR_ASSERT(builder);
+    for (const auto& x : entries) {
+      auto status = builder->Append();
+      if (status.ok()) {
+        status = append_builder(value_type, *builder->field_builder(0),
+                                make_data_view(x.value));
+      }
+      if (status.ok()) {
+        status = append_builder(type{uint64_type{}},
+                                *builder->field_builder(1), data_view{x.count});
+      }
+      if (not status.ok()) {
+        return caf::make_error(ec::system_error,
+                               fmt::format("failed to append row: {}",
+                                           status.ToString()));
+      }
+    }
+    auto array = builder->Finish();
+    if (not array.ok()) {
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to finish builder: {}",
+                                         array.status().ToString()));
+    }
+    auto batch = arrow::RecordBatch::Make(
+      schema.to_arrow_schema(), detail::narrow<int64_t>(entries.size()),
+      caf::get<type_to_arrow_array_t<record_type>>(*array.MoveValueUnsafe())
+        .fields());
+    return table_slice{batch, schema};
+  }
+
+  configuration config_ = {};
+};
+
+template <mode Mode>
+class plugin final : public virtual operator_plugin<top_rare_operator<Mode>> {
+public:
   auto signature() const -> operator_signature override {
     return {.transformation = true};
   }
 
   auto parse_operator(parser_interface& p) const -> operator_ptr override {
+    const auto name = std::string{operator_name(Mode)};
     auto parser = argument_parser{
-      std::string{Name.str()}, fmt::format("https://docs.tenzir.com/docs/next/"
-                                           "operators/transformations/{}",
-                                           Name.str())};
+      name, fmt::format("https://docs.tenzir.com/docs/next/"
+                        "operators/transformations/{}",
+                        name)};
     auto field = located<std::string>{};
     auto count_field = std::optional<located<std::string>>{};
+    auto limit = std::optional<located<uint64_t>>{};
+    auto approximate = std::optional<location>{};
     parser.add(field, "<str>");
     parser.add("-c,--count-field", count_field, "<str>");
+    parser.add("-n,--limit", limit, "<count>");
+    parser.add("--approximate", approximate);
     parser.parse(p);
+    if (field.inner.empty()) {
+      diagnostic::error("field must not be empty")
+        .primary(field.source)
+        .throw_();
+    }
     if (count_field) {
       if (count_field->inner.empty()) {
         diagnostic::error("`--count-field` must not be empty")
@@ -66,27 +492,41 @@ class top_rare_plugin final : public virtual operator_parser_plugin {
         count_field->inner = default_count_field;
       }
     }
-
-    // TODO: Replace this textual parsing with a subpipeline to improve
-    // diagnostics for this operator.
-    auto repr = fmt::format("summarize "
-                            "{0}=count({1}) by "
-                            "{1} | sort {0} {2}",
-                            count_field->inner, field.inner, SortOrder.str());
-    auto parsed = pipeline::internal_parse_as_operator(repr);
-    if (not parsed) {
-      // TODO: Improve error message.
-      diagnostic::error("{}", parsed.error()).throw_();
+    if (limit and limit->inner == 0) {
+      diagnostic::error("`--limit` must be positive")
+        .primary(limit->source)
+        .throw_();
+    }
+    if (approximate) {
+      if constexpr (Mode == mode::rare) {
+        diagnostic::error("`--approximate` is not supported for `rare`")
+          .primary(*approximate)
+          .note("rare values cannot be told apart from noise in bounded "
+                "memory")
+          .throw_();
+      }
+      if (not limit) {
+        diagnostic::error("`--approximate` requires `--limit`")
+          .primary(*approximate)
+          .throw_();
+      }
+    }
+    auto config = configuration{};
+    config.field = std::move(field.inner);
+    config.count_field = std::move(count_field->inner);
+    if (limit) {
+      config.limit = limit->inner;
     }
-    return std::move(*parsed);
+    config.approximate = approximate.has_value();
+    return std::make_unique<top_rare_operator<Mode>>(std::move(config));
   }
 
 private:
   static constexpr auto default_count_field = "count";
 };
 
-using top_plugin = top_rare_plugin<"top", "desc">;
-using rare_plugin = top_rare_plugin<"rare", "asc">;
+using top_plugin = plugin<mode::top>;
+using rare_plugin = plugin<mode::rare>;
 
 } // namespace
 
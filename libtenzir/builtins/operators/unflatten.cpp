@@ -34,8 +34,9 @@ public:
   auto operator()(generator<table_slice> input,
                   [[maybe_unused]] operator_control_plane& ctrl) const
     -> generator<table_slice> {
+    auto unflatten = unflattener{separator_};
     for (auto&& slice : input) {
-      auto result = tenzir::unflatten(slice, separator_);
+      auto result = unflatten(slice);
       co_yield std::move(result);
     }
   }
@@ -7,22 +7,160 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/argument_parser.hpp>
+#include <tenzir/arrow_table_slice.hpp>
 #include <tenzir/concept/parseable/tenzir/pipeline.hpp>
+#include <tenzir/detail/narrow.hpp>
+#include <tenzir/detail/seen_keys.hpp>
+#include <tenzir/detail/string.hpp>
+#include <tenzir/hash/hash.hpp>
+#include <tenzir/hash/hash_append.hpp>
+#include <tenzir/hash/hash_array.hpp>
+#include <tenzir/operator_control_plane.hpp>
 #include <tenzir/plugin.hpp>
 #include <tenzir/table_slice.hpp>
 
+#include <arrow/record_batch.h>
+#include <tsl/robin_map.h>
+
+
 namespace tenzir::plugins::unique {
 
 namespace {
 
+/// The parsed configuration.
+struct configuration {
+  /// Whether to remove all duplicates instead of only adjacent ones.
+  bool global = {};
+
+  /// The fields that identify duplicates, or all fields if empty.
+  std::vector<std::string> fields = {};
+
+  /// The maximum number of remembered keys.
+  std::optional<uint64_t> max_size = {};
+
+  /// For how long a key is remembered after it was seen last.
+  std::optional<duration> ttl = {};
+
+  friend auto inspect(auto& f, configuration& x) -> bool {
+    return f.object(x).fields(f.field("global", x.global),
+                              f.field("fields", x.fields),
+                              f.field("max_size", x.max_size),
+                              f.field("ttl", x.ttl));
+  }
+};
+
+/// The key columns of a schema.
+struct binding {
+  /// The schema that identifies keys, see `detail::seen_keys::key_view`.
+  type key_schema = {};
+
+  /// The digest of `key_schema`, which seeds the digest of every key.
+  size_t key_schema_digest = {};
+
+  /// The key columns, or `std::nullopt` for missing fields.
+  std::vector<std::optional<std::pair<offset, type>>> columns = {};
+
+  static auto make(const type& schema, const configuration& config,
+                   diagnostic_handler& diag) -> binding {
+    auto result = binding{};
+    const auto& rt = caf::get<record_type>(schema);
+    if (config.fields.empty()) {
+      result.key_schema = schema.prune();
+      result.key_schema_digest = std::hash<type>{}(result.key_schema);
+      for (auto&& [field, index] : rt.leaves()) {
+        result.columns.emplace_back(std::pair{index, field.type});
+      }
+      return result;
+    }
+    result.key_schema_digest = std::hash<type>{}(result.key_schema);
+    for (const auto& field : config.fields) {
+      if (auto offset = rt.resolve_key(field)) {
+        auto type = rt.field(*offset).type;
+        result.columns.emplace_back(std::pair{std::move(*offset), type});
+      } else {
+        diagnostic::warning("field `{}` does not exist for schema `{}`", field,
+                            schema.name())
+          .note("the field is considered to be null")
+          .emit(diag);
+        result.columns.emplace_back(std::nullopt);
+      }
+    }
+    return result;
+  }
+};
+
 class unique_operator final : public crtp_operator<unique_operator> {
 public:
   unique_operator() = default;
 
+  explicit unique_operator(configuration config) noexcept
+    : config_{std::move(config)} {
+    // nop
+  }
+
+  auto
+  operator()(generator<table_slice> input, operator_control_plane& ctrl) const
+    -> generator<table_slice> {
+    if (config_.global) {
+      for (auto&& output : remove_all_duplicates(std::move(input), ctrl)) {
+        co_yield std::move(output);
+      }
+      co_return;
+    }
+    for (auto&& output : remove_adjacent_duplicates(std::move(input))) {
+      co_yield std::move(output);
+    }
+  }
+
+  auto to_string() const -> std::string override {
+    auto result = std::string{"unique"};
+    if (config_.global) {
+      result += " --global";
+    }
+    if (not config_.fields.empty()) {
+      result += fmt::format(" --fields {}", fmt::join(config_.fields, ","));
+    }
+    if (config_.max_size) {
+      result += fmt::format(" --max-size {}", *config_.max_size);
+    }
+    if (config_.ttl) {
+      result += fmt::format(" --ttl {}", *config_.ttl);
+    }
+    return result;
+  }
+
+  auto name() const -> std::string override {
+    return "unique";
+  }
+
+  auto optimize(expression const& filter, event_order order) const
+    -> optimize_result override {
+    if (config_.global) {
+      // Duplicates of all fields are identical, so they either all pass a
+      // filter or none does. The same does not hold for keys of selected
+      // fields, where the filter and the order determine which event we keep,
+      // nor with bounds, where the order determines which key we forget.
+      if (config_.fields.empty() and not config_.max_size
+          and not config_.ttl) {
+        return optimize_result{filter, order, copy()};
+      }
+      return optimize_result{std::nullopt, event_order::ordered, copy()};
+    }
+    // TODO: We compare the *pruned* schemas above. Hence, returning
+    // `event_order::schema` here might be slightly incorrect.
+    (void)order;
+    return optimize_result{filter, event_order::schema, copy()};
+  }
+
+  friend auto inspect(auto& f, unique_operator& x) -> bool {
+    return f.apply(x.config_);
+  }
+
+private:
   // Note: The following implementation does a point-wise comparison of
   // consecutive rows. To this end, we use `table_slice::at`. This could be
   // optimized in the future.
-  auto operator()(generator<table_slice> input) const
+  static auto remove_adjacent_duplicates(generator<table_slice> input)
     -> generator<table_slice> {
     // We keep track of the last non-empty slice to compare the first event of
     // the next slice against its last event.
@@ -54,27 +192,85 @@ public:
     }
   }
 
-  auto to_string() const -> std::string override {
-    return "unique";
-  }
-
-  auto name() const -> std::string override {
-    return "unique";
-  }
-
-  auto optimize(expression const& filter, event_order order) const
-    -> optimize_result override {
-    // TODO: We compare the *pruned* schemas above. Hence, returning
-    // `event_order::schema` here might be slightly incorrect.
-    (void)order;
-    return optimize_result{filter, event_order::schema, copy()};
-  }
-
-  friend auto inspect(auto&, unique_operator&) -> bool {
-    return true;
+  auto remove_all_duplicates(generator<table_slice> input,
+                             operator_control_plane& ctrl) const
+    -> generator<table_slice> {
+    auto seen = detail::seen_keys{config_.max_size, config_.ttl};
+    auto bindings = tsl::robin_map<type, binding>{};
+    const auto null_digest = hash(data_view{});
+    for (auto&& slice : input) {
+      const auto now = time{time::clock::now()};
+      seen.expire(now);
+      if (slice.rows() == 0) {
+        co_yield {};
+        continue;
+      }
+      auto it = bindings.find(slice.schema());
+      if (it == bindings.end()) {
+        it = bindings.try_emplace(
+          it, slice.schema(),
+          binding::make(slice.schema(), config_, ctrl.diagnostics()));
+      }
+      const auto& bound = it->second;
+      // Hash all key columns up front, and combine the digests per row like
+      // `summarize` does for its group-by columns.
+      auto batch = to_record_batch(slice);
+      auto arrays = std::vector<std::shared_ptr<arrow::Array>>{};
+      auto digests = std::vector<std::vector<array_digest>>{};
+      arrays.reserve(bound.columns.size());
+      digests.reserve(bound.columns.size());
+      for (const auto& column : bound.columns) {
+        if (column) {
+          auto array = column->first.get(*batch);
+          digests.push_back(hash_array(column->second, *array));
+          arrays.push_back(std::move(array));
+        } else {
+          digests.emplace_back(batch->num_rows(), null_digest);
+          arrays.emplace_back();
+        }
+      }
+      auto key = detail::seen_keys::key_view{&bound.key_schema, {}};
+      key.values.resize(bound.columns.size());
+      // We keep runs of new rows as subslices, and merge them into a single
+      // slice at the end so that heavy deduplication does not fragment the
+      // output.
+      auto runs = std::vector<table_slice>{};
+      auto run_begin = std::optional<size_t>{};
+      for (auto row = size_t{0}; row < slice.rows(); ++row) {
+        auto hasher = xxh64{};
+        hash_append(hasher, bound.key_schema_digest);
+        for (size_t col = 0; col < bound.columns.size(); ++col) {
+          hash_append(hasher, digests[col][row]);
+          key.values[col]
+            = bound.columns[col]
+                ? value_at(bound.columns[col]->second, *arrays[col],
+                           detail::narrow<int64_t>(row))
+                : data_view{};
+        }
+        const auto is_new = seen.insert(key, hasher.finish(), now);
+        if (is_new and not run_begin) {
+          run_begin = row;
+        } else if (not is_new and run_begin) {
+          runs.push_back(subslice(slice, *run_begin, row));
+          run_begin = std::nullopt;
+        }
+      }
+      if (run_begin) {
+        if (*run_begin == 0) {
+          co_yield std::move(slice);
+          continue;
+        }
+        runs.push_back(subslice(slice, *run_begin, slice.rows()));
+      }
+      if (runs.empty()) {
+        co_yield {};
+        continue;
+      }
+      co_yield runs.size() == 1 ? std::move(runs.front())
+                                : concatenate(std::move(runs));
+    }
   }
 
-private:
   /// @pre `a.schema() == b.schema()`
   static auto is_duplicate(const table_slice& a, size_t a_row,
                            const table_slice& b, size_t b_row) -> bool {
@@ -86,6 +282,8 @@ private:
     }
     return true;
   }
+
+  configuration config_ = {};
 };
 
 class plugin final : public virtual operator_plugin<unique_operator> {
@@ -97,8 +295,54 @@ public:
   auto parse_operator(parser_interface& p) const -> operator_ptr override {
     auto parser = argument_parser{"unique", "https://docs.tenzir.com/next/"
                                             "operators/transformations/unique"};
+    auto global = std::optional<location>{};
+    auto fields = std::optional<located<std::string>>{};
+    auto max_size = std::optional<located<uint64_t>>{};
+    auto ttl = std::optional<located<duration>>{};
+    parser.add("-g,--global", global);
+    parser.add("-f,--fields", fields, "<fields>");
+    parser.add("--max-size", max_size, "<count>");
+    parser.add("--ttl", ttl, "<duration>");
     parser.parse(p);
-    return std::make_unique<unique_operator>();
+    auto config = configuration{};
+    config.global = global.has_value();
+    auto require_global = [&](const auto& option) {
+      if (option and not config.global) {
+        diagnostic::error("option requires `--global`")
+          .primary(option->source)
+          .throw_();
+      }
+    };
+    require_global(fields);
+    require_global(max_size);
+    require_global(ttl);
+    if (fields) {
+      for (auto&& field : detail::split(fields->inner, ",")) {
+        if (field.empty()) {
+          diagnostic::error("field must not be empty")
+            .primary(fields->source)
+            .throw_();
+        }
+        config.fields.emplace_back(field);
+      }
+    }
+    if (max_size) {
+      if (max_size->inner == 0) {
+        diagnostic::error("`--max-size` must be positive")
+          .primary(max_size->source)
+          .throw_();
+      }
+      config.max_size = max_size->inner;
+    }
+    if (ttl) {
+      if (ttl->inner <= duration::zero()) {
+        diagnostic::error("`--ttl` must be positive")
+          .primary(ttl->source)
+          .throw_();
+      }
+      config.ttl = ttl->inner;
+    }
+    return std::make_unique<unique_operator>(std::move(config));
   }
 };
 
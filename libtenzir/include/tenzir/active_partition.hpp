@@ -25,6 +25,7 @@
 #include "tenzir/type.hpp"
 #include "tenzir/uuid.hpp"
 #include "tenzir/value_index.hpp"
+#include "tenzir/zone_map.hpp"
 
 #include <caf/broadcast_downstream_manager.hpp>
 #include <caf/optional.hpp>
@@ -43,6 +44,12 @@ bool should_skip_index_creation(const type& type,
                                 const qualified_record_field& qf,
                                 const std::vector<index_config::rule>& rules);
 
+/// Determines the options for creating the value index of a given field.
+caf::settings
+make_value_index_options(const qualified_record_field& qf,
+                         const std::vector<index_config::rule>& rules,
+                         caf::settings index_opts);
+
 /// The state of the ACTIVE PARTITION actor.
 struct active_partition_state {
   // -- constructor ------------------------------------------------------------
@@ -82,6 +89,9 @@ struct active_partition_state {
     /// A mapping from qualified field name to serialized indexer state
     /// for each indexer in the partition.
     std::vector<std::pair<std::string, chunk_ptr>> indexer_chunks = {};
+
+    /// The zone maps of all table slices in the partition, ordered by offset.
+    std::vector<zone_map> zone_maps = {};
   };
 
   // -- utility functions ------------------------------------------------------
@@ -92,6 +102,9 @@ struct active_partition_state {
 
   void notify_flush_listeners();
 
+  /// Reports the ingest throughput since the last report to the accountant.
+  void send_report();
+
   std::optional<tenzir::record_type> combined_schema() const;
 
   const std::unordered_map<std::string, ids>& type_ids() const;
@@ -110,6 +123,12 @@ struct active_partition_state {
   /// Tracks whether we already received at least one table slice.
   bool streaming_initiated = {};
 
+  /// The schema for which we last set up the indexers.
+  type indexed_schema = {};
+
+  /// Timekeeper for adding incoming events to the partition.
+  measurement ingest_measurement = {};
+
   /// Options to be used when adding events to the partition_synopsis.
   uint64_t partition_capacity = 0ull;
   index_config synopsis_index_config = {};
@@ -397,6 +397,8 @@ using datagram_source_actor = typed_actor_fwd<
 using exec_node_sink_actor = typed_actor_fwd<
   // Push events.
   auto(atom::push, std::vector<table_slice> events)->caf::result<void>,
+  // Push events encoded for transfer between processes.
+  auto(atom::push, std::vector<table_slice_frame> frames)->caf::result<void>,
   // Push bytes.
   auto(atom::push, std::vector<chunk_ptr> bytes)->caf::result<void>>::unwrap;
 
@@ -37,7 +37,8 @@ public:
   /// @param array The array ot add.
   /// @pre *array* matches the input type.
   /// @note The default implementation for this calls *add* repeatedly for all
-  /// elements of the *array*.
+  /// elements of the *array*. Since *summarize* always adds entire arrays,
+  /// implementations should override this with a typed loop.
   virtual void add(const arrow::Array& array);
 
   /// Finish the aggregation into a single materialized value.
@@ -14,6 +14,7 @@
 #include "tenzir/detail/type_traits.hpp"
 #include "tenzir/ewah_bitmap.hpp"
 #include "tenzir/null_bitmap.hpp"
+#include "tenzir/roaring_bitmap.hpp"
 #include "tenzir/wah_bitmap.hpp"
 
 #include <caf/detail/type_list.hpp>
@@ -30,7 +31,8 @@ class bitmap : public bitmap_base<bitmap>, detail::equality_comparable<bitmap> {
   friend bitmap_bit_range;
 
 public:
-  using types = caf::detail::type_list<ewah_bitmap, null_bitmap, wah_bitmap>;
+  using types = caf::detail::type_list<ewah_bitmap, null_bitmap, wah_bitmap,
+                                      roaring_bitmap>;
 
   using variant = caf::detail::tl_apply_t<types, caf::variant>;
 
@@ -77,6 +79,14 @@ public:
 
   friend bool operator==(const bitmap& x, const bitmap& y);
 
+  /// Computes the intersection of two bitmaps, operating on the containers
+  /// directly if both are Roaring bitmaps.
+  friend auto binary_and(const bitmap& lhs, const bitmap& rhs) -> bitmap;
+
+  /// Computes the union of two bitmaps, operating on the containers directly
+  /// if both are Roaring bitmaps.
+  friend auto binary_or(const bitmap& lhs, const bitmap& rhs) -> bitmap;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, bitmap& bm) {
     return f.apply(bm.bitmap_);
@@ -104,7 +114,8 @@ public:
 
 private:
   using range_variant
-    = caf::variant<ewah_bitmap_range, null_bitmap_range, wah_bitmap_range>;
+    = caf::variant<ewah_bitmap_range, null_bitmap_range, wah_bitmap_range,
+                   roaring_bitmap_range>;
 
   range_variant range_;
 };
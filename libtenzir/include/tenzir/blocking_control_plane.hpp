@@ -0,0 +1,119 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include "tenzir/generator.hpp"
+#include "tenzir/operator_control_plane.hpp"
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tenzir {
+
+/// A control plane for code that runs as blocking work, see
+/// `operator_control_plane::run_blocking`.
+///
+/// It collects diagnostics and aborts instead of forwarding them, because the
+/// execution node that hosts the operator may run concurrently. Call `flush`
+/// on the execution node after the blocking work finished to forward them.
+class blocking_control_plane final : public operator_control_plane {
+public:
+  /// Captures everything that the blocking work may need from `ctrl`.
+  explicit blocking_control_plane(operator_control_plane& ctrl);
+
+  ~blocking_control_plane() noexcept override;
+
+  /// Blocking work must not access the hosting actor.
+  auto self() noexcept -> exec_node_actor::base& override;
+
+  auto node() noexcept -> node_actor override;
+
+  auto abort(caf::error error) noexcept -> void override;
+
+  auto warn(caf::error warning) noexcept -> void override;
+
+  auto emit(table_slice metrics) noexcept -> void override;
+
+  auto schemas() const noexcept -> const std::vector<type>& override;
+
+  auto concepts() const noexcept -> const concepts_map& override;
+
+  auto diagnostics() noexcept -> diagnostic_handler& override;
+
+  auto allow_unsafe_pipelines() const noexcept -> bool override;
+
+  auto has_terminal() const noexcept -> bool override;
+
+  /// Forwards the collected diagnostics and aborts to `ctrl`.
+  void flush(operator_control_plane& ctrl);
+
+private:
+  class collecting_diagnostic_handler;
+
+  node_actor node_ = {};
+  bool allow_unsafe_pipelines_ = {};
+  bool has_terminal_ = {};
+  std::unique_ptr<collecting_diagnostic_handler> diagnostics_;
+  std::mutex mutex_ = {};
+  std::vector<caf::error> aborts_ = {};
+};
+
+/// Advances a generator as blocking work, one element at a time, and yields
+/// its elements on the execution node.
+/// @param blocking_ctrl The control plane that *gen* was created with.
+/// @param gen The generator to advance.
+/// @param ctrl The control plane of the operator.
+template <class T>
+auto advance_blocking(std::shared_ptr<blocking_control_plane> blocking_ctrl,
+                      generator<T> gen, operator_control_plane& ctrl)
+  -> generator<T> {
+  // The state is shared with the blocking work, which may outlive this
+  // generator if the execution node shuts down while the work runs. The order
+  // of the members ensures that the generator dies before its control plane.
+  struct state {
+    std::shared_ptr<blocking_control_plane> ctrl = {};
+    generator<T> gen = {};
+    typename generator<T>::iterator it = {};
+    bool started = {};
+    std::exception_ptr error = {};
+  };
+  auto shared = std::make_shared<state>();
+  shared->ctrl = std::move(blocking_ctrl);
+  shared->gen = std::move(gen);
+  while (true) {
+    ctrl.run_blocking([shared] {
+      try {
+        if (not shared->started) {
+          shared->started = true;
+          shared->it = shared->gen.begin();
+        } else {
+          ++shared->it;
+        }
+      } catch (...) {
+        // Exceptions, e.g., thrown diagnostics, belong to the execution node.
+        shared->error = std::current_exception();
+      }
+    });
+    co_yield {};
+    shared->ctrl->flush(ctrl);
+    if (shared->error) {
+      std::rethrow_exception(shared->error);
+    }
+    if (shared->it == shared->gen.end()) {
+      co_return;
+    }
+    co_yield std::move(*shared->it);
+  }
+}
+
+} // namespace tenzir
@@ -0,0 +1,178 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include <caf/expected.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tenzir {
+
+/// Options for the blocking executor.
+struct blocking_executor_options {
+  /// Parses the options from the `tenzir.blocking-executor` section of the
+  /// given configuration.
+  static auto make(const caf::settings& options)
+    -> caf::expected<blocking_executor_options>;
+
+  /// The maximum number of threads.
+  uint64_t max_threads = 64;
+
+  /// The time after which an idle thread exits.
+  duration keep_alive = std::chrono::seconds{10};
+
+  /// The time after which waiting tasks get threads of their own if all
+  /// threads are busy and none of them took a task in the meantime.
+  duration overflow_after = std::chrono::seconds{1};
+};
+
+/// A snapshot of the state of a blocking executor.
+struct blocking_executor_statistics {
+  /// The number of threads, including idle ones.
+  uint64_t threads = {};
+
+  /// The number of threads waiting for work.
+  uint64_t idle_threads = {};
+
+  /// The number of threads that run tasks beyond the maximum number of
+  /// threads, because all other threads were blocked.
+  uint64_t overflow_threads = {};
+
+  /// The number of tasks waiting for a thread.
+  uint64_t queued_tasks = {};
+
+  /// The number of tasks that finished.
+  uint64_t executed_tasks = {};
+
+  /// The number of tasks that a thread took from another thread's queue.
+  uint64_t stolen_tasks = {};
+
+  /// The moving average of the time tasks waited for a thread.
+  duration scheduling_latency = {};
+
+  /// The longest time a task waited for a thread.
+  duration max_scheduling_latency = {};
+};
+
+/// A bounded pool of threads for blocking work, e.g., operators reading from
+/// files or sockets.
+///
+/// Every thread has its own queue of tasks. Tasks submitted from a thread of
+/// the pool go to that thread's queue, all others go to a shared queue.
+/// Threads take tasks from their own queue first, then from the shared queue,
+/// and finally steal from other threads. The pool starts threads on demand
+/// when no thread is idle, up to the maximum, and stops threads that were idle
+/// for longer than the keep-alive time.
+///
+/// Tasks may block for an unbounded time, e.g., a loader waiting for a socket
+/// that never receives data. If all threads are busy and none of them took a
+/// task for the overflow time, the pool starts an overflow thread per waiting
+/// task. Overflow threads exit as soon as they find no more tasks, so the
+/// number of threads exceeds the maximum only while tasks would otherwise
+/// starve.
+class blocking_executor {
+public:
+  using task = std::function<void()>;
+
+  explicit blocking_executor(blocking_executor_options options);
+
+  /// Waits for all submitted tasks to finish.
+  ~blocking_executor() noexcept;
+
+  blocking_executor(const blocking_executor&) = delete;
+  auto operator=(const blocking_executor&) -> blocking_executor& = delete;
+  blocking_executor(blocking_executor&&) = delete;
+  auto operator=(blocking_executor&&) -> blocking_executor& = delete;
+
+  /// Returns the executor shared by the entire process.
+  /// @param options The configuration to read the options from on the first
+  /// call; later calls ignore it.
+  static auto instance(const caf::settings& options) -> blocking_executor&;
+
+  /// Schedules a task. Tasks must not throw.
+  void submit(task f);
+
+  /// Returns a snapshot of the executor's state.
+  auto statistics() const -> blocking_executor_statistics;
+
+private:
+  struct queued_task {
+    task f = {};
+    std::chrono::steady_clock::time_point enqueued = {};
+  };
+
+  struct worker {
+    std::mutex mutex = {};
+    std::deque<queued_task> tasks = {};
+    std::atomic<bool> active = {};
+  };
+
+  void run(worker& self);
+  void run_overflow();
+  void watch();
+  void execute(queued_task& next);
+  auto try_pop(worker& self, queued_task& result) -> bool;
+  auto try_steal(const worker* self, queued_task& result) -> bool;
+  void record_latency(duration latency);
+
+  /// Starts a thread on a free slot.
+  /// @pre `sleep_mutex_` is locked and `num_threads_ < workers_.size()`.
+  void start_thread();
+
+  /// Starts a thread that has no slot and runs tasks until none are left.
+  /// @pre `sleep_mutex_` is locked.
+  void start_overflow_thread();
+
+  blocking_executor_options options_ = {};
+
+  /// One slot per possible thread. The slots never move, so that threads can
+  /// steal from each other without holding a lock on the pool.
+  std::vector<std::unique_ptr<worker>> workers_ = {};
+
+  std::mutex global_mutex_ = {};
+  std::deque<queued_task> global_tasks_ = {};
+
+  /// Guards starting, sleeping, and stopping threads.
+  mutable std::mutex sleep_mutex_ = {};
+  std::condition_variable work_available_ = {};
+  std::condition_variable threads_stopped_ = {};
+  uint64_t num_threads_ = {};
+  uint64_t num_idle_ = {};
+  uint64_t num_overflow_threads_ = {};
+
+  /// Whether a thread watches for starving tasks. It runs only while the pool
+  /// is at its maximum and tasks are waiting.
+  bool watching_ = {};
+  std::condition_variable watchdog_ = {};
+
+  /// The number of idle threads that were asked to look for work but did not
+  /// wake up yet. Every submitted task either claims an idle thread or starts
+  /// a new one, so that no task waits behind a blocked thread.
+  uint64_t pending_wakeups_ = {};
+  bool stopping_ = {};
+
+  std::atomic<uint64_t> num_queued_ = {};
+  std::atomic<uint64_t> num_started_ = {};
+  std::atomic<uint64_t> num_executed_ = {};
+  std::atomic<uint64_t> num_stolen_ = {};
+  std::atomic<int64_t> scheduling_latency_ = {};
+  std::atomic<int64_t> max_scheduling_latency_ = {};
+};
+
+} // namespace tenzir
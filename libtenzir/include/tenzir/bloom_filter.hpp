@@ -84,6 +84,26 @@ public:
     return true;
   }
 
+  /// Test whether an element exists in the Bloom filter, given its
+  /// precomputed digests. This allows for hashing an element only once when
+  /// probing many Bloom filters that use the same hasher.
+  /// @param digests The digests of the element as computed by `hasher()`.
+  /// @returns The same result as `lookup` for the element.
+  /// @pre `digests.size() == num_hash_functions()`
+  template <class Digests>
+  bool lookup_digests(const Digests& digests) const {
+    TENZIR_ASSERT(digests.size() == hasher_.size());
+    for (size_t i = 0; i < digests.size(); ++i)
+      if (!bits_[position(i, digests[i])])
+        return false;
+    return true;
+  }
+
+  /// @returns The hasher that generates the digests of this filter.
+  [[nodiscard]] const hasher_type& hasher() const {
+    return hasher_;
+  }
+
   /// @returns The number of cells in the underlying bit vector.
   [[nodiscard]] size_t size() const {
     return bits_.size();
@@ -0,0 +1,252 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/bloom_filter.hpp"
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/uuid.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tenzir {
+
+/// An aggregate over many Bloom filters that answers a membership query for
+/// all of them at once.
+///
+/// Filters of the same shape, i.e., with the same number of cells and the same
+/// hasher, are grouped in blocks of 64 filters. A full block stores its filters
+/// bit-sliced: it holds one 64-bit word per cell, whose *i*-th bit is the cell
+/// of the block's *i*-th filter. A lookup hashes the value once per distinct
+/// hasher and intersects *k* words per block, which yields all filters of the
+/// block that may contain the value. Probing the filters one by one instead
+/// reads *k* scattered cells per filter.
+///
+/// A sliced block costs one word per cell regardless of how many filters it
+/// holds, so blocks that are not full keep the cells of every filter as they
+/// are and probe them one by one. A sliced block goes back to that once half
+/// of its filters are gone, which bounds the memory of the slices to twice
+/// that of the filters.
+/// @tparam HashFunction The hash function of the filters.
+template <class HashFunction>
+class bloom_filter_slices {
+public:
+  using filter_type = bloom_filter<HashFunction>;
+  using hasher_type = typename filter_type::hasher_type;
+  using digest_type = typename HashFunction::result_type;
+
+  /// Adds a filter.
+  /// @param id The ID that lookups return for the filter.
+  /// @param filter The filter to add.
+  /// @pre `!contains(id)`
+  void add(const uuid& id, const filter_type& filter) {
+    TENZIR_ASSERT(not contains(id));
+    const auto cells = filter.size();
+    auto index = static_cast<size_t>(
+      std::find_if(blocks_.begin(), blocks_.end(),
+                   [&](const block& x) {
+                     return x.occupied != full and x.cells == cells
+                            and x.hasher == filter.hasher();
+                   })
+      - blocks_.begin());
+    if (index == blocks_.size()) {
+      blocks_.emplace_back(cells, filter.hasher());
+    }
+    auto& target = blocks_[index];
+    const auto slot = static_cast<size_t>(std::countr_one(target.occupied));
+    target.occupied |= uint64_t{1} << slot;
+    target.ids[slot] = id;
+    const auto& words = filter.data().blocks();
+    target.filters[slot].assign(words.begin(), words.end());
+    if (target.occupied == full) {
+      target.slice();
+    }
+    slots_.emplace(id, std::pair{index, slot});
+  }
+
+  /// Removes a filter.
+  /// @param id The ID of the filter.
+  /// @returns Whether the filter existed.
+  bool erase(const uuid& id) {
+    const auto it = slots_.find(id);
+    if (it == slots_.end()) {
+      return false;
+    }
+    const auto [index, slot] = it->second;
+    slots_.erase(it);
+    auto& target = blocks_[index];
+    const auto mask = ~(uint64_t{1} << slot);
+    target.occupied &= mask;
+    if (target.occupied != 0) {
+      if (target.sliced.empty()) {
+        target.filters[slot] = std::vector<uint64_t>{};
+        return true;
+      }
+      for (auto& word : target.sliced) {
+        word &= mask;
+      }
+      if (std::popcount(target.occupied) <= 32) {
+        target.unslice();
+      }
+      return true;
+    }
+    // Drop empty blocks by moving the last block into their place.
+    if (index + 1 != blocks_.size()) {
+      target = std::move(blocks_.back());
+      for (auto occupied = target.occupied; occupied != 0;
+           occupied &= occupied - 1) {
+        slots_[target.ids[std::countr_zero(occupied)]].first = index;
+      }
+    }
+    blocks_.pop_back();
+    return true;
+  }
+
+  /// Checks whether the slices contain a filter.
+  [[nodiscard]] bool contains(const uuid& id) const {
+    return slots_.contains(id);
+  }
+
+  /// @returns The number of filters.
+  [[nodiscard]] size_t size() const {
+    return slots_.size();
+  }
+
+  /// Appends the IDs of all filters that may contain a value, in no
+  /// particular order.
+  /// @param x The value to look up.
+  /// @param result The list to append the IDs to.
+  template <class T>
+  void lookup(const T& x, std::vector<uuid>& result) const {
+    // Filters of different shapes usually share their hasher, so we compute
+    // the digests again only when the hasher changes.
+    const hasher_type* hasher = nullptr;
+    auto digests = std::vector<digest_type>{};
+    for (const auto& current : blocks_) {
+      if (hasher == nullptr or not(*hasher == current.hasher)) {
+        const auto& xs = current.hasher(x);
+        digests.assign(xs.begin(), xs.end());
+        hasher = &current.hasher;
+      }
+      auto candidates = current.occupied;
+      if (current.sliced.empty()) {
+        for (auto occupied = current.occupied; occupied != 0;
+             occupied &= occupied - 1) {
+          const auto slot = std::countr_zero(occupied);
+          const auto& words = current.filters[slot];
+          for (const auto digest : digests) {
+            const auto cell = digest % current.cells;
+            if (((words[cell / 64] >> (cell % 64)) & 1) == 0) {
+              candidates &= ~(uint64_t{1} << slot);
+              break;
+            }
+          }
+        }
+      } else {
+        for (const auto digest : digests) {
+          candidates &= current.sliced[digest % current.cells];
+          if (candidates == 0) {
+            break;
+          }
+        }
+      }
+      for (; candidates != 0; candidates &= candidates - 1) {
+        result.push_back(current.ids[std::countr_zero(candidates)]);
+      }
+    }
+  }
+
+  /// @returns An estimate for the amount of memory (in bytes) used.
+  [[nodiscard]] size_t memusage() const {
+    auto result = sizeof(bloom_filter_slices)
+                  + slots_.size() * (sizeof(uuid) + 2 * sizeof(size_t));
+    for (const auto& current : blocks_) {
+      result += sizeof(block) + current.sliced.capacity() * sizeof(uint64_t);
+      for (const auto& words : current.filters) {
+        result += words.capacity() * sizeof(uint64_t);
+      }
+    }
+    return result;
+  }
+
+private:
+  static constexpr auto full = ~uint64_t{0};
+
+  struct block {
+    block(size_t cells, hasher_type hasher)
+      : cells{cells}, hasher{std::move(hasher)} {
+      // nop
+    }
+
+    /// Moves the cells of all filters into bit-sliced words.
+    void slice() {
+      sliced.assign(cells, 0);
+      for (auto slots = occupied; slots != 0; slots &= slots - 1) {
+        const auto slot = std::countr_zero(slots);
+        const auto mask = uint64_t{1} << slot;
+        auto& words = filters[slot];
+        for (size_t i = 0; i < words.size(); ++i) {
+          for (auto word = words[i]; word != 0; word &= word - 1) {
+            const auto cell = i * 64 + std::countr_zero(word);
+            if (cell < cells) {
+              sliced[cell] |= mask;
+            }
+          }
+        }
+        words = std::vector<uint64_t>{};
+      }
+    }
+
+    /// Moves the bit-sliced words back into the cells of every filter.
+    void unslice() {
+      for (auto slots = occupied; slots != 0; slots &= slots - 1) {
+        const auto slot = std::countr_zero(slots);
+        auto& words = filters[slot];
+        words.assign((cells + 63) / 64, 0);
+        for (size_t cell = 0; cell < cells; ++cell) {
+          words[cell / 64] |= ((sliced[cell] >> slot) & 1) << (cell % 64);
+        }
+      }
+      sliced = std::vector<uint64_t>{};
+    }
+
+    /// The number of cells of every filter in the block.
+    size_t cells = {};
+
+    /// The hasher of every filter in the block.
+    hasher_type hasher;
+
+    /// The slots that hold a filter.
+    uint64_t occupied = {};
+
+    /// One word per cell, holding the cell of every filter; only set for
+    /// sliced blocks.
+    std::vector<uint64_t> sliced = {};
+
+    /// The cells of every filter by slot; only set for blocks that are not
+    /// sliced.
+    std::array<std::vector<uint64_t>, 64> filters = {};
+
+    /// The IDs of the filters by slot.
+    std::array<uuid, 64> ids = {};
+  };
+
+  std::vector<block> blocks_ = {};
+
+  /// Maps filter IDs to their block and slot.
+  std::unordered_map<uuid, std::pair<size_t, size_t>> slots_ = {};
+};
+
+} // namespace tenzir
@@ -12,7 +12,11 @@
 #include "tenzir/synopsis.hpp"
 #include "tenzir/type.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <optional>
+#include <utility>
+#include <vector>
 
 namespace tenzir {
 
@@ -100,6 +104,46 @@ protected:
   bloom_filter<HashFunction> bloom_filter_;
 };
 
+/// Probes many Bloom filter synopses for equality with the same value. Unlike
+/// calling `lookup` on every synopsis, this hashes the value only once per
+/// distinct hasher, which dominates the cost of probing the filters of many
+/// partitions for a single value.
+template <class T, class HashFunction>
+class bloom_filter_synopsis_probe {
+public:
+  using synopsis_type = bloom_filter_synopsis<T, HashFunction>;
+  using hasher_type = typename synopsis_type::hasher_type;
+  using digest_type = typename HashFunction::result_type;
+
+  /// Constructs a probe for a value.
+  /// @param value The value to look up.
+  explicit bloom_filter_synopsis_probe(view<T> value) : value_{value} {
+    // nop
+  }
+
+  /// Checks whether a synopsis may contain the value.
+  /// @param synopsis The synopsis to probe.
+  /// @returns The same result as `synopsis.lookup(relational_operator::equal,
+  /// value)`.
+  bool operator()(const synopsis_type& synopsis) {
+    const auto& filter = synopsis.filter();
+    const auto& hasher = filter.hasher();
+    auto it = std::find_if(digests_.begin(), digests_.end(),
+                           [&](const auto& entry) {
+                             return entry.first == hasher;
+                           });
+    if (it == digests_.end()) {
+      digests_.emplace_back(hasher, hasher(value_));
+      it = std::prev(digests_.end());
+    }
+    return filter.lookup_digests(it->second);
+  }
+
+private:
+  view<T> value_;
+  std::vector<std::pair<hasher_type, std::vector<digest_type>>> digests_ = {};
+};
+
 // Because Tenzir deserializes a synopsis with empty options and
 // construction of an address synopsis fails without any sizing
 // information, we augment the type with the synopsis options.
@@ -11,10 +11,12 @@
 #include "tenzir/fwd.hpp"
 
 #include "tenzir/actors.hpp"
+#include "tenzir/bloom_filter_slices.hpp"
 #include "tenzir/detail/flat_map.hpp"
 #include "tenzir/detail/heterogeneous_string_hash.hpp"
 #include "tenzir/detail/inspection_common.hpp"
 #include "tenzir/expression.hpp"
+#include "tenzir/hash/legacy_hash.hpp"
 #include "tenzir/module.hpp"
 #include "tenzir/partition_synopsis.hpp"
 #include "tenzir/taxonomies.hpp"
@@ -24,6 +26,7 @@
 #include <caf/settings.hpp>
 #include <caf/typed_event_based_actor.hpp>
 
+#include <functional>
 #include <map>
 #include <string>
 #include <vector>
@@ -80,6 +83,61 @@ struct catalog_lookup_result {
   }
 };
 
+/// Bit-sliced copies of the IP address and string Bloom filter synopses of
+/// the partitions of a schema, which allow for probing the synopses of many
+/// partitions at once in equality lookups.
+struct catalog_bloom_index {
+  /// The synopses of one field or type.
+  struct entry {
+    /// The Bloom filters of the partitions with an IP address synopsis.
+    bloom_filter_slices<legacy_hash> ips = {};
+
+    /// The Bloom filters of the partitions with a string synopsis.
+    bloom_filter_slices<legacy_hash> strings = {};
+
+    /// The number of partitions without a synopsis.
+    size_t num_missing = {};
+
+    /// The number of partitions with any other kind of synopsis.
+    size_t num_other = {};
+
+    /// @returns The number of partitions with a sliced Bloom filter.
+    [[nodiscard]] size_t num_sliced() const {
+      return ips.size() + strings.size();
+    }
+  };
+
+  /// Adds the synopses of a partition.
+  void add(const uuid& partition, const partition_synopsis& synopsis);
+
+  /// Removes the synopses of a partition.
+  void erase(const uuid& partition, const partition_synopsis& synopsis);
+
+  /// Computes the candidate partitions for an equality predicate with an IP
+  /// address or string.
+  /// @param match Selects the fields that the predicate applies to.
+  /// @param rhs The value to look up.
+  /// @param result The list to append the candidate partitions to, in no
+  /// particular order.
+  /// @returns False if the Bloom filters of some partitions are not sliced,
+  /// and the caller must probe the synopses one by one instead.
+  [[nodiscard]] bool
+  lookup(const std::function<bool(const qualified_record_field&)>& match,
+         data_view rhs, std::vector<uuid>& result) const;
+
+  /// @returns A best-effort estimate of the amount of memory used (in bytes).
+  [[nodiscard]] size_t memusage() const;
+
+  /// The number of partitions.
+  size_t num_partitions = {};
+
+  /// The synopses of individual fields.
+  std::unordered_map<qualified_record_field, entry> fields = {};
+
+  /// The synopses of types.
+  std::unordered_map<type, entry> types = {};
+};
+
 /// The state of the CATALOG actor.
 struct catalog_state {
 public:
@@ -153,6 +211,9 @@ public:
                      detail::flat_map<uuid, partition_synopsis_ptr>>
     synopses_per_type = {};
 
+  /// For each type, the sliced Bloom filter synopses of its partitions.
+  std::unordered_map<tenzir::type, catalog_bloom_index> bloom_indexes = {};
+
   /// The set of fields that should not be touched by the pruner.
   detail::heterogeneous_string_hashset unprunable_fields;
 
@@ -118,6 +118,13 @@ namespace index {
 /// The maximum length of a string before the default string index chops it off.
 inline constexpr size_t max_string_size = 1024;
 
+/// The number of bytes per n-gram of the n-gram string index.
+inline constexpr size_t ngram_size = 3;
+
+/// The maximum number of distinct n-grams that the n-gram string index tracks
+/// posting lists for.
+inline constexpr size_t max_ngrams = 65'536;
+
 /// The maximum number elements an index for a container type (set, vector,
 /// or table).
 inline constexpr size_t max_container_elements = 256;
@@ -186,6 +193,54 @@ inline constexpr std::chrono::seconds max_timeout = std::chrono::seconds{5};
 
 } // namespace api
 
+// -- constants for the transport of events between pipeline operators ---------
+
+namespace pipeline_transport {
+
+/// The buffer compression used when sending events to an execution node in a
+/// different process.
+inline constexpr std::string_view compression = "lz4";
+
+/// The number of rows up to which consecutive small batches with the same
+/// schema are coalesced before sending them to a different process.
+inline constexpr uint64_t coalesce_rows = 65'536; // 64 Ki
+
+/// The number of schemas for which an execution node keeps an open stream to
+/// a different process.
+inline constexpr uint64_t max_streams = 256;
+
+} // namespace pipeline_transport
+
+// -- constants for the demand between pipeline operators ----------------------
+
+namespace pipeline_batching {
+
+/// Whether execution nodes adapt the batch size and timeout of their demand
+/// to the measured input rate and processing cost.
+inline constexpr bool adaptive = true;
+
+/// The time an event should wait at most between two operators.
+inline constexpr std::chrono::milliseconds latency_target
+  = std::chrono::seconds{1};
+
+} // namespace pipeline_batching
+
+// -- constants for the blocking executor --------------------------------------
+
+namespace blocking_executor {
+
+/// The maximum number of threads that run blocking work of operators.
+inline constexpr uint64_t max_threads = 64;
+
+/// The time after which an idle thread of the blocking executor exits.
+inline constexpr std::chrono::seconds keep_alive = std::chrono::seconds{10};
+
+/// The time after which waiting tasks of the blocking executor get threads of
+/// their own if all threads are blocked.
+inline constexpr std::chrono::seconds overflow_after = std::chrono::seconds{1};
+
+} // namespace blocking_executor
+
 // -- constants for the entire system ------------------------------------------
 
 /// Hostname or IP address and port of a remote node.
@@ -0,0 +1,97 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include <caf/expected.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+namespace tenzir {
+
+/// Options for the demand that execution nodes signal to their previous
+/// execution node.
+struct demand_options {
+  /// Parses the options from the `tenzir.pipeline-batching` section of the
+  /// given configuration.
+  static auto make(const caf::settings& options)
+    -> caf::expected<demand_options>;
+
+  /// Whether to adapt batch size and timeout to the measured input rate and
+  /// processing cost. If disabled, execution nodes always request the maximum
+  /// batch size.
+  bool adaptive = true;
+
+  /// The time an element should wait at most between two operators. Smaller
+  /// values favor latency, larger values favor throughput.
+  duration latency_target = std::chrono::seconds{1};
+};
+
+/// The bounds within which a demand controller picks its values. They depend
+/// on the type of the elements flowing between two operators.
+struct demand_bounds {
+  uint64_t min_batch_size = 1;
+  uint64_t max_batch_size = 1;
+  duration min_batch_timeout = {};
+  duration max_batch_timeout = {};
+};
+
+/// Tunes the batch size and timeout of the demand of an execution node.
+///
+/// The previous execution node delivers a batch once it has as many elements
+/// as requested, or once the timeout expires. The controller therefore grows
+/// the batch size while batches arrive full, and shrinks it to about the
+/// number of elements that actually arrived when the timeout expired. This
+/// way, low-rate inputs are delivered as soon as they arrive, and high-rate
+/// inputs arrive in few large batches. The timeout never exceeds the latency
+/// target, and the batch size is capped such that processing a batch takes
+/// no longer than the latency target.
+class demand_controller {
+public:
+  demand_controller() = default;
+
+  demand_controller(demand_bounds bounds, demand_options options) noexcept;
+
+  /// The number of elements to request next.
+  auto batch_size() const noexcept -> uint64_t;
+
+  /// The time after which the previous execution node should deliver a
+  /// partial batch.
+  auto batch_timeout() const noexcept -> duration;
+
+  /// Records the result of a request.
+  /// @param requested The number of requested elements.
+  /// @param received The number of elements that arrived.
+  /// @param backlog The number of elements that were still buffered when
+  /// issuing the request.
+  void finish_request(uint64_t requested, uint64_t received,
+                      uint64_t backlog) noexcept;
+
+  /// Records the time spent processing a number of input elements.
+  void add_processing(uint64_t elements, duration elapsed) noexcept;
+
+  /// Resets the timeout to its lower bound, e.g., after resuming a paused
+  /// pipeline.
+  void reset_timeout() noexcept;
+
+private:
+  void apply_cost_cap() noexcept;
+
+  demand_bounds bounds_ = {};
+  demand_options options_ = {};
+  uint64_t batch_size_ = 1;
+  duration batch_timeout_ = {};
+
+  /// The moving average of the processing time per element in nanoseconds.
+  double cost_per_element_ = {};
+};
+
+} // namespace tenzir
@@ -0,0 +1,42 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace tenzir::detail {
+
+enum class frame_status { complete, incomplete, unsplittable };
+
+/// The outcome of looking for a frame at the start of a buffer.
+struct frame_info {
+  frame_status status = frame_status::unsplittable;
+
+  /// The size of the frame in bytes if it is complete.
+  int64_t size = {};
+
+  /// Whether the frame carries no compressed data.
+  bool skippable = {};
+};
+
+/// Walks the block headers of a zstd frame to find its end without
+/// decompressing it, see RFC 8878.
+auto scan_zstd_frame(std::span<const uint8_t> bytes) -> frame_info;
+
+/// Walks the blocks of an LZ4 frame to find its end without decompressing it,
+/// see the LZ4 frame format description.
+auto scan_lz4_frame(std::span<const uint8_t> bytes) -> frame_info;
+
+/// Finds the end of a gzip member that carries its size in a BGZF extra field,
+/// as written by bgzip. Plain gzip members do not record their size, so we
+/// cannot split them without decompressing them.
+auto scan_bgzf_block(std::span<const uint8_t> bytes) -> frame_info;
+
+} // namespace tenzir::detail
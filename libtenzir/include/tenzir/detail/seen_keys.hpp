@@ -0,0 +1,105 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include "tenzir/data.hpp"
+#include "tenzir/time.hpp"
+#include "tenzir/type.hpp"
+#include "tenzir/view.hpp"
+
+#include <tsl/robin_set.h>
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <vector>
+
+namespace tenzir::detail {
+
+/// A set of keys with an optional bound on its size and on the time that a key
+/// is remembered for. Keys are ordered by the last time they were seen, so both
+/// evicting the least recently seen key and expiring keys happen at the back of
+/// the list. This works like `detail::lru_cache`, except that we probe with
+/// views and digests computed for entire columns.
+class seen_keys {
+public:
+  /// A view on a key, which we use to probe the set without materializing it.
+  struct key_view {
+    /// The type that identifies keys of equal values from different schemas as
+    /// different, or the null type if only the values count.
+    const type* schema = {};
+    std::vector<data_view> values = {};
+  };
+
+  /// Constructs an empty set.
+  /// @param max_size The maximum number of remembered keys.
+  /// @param ttl For how long a key is remembered after it was seen last.
+  seen_keys(std::optional<uint64_t> max_size, std::optional<duration> ttl);
+
+  /// Checks whether a key was seen before, and remembers it as seen now.
+  /// @param key The key to check.
+  /// @param digest The digest of *key*.
+  /// @param now The current time.
+  /// @returns Whether the key is new, or was last seen more than the TTL ago.
+  auto insert(const key_view& key, size_t digest, time now) -> bool;
+
+  /// Forgets all keys that were not seen for longer than the TTL.
+  /// @param now The current time.
+  void expire(time now);
+
+  /// Returns the number of remembered keys.
+  auto size() const noexcept -> size_t;
+
+private:
+  /// A remembered key in the order of recency.
+  struct entry {
+    type schema = {};
+    std::vector<data> values = {};
+
+    /// The digest of the key, which we compute once from the arrays.
+    size_t digest = {};
+
+    /// The last time that we saw the key.
+    time last_seen = {};
+  };
+
+  using entry_list = std::list<entry>;
+
+  /// Hashes remembered keys by their precomputed digest. Lookups always
+  /// provide the digest of the key view as well.
+  struct entry_hash {
+    using is_transparent = void;
+
+    auto operator()(entry_list::const_iterator x) const noexcept -> size_t;
+    auto operator()(const key_view&) const noexcept -> size_t;
+  };
+
+  struct entry_equal {
+    using is_transparent = void;
+
+    auto operator()(entry_list::const_iterator x,
+                    entry_list::const_iterator y) const noexcept -> bool;
+    auto operator()(const key_view& x,
+                    entry_list::const_iterator y) const noexcept -> bool;
+    auto operator()(entry_list::const_iterator x,
+                    const key_view& y) const noexcept -> bool;
+  };
+
+  void pop_back();
+
+  std::optional<uint64_t> max_size_ = {};
+  std::optional<duration> ttl_ = {};
+  entry_list order_ = {};
+  tsl::robin_set<entry_list::const_iterator, entry_hash, entry_equal> index_
+    = {};
+};
+
+} // namespace tenzir::detail
@@ -162,6 +162,7 @@ class plugin_ptr;
 class plugin;
 class port;
 class record_type;
+class roaring_bitmap;
 class segment;
 class string_type;
 class subnet_type;
@@ -242,6 +243,7 @@ struct rest_response;
 struct schema_statistics;
 struct spawn_arguments;
 struct status;
+struct table_slice_frame;
 struct taxonomies;
 struct type_extractor;
 struct type_set;
@@ -322,6 +324,7 @@ namespace bitmap {
 
 struct EWAHBitmap;
 struct NullBitmap;
+struct RoaringBitmap;
 struct WAHBitmap;
 
 } // namespace bitmap
@@ -433,9 +436,11 @@ CAF_BEGIN_TYPE_ID_BLOCK(tenzir_types, first_tenzir_type_id)
   TENZIR_ADD_TYPE_ID((tenzir::relational_operator))
   TENZIR_ADD_TYPE_ID((tenzir::rest_endpoint))
   TENZIR_ADD_TYPE_ID((tenzir::rest_response))
+  TENZIR_ADD_TYPE_ID((tenzir::roaring_bitmap))
   TENZIR_ADD_TYPE_ID((tenzir::subnet))
   TENZIR_ADD_TYPE_ID((tenzir::table_slice))
   TENZIR_ADD_TYPE_ID((tenzir::table_slice_column))
+  TENZIR_ADD_TYPE_ID((tenzir::table_slice_frame))
   TENZIR_ADD_TYPE_ID((tenzir::taxonomies))
   TENZIR_ADD_TYPE_ID((tenzir::type))
   TENZIR_ADD_TYPE_ID((tenzir::type_extractor))
@@ -477,6 +482,7 @@ CAF_BEGIN_TYPE_ID_BLOCK(tenzir_types, first_tenzir_type_id)
   TENZIR_ADD_TYPE_ID((std::vector<tenzir::framed<tenzir::chunk_ptr>>))
   TENZIR_ADD_TYPE_ID((std::vector<tenzir::framed<tenzir::table_slice>>))
   TENZIR_ADD_TYPE_ID((std::vector<tenzir::table_slice_column>))
+  TENZIR_ADD_TYPE_ID((std::vector<tenzir::table_slice_frame>))
   TENZIR_ADD_TYPE_ID((std::vector<tenzir::uuid>))
   TENZIR_ADD_TYPE_ID((std::vector<tenzir::partition_info>))
   TENZIR_ADD_TYPE_ID(
@@ -0,0 +1,82 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include "tenzir/hash/default_hash.hpp"
+#include "tenzir/hash/hash_append.hpp"
+#include "tenzir/view.hpp"
+
+#include <arrow/type_fwd.h>
+#include <caf/detail/type_list.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace tenzir {
+
+/// The digest type produced by the columnar hash kernels.
+using array_digest = default_hash::result_type;
+
+namespace detail {
+
+/// The index of a view type in the `data_view` variant, which `hash_append`
+/// prepends when hashing a `data_view`.
+template <class View>
+inline constexpr auto data_view_tag = static_cast<uint8_t>(
+  caf::detail::tl_index_of<data_view::types, View>::value);
+
+} // namespace detail
+
+/// Computes the digest of a single value exactly like `hash_array` does for a
+/// row with that value, i.e., as if hashing the corresponding `data_view`.
+/// Use this for hash tables that are probed with the digests of `hash_array`.
+/// @param x The view to hash.
+template <class View>
+auto hash_as_data_view(const View& x) noexcept -> array_digest {
+  auto h = default_hash{};
+  hash_append(h, detail::data_view_tag<View>);
+  hash_append(h, x);
+  return h.finish();
+}
+
+/// Computes a hash digest for every element of an array in one pass.
+///
+/// The digest of every row is identical to `hash(value)`, or to
+/// `hash(value, *salt)` if a salt is provided, where `value` is the
+/// `data_view` of that row. This holds for null values as well. Unlike
+/// hashing the values one by one, the kernel neither materializes views nor
+/// sets up a new hash state per row.
+/// @param type The type of the array.
+/// @param array The array to hash.
+/// @param digests The output digests.
+/// @param salt An optional salt that gets appended to every value.
+/// @pre `digests.size() == array.length()`
+auto hash_array(const type& type, const arrow::Array& array,
+                std::span<array_digest> digests,
+                std::optional<std::string_view> salt = std::nullopt) -> void;
+
+/// Computes a hash digest for every element of an array in one pass.
+/// @relates hash_array
+auto hash_array(const type& type, const arrow::Array& array,
+                std::optional<std::string_view> salt = std::nullopt)
+  -> std::vector<array_digest>;
+
+/// Formats digests as lowercase hexadecimal strings into a pre-sized string
+/// array. Every string equals `fmt::format("{:x}", digest)`.
+/// @param digests The digests to format.
+auto make_hex_digest_array(std::span<const array_digest> digests)
+  -> std::shared_ptr<arrow::StringArray>;
+
+} // namespace tenzir
@@ -17,7 +17,10 @@
 #include <caf/expected.hpp>
 #include <caf/optional.hpp>
 
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace tenzir {
 
@@ -36,6 +39,7 @@ auto http_method_from_string(const std::string& str)
 enum class http_content_type : uint16_t {
   json,
   ldjson,
+  arrow_ipc,
 };
 
 enum class http_status_code : uint16_t {
@@ -120,6 +124,10 @@ struct rest_response {
   /// Create a response from a JSON string.
   static auto from_json_string(std::string json) -> rest_response;
 
+  /// Create a response with a non-JSON body.
+  static auto from_binary(std::string body, http_content_type content_type)
+    -> rest_response;
+
   /// Returns an error that uses `{error: "{message}"}` as the response body.
   static auto make_error(uint16_t error_code, std::string_view message,
                          caf::error detail = {}) -> rest_response;
@@ -138,12 +146,31 @@ struct rest_response {
   auto error_detail() const -> const caf::error&;
   auto release() && -> std::string;
 
+  /// Returns the content type of the response if it differs from the content
+  /// type of the endpoint.
+  auto content_type() const -> const std::optional<http_content_type>&;
+
+  /// Adds a header to the response.
+  auto add_header(std::string field, std::string value) -> void;
+  auto headers() const
+    -> const std::vector<std::pair<std::string, std::string>>&;
+
+  /// Turns the response into one chunk of a streamed response. The server
+  /// writes the body as a chunk and, once the client received it, requests
+  /// the same endpoint again with the given parameters to get the next chunk.
+  /// A response without follow-up parameters ends the stream.
+  auto set_follow_up(tenzir::record params) -> void;
+  auto follow_up() const -> const std::optional<tenzir::record>&;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, rest_response& r) {
     return f.object(r)
       .pretty_name("tenzir.rest_response")
       .fields(f.field("code", r.code_), f.field("body", r.body_),
-              f.field("detail", r.detail_));
+              f.field("detail", r.detail_),
+              f.field("content-type", r.content_type_),
+              f.field("headers", r.headers_),
+              f.field("follow-up", r.follow_up_));
   }
 
 private:
@@ -161,6 +188,15 @@ private:
 
   // For log messages, debugging, etc. Not returned to the client.
   caf::error detail_ = {};
+
+  // Overrides the content type of the endpoint, if set.
+  std::optional<http_content_type> content_type_ = {};
+
+  // Additional response headers.
+  std::vector<std::pair<std::string, std::string>> headers_ = {};
+
+  // The parameters for requesting the next chunk of a streamed response.
+  std::optional<tenzir::record> follow_up_ = {};
 };
 
 /// Used for serializing an incoming request to be able to send it as a caf
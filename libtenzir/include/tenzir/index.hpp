@@ -330,6 +330,9 @@ struct index_state {
   /// Timekeeper for the scheduling algorithm.
   struct measurement scheduler_measurement = {};
 
+  /// Timekeeper for routing incoming events to the active partitions.
+  struct measurement ingest_measurement = {};
+
   /// Handle of the accountant.
   accountant_actor accountant = {};
 
@@ -0,0 +1,74 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/ids.hpp"
+#include "tenzir/roaring_bitmap.hpp"
+#include "tenzir/value_index.hpp"
+#include "tenzir/view.hpp"
+
+#include <caf/error.hpp>
+#include <caf/expected.hpp>
+#include <caf/fwd.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tenzir {
+
+/// An inverted index for strings that maps every n-gram to the IDs of the
+/// values that contain it. Substring and pattern queries intersect the posting
+/// lists of all n-grams of the literal they search for.
+///
+/// The index answers lookups with candidates, i.e., a superset of the exact
+/// result. To bound the memory footprint, the index tracks at most
+/// `max-ngrams` distinct n-grams and considers only the first `max-size` bytes
+/// of every value; values that overflow either limit are always candidates.
+class ngram_index : public value_index {
+public:
+  /// Constructs an n-gram index.
+  /// @param t An instance of `string_type`.
+  /// @param opts Runtime context for index parameterization.
+  explicit ngram_index(tenzir::type t, caf::settings opts = {});
+
+  bool inspect_impl(supported_inspectors& inspector) override;
+
+  /// Extracts the longest literal prefix that every match of a regular
+  /// expression must contain, or an empty string if there is none.
+  /// @param regex The regular expression.
+  static auto literal_prefix(std::string_view regex) -> std::string;
+
+private:
+  bool append_impl(data_view x, id pos) override;
+
+  caf::expected<ids>
+  lookup_impl(relational_operator op, data_view x) const override;
+
+  size_t memusage_impl() const override;
+
+  flatbuffers::Offset<fbs::ValueIndex>
+  pack_impl(flatbuffers::FlatBufferBuilder& builder,
+            flatbuffers::Offset<fbs::value_index::detail::ValueIndexBase>
+              base_offset) override;
+
+  caf::error unpack_impl(const fbs::ValueIndex& from) override;
+
+  /// Computes the candidates for values that contain a literal.
+  auto candidates(std::string_view literal) const -> ids;
+
+  size_t ngram_size_;
+  size_t max_length_;
+  size_t max_ngrams_;
+  std::unordered_map<std::string, roaring_bitmap> postings_;
+  roaring_bitmap overflow_;
+};
+
+} // namespace tenzir
@@ -15,6 +15,7 @@
 #include "tenzir/type.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tenzir {
@@ -27,11 +28,12 @@ struct index_config {
     std::vector<std::string> targets = {};
     double fp_rate = defaults::fp_rate;
     bool create_partition_index = defaults::create_partition_index;
+    std::string value_index = {};
 
     template <class Inspector>
     friend auto inspect(Inspector& f, rule& x) {
       return detail::apply_all(f, x.targets, x.fp_rate,
-                               x.create_partition_index);
+                               x.create_partition_index, x.value_index);
     }
 
     static inline const record_type& schema() noexcept {
@@ -39,6 +41,7 @@ struct index_config {
         {"targets", list_type{string_type{}}},
         {"fp-rate", double_type{}},
         {"partition-index", bool_type{}},
+        {"value-index", string_type{}},
       };
       return result;
     }
@@ -64,4 +67,10 @@ struct index_config {
 bool should_create_partition_index(const qualified_record_field& index_qf,
                                    const std::vector<index_config::rule>& rules);
 
+/// Returns the value index that the first rule applicable to a field selects,
+/// or an empty string if no such rule exists or the rule selects none.
+std::string_view
+selected_value_index(const qualified_record_field& index_qf,
+                     const std::vector<index_config::rule>& rules);
+
 } // namespace tenzir
@@ -19,6 +19,7 @@
 #include <bit>
 #include <cstddef>
 #include <cstring>
+#include <memory>
 #include <span>
 #include <string>
 #include <type_traits>
@@ -190,6 +191,40 @@ private:
   byte_array bytes_;
 };
 
+/// Pseudonymizes many addresses with the same seed using the Crypto-PAn
+/// algorithm. The results are identical to those of `ip::pseudonymize`, but
+/// the cipher gets initialized only once, and the one-time pad of every
+/// byte-aligned address prefix is cached. Addresses that share a prefix thus
+/// only pay for the bytes in which they differ.
+class ip_pseudonymizer {
+public:
+  /// The default maximum number of cached prefixes.
+  static constexpr inline auto default_cache_capacity = size_t{1} << 16;
+
+  /// Constructs a pseudonymizer.
+  /// @param seed 256-bit seed for the cipher and padding.
+  /// @param cache_capacity The maximum number of cached prefixes, or zero to
+  /// disable caching.
+  explicit ip_pseudonymizer(
+    const std::array<ip::byte_type, ip::pseudonymization_seed_array_size>& seed,
+    size_t cache_capacity = default_cache_capacity);
+
+  ~ip_pseudonymizer() noexcept;
+  ip_pseudonymizer(const ip_pseudonymizer&) = delete;
+  auto operator=(const ip_pseudonymizer&) -> ip_pseudonymizer& = delete;
+  ip_pseudonymizer(ip_pseudonymizer&&) noexcept;
+  auto operator=(ip_pseudonymizer&&) noexcept -> ip_pseudonymizer&;
+
+  /// Pseudonymizes an address.
+  /// @param original The address to be pseudonymized.
+  /// @returns A copy of the `original` address with pseudonymized bytes.
+  auto operator()(const ip& original) -> ip;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
 template <>
 struct is_uniquely_represented<ip>
   : std::bool_constant<sizeof(ip) == sizeof(ip::byte_array)> {};
@@ -18,6 +18,8 @@
 
 #include <caf/typed_actor.hpp>
 
+#include <functional>
+
 namespace tenzir {
 
 /// The operator control plane is the bridge between an operator and an
@@ -61,6 +63,15 @@ struct operator_control_plane {
 
   /// Returns true if the operator is hosted by process that has a terminal.
   virtual auto has_terminal() const noexcept -> bool = 0;
+
+  /// Runs blocking work, e.g., reading from a file or a socket, on a shared
+  /// pool of threads. The operator is not advanced until the work finished, so
+  /// it should yield right after calling this. The work must neither access
+  /// the operator nor this control plane; see `blocking_control_plane`.
+  /// Control planes without such a pool run the work immediately.
+  virtual auto run_blocking(std::function<void()> work) noexcept -> void {
+    work();
+  }
 };
 
 } // namespace tenzir
@@ -20,6 +20,7 @@
 #include "tenzir/type.hpp"
 #include "tenzir/uuid.hpp"
 #include "tenzir/value_index.hpp"
+#include "tenzir/zone_map.hpp"
 
 #include <caf/optional.hpp>
 #include <caf/stream_slot.hpp>
@@ -71,6 +72,9 @@ struct passive_partition_state {
   /// Maps type names to ids. Used the answer #schema queries.
   std::unordered_map<std::string, ids> type_ids_ = {};
 
+  /// The zone maps of all table slices in the partition, ordered by offset.
+  std::vector<zone_map> zone_maps = {};
+
   /// A readable name for this partition.
   static constexpr auto name = "passive-partition";
 
@@ -200,6 +200,11 @@ struct [[nodiscard]] metric {
   uint64_t num_runs_processing_input = {};
   uint64_t num_runs_processing_output = {};
 
+  // The batch size and timeout that the operator last requested from the
+  // previous operator.
+  uint64_t demand_batch_size = {};
+  duration demand_batch_timeout = {};
+
   template <class Inspector>
   friend auto inspect(Inspector& f, metric& x) -> bool {
     return f.object(x).pretty_name("metric").fields(
@@ -214,7 +219,9 @@ struct [[nodiscard]] metric {
       f.field("num_runs", x.num_runs),
       f.field("num_runs_processing", x.num_runs_processing),
       f.field("num_runs_processing_input", x.num_runs_processing_input),
-      f.field("num_runs_processing_output", x.num_runs_processing_output));
+      f.field("num_runs_processing_output", x.num_runs_processing_output),
+      f.field("demand_batch_size", x.demand_batch_size),
+      f.field("demand_batch_timeout", x.demand_batch_timeout));
   }
 };
 
@@ -329,7 +336,9 @@ public:
     return operator_location::anywhere;
   }
 
-  /// Returns whether the operator should be spawned in its own thread.
+  /// Returns whether the operator should be spawned in its own thread. Prefer
+  /// `operator_control_plane::run_blocking` for operators that only need to
+  /// block occasionally, which shares a bounded pool of threads.
   virtual auto detached() const -> bool {
     return false;
   }
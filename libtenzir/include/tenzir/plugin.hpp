@@ -32,6 +32,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <span>
 #include <type_traits>
 #include <vector>
@@ -558,6 +559,38 @@ class printer_plugin : public virtual printer_inspection_plugin<Printer>,
 struct printer_info {
   type input_schema{};
   std::string format{};
+
+  /// The values of the partitioning fields that all events for this saver
+  /// instance share. Empty unless the saver partitions its output.
+  record partition{};
+
+  /// The number of earlier saver instances for the same schema and partition
+  /// whose output this instance does not continue. Non-zero only if the saver
+  /// rolls over its output or limits the number of its instances.
+  uint64_t sequence_number{};
+
+  /// Whether this instance continues the output of an earlier instance with
+  /// the same schema, partition, and sequence number, which was finished to
+  /// make room for other instances. Only set if the printer allows joining.
+  bool resumed{};
+};
+
+/// Describes how the output of a saver that does not join its input is split
+/// among separate saver instances.
+struct saver_partitioning {
+  /// The fields whose values partition the output. Every distinct combination
+  /// of values gets its own printer and saver instance.
+  std::vector<std::string> fields = {};
+
+  /// Finishes a printer and saver instance once it saved this many bytes.
+  std::optional<uint64_t> max_bytes = {};
+
+  /// Finishes a printer and saver instance once it has existed for this long.
+  std::optional<duration> max_age = {};
+
+  /// Finishes the least recently used printer and saver instance before
+  /// creating a new one once this many instances exist.
+  std::optional<uint64_t> max_instances = {};
 };
 
 class plugin_saver {
@@ -575,6 +608,12 @@ public:
   /// so, `instantiate()` will only be called once.
   virtual auto is_joining() const -> bool = 0;
 
+  /// Returns how to split the output among saver instances. Only used if the
+  /// saver does not join its input.
+  virtual auto partitioning() const -> saver_partitioning {
+    return {};
+  }
+
   virtual auto default_printer() const -> std::string {
     return "json";
   }
@@ -0,0 +1,204 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/bitmap_algorithms.hpp"
+#include "tenzir/bitmap_base.hpp"
+#include "tenzir/detail/inspection_common.hpp"
+#include "tenzir/detail/operators.hpp"
+#include "tenzir/word.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace tenzir {
+
+class roaring_bitmap_range;
+
+/// A bitmap in the style of *Roaring*. The bitmap partitions the bit positions
+/// into chunks of 2^16 bits and stores the 1-bits of every non-empty chunk in
+/// one of three container types, whichever is smallest:
+///
+/// 1. An *array* container holds the sorted positions of up to 4096 bits.
+/// 2. A *bitset* container holds an uncompressed bitvector of 2^16 bits.
+/// 3. A *run* container holds pairs of start position and length minus one.
+///
+/// Unlike run-length encoded bitmaps, Roaring offers fast rank and select as
+/// well as fast intersections and unions between sparse and dense bitmaps,
+/// because operations work on the level of chunks and skip chunks that only
+/// one side has.
+class roaring_bitmap : public bitmap_base<roaring_bitmap>,
+                       detail::equality_comparable<roaring_bitmap> {
+  friend roaring_bitmap_range;
+
+public:
+  /// The number of bits that a single container spans.
+  static constexpr size_type container_width = size_type{1} << 16;
+
+  /// The maximum number of values in an array container.
+  static constexpr size_t max_array_size = 4096;
+
+  /// The maximum number of runs in a run container.
+  static constexpr size_t max_run_count = 2048;
+
+  /// The number of blocks in a bitset container.
+  static constexpr size_t bitset_size = container_width / word_type::width;
+
+  /// The representation of a container.
+  enum class container_kind : uint8_t {
+    array,
+    bitset,
+    run,
+  };
+
+  /// The 1-bits of a single chunk.
+  struct container {
+    /// The position of the first bit of the chunk divided by the container
+    /// width.
+    size_type key = 0;
+
+    /// The representation of the container.
+    container_kind kind = container_kind::array;
+
+    /// The number of 1-bits in the container.
+    uint32_t cardinality = 0;
+
+    /// The sorted positions of an array container, or the flattened pairs of
+    /// start position and length minus one of a run container.
+    std::vector<uint16_t> values = {};
+
+    /// The blocks of a bitset container.
+    std::vector<block_type> blocks = {};
+
+    friend bool operator==(const container& x, const container& y);
+
+    template <class Inspector>
+    friend auto inspect(Inspector& f, container& x) {
+      return detail::apply_all(f, x.key, x.kind, x.cardinality, x.values,
+                               x.blocks);
+    }
+  };
+
+  roaring_bitmap() = default;
+
+  explicit roaring_bitmap(size_type n, bool bit = false);
+
+  // -- inspectors -----------------------------------------------------------
+
+  [[nodiscard]] bool empty() const;
+
+  [[nodiscard]] size_type size() const;
+
+  [[nodiscard]] size_t memusage() const;
+
+  /// @returns The number of 1-bits.
+  [[nodiscard]] size_type cardinality() const;
+
+  [[nodiscard]] const std::vector<container>& containers() const;
+
+  // -- modifiers ------------------------------------------------------------
+
+  void append_bit(bool bit);
+
+  void append_bits(bool bit, size_type n);
+
+  void append_block(block_type bits, size_type n = word_type::width);
+
+  void flip();
+
+  /// Converts every container into its smallest representation.
+  void optimize();
+
+  // -- concepts -------------------------------------------------------------
+
+  friend bool operator==(const roaring_bitmap& x, const roaring_bitmap& y);
+
+  /// Computes the intersection of two bitmaps chunk by chunk.
+  friend auto binary_and(const roaring_bitmap& lhs, const roaring_bitmap& rhs)
+    -> roaring_bitmap;
+
+  /// Computes the union of two bitmaps chunk by chunk.
+  friend auto binary_or(const roaring_bitmap& lhs, const roaring_bitmap& rhs)
+    -> roaring_bitmap;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, roaring_bitmap& bm) {
+    return detail::apply_all(f, bm.containers_, bm.num_bits_);
+  }
+
+  friend auto
+  pack(flatbuffers::FlatBufferBuilder& builder, const roaring_bitmap& from)
+    -> flatbuffers::Offset<fbs::bitmap::RoaringBitmap>;
+
+  friend auto unpack(const fbs::bitmap::RoaringBitmap& from, roaring_bitmap& to)
+    -> caf::error;
+
+private:
+  /// Returns the container for a key, creating it at the end if necessary.
+  /// @pre `containers_.empty() || containers_.back().key <= key`
+  container& container_for(size_type key);
+
+  std::vector<container> containers_;
+  size_type num_bits_ = 0;
+};
+
+/// @relates roaring_bitmap
+template <class Inspector>
+auto inspect(Inspector& f, roaring_bitmap::container_kind& x) {
+  return detail::inspect_enum(f, x);
+}
+
+/// Computes the position of the *i*-th 1-bit without scanning the chunks
+/// before the one that contains it.
+/// @relates roaring_bitmap
+auto select_one(const roaring_bitmap& bm, roaring_bitmap::size_type i)
+  -> roaring_bitmap::size_type;
+
+/// Computes the *rank* of a roaring bitmap from the container cardinalities.
+/// @relates roaring_bitmap
+template <bool Bit = true>
+auto rank(const roaring_bitmap& bm) -> roaring_bitmap::size_type {
+  const auto ones = bm.cardinality();
+  return Bit ? ones : bm.size() - ones;
+}
+
+/// Computes the position of the i-th occurrence of a bit.
+/// @relates roaring_bitmap
+template <bool Bit = true>
+auto select(const roaring_bitmap& bm, roaring_bitmap::size_type i)
+  -> roaring_bitmap::size_type {
+  if constexpr (Bit)
+    return select_one(bm, i);
+  else
+    return select<Bit, roaring_bitmap>(bm, i);
+}
+
+class roaring_bitmap_range
+  : public bit_range_base<roaring_bitmap_range, roaring_bitmap::block_type> {
+public:
+  using word_type = roaring_bitmap::word_type;
+
+  roaring_bitmap_range() = default;
+
+  explicit roaring_bitmap_range(const roaring_bitmap& bm);
+
+  void next();
+  [[nodiscard]] bool done() const;
+
+private:
+  void scan();
+
+  const roaring_bitmap* bm_ = nullptr;
+  size_t container_ = 0;
+  roaring_bitmap::size_type position_ = 0;
+};
+
+roaring_bitmap_range bit_range(const roaring_bitmap& bm);
+
+} // namespace tenzir
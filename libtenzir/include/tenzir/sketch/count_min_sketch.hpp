@@ -0,0 +1,88 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// This count-min sketch estimates the frequency of hash digests in constant
+// memory. Every row derives its counter from the same digest via double
+// hashing, so the sketch never needs to see the original value.
+//
+#pragma once
+
+#include <caf/error.hpp>
+#include <caf/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tenzir::sketch {
+
+/// A mergeable sketch for approximate frequencies. Estimates never
+/// underestimate, and overestimate by at most `e / width` times the total
+/// count with probability `1 - e^-depth`.
+class count_min_sketch {
+public:
+  static constexpr size_t default_width = 1024;
+  static constexpr size_t default_depth = 4;
+
+  /// Constructs a count-min sketch.
+  /// @param width The number of counters per row, rounded up to the next
+  /// power of two.
+  /// @param depth The number of rows.
+  /// @returns The sketch iff *width* and *depth* are positive.
+  static auto make(size_t width = default_width, size_t depth = default_depth)
+    -> caf::expected<count_min_sketch>;
+
+  /// Default-constructs a sketch with the default dimensions.
+  count_min_sketch();
+
+  /// Adds a hash digest to the sketch.
+  /// @param digest The digest to add.
+  /// @param count The number of times to add *digest*.
+  void add(uint64_t digest, uint64_t count = 1);
+
+  /// Estimates how often a digest was added to the sketch.
+  /// @param digest The digest to look up.
+  [[nodiscard]] auto estimate(uint64_t digest) const -> uint64_t;
+
+  /// Merges another sketch into this one.
+  /// @param other The sketch to merge.
+  /// @returns An error if the dimensions of the sketches differ.
+  auto merge(const count_min_sketch& other) -> caf::error;
+
+  /// Retrieves the number of counters per row.
+  [[nodiscard]] auto width() const noexcept -> size_t;
+
+  /// Retrieves the number of rows.
+  [[nodiscard]] auto depth() const noexcept -> size_t;
+
+  // -- concepts --------------------------------------------------------------
+
+  friend auto mem_usage(const count_min_sketch& x) -> size_t;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, count_min_sketch& x) -> bool {
+    return f.object(x)
+      .pretty_name("tenzir.sketch.count_min_sketch")
+      .fields(f.field("width", x.width_), f.field("depth", x.depth_),
+              f.field("counters", x.counters_));
+  }
+
+private:
+  count_min_sketch(size_t width, size_t depth);
+
+  /// Computes the index of the counter of a digest in a row.
+  [[nodiscard]] auto index(uint64_t digest, size_t row) const -> size_t;
+
+  size_t width_ = {};
+  size_t depth_ = {};
+
+  /// The counters of all rows, stored row after row.
+  std::vector<uint64_t> counters_ = {};
+};
+
+} // namespace tenzir::sketch
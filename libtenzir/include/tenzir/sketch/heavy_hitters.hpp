@@ -0,0 +1,122 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include "tenzir/data.hpp"
+#include "tenzir/sketch/count_min_sketch.hpp"
+#include "tenzir/view.hpp"
+
+#include <caf/error.hpp>
+#include <caf/expected.hpp>
+#include <tsl/robin_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tenzir::sketch {
+
+/// Tracks the most frequent values of a stream in bounded memory. A count-min
+/// sketch estimates the frequency of every value, and a min-heap keeps the
+/// values with the highest estimates.
+class heavy_hitters {
+public:
+  static constexpr size_t default_capacity = 10;
+
+  /// A tracked value and its estimated frequency.
+  struct entry {
+    uint64_t digest = {};
+    data value = {};
+    uint64_t count = {};
+
+    friend auto operator==(const entry&, const entry&) -> bool = default;
+
+    template <class Inspector>
+    friend auto inspect(Inspector& f, entry& x) -> bool {
+      return f.object(x)
+        .pretty_name("tenzir.sketch.heavy_hitters.entry")
+        .fields(f.field("digest", x.digest), f.field("value", x.value),
+                f.field("count", x.count));
+    }
+  };
+
+  /// Constructs a heavy hitters sketch.
+  /// @param capacity The maximum number of tracked values.
+  /// @param width The width of the underlying count-min sketch.
+  /// @param depth The depth of the underlying count-min sketch.
+  /// @returns The sketch iff all parameters are positive.
+  static auto make(size_t capacity = default_capacity,
+                   size_t width = count_min_sketch::default_width,
+                   size_t depth = count_min_sketch::default_depth)
+    -> caf::expected<heavy_hitters>;
+
+  /// Default-constructs a sketch with the default parameters.
+  heavy_hitters();
+
+  /// Adds a value to the sketch.
+  /// @param digest The hash digest of *value*.
+  /// @param value The value to add.
+  /// @param count The number of times to add *value*.
+  void add(uint64_t digest, data_view value, uint64_t count = 1);
+
+  /// Merges another sketch into this one.
+  /// @param other The sketch to merge.
+  /// @returns An error if the count-min sketches have different dimensions.
+  auto merge(const heavy_hitters& other) -> caf::error;
+
+  /// Retrieves the tracked values ordered by descending estimated frequency.
+  [[nodiscard]] auto top() const -> std::vector<entry>;
+
+  /// Retrieves the maximum number of tracked values.
+  [[nodiscard]] auto capacity() const noexcept -> size_t;
+
+  // -- concepts --------------------------------------------------------------
+
+  friend auto mem_usage(const heavy_hitters& x) -> size_t;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, heavy_hitters& x) -> bool {
+    auto load = [&] {
+      x.positions_.clear();
+      for (size_t i = 0; i < x.heap_.size(); ++i)
+        x.positions_.emplace(x.heap_[i].digest, i);
+      return true;
+    };
+    return f.object(x)
+      .pretty_name("tenzir.sketch.heavy_hitters")
+      .on_load(load)
+      .fields(f.field("counts", x.counts_), f.field("capacity", x.capacity_),
+              f.field("heap", x.heap_));
+  }
+
+private:
+  heavy_hitters(count_min_sketch counts, size_t capacity);
+
+  /// Restores the heap property after the entry at *position* decreased.
+  void sift_up(size_t position);
+
+  /// Restores the heap property after the entry at *position* increased.
+  void sift_down(size_t position);
+
+  /// Swaps two entries of the heap and updates their positions.
+  void swap_entries(size_t lhs, size_t rhs);
+
+  count_min_sketch counts_ = {};
+  size_t capacity_ = default_capacity;
+
+  /// The tracked values as a min-heap on their estimated counts.
+  std::vector<entry> heap_ = {};
+
+  /// The position of every tracked value in the heap, keyed by digest.
+  tsl::robin_map<uint64_t, size_t> positions_ = {};
+};
+
+} // namespace tenzir::sketch
@@ -0,0 +1,90 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// This HyperLogLog sketch estimates the number of distinct hash digests in
+// constant memory. Like HyperLogLog++, it starts with a sparse representation
+// that counts exactly until it would exceed the memory of the dense registers.
+// Instead of the empirical bias correction of HyperLogLog++, the dense
+// estimate uses the improved estimator by Otmar Ertl ("New cardinality
+// estimation algorithms for HyperLogLog sketches", 2017), which is unbiased
+// over the entire cardinality range without lookup tables.
+//
+#pragma once
+
+#include <caf/error.hpp>
+#include <caf/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tenzir::sketch {
+
+/// A mergeable sketch for approximate distinct counting.
+class hyperloglog {
+public:
+  /// The default precision, which uses 4 KiB of registers and has a standard
+  /// error of about 1.6%.
+  static constexpr uint8_t default_precision = 12;
+
+  /// Constructs a HyperLogLog sketch.
+  /// @param precision The number of digest bits that select a register.
+  /// @returns The sketch iff *precision* is in [4, 18].
+  static auto make(uint8_t precision = default_precision)
+    -> caf::expected<hyperloglog>;
+
+  /// Default-constructs a sketch with the default precision.
+  hyperloglog() noexcept;
+
+  /// Adds a hash digest to the sketch.
+  /// @param digest The digest to add.
+  void add(uint64_t digest);
+
+  /// Merges another sketch into this one.
+  /// @param other The sketch to merge.
+  /// @returns An error if the precisions of the sketches differ.
+  auto merge(const hyperloglog& other) -> caf::error;
+
+  /// Estimates the number of distinct digests added to the sketch.
+  [[nodiscard]] auto estimate() const -> double;
+
+  /// Retrieves the precision of the sketch.
+  [[nodiscard]] auto precision() const noexcept -> uint8_t;
+
+  // -- concepts --------------------------------------------------------------
+
+  friend auto mem_usage(const hyperloglog& x) -> size_t;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, hyperloglog& x) -> bool {
+    return f.object(x)
+      .pretty_name("tenzir.sketch.hyperloglog")
+      .fields(f.field("precision", x.precision_), f.field("sparse", x.sparse_),
+              f.field("registers", x.registers_));
+  }
+
+private:
+  explicit hyperloglog(uint8_t precision) noexcept;
+
+  /// Switches from the sparse to the dense representation.
+  void densify();
+
+  /// Updates the register that a digest maps to.
+  void add_dense(uint64_t digest);
+
+  uint8_t precision_ = default_precision;
+
+  /// The distinct digests in sorted order, as long as they take less memory
+  /// than the registers.
+  std::vector<uint64_t> sparse_ = {};
+
+  /// The dense registers, or empty while the sketch is sparse.
+  std::vector<uint8_t> registers_ = {};
+};
+
+} // namespace tenzir::sketch
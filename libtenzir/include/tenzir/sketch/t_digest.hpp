@@ -0,0 +1,117 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+//
+// This t-digest is the merging variant described by Ted Dunning and Otmar
+// Ertl ("Computing Extremely Accurate Quantiles Using t-Digests", 2019). It
+// buffers incoming values and periodically merges them into a sorted list of
+// centroids whose sizes are bounded by the arcsine scale function, which
+// keeps centroids near the tails small and thus the tail quantiles accurate.
+//
+#pragma once
+
+#include <caf/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace tenzir::sketch {
+
+/// A mergeable sketch for approximate quantiles.
+class t_digest {
+public:
+  /// The default compression, which bounds the number of centroids to about
+  /// 100.
+  static constexpr double default_compression = 100.0;
+
+  /// A cluster of values, represented by their mean and count.
+  struct centroid {
+    double mean = {};
+    double weight = {};
+
+    template <class Inspector>
+    friend auto inspect(Inspector& f, centroid& x) -> bool {
+      return f.object(x)
+        .pretty_name("tenzir.sketch.t_digest.centroid")
+        .fields(f.field("mean", x.mean), f.field("weight", x.weight));
+    }
+  };
+
+  /// Constructs a t-digest.
+  /// @param compression The compression parameter that trades accuracy for
+  /// memory.
+  /// @returns The t-digest iff *compression* is at least 10.
+  static auto make(double compression = default_compression)
+    -> caf::expected<t_digest>;
+
+  /// Default-constructs a t-digest with the default compression.
+  t_digest() noexcept;
+
+  /// Adds a value to the t-digest.
+  /// @param x The value to add.
+  /// @param weight The number of times to add *x*.
+  /// @pre *x* is not NaN.
+  void add(double x, double weight = 1.0);
+
+  /// Merges another t-digest into this one.
+  /// @param other The t-digest to merge.
+  void merge(const t_digest& other);
+
+  /// Estimates a quantile of all added values.
+  /// @param q The quantile in [0, 1].
+  /// @returns The estimate, or nothing if the t-digest is empty.
+  [[nodiscard]] auto quantile(double q) const -> std::optional<double>;
+
+  /// Retrieves the total weight of all added values.
+  [[nodiscard]] auto count() const noexcept -> double;
+
+  // -- concepts --------------------------------------------------------------
+
+  friend auto mem_usage(const t_digest& x) -> size_t;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, t_digest& x) -> bool {
+    // Only compressed t-digests go over the wire, which keeps the buffer out
+    // of the serialized representation.
+    if constexpr (Inspector::is_loading)
+      x.buffer_.clear();
+    else
+      x.compress();
+    return f.object(x)
+      .pretty_name("tenzir.sketch.t_digest")
+      .fields(f.field("compression", x.compression_),
+              f.field("centroids", x.centroids_),
+              f.field("total", x.total_), f.field("min", x.min_),
+              f.field("max", x.max_));
+  }
+
+private:
+  explicit t_digest(double compression) noexcept;
+
+  /// Merges the buffered values into the centroids.
+  void compress() const;
+
+  double compression_ = default_compression;
+
+  /// The centroids in ascending order of their means.
+  mutable std::vector<centroid> centroids_ = {};
+
+  /// Values that are not yet merged into the centroids.
+  mutable std::vector<centroid> buffer_ = {};
+
+  /// The total weight of centroids and buffer.
+  double total_ = {};
+
+  /// The smallest and largest added values, which anchor the interpolation of
+  /// the outermost quantiles.
+  double min_ = {};
+  double max_ = {};
+};
+
+} // namespace tenzir::sketch
@@ -50,6 +50,12 @@ public:
   /// @return The results of applying the extract query to each table slice.
   [[nodiscard]] virtual generator<table_slice>
   extract(expression expr, ids selection) const;
+
+  /// Retrieve the error that made the most recently advanced generator of the
+  /// store stop early, and reset it. Stores that decode their contents lazily
+  /// may only fail while a generator runs.
+  /// @returns The error, or none if the generator finished regularly.
+  [[nodiscard]] virtual caf::error take_error();
 };
 
 /// A base class for passive stores used by the store plugin.
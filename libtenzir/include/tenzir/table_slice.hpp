@@ -18,7 +18,10 @@
 #include "tenzir/view.hpp"
 
 #include <cstddef>
+#include <memory>
 #include <span>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace tenzir {
@@ -407,6 +410,26 @@ auto resolve_operand(const table_slice& slice, const operand& op)
 auto unflatten(const table_slice& slice,
                std::string_view nested_field_separator) -> table_slice;
 
+/// Unflattens table slices like `unflatten`, but determines how to nest the
+/// fields only once per schema. Applying the plan for a schema rewraps the
+/// existing arrays without copying their buffers.
+class unflattener {
+public:
+  /// The schema-specific steps for unflattening a table slice.
+  struct plan;
+
+  /// @param nested_field_separator A string treated as a separator of nested
+  /// fields.
+  explicit unflattener(std::string nested_field_separator);
+
+  /// Unflattens a table slice.
+  auto operator()(const table_slice& slice) -> table_slice;
+
+private:
+  std::string separator_ = {};
+  std::unordered_map<type, std::shared_ptr<const plan>> plans_ = {};
+};
+
 /// @related flatten
 struct flatten_result {
   table_slice slice = {};
@@ -426,6 +449,32 @@ struct flatten_result {
 auto flatten(table_slice slice, std::string_view separator = ".")
   -> flatten_result;
 
+/// Flattens table slices like `flatten`, but determines the renamed fields only
+/// once per schema.
+class flattener {
+public:
+  /// The schema-specific steps for flattening a table slice.
+  struct plan;
+
+  /// @param separator The separator to join record field names with.
+  explicit flattener(std::string separator = ".");
+
+  // The cached plans refer to the separator, so a flattener must stay in
+  // place.
+  flattener(const flattener&) = delete;
+  flattener(flattener&&) = delete;
+  auto operator=(const flattener&) -> flattener& = delete;
+  auto operator=(flattener&&) -> flattener& = delete;
+  ~flattener() noexcept = default;
+
+  /// Flattens a table slice.
+  auto operator()(table_slice slice) -> flatten_result;
+
+private:
+  std::string separator_ = {};
+  std::unordered_map<type, std::shared_ptr<const plan>> plans_ = {};
+};
+
 } // namespace tenzir
 
 #include "tenzir/concept/printable/tenzir/table_slice.hpp"
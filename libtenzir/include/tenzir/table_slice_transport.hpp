@@ -0,0 +1,139 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include "tenzir/aliases.hpp"
+#include "tenzir/chunk.hpp"
+#include "tenzir/detail/lru_cache.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/type.hpp"
+
+#include <arrow/util/type_fwd.h>
+#include <caf/expected.hpp>
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tenzir {
+
+/// A piece of an Arrow IPC stream that carries exactly one record batch.
+///
+/// Every schema maps to its own IPC stream. The first frame of a stream
+/// additionally carries the schema and the IPC schema message; all subsequent
+/// frames only contain the record batch and possibly dictionary deltas.
+struct table_slice_frame {
+  /// Identifies the IPC stream within a pair of encoder and decoder.
+  uint64_t stream = {};
+
+  /// The schema of the stream; set for the first frame of a stream only.
+  type schema = {};
+
+  /// The stream that the encoder closed to make room for this frame's stream;
+  /// set for the first frame of a stream only.
+  std::optional<uint64_t> evicted_stream = {};
+
+  /// The IPC messages written to the stream for this frame.
+  chunk_ptr payload = {};
+
+  /// Per-slice metadata that is not part of the Arrow IPC format.
+  time import_time = {};
+  id offset = invalid_id;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, table_slice_frame& x) -> bool {
+    return f.object(x)
+      .pretty_name("tenzir.table_slice_frame")
+      .fields(f.field("stream", x.stream), f.field("schema", x.schema),
+              f.field("evicted-stream", x.evicted_stream),
+              f.field("payload", x.payload),
+              f.field("import-time", x.import_time),
+              f.field("offset", x.offset));
+  }
+};
+
+/// Options for transferring table slices between actor systems.
+struct table_slice_transport_options {
+  /// Parses the options from the `tenzir.pipeline-transport` section of the
+  /// given configuration.
+  static auto make(const caf::settings& options)
+    -> caf::expected<table_slice_transport_options>;
+
+  /// The buffer compression applied by the Arrow IPC writer.
+  arrow::Compression::type compression = {};
+
+  /// Consecutive slices with the same schema and import time are coalesced
+  /// into a single record batch until they reach this number of rows.
+  uint64_t coalesce_rows = {};
+
+  /// The number of streams an encoder keeps open at most. Writing a schema
+  /// beyond that closes the least recently used stream.
+  uint64_t max_streams = {};
+};
+
+/// Encodes table slices into a set of schema-deduplicating Arrow IPC streams.
+/// An encoder must be paired with exactly one decoder, and frames must be
+/// decoded in the order they were encoded in. The decoder closes its streams
+/// together with the encoder, so the encoder's limit bounds both.
+class table_slice_encoder final {
+public:
+  explicit table_slice_encoder(table_slice_transport_options options);
+  table_slice_encoder(const table_slice_encoder&) = delete;
+  table_slice_encoder(table_slice_encoder&&) noexcept;
+  auto operator=(const table_slice_encoder&) -> table_slice_encoder& = delete;
+  auto operator=(table_slice_encoder&&) noexcept -> table_slice_encoder&;
+  ~table_slice_encoder() noexcept;
+
+  /// Encodes a batch of table slices, coalescing small slices along the way.
+  auto encode(std::vector<table_slice> slices)
+    -> caf::expected<std::vector<table_slice_frame>>;
+
+  /// Forgets all previously written schemas, e.g., after the peer has lost
+  /// its decoder state. The next frame for each schema starts a new stream.
+  auto reset() -> void;
+
+private:
+  struct stream;
+
+  /// Streams are always created explicitly, so the cache never loads them.
+  struct no_stream {
+    auto operator()(const type& schema) const -> std::unique_ptr<stream>;
+  };
+
+  auto encode_one(const table_slice& slice) -> caf::expected<table_slice_frame>;
+
+  table_slice_transport_options options_ = {};
+  detail::lru_cache<type, std::unique_ptr<stream>, no_stream> streams_;
+  uint64_t next_stream_ = {};
+};
+
+/// Decodes frames created by a `table_slice_encoder`.
+class table_slice_decoder final {
+public:
+  table_slice_decoder();
+  table_slice_decoder(const table_slice_decoder&) = delete;
+  table_slice_decoder(table_slice_decoder&&) noexcept;
+  auto operator=(const table_slice_decoder&) -> table_slice_decoder& = delete;
+  auto operator=(table_slice_decoder&&) noexcept -> table_slice_decoder&;
+  ~table_slice_decoder() noexcept;
+
+  /// Decodes a batch of frames into table slices.
+  auto decode(std::vector<table_slice_frame> frames)
+    -> caf::expected<std::vector<table_slice>>;
+
+private:
+  struct stream;
+
+  std::unordered_map<uint64_t, std::unique_ptr<stream>> streams_ = {};
+};
+
+} // namespace tenzir
@@ -0,0 +1,106 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "tenzir/fwd.hpp"
+
+#include "tenzir/aliases.hpp"
+#include "tenzir/data.hpp"
+#include "tenzir/fbs/partition.hpp"
+#include "tenzir/ids.hpp"
+
+#include <caf/error.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tenzir {
+
+/// The range of values and the number of nulls of a single column within a
+/// table slice.
+struct zone_map_column {
+  /// The flat index of the column in the schema.
+  size_t column = {};
+
+  /// The smallest non-null value, or null if all values are null.
+  data min = {};
+
+  /// The largest non-null value, or null if all values are null.
+  data max = {};
+
+  /// The number of null values.
+  uint64_t null_count = {};
+
+  friend bool operator==(const zone_map_column&, const zone_map_column&)
+    = default;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, zone_map_column& x) {
+    return f.object(x)
+      .pretty_name("tenzir.zone_map_column")
+      .fields(f.field("column", x.column), f.field("min", x.min),
+              f.field("max", x.max), f.field("null-count", x.null_count));
+  }
+};
+
+/// Column statistics of a single table slice in a partition. Other than the
+/// partition synopsis, which decides whether a partition needs to be looked at
+/// at all, zone maps allow for skipping individual table slices within a
+/// partition that cannot contain any matches for a query. Zone maps exist for
+/// columns of integral, floating-point, and temporal types only.
+struct zone_map {
+  /// The id of the first row of the table slice.
+  id offset = {};
+
+  /// The number of rows in the table slice.
+  uint64_t rows = {};
+
+  /// The statistics for all columns of a supported type.
+  std::vector<zone_map_column> columns = {};
+
+  /// Checks whether any row of the table slice may match an expression.
+  /// @param expr An expression tailored to the schema of the table slice.
+  /// @returns `false` only if no row can possibly match *expr*.
+  [[nodiscard]] bool may_match(const expression& expr) const;
+
+  friend bool operator==(const zone_map&, const zone_map&) = default;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, zone_map& x) {
+    return f.object(x)
+      .pretty_name("tenzir.zone_map")
+      .fields(f.field("offset", x.offset), f.field("rows", x.rows),
+              f.field("columns", x.columns));
+  }
+};
+
+/// Computes the zone map of a table slice.
+/// @param slice The table slice with a valid offset.
+/// @relates zone_map
+zone_map make_zone_map(const table_slice& slice);
+
+/// Removes the ids of all table slices that cannot contain a match for an
+/// expression from a selection.
+/// @param zone_maps The zone maps of a partition, ordered by offset.
+/// @param expr An expression tailored to the schema of the partition.
+/// @param selection The ids to consider. An empty selection denotes all ids.
+/// @returns The ids of *selection* that may match *expr*.
+/// @relates zone_map
+ids prune(std::span<const zone_map> zone_maps, const expression& expr,
+          ids selection);
+
+/// @relates zone_map
+flatbuffers::Offset<fbs::partition::detail::ZoneMap>
+pack(flatbuffers::FlatBufferBuilder& builder, const zone_map& x);
+
+/// @relates zone_map
+caf::error unpack(const fbs::partition::detail::ZoneMap& from, zone_map& to);
+
+} // namespace tenzir
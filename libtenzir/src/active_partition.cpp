@@ -16,6 +16,7 @@
 #include "tenzir/concept/printable/tenzir/table_slice.hpp"
 #include "tenzir/concept/printable/tenzir/uuid.hpp"
 #include "tenzir/concept/printable/to_string.hpp"
+#include "tenzir/defaults.hpp"
 #include "tenzir/detail/assert.hpp"
 #include "tenzir/detail/fill_status_map.hpp"
 #include "tenzir/detail/narrow.hpp"
@@ -46,6 +47,7 @@
 #include "tenzir/time.hpp"
 #include "tenzir/type.hpp"
 #include "tenzir/value_index.hpp"
+#include "tenzir/zone_map.hpp"
 #include "tenzir/value_index_factory.hpp"
 
 #include <caf/attach_continuous_stream_stage.hpp>
@@ -187,12 +189,22 @@ bool should_skip_index_creation(const type& type,
   // We no longer build dense indexes as of Tenzir v4.3. Over time, they've lost
   // much of their appeal with partition sizes growing and columnar scanning of
   // stores becoming more effective.
-  // TODO: Rip out the parts of the code base relating to value indexes, the
-  // value index factory, and active and passive indexer actors.
-  (void)type;
-  (void)qf;
-  (void)rules;
-  return true;
+  // The only exception are n-gram indexes for strings, which speed up
+  // substring searches beyond what a scan can achieve, and which users must
+  // select explicitly with the `value-index` key of an index rule.
+  // TODO: Rip out the parts of the code base relating to the other value
+  // indexes.
+  return selected_value_index(qf, rules) != "ngram"
+         || !caf::holds_alternative<string_type>(type);
+}
+
+caf::settings
+make_value_index_options(const qualified_record_field& qf,
+                         const std::vector<index_config::rule>& rules,
+                         caf::settings index_opts) {
+  if (auto selected = selected_value_index(qf, rules); !selected.empty())
+    index_opts["index"] = std::string{selected};
+  return index_opts;
 }
 
 /// Gets the ACTIVE INDEXER at a certain position.
@@ -222,6 +234,19 @@ void active_partition_state::add_flush_listener(flush_listener_actor listener) {
   detail::notify_listeners_if_clean(*this, *stage);
 }
 
+void active_partition_state::send_report() {
+  if (ingest_measurement.events == 0 or not accountant)
+    return;
+  auto r = performance_report{
+    .data = {{
+      "active-partition",
+      std::exchange(ingest_measurement, {}),
+      {{"schema", std::string{data.synopsis->schema.name()}}},
+    }},
+  };
+  self->send(accountant, atom::metrics_v, std::move(r));
+}
+
 void active_partition_state::notify_flush_listeners() {
   TENZIR_DEBUG("{} sends 'flush' messages to {} listeners", *self,
                flush_listeners.size());
@@ -309,6 +334,13 @@ pack_full(const active_partition_state::serialization_data& x,
   store_builder.add_id(store_name);
   store_builder.add_data(store_data);
   store_header = store_builder.Finish();
+  // Serialize zone maps.
+  auto zone_map_offsets
+    = std::vector<flatbuffers::Offset<fbs::partition::detail::ZoneMap>>{};
+  zone_map_offsets.reserve(x.zone_maps.size());
+  for (const auto& zone_map : x.zone_maps)
+    zone_map_offsets.push_back(pack(builder, zone_map));
+  auto zone_maps = builder.CreateVector(zone_map_offsets);
   fbs::partition::LegacyPartitionBuilder legacy_builder(builder);
   legacy_builder.add_uuid(*uuid);
   legacy_builder.add_events(x.events);
@@ -317,6 +349,7 @@ pack_full(const active_partition_state::serialization_data& x,
   legacy_builder.add_schema(schema_offset);
   legacy_builder.add_type_ids(type_ids);
   legacy_builder.add_store(store_header);
+  legacy_builder.add_zone_maps(zone_maps);
   auto partition_v0 = legacy_builder.Finish();
   fbs::PartitionBuilder partition_builder(builder);
   partition_builder.add_partition_type(fbs::partition::Partition::legacy);
@@ -369,6 +402,7 @@ active_partition_actor::behavior_type active_partition(
         // slices not to have an offset at all. We should fix the unit tests
         // properly, but that takes time we did not want to spend when migrating
         // to partition-local ids. -- DL
+        auto t = timer::start(self->state.ingest_measurement);
         if (x.offset() == invalid_id)
           x.offset(self->state.data.events);
         TENZIR_ASSERT(x.offset() == self->state.data.events);
@@ -394,6 +428,15 @@ active_partition_actor::behavior_type active_partition(
         self->state.data.events += x.rows();
         self->state.data.synopsis.unshared().add(
           x, self->state.partition_capacity, self->state.synopsis_index_config);
+        self->state.data.zone_maps.push_back(make_zone_map(x));
+        // The indexers only depend on the schema, so we only need to set them
+        // up for the first table slice of every schema.
+        if (schema == self->state.indexed_schema) {
+          out.push(x);
+          t.stop(x.rows());
+          return;
+        }
+        self->state.indexed_schema = schema;
         size_t column_idx = -1;
         for (const auto& [field, offset] :
              caf::get<record_type>(schema).leaves()) {
@@ -407,8 +450,10 @@ active_partition_actor::behavior_type active_partition(
           if (should_skip_index_creation(
                 field.type, qf, self->state.synopsis_index_config.rules))
             continue;
-          auto value_index
-            = factory<tenzir::value_index>::make(field.type, index_opts);
+          auto value_index = factory<tenzir::value_index>::make(
+            field.type,
+            make_value_index_options(
+              qf, self->state.synopsis_index_config.rules, index_opts));
           if (!value_index) {
             TENZIR_WARN("{} failed to spawn active indexer with options {} for "
                         "field {}: value index missing",
@@ -421,6 +466,7 @@ active_partition_actor::behavior_type active_partition(
                        *self, field.name, slot);
         }
         out.push(x);
+        t.stop(x.rows());
       },
       [=](caf::unit_t&, const caf::error& err) {
         TENZIR_DEBUG("active partition {} finalized streaming {}", id,
@@ -453,6 +499,11 @@ active_partition_actor::behavior_type active_partition(
   dynamic_cast<decltype(make_stage())::pointer>(self->state.stage.get())
     ->set_notification_slot(slot);
   TENZIR_DEBUG("{} spawned new active store at slot {}", *self, slot);
+  if (self->state.accountant) {
+    detail::weak_run_delayed_loop(self, defaults::telemetry_rate, [self] {
+      self->state.send_report();
+    });
+  }
   self->set_exit_handler([=](const caf::exit_msg& msg) {
     TENZIR_DEBUG("{} received EXIT from {} with reason: {}", *self, msg.source,
                  msg.reason);
@@ -507,6 +558,7 @@ active_partition_actor::behavior_type active_partition(
            const std::filesystem::path& synopsis_dir)
       -> caf::result<partition_synopsis_ptr> {
       TENZIR_DEBUG("{} got persist atom", *self);
+      self->state.send_report();
       // Ensure that the response promise has not already been initialized.
       TENZIR_ASSERT(!self->state.persistence_promise.source());
       self->state.persist_path = part_dir;
@@ -8,6 +8,7 @@
 
 #include "tenzir/bitmap.hpp"
 
+#include "tenzir/bitmap_algorithms.hpp"
 #include "tenzir/detail/overload.hpp"
 #include "tenzir/error.hpp"
 #include "tenzir/fbs/bitmap.hpp"
@@ -89,6 +90,22 @@ bool operator==(const bitmap& x, const bitmap& y) {
   return x.bitmap_ == y.bitmap_;
 }
 
+auto binary_and(const bitmap& lhs, const bitmap& rhs) -> bitmap {
+  const auto* x = caf::get_if<roaring_bitmap>(&lhs.bitmap_);
+  const auto* y = caf::get_if<roaring_bitmap>(&rhs.bitmap_);
+  if (x && y)
+    return binary_and(*x, *y);
+  return tenzir::binary_and<bitmap, bitmap>(lhs, rhs);
+}
+
+auto binary_or(const bitmap& lhs, const bitmap& rhs) -> bitmap {
+  const auto* x = caf::get_if<roaring_bitmap>(&lhs.bitmap_);
+  const auto* y = caf::get_if<roaring_bitmap>(&rhs.bitmap_);
+  if (x && y)
+    return binary_or(*x, *y);
+  return tenzir::binary_or<bitmap, bitmap>(lhs, rhs);
+}
+
 auto pack(flatbuffers::FlatBufferBuilder& builder, const bitmap& from)
   -> flatbuffers::Offset<fbs::Bitmap> {
   auto f = detail::overload{
@@ -107,6 +124,11 @@ auto pack(flatbuffers::FlatBufferBuilder& builder, const bitmap& from)
       return fbs::CreateBitmap(builder, fbs::bitmap::Bitmap::wah,
                                wah_offset.Union());
     },
+    [&](const roaring_bitmap& roaring) {
+      const auto roaring_offset = pack(builder, roaring).Union();
+      return fbs::CreateBitmap(builder, fbs::bitmap::Bitmap::roaring,
+                               roaring_offset.Union());
+    },
   };
   return caf::visit(f, from.bitmap_);
 }
@@ -128,6 +150,8 @@ auto unpack(const fbs::Bitmap& from, bitmap& to) -> caf::error {
       return do_unpack(*from.bitmap_as_null(), null_bitmap{});
     case fbs::bitmap::Bitmap::wah:
       return do_unpack(*from.bitmap_as_wah(), wah_bitmap{});
+    case fbs::bitmap::Bitmap::roaring:
+      return do_unpack(*from.bitmap_as_roaring(), roaring_bitmap{});
   }
   __builtin_unreachable();
 }
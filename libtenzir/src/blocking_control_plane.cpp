@@ -0,0 +1,111 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/blocking_control_plane.hpp"
+
+#include "tenzir/die.hpp"
+#include "tenzir/modules.hpp"
+
+namespace tenzir {
+
+class blocking_control_plane::collecting_diagnostic_handler final
+  : public diagnostic_handler {
+public:
+  void emit(diagnostic d) override {
+    auto lock = std::unique_lock{mutex_};
+    if (d.severity == severity::error) {
+      has_seen_error_ = true;
+    }
+    diagnostics_.push_back(std::move(d));
+  }
+
+  auto has_seen_error() const -> bool override {
+    auto lock = std::unique_lock{mutex_};
+    return has_seen_error_;
+  }
+
+  auto take() -> std::vector<diagnostic> {
+    auto lock = std::unique_lock{mutex_};
+    return std::exchange(diagnostics_, {});
+  }
+
+private:
+  mutable std::mutex mutex_ = {};
+  std::vector<diagnostic> diagnostics_ = {};
+  bool has_seen_error_ = {};
+};
+
+blocking_control_plane::blocking_control_plane(operator_control_plane& ctrl)
+  : node_{ctrl.node()},
+    allow_unsafe_pipelines_{ctrl.allow_unsafe_pipelines()},
+    has_terminal_{ctrl.has_terminal()},
+    diagnostics_{std::make_unique<collecting_diagnostic_handler>()} {
+}
+
+blocking_control_plane::~blocking_control_plane() noexcept = default;
+
+auto blocking_control_plane::self() noexcept -> exec_node_actor::base& {
+  die("blocking work must not access the execution node");
+}
+
+auto blocking_control_plane::node() noexcept -> node_actor {
+  return node_;
+}
+
+auto blocking_control_plane::abort(caf::error error) noexcept -> void {
+  TENZIR_ASSERT(error != caf::none);
+  auto lock = std::unique_lock{mutex_};
+  aborts_.push_back(std::move(error));
+}
+
+auto blocking_control_plane::warn(caf::error warning) noexcept -> void {
+  if (warning != ec::silent) {
+    diagnostic::warning("{}", warning).emit(diagnostics());
+  }
+}
+
+auto blocking_control_plane::emit(table_slice) noexcept -> void {
+  die("not implemented");
+}
+
+auto blocking_control_plane::schemas() const noexcept
+  -> const std::vector<type>& {
+  return tenzir::modules::schemas();
+}
+
+auto blocking_control_plane::concepts() const noexcept -> const concepts_map& {
+  return tenzir::modules::concepts();
+}
+
+auto blocking_control_plane::diagnostics() noexcept -> diagnostic_handler& {
+  return *diagnostics_;
+}
+
+auto blocking_control_plane::allow_unsafe_pipelines() const noexcept -> bool {
+  return allow_unsafe_pipelines_;
+}
+
+auto blocking_control_plane::has_terminal() const noexcept -> bool {
+  return has_terminal_;
+}
+
+void blocking_control_plane::flush(operator_control_plane& ctrl) {
+  for (auto& diagnostic : diagnostics_->take()) {
+    ctrl.diagnostics().emit(std::move(diagnostic));
+  }
+  auto aborts = std::vector<caf::error>{};
+  {
+    auto lock = std::unique_lock{mutex_};
+    aborts = std::exchange(aborts_, {});
+  }
+  for (auto& error : aborts) {
+    ctrl.abort(std::move(error));
+  }
+}
+
+} // namespace tenzir
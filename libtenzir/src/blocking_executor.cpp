@@ -0,0 +1,351 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/blocking_executor.hpp"
+
+#include "tenzir/configuration.hpp"
+#include "tenzir/defaults.hpp"
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/error.hpp"
+#include "tenzir/logger.hpp"
+
+#include <caf/settings.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace tenzir {
+
+namespace {
+
+/// The executor and the slot of the current thread, if it belongs to a pool.
+thread_local const blocking_executor* this_executor = nullptr;
+thread_local void* this_worker = nullptr;
+
+} // namespace
+
+auto blocking_executor_options::make(const caf::settings& options)
+  -> caf::expected<blocking_executor_options> {
+  auto result = blocking_executor_options{};
+  result.max_threads
+    = caf::get_or(options, "tenzir.blocking-executor.max-threads",
+                  defaults::blocking_executor::max_threads);
+  if (result.max_threads == 0) {
+    return caf::make_error(ec::invalid_configuration,
+                           "tenzir.blocking-executor.max-threads must be "
+                           "positive");
+  }
+  auto keep_alive
+    = get_or_duration(options, "tenzir.blocking-executor.keep-alive",
+                      defaults::blocking_executor::keep_alive);
+  if (not keep_alive) {
+    return std::move(keep_alive.error());
+  }
+  result.keep_alive = *keep_alive;
+  auto overflow_after
+    = get_or_duration(options, "tenzir.blocking-executor.overflow-after",
+                      defaults::blocking_executor::overflow_after);
+  if (not overflow_after) {
+    return std::move(overflow_after.error());
+  }
+  if (*overflow_after <= duration::zero()) {
+    return caf::make_error(ec::invalid_configuration,
+                           "tenzir.blocking-executor.overflow-after must be "
+                           "positive");
+  }
+  result.overflow_after = *overflow_after;
+  return result;
+}
+
+blocking_executor::blocking_executor(blocking_executor_options options)
+  : options_{options} {
+  TENZIR_ASSERT(options_.max_threads > 0);
+  workers_.reserve(options_.max_threads);
+  for (auto i = uint64_t{0}; i < options_.max_threads; ++i) {
+    workers_.push_back(std::make_unique<worker>());
+  }
+}
+
+blocking_executor::~blocking_executor() noexcept {
+  auto lock = std::unique_lock{sleep_mutex_};
+  stopping_ = true;
+  work_available_.notify_all();
+  watchdog_.notify_all();
+  threads_stopped_.wait(lock, [&] {
+    return num_threads_ == 0 and num_overflow_threads_ == 0 and not watching_;
+  });
+}
+
+auto blocking_executor::instance(const caf::settings& options)
+  -> blocking_executor& {
+  static auto flag = std::once_flag{};
+  static blocking_executor* result = nullptr;
+  std::call_once(flag, [&] {
+    auto parsed = blocking_executor_options::make(options);
+    if (not parsed) {
+      TENZIR_WARN("falling back to default options for the blocking executor: "
+                  "{}",
+                  parsed.error());
+      parsed = blocking_executor_options{};
+    }
+    // We never destroy the process-wide executor, because tasks may still be
+    // blocked in a system call when the process exits.
+    result = new blocking_executor(*parsed);
+  });
+  return *result;
+}
+
+void blocking_executor::submit(task f) {
+  auto next = queued_task{std::move(f), std::chrono::steady_clock::now()};
+  if (this_executor == this) {
+    auto& self = *static_cast<worker*>(this_worker);
+    auto lock = std::unique_lock{self.mutex};
+    self.tasks.push_back(std::move(next));
+  } else {
+    auto lock = std::unique_lock{global_mutex_};
+    global_tasks_.push_back(std::move(next));
+  }
+  num_queued_.fetch_add(1, std::memory_order_release);
+  // Make sure that some thread looks for the task. Even when the task went to
+  // the queue of the current thread, that thread may block in its current
+  // task for a long time, so another thread must be ready to steal it.
+  auto lock = std::unique_lock{sleep_mutex_};
+  if (num_idle_ > pending_wakeups_) {
+    ++pending_wakeups_;
+    work_available_.notify_one();
+  } else if (num_threads_ < workers_.size()) {
+    start_thread();
+  } else if (not watching_) {
+    // All threads are busy. Usually one of them finishes soon, but if all of
+    // them block for a long time, the task would starve.
+    watching_ = true;
+    auto thread = std::thread{[this] {
+      watch();
+    }};
+    thread.detach();
+  }
+}
+
+auto blocking_executor::statistics() const -> blocking_executor_statistics {
+  auto result = blocking_executor_statistics{};
+  {
+    auto lock = std::unique_lock{sleep_mutex_};
+    result.threads = num_threads_;
+    result.idle_threads = num_idle_;
+    result.overflow_threads = num_overflow_threads_;
+  }
+  result.queued_tasks = num_queued_.load(std::memory_order_relaxed);
+  result.executed_tasks = num_executed_.load(std::memory_order_relaxed);
+  result.stolen_tasks = num_stolen_.load(std::memory_order_relaxed);
+  result.scheduling_latency
+    = duration{scheduling_latency_.load(std::memory_order_relaxed)};
+  result.max_scheduling_latency
+    = duration{max_scheduling_latency_.load(std::memory_order_relaxed)};
+  return result;
+}
+
+void blocking_executor::run(worker& self) {
+  this_executor = this;
+  this_worker = &self;
+  auto lock = std::unique_lock{sleep_mutex_, std::defer_lock};
+  while (true) {
+    auto next = queued_task{};
+    if (try_pop(self, next)) {
+      execute(next);
+      continue;
+    }
+    lock.lock();
+    // A task may have been submitted after we looked for one, but before we
+    // acquired the lock.
+    if (num_queued_.load(std::memory_order_acquire) > 0) {
+      lock.unlock();
+      continue;
+    }
+    if (stopping_) {
+      break;
+    }
+    ++num_idle_;
+    const auto woken
+      = work_available_.wait_for(lock, options_.keep_alive, [&] {
+          return pending_wakeups_ > 0 or stopping_;
+        });
+    --num_idle_;
+    const auto claimed = woken and pending_wakeups_ > 0;
+    if (claimed) {
+      --pending_wakeups_;
+    }
+    if (claimed or num_queued_.load(std::memory_order_acquire) > 0) {
+      lock.unlock();
+      continue;
+    }
+    // We are either stopping or were idle for longer than the keep-alive time.
+    break;
+  }
+  TENZIR_ASSERT(lock.owns_lock());
+  TENZIR_ASSERT(self.tasks.empty());
+  self.active.store(false, std::memory_order_relaxed);
+  --num_threads_;
+  threads_stopped_.notify_all();
+}
+
+void blocking_executor::run_overflow() {
+  auto next = queued_task{};
+  while (true) {
+    {
+      auto lock = std::unique_lock{global_mutex_};
+      if (not global_tasks_.empty()) {
+        next = std::move(global_tasks_.front());
+        global_tasks_.pop_front();
+        lock.unlock();
+        execute(next);
+        continue;
+      }
+    }
+    if (not try_steal(nullptr, next)) {
+      break;
+    }
+    execute(next);
+  }
+  auto lock = std::unique_lock{sleep_mutex_};
+  --num_overflow_threads_;
+  threads_stopped_.notify_all();
+}
+
+void blocking_executor::watch() {
+  auto lock = std::unique_lock{sleep_mutex_};
+  auto started = num_started_.load(std::memory_order_relaxed);
+  while (not stopping_ and num_queued_.load(std::memory_order_acquire) > 0) {
+    watchdog_.wait_for(lock, options_.overflow_after, [&] {
+      return stopping_;
+    });
+    if (stopping_) {
+      break;
+    }
+    const auto previous
+      = std::exchange(started, num_started_.load(std::memory_order_relaxed));
+    const auto queued = num_queued_.load(std::memory_order_acquire);
+    if (started != previous or queued == 0 or num_idle_ > pending_wakeups_) {
+      continue;
+    }
+    // No thread took a task for a while although tasks are waiting, so all
+    // threads are blocked. Every waiting task gets a thread of its own.
+    TENZIR_DEBUG("blocking executor starts {} overflow threads for starving "
+                 "tasks",
+                 queued);
+    for (auto i = uint64_t{0}; i < queued; ++i) {
+      start_overflow_thread();
+    }
+  }
+  watching_ = false;
+  threads_stopped_.notify_all();
+}
+
+void blocking_executor::execute(queued_task& next) {
+  num_queued_.fetch_sub(1, std::memory_order_relaxed);
+  num_started_.fetch_add(1, std::memory_order_relaxed);
+  record_latency(std::chrono::steady_clock::now() - next.enqueued);
+  try {
+    next.f();
+  } catch (const std::exception& err) {
+    TENZIR_ERROR("blocking task threw an exception: {}", err.what());
+  } catch (...) {
+    TENZIR_ERROR("blocking task threw an exception");
+  }
+  next = {};
+  num_executed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto blocking_executor::try_pop(worker& self, queued_task& result) -> bool {
+  {
+    // Our own queue is the most likely to be warm in the cache, and taking the
+    // most recent task keeps the queue short.
+    auto lock = std::unique_lock{self.mutex};
+    if (not self.tasks.empty()) {
+      result = std::move(self.tasks.back());
+      self.tasks.pop_back();
+      return true;
+    }
+  }
+  {
+    auto lock = std::unique_lock{global_mutex_};
+    if (not global_tasks_.empty()) {
+      result = std::move(global_tasks_.front());
+      global_tasks_.pop_front();
+      return true;
+    }
+  }
+  return try_steal(&self, result);
+}
+
+auto blocking_executor::try_steal(const worker* self, queued_task& result)
+  -> bool {
+  // Steal the oldest task from another thread, starting at our own position
+  // so that threads do not all contend for the first queue.
+  const auto offset = static_cast<size_t>(
+    std::distance(workers_.begin(),
+                  std::find_if(workers_.begin(), workers_.end(),
+                               [&](const auto& x) {
+                                 return x.get() == self;
+                               })));
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    auto& victim = *workers_[(offset + i) % workers_.size()];
+    if (&victim == self or not victim.active.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    auto lock = std::unique_lock{victim.mutex, std::try_to_lock};
+    if (lock.owns_lock() and not victim.tasks.empty()) {
+      result = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      num_stolen_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void blocking_executor::record_latency(duration latency) {
+  const auto sample = latency.count();
+  // Both statistics may lose concurrent updates, which is fine for reporting.
+  const auto average = scheduling_latency_.load(std::memory_order_relaxed);
+  scheduling_latency_.store(average + (sample - average) / 8,
+                            std::memory_order_relaxed);
+  auto max = max_scheduling_latency_.load(std::memory_order_relaxed);
+  while (sample > max
+         and not max_scheduling_latency_.compare_exchange_weak(
+           max, sample, std::memory_order_relaxed)) {
+    // Try again with the updated maximum.
+  }
+}
+
+void blocking_executor::start_thread() {
+  TENZIR_ASSERT(num_threads_ < workers_.size());
+  const auto slot = std::find_if(workers_.begin(), workers_.end(),
+                                 [](const auto& x) {
+                                   return not x->active.load(
+                                     std::memory_order_relaxed);
+                                 });
+  TENZIR_ASSERT(slot != workers_.end());
+  auto& self = **slot;
+  self.active.store(true, std::memory_order_relaxed);
+  ++num_threads_;
+  auto thread = std::thread{[this, &self] {
+    run(self);
+  }};
+  thread.detach();
+}
+
+void blocking_executor::start_overflow_thread() {
+  ++num_overflow_threads_;
+  auto thread = std::thread{[this] {
+    run_overflow();
+  }};
+  thread.detach();
+}
+
+} // namespace tenzir
@@ -10,6 +10,7 @@
 
 #include "tenzir/actors.hpp"
 #include "tenzir/as_bytes.hpp"
+#include "tenzir/bloom_filter_synopsis.hpp"
 #include "tenzir/concept/convertible/data.hpp"
 #include "tenzir/data.hpp"
 #include "tenzir/defaults.hpp"
@@ -24,7 +25,9 @@
 #include "tenzir/expression.hpp"
 #include "tenzir/fbs/type_registry.hpp"
 #include "tenzir/flatbuffer.hpp"
+#include "tenzir/hash/legacy_hash.hpp"
 #include "tenzir/instrumentation.hpp"
+#include "tenzir/ip.hpp"
 #include "tenzir/io/read.hpp"
 #include "tenzir/io/save.hpp"
 #include "tenzir/legacy_type.hpp"
@@ -42,10 +45,141 @@
 #include <caf/detail/set_thread_name.hpp>
 #include <caf/expected.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <optional>
 #include <type_traits>
+#include <vector>
 
 namespace tenzir {
 
+namespace {
+
+void add_synopsis(catalog_bloom_index::entry& entry, const uuid& partition,
+                  const synopsis* syn) {
+  if (syn == nullptr) {
+    ++entry.num_missing;
+  } else if (const auto* bf
+             = dynamic_cast<const bloom_filter_synopsis<ip, legacy_hash>*>(
+               syn)) {
+    entry.ips.add(partition, bf->filter());
+  } else if (const auto* bf = dynamic_cast<
+               const bloom_filter_synopsis<std::string, legacy_hash>*>(syn)) {
+    entry.strings.add(partition, bf->filter());
+  } else {
+    ++entry.num_other;
+  }
+}
+
+/// @returns True if the entry became empty.
+auto erase_synopsis(catalog_bloom_index::entry& entry, const uuid& partition,
+                    const synopsis* syn) -> bool {
+  if (syn == nullptr) {
+    TENZIR_ASSERT(entry.num_missing > 0);
+    --entry.num_missing;
+  } else if (not entry.ips.erase(partition)
+             and not entry.strings.erase(partition)) {
+    TENZIR_ASSERT(entry.num_other > 0);
+    --entry.num_other;
+  }
+  return entry.num_missing == 0 and entry.num_other == 0
+         and entry.num_sliced() == 0;
+}
+
+} // namespace
+
+void catalog_bloom_index::add(const uuid& partition,
+                              const partition_synopsis& synopsis) {
+  ++num_partitions;
+  for (const auto& [field, syn] : synopsis.field_synopses_) {
+    add_synopsis(fields[field], partition, syn.get());
+  }
+  // Partitions without a synopsis for a type do not need to be tracked, as
+  // the lookup requires all partitions to have one.
+  for (const auto& [type, syn] : synopsis.type_synopses_) {
+    if (syn) {
+      add_synopsis(types[type], partition, syn.get());
+    }
+  }
+}
+
+void catalog_bloom_index::erase(const uuid& partition,
+                                const partition_synopsis& synopsis) {
+  TENZIR_ASSERT(num_partitions > 0);
+  --num_partitions;
+  for (const auto& [field, syn] : synopsis.field_synopses_) {
+    auto it = fields.find(field);
+    TENZIR_ASSERT(it != fields.end());
+    if (erase_synopsis(it->second, partition, syn.get())) {
+      fields.erase(it);
+    }
+  }
+  for (const auto& [type, syn] : synopsis.type_synopses_) {
+    if (syn) {
+      auto it = types.find(type);
+      TENZIR_ASSERT(it != types.end());
+      if (erase_synopsis(it->second, partition, syn.get())) {
+        types.erase(it);
+      }
+    }
+  }
+}
+
+bool catalog_bloom_index::lookup(
+  const std::function<bool(const qualified_record_field&)>& match,
+  data_view rhs, std::vector<uuid>& result) const {
+  const auto* ip_value = caf::get_if<view<ip>>(&rhs);
+  const auto* string_value = caf::get_if<view<std::string>>(&rhs);
+  TENZIR_ASSERT(ip_value or string_value);
+  // A synopsis of the wrong kind rules out the partition, just like the
+  // lookup of the synopsis itself.
+  auto probe = [&](const entry& x) {
+    if (ip_value) {
+      x.ips.lookup(*ip_value, result);
+    } else {
+      x.strings.lookup(*string_value, result);
+    }
+  };
+  for (const auto& [field, x] : fields) {
+    if (not match(field)) {
+      continue;
+    }
+    if (x.num_other > 0) {
+      return false;
+    }
+    if (x.num_sliced() == num_partitions) {
+      probe(x);
+      continue;
+    }
+    if (x.num_missing != num_partitions) {
+      return false;
+    }
+    // The field has no dedicated synopsis in any partition, so all of them
+    // fall back to the synopsis of the field's type.
+    auto prune = []<concrete_type T>(const T& concrete) {
+      return type{concrete};
+    };
+    const auto it = types.find(caf::visit(prune, field.type()));
+    if (it == types.end() or it->second.num_other > 0
+        or it->second.num_sliced() != num_partitions) {
+      return false;
+    }
+    probe(it->second);
+  }
+  return true;
+}
+
+size_t catalog_bloom_index::memusage() const {
+  auto result = sizeof(catalog_bloom_index);
+  for (const auto& [_, x] : fields) {
+    result += x.ips.memusage() + x.strings.memusage();
+  }
+  for (const auto& [_, x] : types) {
+    result += x.ips.memusage() + x.strings.memusage();
+  }
+  return result;
+}
+
 void catalog_state::create_from(
   std::unordered_map<uuid, partition_synopsis_ptr>&& ps) {
   std::unordered_map<tenzir::type,
@@ -62,6 +196,10 @@ void catalog_state::create_from(
                  const std::pair<uuid, partition_synopsis_ptr>& rhs) {
                 return lhs.first < rhs.first;
               });
+    auto& bloom_index = bloom_indexes[type] = catalog_bloom_index{};
+    for (const auto& [uuid, synopsis] : flat_data) {
+      bloom_index.add(uuid, *synopsis);
+    }
     synopses_per_type[type]
       = decltype(synopses_per_type)::value_type::second_type::make_unsafe(
         std::move(flat_data));
@@ -70,14 +208,25 @@ void catalog_state::create_from(
 
 void catalog_state::merge(const uuid& partition, partition_synopsis_ptr ps) {
   update_unprunable_fields(*ps);
-  synopses_per_type[ps->schema][partition] = std::move(ps);
+  auto& bloom_index = bloom_indexes[ps->schema];
+  auto& slot = synopses_per_type[ps->schema][partition];
+  if (slot) {
+    bloom_index.erase(partition, *slot);
+  }
+  bloom_index.add(partition, *ps);
+  slot = std::move(ps);
 }
 
 void catalog_state::erase(const uuid& partition) {
   for (auto& [type, uuid_synopsis_map] : synopses_per_type) {
-    auto erased = uuid_synopsis_map.erase(partition);
-    if (erased) {
+    auto it = uuid_synopsis_map.find(partition);
+    if (it != uuid_synopsis_map.end()) {
+      auto bloom_index = bloom_indexes.find(type);
+      TENZIR_ASSERT(bloom_index != bloom_indexes.end());
+      bloom_index->second.erase(partition, *it->second);
+      uuid_synopsis_map.erase(it);
       if (uuid_synopsis_map.empty()) {
+        bloom_indexes.erase(bloom_index);
         synopses_per_type.erase(type);
       }
       return;
@@ -189,35 +338,87 @@ catalog_state::lookup_impl(const expression& expr, const type& schema) const {
       auto search = [&](auto match) {
         TENZIR_ASSERT(caf::holds_alternative<data>(x.rhs));
         const auto& rhs = caf::get<data>(x.rhs);
+        const auto rhs_view = make_view(rhs);
+        // Equality lookups for IP addresses and strings hit the Bloom filter
+        // synopses of every candidate partition. We probe them in a batch to
+        // hash the value only once rather than once per partition.
+        auto ip_probe
+          = std::optional<bloom_filter_synopsis_probe<ip, legacy_hash>>{};
+        auto string_probe = std::optional<
+          bloom_filter_synopsis_probe<std::string, legacy_hash>>{};
+        if (x.op == relational_operator::equal) {
+          if (const auto* value = caf::get_if<view<ip>>(&rhs_view))
+            ip_probe.emplace(*value);
+          else if (const auto* value
+                   = caf::get_if<view<std::string>>(&rhs_view))
+            string_probe.emplace(*value);
+        }
+        auto lookup = [&](const synopsis& syn) -> std::optional<bool> {
+          if (ip_probe) {
+            if (const auto* bf = dynamic_cast<
+                  const bloom_filter_synopsis<ip, legacy_hash>*>(&syn))
+              return (*ip_probe)(*bf);
+          } else if (string_probe) {
+            if (const auto* bf = dynamic_cast<
+                  const bloom_filter_synopsis<std::string, legacy_hash>*>(&syn))
+              return (*string_probe)(*bf);
+          }
+          return syn.lookup(x.op, rhs_view);
+        };
         catalog_lookup_result::candidate_info result;
+        // If the Bloom filters of all partitions are sliced, we can probe
+        // them in blocks of 64 partitions instead of one by one.
+        if (ip_probe or string_probe) {
+          const auto bloom_index = bloom_indexes.find(schema);
+          auto ids = std::vector<uuid>{};
+          if (bloom_index != bloom_indexes.end()
+              and bloom_index->second.lookup(match, rhs_view, ids)) {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+            result.partition_infos.reserve(ids.size());
+            for (const auto& id : ids) {
+              const auto it = partition_synopses.find(id);
+              TENZIR_ASSERT(it != partition_synopses.end());
+              result.partition_infos.emplace_back(id, *it->second);
+            }
+            TENZIR_DEBUG("{} probed sliced Bloom filters of {} partitions for "
+                         "predicate {} and got {} results",
+                         detail::pretty_type_name(this),
+                         partition_synopses.size(), x,
+                         result.partition_infos.size());
+            return result;
+          }
+        }
         // dont iterate through all synopses, rewrite lookup_impl to use a
         // singular type all synopses loops -> relevant anymore? Use type as
         // synopses key
         for (const auto& [part_id, part_syn] : partition_synopses) {
           for (const auto& [field, syn] : part_syn->field_synopses_) {
             if (match(field)) {
-              // We need to prune the type's metadata here by converting it to
-              // a concrete type and back, because the type synopses are
-              // looked up independent from names and attributes.
-              auto prune = [&]<concrete_type T>(const T& x) {
-                return type{x};
-              };
-              auto cleaned_type = caf::visit(prune, field.type());
               // We rely on having a field -> nullptr mapping here for the
               // fields that don't have their own synopsis.
               if (syn) {
-                auto opt = syn->lookup(x.op, make_view(rhs));
+                auto opt = lookup(*syn);
                 if (!opt || *opt) {
                   TENZIR_TRACE("{} selects {} at predicate {}",
                                detail::pretty_type_name(this), part_id, x);
                   result.partition_infos.emplace_back(part_id, *part_syn);
                   break;
                 }
-                // The field has no dedicated synopsis. Check if there is one
-                // for the type in general.
-              } else if (auto it = part_syn->type_synopses_.find(cleaned_type);
-                         it != part_syn->type_synopses_.end() && it->second) {
-                auto opt = it->second->lookup(x.op, make_view(rhs));
+                continue;
+              }
+              // The field has no dedicated synopsis. Check if there is one
+              // for the type in general. We need to prune the type's metadata
+              // here by converting it to a concrete type and back, because
+              // the type synopses are looked up independent from names and
+              // attributes.
+              auto prune = [&]<concrete_type T>(const T& x) {
+                return type{x};
+              };
+              auto cleaned_type = caf::visit(prune, field.type());
+              if (auto it = part_syn->type_synopses_.find(cleaned_type);
+                  it != part_syn->type_synopses_.end() && it->second) {
+                auto opt = lookup(*it->second);
                 if (!opt || *opt) {
                   TENZIR_TRACE("{} selects {} at predicate {}",
                                detail::pretty_type_name(this), part_id, x);
@@ -382,6 +583,8 @@ size_t catalog_state::memusage() const {
     for (const auto& [id, synopsis] : id_synopsis_map) {
       result += synopsis->memusage();
     }
+  for (const auto& [type, bloom_index] : bloom_indexes)
+    result += bloom_index.memusage();
   return result;
 }
 
@@ -0,0 +1,131 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/demand_controller.hpp"
+
+#include "tenzir/configuration.hpp"
+#include "tenzir/defaults.hpp"
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/error.hpp"
+
+#include <caf/settings.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace tenzir {
+
+auto demand_options::make(const caf::settings& options)
+  -> caf::expected<demand_options> {
+  auto result = demand_options{};
+  result.adaptive = caf::get_or(options, "tenzir.pipeline-batching.adaptive",
+                                defaults::pipeline_batching::adaptive);
+  auto latency_target = get_or_duration(
+    options, "tenzir.pipeline-batching.latency-target",
+    defaults::pipeline_batching::latency_target);
+  if (not latency_target) {
+    return std::move(latency_target.error());
+  }
+  if (*latency_target <= duration::zero()) {
+    return caf::make_error(ec::invalid_configuration,
+                           "tenzir.pipeline-batching.latency-target must be "
+                           "positive");
+  }
+  result.latency_target = *latency_target;
+  return result;
+}
+
+demand_controller::demand_controller(demand_bounds bounds,
+                                     demand_options options) noexcept
+  : bounds_{bounds}, options_{options} {
+  TENZIR_ASSERT(bounds_.min_batch_size > 0);
+  TENZIR_ASSERT(bounds_.min_batch_size <= bounds_.max_batch_size);
+  TENZIR_ASSERT(bounds_.min_batch_timeout <= bounds_.max_batch_timeout);
+  if (options_.adaptive) {
+    // The timeout bounds how long a partial batch waits for more elements, so
+    // it must never exceed the latency target.
+    bounds_.max_batch_timeout = options_.latency_target;
+    bounds_.min_batch_timeout
+      = std::min(bounds_.min_batch_timeout, options_.latency_target);
+  }
+  // Start with the largest batches, which is what a busy input wants. Idle
+  // inputs shrink the batch size with their first timeout.
+  batch_size_ = bounds_.max_batch_size;
+  batch_timeout_ = bounds_.min_batch_timeout;
+}
+
+auto demand_controller::batch_size() const noexcept -> uint64_t {
+  return batch_size_;
+}
+
+auto demand_controller::batch_timeout() const noexcept -> duration {
+  return batch_timeout_;
+}
+
+void demand_controller::finish_request(uint64_t requested, uint64_t received,
+                                       uint64_t backlog) noexcept {
+  const auto full = received >= requested;
+  // We back off with the timeout while the previous execution node cannot
+  // fill our demand. Without adapting, this is all we do.
+  if (full) {
+    batch_timeout_ = bounds_.min_batch_timeout;
+  } else {
+    batch_timeout_ = std::min(batch_timeout_ * 2, bounds_.max_batch_timeout);
+  }
+  if (not options_.adaptive) {
+    return;
+  }
+  if (full or backlog >= batch_size_) {
+    // Either the input arrives faster than we ask for it, or we still have
+    // unprocessed input anyways. In both cases larger batches cost no latency
+    // but save per-batch overhead.
+    batch_size_ = std::min(batch_size_ * 2, bounds_.max_batch_size);
+  } else {
+    // The timeout expired before the batch was full. Asking for about as many
+    // elements as arrived makes the previous execution node deliver as soon
+    // as they are available instead of waiting for the timeout again.
+    batch_size_ = std::clamp(std::bit_ceil(std::max(received, uint64_t{1})),
+                             bounds_.min_batch_size, bounds_.max_batch_size);
+  }
+  apply_cost_cap();
+}
+
+void demand_controller::add_processing(uint64_t elements,
+                                       duration elapsed) noexcept {
+  if (elements == 0) {
+    return;
+  }
+  const auto sample = static_cast<double>(elapsed.count())
+                      / static_cast<double>(elements);
+  constexpr auto weight = 0.2;
+  cost_per_element_ = cost_per_element_ == 0.0
+                        ? sample
+                        : (1.0 - weight) * cost_per_element_ + weight * sample;
+}
+
+void demand_controller::reset_timeout() noexcept {
+  batch_timeout_ = bounds_.min_batch_timeout;
+}
+
+void demand_controller::apply_cost_cap() noexcept {
+  if (cost_per_element_ <= 0.0) {
+    return;
+  }
+  // The last element of a batch waits for all elements before it to be
+  // processed, so we bound the batch size by what the operator processes
+  // within the latency target.
+  const auto affordable
+    = static_cast<double>(options_.latency_target.count()) / cost_per_element_;
+  if (affordable < static_cast<double>(batch_size_)) {
+    batch_size_ = std::max(static_cast<uint64_t>(affordable),
+                           bounds_.min_batch_size);
+  }
+}
+
+} // namespace tenzir
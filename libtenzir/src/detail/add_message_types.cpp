@@ -42,6 +42,7 @@
 #include "tenzir/subnet.hpp"
 #include "tenzir/table_slice.hpp"
 #include "tenzir/table_slice_column.hpp"
+#include "tenzir/table_slice_transport.hpp"
 #include "tenzir/taxonomies.hpp"
 #include "tenzir/type.hpp"
 #include "tenzir/uuid.hpp"
@@ -0,0 +1,161 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/detail/compressed_frames.hpp"
+
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/detail/narrow.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace tenzir::detail {
+
+namespace {
+
+/// Reads a little-endian unsigned integer of `n` bytes at `offset`.
+auto load_le(std::span<const uint8_t> bytes, size_t offset, size_t n)
+  -> uint64_t {
+  TENZIR_ASSERT(offset + n <= bytes.size());
+  auto result = uint64_t{0};
+  for (size_t i = 0; i < n; ++i) {
+    result |= uint64_t{bytes[offset + i]} << (8 * i);
+  }
+  return result;
+}
+
+/// Checks whether a frame of `size` bytes is fully contained in `bytes`.
+auto make_frame_info(std::span<const uint8_t> bytes, uint64_t size,
+                     bool skippable = false) -> frame_info {
+  if (size > bytes.size()) {
+    return {.status = frame_status::incomplete};
+  }
+  return {
+    .status = frame_status::complete,
+    .size = narrow_cast<int64_t>(size),
+    .skippable = skippable,
+  };
+}
+
+/// Both zstd and LZ4 frames may be interleaved with skippable frames, which
+/// start with one of 16 magic numbers followed by their size.
+auto is_skippable_frame(uint64_t magic) -> bool {
+  return (magic & 0xFFFFFFF0) == 0x184D2A50;
+}
+
+} // namespace
+
+auto scan_zstd_frame(std::span<const uint8_t> bytes) -> frame_info {
+  if (bytes.size() < 5) {
+    return {.status = frame_status::incomplete};
+  }
+  const auto magic = load_le(bytes, 0, 4);
+  if (is_skippable_frame(magic)) {
+    if (bytes.size() < 8) {
+      return {.status = frame_status::incomplete};
+    }
+    return make_frame_info(bytes, 8 + load_le(bytes, 4, 4), true);
+  }
+  const auto descriptor = bytes[4];
+  // The reserved bit of the frame header descriptor must be unset.
+  if (magic != 0xFD2FB528 or (descriptor & 0x08) != 0) {
+    return {};
+  }
+  const auto single_segment = ((descriptor >> 5) & 1) != 0;
+  const auto has_checksum = ((descriptor >> 2) & 1) != 0;
+  constexpr auto dictionary_id_sizes = std::array<size_t, 4>{0, 1, 2, 4};
+  constexpr auto content_size_sizes = std::array<size_t, 4>{0, 2, 4, 8};
+  auto content_size_size = content_size_sizes[descriptor >> 6];
+  if (content_size_size == 0 and single_segment) {
+    content_size_size = 1;
+  }
+  auto pos = size_t{5} + (single_segment ? 0 : 1)
+             + dictionary_id_sizes[descriptor & 3] + content_size_size;
+  while (true) {
+    if (pos + 3 > bytes.size()) {
+      return {.status = frame_status::incomplete};
+    }
+    const auto header = load_le(bytes, pos, 3);
+    pos += 3;
+    switch ((header >> 1) & 3) {
+      case 0: // Raw block
+      case 2: // Compressed block
+        pos += header >> 3;
+        break;
+      case 1: // RLE block
+        pos += 1;
+        break;
+      default:
+        return {};
+    }
+    if ((header & 1) != 0) {
+      break;
+    }
+  }
+  return make_frame_info(bytes, pos + (has_checksum ? 4 : 0));
+}
+
+auto scan_lz4_frame(std::span<const uint8_t> bytes) -> frame_info {
+  if (bytes.size() < 8) {
+    return {.status = frame_status::incomplete};
+  }
+  const auto magic = load_le(bytes, 0, 4);
+  if (is_skippable_frame(magic)) {
+    return make_frame_info(bytes, 8 + load_le(bytes, 4, 4), true);
+  }
+  const auto flags = bytes[4];
+  if (magic != 0x184D2204 or (flags >> 6) != 1) {
+    return {};
+  }
+  const auto has_block_checksum = ((flags >> 4) & 1) != 0;
+  const auto has_content_size = ((flags >> 3) & 1) != 0;
+  const auto has_content_checksum = ((flags >> 2) & 1) != 0;
+  const auto has_dictionary_id = (flags & 1) != 0;
+  auto pos = size_t{7} + (has_content_size ? 8 : 0)
+             + (has_dictionary_id ? 4 : 0);
+  while (true) {
+    if (pos + 4 > bytes.size()) {
+      return {.status = frame_status::incomplete};
+    }
+    const auto header = load_le(bytes, pos, 4);
+    pos += 4;
+    if (header == 0) {
+      break;
+    }
+    // The highest bit marks uncompressed blocks.
+    pos += (header & 0x7FFFFFFF) + (has_block_checksum ? 4 : 0);
+  }
+  return make_frame_info(bytes, pos + (has_content_checksum ? 4 : 0));
+}
+
+auto scan_bgzf_block(std::span<const uint8_t> bytes) -> frame_info {
+  if (bytes.size() < 12) {
+    return {.status = frame_status::incomplete};
+  }
+  constexpr auto has_extra_field = 0x04;
+  if (bytes[0] != 0x1F or bytes[1] != 0x8B or bytes[2] != 0x08
+      or (bytes[3] & has_extra_field) == 0) {
+    return {};
+  }
+  const auto end = 12 + load_le(bytes, 10, 2);
+  if (end > bytes.size()) {
+    return {.status = frame_status::incomplete};
+  }
+  auto pos = size_t{12};
+  while (pos + 4 <= end) {
+    const auto length = load_le(bytes, pos + 2, 2);
+    if (bytes[pos] == 'B' and bytes[pos + 1] == 'C' and length == 2
+        and pos + 6 <= end) {
+      return make_frame_info(bytes, load_le(bytes, pos + 4, 2) + 1);
+    }
+    pos += 4 + length;
+  }
+  return {};
+}
+
+} // namespace tenzir::detail
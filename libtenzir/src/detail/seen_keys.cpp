@@ -0,0 +1,97 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/detail/seen_keys.hpp"
+
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/die.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace tenzir::detail {
+
+seen_keys::seen_keys(std::optional<uint64_t> max_size,
+                     std::optional<duration> ttl)
+  : max_size_{max_size}, ttl_{ttl} {
+  // nop
+}
+
+auto seen_keys::insert(const key_view& key, size_t digest, time now) -> bool {
+  if (auto it = index_.find(key, digest); it != index_.end()) {
+    const auto entry = *it;
+    const auto expired = ttl_ and entry->last_seen + *ttl_ <= now;
+    entry->last_seen = now;
+    order_.splice(order_.begin(), order_, entry);
+    return expired;
+  }
+  auto values = std::vector<data>{};
+  values.reserve(key.values.size());
+  for (const auto& value : key.values) {
+    values.push_back(materialize(value));
+  }
+  order_.push_front({*key.schema, std::move(values), digest, now});
+  index_.insert(order_.cbegin());
+  if (max_size_ and index_.size() > *max_size_) {
+    pop_back();
+  }
+  return true;
+}
+
+void seen_keys::expire(time now) {
+  if (not ttl_) {
+    return;
+  }
+  while (not order_.empty() and order_.back().last_seen + *ttl_ <= now) {
+    pop_back();
+  }
+}
+
+auto seen_keys::size() const noexcept -> size_t {
+  return index_.size();
+}
+
+void seen_keys::pop_back() {
+  TENZIR_ASSERT(not order_.empty());
+  const auto erased = index_.erase(std::prev(order_.cend()));
+  TENZIR_ASSERT(erased == 1);
+  order_.pop_back();
+}
+
+auto seen_keys::entry_hash::operator()(
+  entry_list::const_iterator x) const noexcept -> size_t {
+  return x->digest;
+}
+
+auto seen_keys::entry_hash::operator()(const key_view&) const noexcept
+  -> size_t {
+  // All lookups with views provide a precalculated hash.
+  die("unreachable");
+}
+
+auto seen_keys::entry_equal::operator()(
+  entry_list::const_iterator x,
+  entry_list::const_iterator y) const noexcept -> bool {
+  return x == y;
+}
+
+auto seen_keys::entry_equal::operator()(
+  const key_view& x, entry_list::const_iterator y) const noexcept -> bool {
+  return *x.schema == y->schema
+         && std::equal(x.values.begin(), x.values.end(), y->values.begin(),
+                       y->values.end(), [](const auto& lhs, const auto& rhs) {
+                         return lhs == make_view(rhs);
+                       });
+}
+
+auto seen_keys::entry_equal::operator()(
+  entry_list::const_iterator x, const key_view& y) const noexcept -> bool {
+  return (*this)(y, x);
+}
+
+} // namespace tenzir::detail
@@ -22,6 +22,8 @@
 #include <cstddef>
 #include <regex>
 #include <span>
+#include <string_view>
+#include <unordered_map>
 
 namespace tenzir {
 
@@ -312,6 +314,41 @@ struct column_evaluator<Op, enumeration_type, std::string> {
   }
 };
 
+// Matching a pattern is expensive compared to all other comparisons, and string
+// columns typically contain few distinct values. We thus remember the result
+// per distinct value, which bounds the number of matches by the number of
+// distinct values rather than the number of rows.
+template <relational_operator Op>
+struct column_evaluator<Op, string_type, pattern> {
+  static ids evaluate(string_type type, id offset, const arrow::Array& array,
+                      const pattern& rhs, const ids& selection) noexcept {
+    // Columns with many distinct values gain nothing from the memoization, so
+    // we stop growing the cache at a fixed size.
+    constexpr auto max_cache_size = size_t{1024};
+    auto cache = std::unordered_map<std::string_view, bool>{};
+    ids result{};
+    for (auto id : select(selection)) {
+      TENZIR_ASSERT(id >= offset);
+      const auto row = detail::narrow_cast<int64_t>(id - offset);
+      if (array.IsNull(row))
+        continue;
+      const auto value = value_at(type, array, row);
+      auto matches = false;
+      if (auto it = cache.find(value); it != cache.end()) {
+        matches = it->second;
+      } else {
+        matches = cell_evaluator<Op>::evaluate(value, rhs);
+        if (cache.size() < max_cache_size)
+          cache.emplace(value, matches);
+      }
+      result.append(false, id - result.size());
+      result.append(matches, 1u);
+    }
+    result.append(false, offset + array.length() - result.size());
+    return result;
+  }
+};
+
 // A utility function for evaluating meta extractors in predicates. This is
 // always a yes or no question per batch, so the function does not have to deal
 // with bitmaps at all.
@@ -9,7 +9,9 @@
 #include "tenzir/execution_node.hpp"
 
 #include "tenzir/actors.hpp"
+#include "tenzir/blocking_executor.hpp"
 #include "tenzir/chunk.hpp"
+#include "tenzir/demand_controller.hpp"
 #include "tenzir/detail/weak_handle.hpp"
 #include "tenzir/detail/weak_run_delayed.hpp"
 #include "tenzir/diagnostics.hpp"
@@ -17,6 +19,7 @@
 #include "tenzir/operator_control_plane.hpp"
 #include "tenzir/si_literals.hpp"
 #include "tenzir/table_slice.hpp"
+#include "tenzir/table_slice_transport.hpp"
 
 #include <arrow/config.h>
 #include <arrow/util/byte_size.h>
@@ -55,6 +58,10 @@ struct defaults<table_slice> : defaults<> {
   /// execution node before it requests further data.
   inline static constexpr uint64_t min_batch_size = 8_Ki;
 
+  /// Defines the lower bound for the batch size when adapting it to the input
+  /// rate. A single event allows for delivering rare events immediately.
+  inline static constexpr uint64_t min_adaptive_batch_size = 1;
+
   /// Defines the upper bound for the inbound and outbound buffer of the
   /// execution node.
   inline static constexpr uint64_t max_buffered = 254_Ki;
@@ -70,6 +77,10 @@ struct defaults<chunk_ptr> : defaults<> {
   /// execution node before it requests further data.
   inline static constexpr uint64_t min_batch_size = 128_Ki;
 
+  /// Defines the lower bound for the batch size when adapting it to the input
+  /// rate.
+  inline static constexpr uint64_t min_adaptive_batch_size = 4_Ki;
+
   /// Defines the upper bound for the inbound and outbound buffer of the
   /// execution node.
   inline static constexpr uint64_t max_buffered = 4_Mi;
@@ -223,6 +234,22 @@ public:
     return has_terminal_;
   }
 
+  auto run_blocking(std::function<void()> work) noexcept -> void override {
+    auto& executor
+      = blocking_executor::instance(content(state_.self->config()));
+    state_.blocking_pending->fetch_add(1, std::memory_order_relaxed);
+    executor.submit([work = std::move(work), pending = state_.blocking_pending,
+                     weak_self = detail::weak_handle<exec_node_actor>{
+                       caf::actor_cast<exec_node_actor>(state_.self)}] {
+      work();
+      pending->fetch_sub(1, std::memory_order_release);
+      // Wake up the execution node, unless it shut down in the meantime.
+      if (auto self = weak_self.lock()) {
+        caf::anon_send(self, atom::internal_v, atom::run_v);
+      }
+    });
+  }
+
 private:
   exec_node_state<Input, Output>& state_;
   std::unique_ptr<exec_node_diagnostic_handler<Input, Output>> diagnostic_handler_
@@ -307,8 +334,21 @@ struct inbound_state_mixin {
   uint64_t signaled_demand = {};
   uint64_t fulfilled_demand = {};
 
+  /// Picks batch size and timeout for the next request.
+  demand_controller demand = {};
+
+  /// The number of elements in the inbound buffer when signaling demand.
+  uint64_t demand_backlog = {};
+
+  /// The total number of elements that the operator took from the inbound
+  /// buffer.
+  uint64_t num_consumed = {};
+
   std::vector<Input> inbound_buffer = {};
   uint64_t inbound_buffer_size = {};
+
+  /// Decodes events pushed from an execution node in a different process.
+  table_slice_decoder decoder = {};
 };
 
 template <>
@@ -331,6 +371,10 @@ struct outbound_state_mixin {
   };
   std::optional<demand> current_demand = {};
   bool reject_demand = {};
+
+  /// Encodes events pushed to an execution node in a different process.
+  /// Created lazily on the first push that crosses a process boundary.
+  std::optional<table_slice_encoder> encoder = {};
 };
 
 template <>
@@ -362,7 +406,6 @@ struct exec_node_state : inbound_state_mixin<Input>,
   // Indicates whether the operator input has stalled, i.e., the generator
   // should not be advanced.
   bool input_stalled = {};
-  duration batch_timeout = defaults<>::min_batch_timeout;
 
   /// A pointer to te operator control plane passed to this operator during
   /// execution, which acts as an escape hatch to this actor.
@@ -381,6 +424,11 @@ struct exec_node_state : inbound_state_mixin<Input>,
   /// Set by `ctrl.abort(...)`, to be checked by `start()` and `run()`.
   caf::error abort;
 
+  /// The number of tasks submitted via `ctrl.run_blocking(...)` that did not
+  /// finish yet. Shared with the tasks, which may outlive this actor.
+  std::shared_ptr<std::atomic<uint64_t>> blocking_pending
+    = std::make_shared<std::atomic<uint64_t>>();
+
   auto start(std::vector<caf::actor> previous) -> caf::result<void> {
     auto time_starting_guard = make_timer_guard(metrics->values.time_scheduled,
                                                 metrics->values.time_starting);
@@ -437,7 +485,7 @@ struct exec_node_state : inbound_state_mixin<Input>,
         // correctly, we must set `signaled_demand` to false as a workaround.
         this->signaled_demand = 0;
         this->fulfilled_demand = 0;
-        batch_timeout = defaults<>::min_batch_timeout;
+        this->demand.reset_timeout();
         schedule_run();
         if (msg.reason) {
           auto category
@@ -518,7 +566,9 @@ struct exec_node_state : inbound_state_mixin<Input>,
     auto time_scheduled_guard
       = make_timer_guard(metrics->values.time_scheduled);
     paused = false;
-    batch_timeout = defaults<>::min_batch_timeout;
+    if constexpr (not std::is_same_v<Input, std::monostate>) {
+      this->demand.reset_timeout();
+    }
     schedule_run();
     return {};
   }
@@ -527,29 +577,29 @@ struct exec_node_state : inbound_state_mixin<Input>,
     requires(not std::is_same_v<Input, std::monostate>)
   {
     // There are a few reasons why we would not be able to request more input:
-    // 1. The space in our inbound buffer is below the minimum batch size.
+    // 1. The space in our inbound buffer is below the minimum batch size, or
+    //    below the adapted batch size if that is smaller.
     // 2. The previous execution node is down.
     // 3. We already have an open request for more input.
     TENZIR_ASSERT(this->inbound_buffer_size <= defaults<Input>::max_buffered);
     const auto batch_size
       = std::min(defaults<Input>::max_buffered - this->inbound_buffer_size,
-                 defaults<Input>::max_batch_size);
+                 this->demand.batch_size());
     if (not this->previous or this->signaled_demand > 0
-        or batch_size < defaults<Input>::min_batch_size) {
+        or batch_size < std::min(defaults<Input>::min_batch_size,
+                                 this->demand.batch_size())) {
       return;
     }
+    const auto batch_timeout = this->demand.batch_timeout();
     /// Issue the actual request. If the inbound buffer is empty, we await the
     /// response, causing this actor to be suspended until the events have
     /// arrived.
     auto handle_result_or_error = [this]() {
       auto time_scheduled_guard
         = make_timer_guard(metrics->values.time_scheduled);
-      if (this->signaled_demand > this->fulfilled_demand) {
-        batch_timeout
-          = std::min(batch_timeout * 2, defaults<>::max_batch_timeout);
-      } else {
-        batch_timeout = defaults<>::min_batch_timeout;
-      }
+      this->demand.finish_request(this->signaled_demand,
+                                  this->fulfilled_demand,
+                                  this->demand_backlog);
       this->signaled_demand = 0;
       this->fulfilled_demand = 0;
       schedule_run();
@@ -574,6 +624,9 @@ struct exec_node_state : inbound_state_mixin<Input>,
       }
     };
     this->signaled_demand = batch_size;
+    this->demand_backlog = this->inbound_buffer_size;
+    metrics->values.demand_batch_size = batch_size;
+    metrics->values.demand_batch_timeout = batch_timeout;
     TENZIR_TRACE("sending pull from {}", op->name());
     auto response_handle
       = self->request(this->previous, caf::infinite, atom::pull_v,
@@ -585,6 +638,21 @@ struct exec_node_state : inbound_state_mixin<Input>,
 
   auto advance_generator() -> bool {
     auto time_running_guard = make_timer_guard(metrics->values.time_processing);
+    // Feed the time it took to process input back into the demand controller,
+    // which bounds the batch size by the cost of processing it.
+    auto processing_guard = [&] {
+      if constexpr (std::is_same_v<Input, std::monostate>) {
+        return caf::detail::make_scope_guard([] {});
+      } else {
+        return caf::detail::make_scope_guard(
+          [this, num_consumed = this->num_consumed,
+           start_time = std::chrono::steady_clock::now()] {
+            this->demand.add_processing(
+              this->num_consumed - num_consumed,
+              std::chrono::steady_clock::now() - start_time);
+          });
+      }
+    }();
     TENZIR_ASSERT(instance);
     TENZIR_ASSERT(instance->it != instance->gen.end());
     if constexpr (not std::is_same_v<Output, std::monostate>) {
@@ -634,6 +702,7 @@ struct exec_node_state : inbound_state_mixin<Input>,
         auto next = std::move(this->inbound_buffer.front());
         TENZIR_ASSERT(size(next) != 0);
         this->inbound_buffer_size -= size(next);
+        this->num_consumed += size(next);
         this->inbound_buffer.erase(this->inbound_buffer.begin());
         input_stalled = false;
         co_yield std::move(next);
@@ -718,25 +787,70 @@ struct exec_node_state : inbound_state_mixin<Input>,
       auto time_scheduled_guard
         = make_timer_guard(metrics->values.time_scheduled);
       TENZIR_DEBUG("{} failed to push", op->name());
+      // We cannot know how much of the encoded streams the next execution node
+      // has seen, so we start over with fresh streams for the next push.
+      if (this->encoder) {
+        this->encoder->reset();
+      }
       this->current_demand->rp.deliver(std::move(error));
       this->current_demand.reset();
       schedule_run();
     };
-    auto response_handle = self->request(
-      this->current_demand->sink, caf::infinite, atom::push_v, std::move(lhs));
-    if (force or this->outbound_buffer_size >= defaults<Output>::max_buffered) {
-      TENZIR_TRACE("{} pushes {}/{} buffered elements and suspends execution",
-                   op->name(), capped_demand, this->outbound_buffer_size);
-      std::move(response_handle)
-        .await(std::move(handle_result), std::move(handle_error));
-    } else {
-      TENZIR_TRACE("{} pushes {}/{} buffered elements", op->name(),
-                   capped_demand, this->outbound_buffer_size);
-      std::move(response_handle)
-        .then(std::move(handle_result), std::move(handle_error));
+    auto push = [&](auto batches) {
+      auto response_handle
+        = self->request(this->current_demand->sink, caf::infinite,
+                        atom::push_v, std::move(batches));
+      if (force
+          or this->outbound_buffer_size >= defaults<Output>::max_buffered) {
+        TENZIR_TRACE("{} pushes {}/{} buffered elements and suspends execution",
+                     op->name(), capped_demand, this->outbound_buffer_size);
+        std::move(response_handle)
+          .await(std::move(handle_result), std::move(handle_error));
+      } else {
+        TENZIR_TRACE("{} pushes {}/{} buffered elements", op->name(),
+                     capped_demand, this->outbound_buffer_size);
+        std::move(response_handle)
+          .then(std::move(handle_result), std::move(handle_error));
+      }
+    };
+    // When the next execution node lives in a different process, we send the
+    // events as schema-deduplicating and optionally compressed Arrow IPC
+    // streams rather than as individually serialized table slices.
+    if constexpr (std::is_same_v<Output, table_slice>) {
+      if (this->current_demand->sink.node() != self->node()) {
+        if (auto frames = encode_for_transport(std::move(lhs))) {
+          push(std::move(*frames));
+        } else {
+          TENZIR_DEBUG("{} failed to encode events: {}", op->name(),
+                       frames.error());
+          this->current_demand->rp.deliver(frames.error());
+          this->current_demand.reset();
+          ctrl->abort(std::move(frames.error()));
+          schedule_run();
+        }
+        return;
+      }
     }
+    push(std::move(lhs));
   };
 
+  auto encode_for_transport(std::vector<table_slice> events)
+    -> caf::expected<std::vector<table_slice_frame>>
+    requires(std::is_same_v<Output, table_slice>)
+  {
+    auto time_processing_guard
+      = make_timer_guard(metrics->values.time_processing);
+    if (not this->encoder) {
+      auto options
+        = table_slice_transport_options::make(content(self->config()));
+      if (not options) {
+        return std::move(options.error());
+      }
+      this->encoder.emplace(*options);
+    }
+    return this->encoder->encode(std::move(events));
+  }
+
   auto run() -> void {
     TENZIR_TRACE("{} enters run loop", op->name());
     TENZIR_ASSERT(instance);
@@ -792,8 +906,13 @@ struct exec_node_state : inbound_state_mixin<Input>,
     // Produce more output if there's more to be produced, then schedule the
     // next run. For sinks, this happens delayed when there is no input. For
     // everything else, it needs to happen only when there's enough space in the
-    // outbound buffer.
-    const auto output_stalled = not advance_generator();
+    // outbound buffer. While blocking work of the operator is running, the
+    // generator must not be advanced; the work schedules the next run when it
+    // finishes.
+    const auto waiting_for_blocking_work
+      = blocking_pending->load(std::memory_order_acquire) > 0;
+    const auto output_stalled
+      = waiting_for_blocking_work or not advance_generator();
     // Check if we need to quit.
     if (abort) {
       self->quit(abort);
@@ -907,6 +1026,22 @@ auto exec_node(
     return exec_node_actor::behavior_type::make_empty_behavior();
   }
   self->state.weak_node = node;
+  if constexpr (not std::is_same_v<Input, std::monostate>) {
+    auto options = demand_options::make(content(self->config()));
+    if (not options) {
+      self->quit(std::move(options.error()));
+      return exec_node_actor::behavior_type::make_empty_behavior();
+    }
+    self->state.demand = demand_controller{
+      demand_bounds{
+        .min_batch_size = defaults<Input>::min_adaptive_batch_size,
+        .max_batch_size = defaults<Input>::max_batch_size,
+        .min_batch_timeout = defaults<>::min_batch_timeout,
+        .max_batch_timeout = defaults<>::max_batch_timeout,
+      },
+      *options,
+    };
+  }
   self->attach_functor(
     [name = self->state.op->name(), metrics = self->state.metrics] {
       TENZIR_DEBUG("exec-node for {} shut down", name);
@@ -935,6 +1070,20 @@ auto exec_node(
                                            *self));
       }
     },
+    [self](atom::push,
+           std::vector<table_slice_frame>& frames) -> caf::result<void> {
+      if constexpr (std::is_same_v<Input, table_slice>) {
+        auto events = self->state.decoder.decode(std::move(frames));
+        if (not events) {
+          return std::move(events.error());
+        }
+        return self->state.push(std::move(*events));
+      } else {
+        return caf::make_error(ec::logic_error,
+                               fmt::format("{} does not accept events as input",
+                                           *self));
+      }
+    },
     [self](atom::push, std::vector<chunk_ptr>& bytes) -> caf::result<void> {
       if constexpr (std::is_same_v<Input, chunk_ptr>) {
         return self->state.push(std::move(bytes));
@@ -0,0 +1,150 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/hash/hash_array.hpp"
+
+#include "tenzir/arrow_table_slice.hpp"
+#include "tenzir/detail/narrow.hpp"
+#include "tenzir/detail/passthrough.hpp"
+#include "tenzir/hash/hash.hpp"
+#include "tenzir/type.hpp"
+#include "tenzir/view.hpp"
+
+#include <arrow/array.h>
+#include <arrow/builder.h>
+
+#include <array>
+
+namespace tenzir {
+
+namespace {
+
+/// An incremental hash algorithm that produces the same digests as
+/// `default_hash` by collecting all input and hashing it in one shot. The XXH3
+/// streaming and one-shot APIs are guaranteed to agree, and this avoids
+/// setting up a fresh streaming state for every value, which dominates the
+/// cost of hashing small values.
+class scratch_hash {
+public:
+  static constexpr std::endian endian = default_hash::endian;
+
+  using result_type = default_hash::result_type;
+
+  scratch_hash() noexcept {
+    buffer_.reserve(64);
+  }
+
+  void add(std::span<const std::byte> bytes) noexcept {
+    buffer_.insert(buffer_.end(), bytes.begin(), bytes.end());
+  }
+
+  result_type finish() noexcept {
+    const auto result = default_hash::make(buffer_);
+    buffer_.clear();
+    return result;
+  }
+
+private:
+  std::vector<std::byte> buffer_ = {};
+};
+
+template <concrete_type Type, class... Salt>
+auto hash_typed_array(const Type& type,
+                      const type_to_arrow_array_storage_t<Type>& array,
+                      std::span<array_digest> digests, array_digest null_digest,
+                      const Salt&... salt) -> void {
+  using view_type = view<type_to_data_t<Type>>;
+  constexpr auto tag = detail::data_view_tag<view_type>;
+  static_assert(tag != 0, "unexpected null view type");
+  auto h = scratch_hash{};
+  const auto length = array.length();
+  for (auto row = int64_t{0}; row < length; ++row) {
+    if (array.IsNull(row)) {
+      digests[row] = null_digest;
+      continue;
+    }
+    hash_append(h, tag);
+    hash_append(h, value_at(type, array, row));
+    (hash_append(h, salt), ...);
+    digests[row] = h.finish();
+  }
+}
+
+template <class... Salt>
+auto hash_array_impl(const type& type, const arrow::Array& array,
+                     std::span<array_digest> digests, const Salt&... salt)
+  -> void {
+  // The digest for null values does not depend on the row, so we compute it
+  // just once.
+  const auto null_digest = hash(data_view{}, salt...);
+  auto f = [&]<concrete_type Type>(const Type& type,
+                                   const arrow::Array& array) {
+    const auto& typed_array = caf::get<type_to_arrow_array_t<Type>>(array);
+    if constexpr (arrow::is_extension_type<
+                    type_to_arrow_type_t<Type>>::value) {
+      hash_typed_array(type, *typed_array.storage(), digests, null_digest,
+                       salt...);
+    } else {
+      hash_typed_array(type, typed_array, digests, null_digest, salt...);
+    }
+  };
+  caf::visit(f, type, detail::passthrough(array));
+}
+
+/// Formats a digest as hexadecimal string without leading zeros.
+auto format_hex(array_digest digest,
+                std::array<char, 2 * sizeof(array_digest)>& buffer)
+  -> std::string_view {
+  constexpr auto digits = std::string_view{"0123456789abcdef"};
+  auto* it = buffer.end();
+  do {
+    *--it = digits[digest & 0xf];
+    digest >>= 4;
+  } while (digest != 0);
+  return {it, buffer.end()};
+}
+
+} // namespace
+
+auto hash_array(const type& type, const arrow::Array& array,
+                std::span<array_digest> digests,
+                std::optional<std::string_view> salt) -> void {
+  TENZIR_ASSERT(digests.size() == detail::narrow_cast<size_t>(array.length()));
+  if (salt) {
+    hash_array_impl(type, array, digests, *salt);
+  } else {
+    hash_array_impl(type, array, digests);
+  }
+}
+
+auto hash_array(const type& type, const arrow::Array& array,
+                std::optional<std::string_view> salt)
+  -> std::vector<array_digest> {
+  auto result = std::vector<array_digest>(array.length());
+  hash_array(type, array, result, salt);
+  return result;
+}
+
+auto make_hex_digest_array(std::span<const array_digest> digests)
+  -> std::shared_ptr<arrow::StringArray> {
+  constexpr auto max_length = 2 * sizeof(array_digest);
+  auto builder = arrow::StringBuilder{};
+  const auto num_digests = detail::narrow_cast<int64_t>(digests.size());
+  auto status = builder.Reserve(num_digests);
+  TENZIR_ASSERT(status.ok(), status.ToString().c_str());
+  status = builder.ReserveData(num_digests * max_length);
+  TENZIR_ASSERT(status.ok(), status.ToString().c_str());
+  auto buffer = std::array<char, max_length>{};
+  for (const auto digest : digests) {
+    builder.UnsafeAppend(format_hex(digest, buffer));
+  }
+  return std::static_pointer_cast<arrow::StringArray>(
+    builder.Finish().ValueOrDie());
+}
+
+} // namespace tenzir
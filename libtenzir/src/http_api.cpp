@@ -265,6 +265,16 @@ auto rest_response::from_json_string(std::string json) -> rest_response {
   return result;
 }
 
+auto rest_response::from_binary(std::string body,
+                                http_content_type content_type)
+  -> rest_response {
+  auto result = rest_response{};
+  result.code_ = 200;
+  result.body_ = std::move(body);
+  result.content_type_ = content_type;
+  return result;
+}
+
 auto rest_response::is_error() const -> bool {
   return is_error_;
 }
@@ -285,6 +295,28 @@ auto rest_response::release() && -> std::string {
   return std::move(body_);
 }
 
+auto rest_response::content_type() const
+  -> const std::optional<http_content_type>& {
+  return content_type_;
+}
+
+auto rest_response::add_header(std::string field, std::string value) -> void {
+  headers_.emplace_back(std::move(field), std::move(value));
+}
+
+auto rest_response::headers() const
+  -> const std::vector<std::pair<std::string, std::string>>& {
+  return headers_;
+}
+
+auto rest_response::set_follow_up(tenzir::record params) -> void {
+  follow_up_ = std::move(params);
+}
+
+auto rest_response::follow_up() const -> const std::optional<tenzir::record>& {
+  return follow_up_;
+}
+
 auto rest_response::make_error(uint16_t error_code, std::string_view message,
                                caf::error detail) -> rest_response {
   return make_error_raw(error_code,
@@ -972,9 +972,13 @@ void index_state::send_report() {
           },
         });
   self->send(accountant, atom::metrics_v, std::move(msg));
-  auto r = performance_report{.data = {{{"scheduler", scheduler_measurement}}}};
+  auto r = performance_report{.data = {
+                                {"scheduler", scheduler_measurement},
+                                {"index-ingest", ingest_measurement},
+                              }};
   self->send(accountant, atom::metrics_v, std::move(r));
   scheduler_measurement = measurement{};
+  ingest_measurement = measurement{};
 }
 
 std::size_t index_state::memusage() const {
@@ -1180,6 +1184,7 @@ index(index_actor::stateful_pointer<index_state> self,
       TENZIR_ASSERT(x.encoding() != table_slice_encoding::none);
       if (!self->state.stage->running())
         return;
+      auto t = timer::start(self->state.ingest_measurement);
       auto&& schema = x.schema();
       // TODO: Consider switching schemas to a robin map to take advantage of
       // transparent key lookup with string views, avoding the copy of the name
@@ -1229,6 +1234,7 @@ index(index_actor::stateful_pointer<index_state> self,
         TENZIR_ASSERT(active_partition->second.capacity >= x.rows());
         active_partition->second.capacity -= x.rows();
       }
+      t.stop(x.rows());
     },
     [self](caf::unit_t&, const caf::error& err) {
       // During "normal" shutdown, the node will send an exit message to
@@ -0,0 +1,250 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/index/ngram_index.hpp"
+
+#include "tenzir/bitmap_algorithms.hpp"
+#include "tenzir/defaults.hpp"
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/detail/inspection_common.hpp"
+#include "tenzir/detail/overload.hpp"
+#include "tenzir/fbs/value_index.hpp"
+#include "tenzir/index/container_lookup.hpp"
+#include "tenzir/type.hpp"
+
+#include <caf/settings.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace tenzir {
+
+ngram_index::ngram_index(tenzir::type t, caf::settings opts)
+  : value_index{std::move(t), std::move(opts)} {
+  ngram_size_
+    = caf::get_or(options(), "ngram-size", defaults::index::ngram_size);
+  if (ngram_size_ == 0)
+    ngram_size_ = defaults::index::ngram_size;
+  max_length_
+    = caf::get_or(options(), "max-size", defaults::index::max_string_size);
+  max_ngrams_
+    = caf::get_or(options(), "max-ngrams", defaults::index::max_ngrams);
+}
+
+bool ngram_index::inspect_impl(supported_inspectors& inspector) {
+  return value_index::inspect_impl(inspector)
+         && std::visit(
+           [this]<class Inspector>(std::reference_wrapper<Inspector> visitor) {
+             // We inspect the posting lists as a sequence because the legacy
+             // deserializer cannot load maps with a const key type.
+             auto postings
+               = std::vector<std::pair<std::string, roaring_bitmap>>{};
+             if constexpr (not Inspector::is_loading)
+               postings.assign(postings_.begin(), postings_.end());
+             if (!detail::apply_all(visitor.get(), ngram_size_, max_length_,
+                                    max_ngrams_, postings, overflow_))
+               return false;
+             if constexpr (Inspector::is_loading)
+               postings_ = {std::make_move_iterator(postings.begin()),
+                            std::make_move_iterator(postings.end())};
+             return true;
+           },
+           inspector);
+}
+
+auto ngram_index::literal_prefix(std::string_view regex) -> std::string {
+  // An alternation anywhere in the expression may make every literal optional,
+  // so we don't attempt to find a common literal across branches.
+  if (regex.find('|') != std::string_view::npos)
+    return {};
+  constexpr auto metacharacters = std::string_view{".[]()*+?{}^$"};
+  auto result = std::string{};
+  auto i = size_t{regex.starts_with('^') ? 1u : 0u};
+  for (; i < regex.size(); ++i) {
+    auto c = regex[i];
+    if (c == '\\') {
+      // Escaped punctuation is a literal, whereas escaped alphanumeric
+      // characters denote character classes or assertions.
+      if (i + 1 == regex.size()
+          || std::isalnum(static_cast<unsigned char>(regex[i + 1])))
+        break;
+      result.push_back(regex[++i]);
+      continue;
+    }
+    if (metacharacters.find(c) != std::string_view::npos) {
+      // A quantifier that permits zero repetitions makes the preceding
+      // character optional.
+      if ((c == '*' || c == '?' || c == '{') && !result.empty())
+        result.pop_back();
+      break;
+    }
+    result.push_back(c);
+  }
+  return result;
+}
+
+bool ngram_index::append_impl(data_view x, id pos) {
+  auto str = caf::get_if<view<std::string>>(&x);
+  if (!str)
+    return false;
+  auto length = str->size();
+  if (length > max_length_) {
+    length = max_length_;
+    overflow_.append_bits(false, pos - overflow_.size());
+    overflow_.append_bit(true);
+  }
+  for (auto i = size_t{0}; i + ngram_size_ <= length; ++i) {
+    auto ngram = str->substr(i, ngram_size_);
+    auto it = postings_.find(std::string{ngram});
+    if (it == postings_.end()) {
+      if (postings_.size() >= max_ngrams_) {
+        if (overflow_.size() <= pos) {
+          overflow_.append_bits(false, pos - overflow_.size());
+          overflow_.append_bit(true);
+        }
+        continue;
+      }
+      it = postings_.emplace(std::string{ngram}, roaring_bitmap{}).first;
+    }
+    // A value may contain the same n-gram multiple times, but we must add its
+    // ID only once.
+    auto& bm = it->second;
+    if (bm.size() > pos)
+      continue;
+    bm.append_bits(false, pos - bm.size());
+    bm.append_bit(true);
+  }
+  return true;
+}
+
+auto ngram_index::candidates(std::string_view literal) const -> ids {
+  if (literal.size() > max_length_)
+    literal = literal.substr(0, max_length_);
+  if (literal.size() < ngram_size_)
+    return ids{offset(), true};
+  // Intersecting Roaring bitmaps only touches the chunks that both sides
+  // have, so rare n-grams quickly narrow down the result.
+  auto result = roaring_bitmap{offset(), true};
+  for (auto i = size_t{0}; i + ngram_size_ <= literal.size(); ++i) {
+    auto ngram = literal.substr(i, ngram_size_);
+    // Values that overflowed may contain n-grams that we did not index, so
+    // they are always candidates.
+    if (auto it = postings_.find(std::string{ngram}); it != postings_.end())
+      result &= it->second | overflow_;
+    else
+      result &= overflow_;
+    if (result.cardinality() == 0)
+      break;
+  }
+  return result;
+}
+
+caf::expected<ids>
+ngram_index::lookup_impl(relational_operator op, data_view x) const {
+  auto f = detail::overload{
+    [&](auto x) -> caf::expected<ids> {
+      return caf::make_error(ec::type_clash, materialize(x));
+    },
+    [&](view<pattern> pat) -> caf::expected<ids> {
+      switch (op) {
+        default:
+          return caf::make_error(ec::unsupported_operator, op);
+        case relational_operator::equal:
+          if (pat.case_insensitive())
+            return ids{offset(), true};
+          return candidates(literal_prefix(pat.string()));
+        case relational_operator::not_equal:
+          return ids{offset(), true};
+      }
+    },
+    [&](view<std::string> str) -> caf::expected<ids> {
+      switch (op) {
+        default:
+          return caf::make_error(ec::unsupported_operator, op);
+        case relational_operator::equal:
+        case relational_operator::ni:
+          // Every value equal to the string also contains it.
+          return candidates(str);
+        case relational_operator::not_equal:
+        case relational_operator::not_ni:
+          // The complement of a candidate set is not a candidate set for the
+          // negated predicate.
+          return ids{offset(), true};
+      }
+    },
+    [&](view<list> xs) {
+      return detail::container_lookup(*this, op, xs);
+    },
+  };
+  return caf::visit(f, x);
+}
+
+size_t ngram_index::memusage_impl() const {
+  auto acc = overflow_.memusage();
+  for (const auto& [ngram, bm] : postings_)
+    acc += ngram.capacity() + bm.memusage();
+  return acc;
+}
+
+flatbuffers::Offset<fbs::ValueIndex> ngram_index::pack_impl(
+  flatbuffers::FlatBufferBuilder& builder,
+  flatbuffers::Offset<fbs::value_index::detail::ValueIndexBase> base_offset) {
+  // Sort the posting lists so that packing the same index always yields the
+  // same bytes.
+  auto sorted = std::vector<const decltype(postings_)::value_type*>{};
+  sorted.reserve(postings_.size());
+  for (const auto& posting : postings_)
+    sorted.push_back(&posting);
+  std::sort(sorted.begin(), sorted.end(), [](const auto* lhs, const auto* rhs) {
+    return lhs->first < rhs->first;
+  });
+  auto posting_offsets = std::vector<
+    flatbuffers::Offset<fbs::value_index::detail::NGramPostingList>>{};
+  posting_offsets.reserve(sorted.size());
+  for (const auto* posting : sorted) {
+    const auto& [ngram, bm] = *posting;
+    const auto ngram_offset = builder.CreateVector(
+      reinterpret_cast<const uint8_t*>(ngram.data()), ngram.size());
+    const auto ids_offset = pack(builder, bm);
+    posting_offsets.emplace_back(
+      fbs::value_index::detail::CreateNGramPostingList(builder, ngram_offset,
+                                                       ids_offset));
+  }
+  const auto overflow_offset = pack(builder, overflow_);
+  const auto ngram_index_offset = fbs::value_index::CreateNGramIndexDirect(
+    builder, base_offset, ngram_size_, max_length_, max_ngrams_,
+    &posting_offsets, overflow_offset);
+  return fbs::CreateValueIndex(builder, fbs::value_index::ValueIndex::ngram,
+                               ngram_index_offset.Union());
+}
+
+caf::error ngram_index::unpack_impl(const fbs::ValueIndex& from) {
+  const auto* from_ngram = from.value_index_as_ngram();
+  TENZIR_ASSERT(from_ngram);
+  ngram_size_ = from_ngram->ngram_size();
+  max_length_ = from_ngram->max_length();
+  max_ngrams_ = from_ngram->max_ngrams();
+  if (ngram_size_ == 0)
+    return caf::make_error(ec::format_error, "invalid n-gram size 0");
+  postings_.clear();
+  postings_.reserve(from_ngram->postings()->size());
+  for (const auto* posting : *from_ngram->postings()) {
+    auto ngram = std::string{
+      reinterpret_cast<const char*>(posting->ngram()->data()),
+      posting->ngram()->size()};
+    auto& to = postings_[std::move(ngram)];
+    if (auto err = unpack(*posting->ids(), to))
+      return err;
+  }
+  return unpack(*from_ngram->overflow(), overflow_);
+}
+
+} // namespace tenzir
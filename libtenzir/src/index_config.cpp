@@ -65,4 +65,14 @@ bool should_create_partition_index(
   return true;
 }
 
+std::string_view
+selected_value_index(const qualified_record_field& index_qf,
+                     const std::vector<index_config::rule>& rules) {
+  for (const auto& rule : rules) {
+    if (should_use_rule(rule.targets, index_qf))
+      return rule.value_index;
+  }
+  return {};
+}
+
 } // namespace tenzir
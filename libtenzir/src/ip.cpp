@@ -21,8 +21,11 @@
 #include <openssl/evp.h>
 #include <openssl/ossl_typ.h>
 #include <sys/socket.h>
+#include <tsl/robin_map.h>
 
 #include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <utility>
 
 namespace tenzir {
@@ -37,60 +40,56 @@ class address_encryptor {
 public:
   explicit address_encryptor(const std::array<ip::byte_type, 32>& key) {
     cipher_ = EVP_get_cipherbyname("aes-128-ecb");
-    block_size_ = EVP_CIPHER_block_size(cipher_);
-    pad_ = std::vector<ip::byte_type>(block_size_);
+    TENZIR_ASSERT(EVP_CIPHER_block_size(cipher_) == block_size);
     auto pad_out_len = 0;
     EVP_CipherInit_ex(ctx_.get(), cipher_, nullptr, key.data(), nullptr, 1);
     // use second 16-byte half of key for padding
     EVP_CipherUpdate(ctx_.get(), pad_.data(), &pad_out_len,
-                     key.data() + block_size_, block_size_);
+                     key.data() + block_size, block_size);
   }
 
-  auto operator()(ip::byte_array bytes, size_t byte_offset) {
-    auto bytes_to_encrypt = std::span{bytes.begin() + byte_offset, bytes.end()};
-    auto one_time_pad = generate_one_time_pad(bytes_to_encrypt);
-    for (auto i = size_t{0}; i < bytes_to_encrypt.size(); ++i) {
-      bytes[i + byte_offset] = bytes_to_encrypt[i] ^ one_time_pad[i];
+  /// Computes the one-time pad for a single byte of an address. The pad bit
+  /// for bit *i* of the address is the most significant bit of the encrypted
+  /// block that consists of the first *i* bits of the address followed by
+  /// the padding. All eight blocks of a byte are known up front, so we
+  /// encrypt them with a single call, which lets the cipher implementation
+  /// pipeline the blocks, e.g., when using AES-NI.
+  /// @param bytes The original bytes to encrypt.
+  /// @param index The index of the byte to compute the pad for.
+  auto pad_byte(std::span<const ip::byte_type> bytes, size_t index)
+    -> ip::byte_type {
+    TENZIR_ASSERT(index < bytes.size());
+    TENZIR_ASSERT(bytes.size() <= size_t{block_size});
+    auto cipher_input = std::array<ip::byte_type, 8 * block_size>{};
+    auto cipher_output = std::array<ip::byte_type, 8 * block_size>{};
+    for (auto bit = 0; bit < 8; ++bit) {
+      auto* block = cipher_input.data() + bit * block_size;
+      std::memcpy(block, pad_.data(), block_size);
+      std::memcpy(block, bytes.data(), index);
+      auto padding_mask = 0xff >> bit;
+      auto original_mask = ~padding_mask;
+      block[index]
+        = (bytes[index] & original_mask) | (pad_[index] & padding_mask);
+    }
+    auto out_len = 0;
+    const auto in_len = static_cast<int>(cipher_input.size());
+    EVP_CipherUpdate(ctx_.get(), cipher_output.data(), &out_len,
+                     cipher_input.data(), in_len);
+    TENZIR_ASSERT(out_len == in_len);
+    auto result = ip::byte_type{0};
+    for (auto bit = 0; bit < 8; ++bit) {
+      result |= (cipher_output[bit * block_size] & msb_of_byte_mask) >> bit;
     }
-    return bytes;
+    return result;
   }
 
 private:
+  static constexpr inline auto block_size = 16;
   static constexpr inline auto msb_of_byte_mask = 0b10000000;
   std::unique_ptr<EVP_CIPHER_CTX, std::function<void(EVP_CIPHER_CTX*)>> ctx_
     = {EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free};
   const EVP_CIPHER* cipher_ = {};
-  int block_size_ = {};
-  std::vector<ip::byte_type> pad_ = {};
-
-  std::vector<ip::byte_type>
-  generate_one_time_pad(std::span<ip::byte_type> bytes_to_encrypt) {
-    auto out_len = 0;
-    auto cipher_input = std::vector<ip::byte_type>(pad_);
-    auto cipher_output = std::vector<ip::byte_type>(pad_);
-    EVP_CipherUpdate(ctx_.get(), cipher_output.data(), &out_len,
-                     cipher_input.data(), block_size_);
-    auto byte_index = 0;
-    auto bit_index = 0;
-    auto one_time_pad = std::vector<ip::byte_type>(bytes_to_encrypt.size());
-    one_time_pad[byte_index] |= cipher_output[0] & msb_of_byte_mask;
-    for (auto i = size_t{0}; i < bytes_to_encrypt.size() * 8 - 1;) {
-      auto padding_mask = 0xff >> (bit_index + 1);
-      auto original_mask = ~padding_mask;
-      auto padding_byte = pad_[byte_index];
-      auto original_byte = bytes_to_encrypt[byte_index];
-      cipher_input[byte_index]
-        = (original_byte & original_mask) | (padding_byte & padding_mask);
-      EVP_CipherUpdate(ctx_.get(), cipher_output.data(), &out_len,
-                       cipher_input.data(), block_size_);
-      ++i;
-      byte_index = i / 8;
-      bit_index = i % 8;
-      one_time_pad[byte_index]
-        |= (cipher_output[0] & msb_of_byte_mask) >> bit_index;
-    }
-    return one_time_pad;
-  }
+  std::array<ip::byte_type, block_size> pad_ = {};
 };
 
 } // namespace
@@ -98,10 +97,7 @@ private:
 ip ip::pseudonymize(
   const ip& original,
   const std::array<byte_type, pseudonymization_seed_array_size>& seed) {
-  auto byte_offset = (original.is_v4() ? 12 : 0);
-  address_encryptor encryptor(seed);
-  auto pseudonymized_bytes = encryptor(original.bytes_, byte_offset);
-  return ip(pseudonymized_bytes);
+  return ip_pseudonymizer{seed, 0}(original);
 }
 
 bool ip::is_v4() const {
@@ -191,4 +187,73 @@ bool operator<(const ip& x, const ip& y) {
   return x.bytes_ < y.bytes_;
 }
 
+struct ip_pseudonymizer::impl {
+  /// A byte-aligned prefix of an address to encrypt. The first byte holds the
+  /// length of the prefix, followed by the prefix itself and zero bytes. The
+  /// address family is not part of the key, because the one-time pad only
+  /// depends on the bytes to encrypt.
+  using prefix_key = std::array<ip::byte_type, 17>;
+
+  struct prefix_key_hash {
+    auto operator()(const prefix_key& key) const noexcept -> size_t {
+      return hash(key);
+    }
+  };
+
+  impl(const std::array<ip::byte_type, ip::pseudonymization_seed_array_size>&
+         seed,
+       size_t cache_capacity)
+    : encryptor{seed}, cache_capacity{cache_capacity} {
+  }
+
+  auto pad_byte(std::span<const ip::byte_type> bytes, size_t index)
+    -> ip::byte_type {
+    if (cache_capacity == 0) {
+      return encryptor.pad_byte(bytes, index);
+    }
+    auto key = prefix_key{};
+    key[0] = static_cast<ip::byte_type>(index + 1);
+    std::memcpy(key.data() + 1, bytes.data(), index + 1);
+    if (auto it = cache.find(key); it != cache.end()) {
+      return it->second;
+    }
+    // We keep the cache bounded by starting over once it is full. This is
+    // cheap, and the prefixes that are still in use repopulate it quickly.
+    if (cache.size() >= cache_capacity) {
+      cache.clear();
+    }
+    auto result = encryptor.pad_byte(bytes, index);
+    cache.emplace(key, result);
+    return result;
+  }
+
+  address_encryptor encryptor;
+  size_t cache_capacity = {};
+  tsl::robin_map<prefix_key, ip::byte_type, prefix_key_hash> cache = {};
+};
+
+ip_pseudonymizer::ip_pseudonymizer(
+  const std::array<ip::byte_type, ip::pseudonymization_seed_array_size>& seed,
+  size_t cache_capacity)
+  : impl_{std::make_unique<impl>(seed, cache_capacity)} {
+}
+
+ip_pseudonymizer::~ip_pseudonymizer() noexcept = default;
+
+ip_pseudonymizer::ip_pseudonymizer(ip_pseudonymizer&&) noexcept = default;
+
+auto ip_pseudonymizer::operator=(ip_pseudonymizer&&) noexcept
+  -> ip_pseudonymizer& = default;
+
+auto ip_pseudonymizer::operator()(const ip& original) -> ip {
+  const auto original_bytes = static_cast<ip::byte_array>(original);
+  const auto byte_offset = original.is_v4() ? size_t{12} : size_t{0};
+  const auto bytes_to_encrypt = std::span{original_bytes}.subspan(byte_offset);
+  auto result = original_bytes;
+  for (auto i = size_t{0}; i < bytes_to_encrypt.size(); ++i) {
+    result[byte_offset + i] ^= impl_->pad_byte(bytes_to_encrypt, i);
+  }
+  return ip{result};
+}
+
 } // namespace tenzir
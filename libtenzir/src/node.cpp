@@ -13,6 +13,7 @@
 #include "tenzir/accountant.hpp"
 #include "tenzir/accountant_config.hpp"
 #include "tenzir/atoms.hpp"
+#include "tenzir/blocking_executor.hpp"
 #include "tenzir/concept/convertible/to.hpp"
 #include "tenzir/concept/parseable/tenzir/endpoint.hpp"
 #include "tenzir/concept/parseable/to.hpp"
@@ -186,6 +187,18 @@ void collect_component_status(node_actor::stateful_pointer<node_state> self,
       system["running-actors"] = uint64_t{sys.registry().running()};
       system["detached-actors"] = uint64_t{sys.detached_actors()};
       system["worker-threads"] = uint64_t{sys.scheduler().num_workers()};
+      const auto blocking
+        = blocking_executor::instance(content(sys.config())).statistics();
+      system["blocking-executor"] = record{
+        {"threads", blocking.threads},
+        {"idle-threads", blocking.idle_threads},
+        {"overflow-threads", blocking.overflow_threads},
+        {"queued-tasks", blocking.queued_tasks},
+        {"executed-tasks", blocking.executed_tasks},
+        {"stolen-tasks", blocking.stolen_tasks},
+        {"scheduling-latency", blocking.scheduling_latency},
+        {"max-scheduling-latency", blocking.max_scheduling_latency},
+      };
     }
     rs->content["system"] = std::move(system);
   }
@@ -8,11 +8,16 @@
 
 #include "tenzir/partition_synopsis.hpp"
 
+#include "tenzir/arrow_table_slice.hpp"
 #include "tenzir/collect.hpp"
 #include "tenzir/error.hpp"
 #include "tenzir/fbs/utils.hpp"
 #include "tenzir/index_config.hpp"
+#include "tenzir/offset.hpp"
 #include "tenzir/synopsis_factory.hpp"
+#include "tenzir/table_slice.hpp"
+
+#include <arrow/record_batch.h>
 
 namespace tenzir {
 
@@ -112,11 +117,15 @@ void partition_synopsis::add(const table_slice& slice,
     = get_type_fprate(fp_rates, tenzir::type{string_type{}});
   synopsis_opts["address-synopsis-fp-rate"]
     = get_type_fprate(fp_rates, tenzir::type{ip_type{}});
+  const auto batch = to_record_batch(slice);
   for (size_t col = 0; col < slice.columns(); ++col, ++leaf_it) {
     auto&& leaf = *leaf_it;
+    // Access the column array only once, and only if we actually need it.
+    auto array = std::shared_ptr<arrow::Array>{};
     auto add_column = [&](const synopsis_ptr& syn) {
-      for (size_t row = 0; row < slice.rows(); ++row) {
-        auto view = slice.at(row, col, leaf.field.type);
+      if (not array)
+        array = leaf.index.get(*batch);
+      for (auto&& view : values(leaf.field.type, *array)) {
         // TODO: It would probably make sense to allow `null` in the
         // synopsis API, so we can treat queries like `x == null` just
         // like normal queries.
@@ -16,6 +16,7 @@
 #include "tenzir/pipeline.hpp"
 #include "tenzir/plugin.hpp"
 #include "tenzir/value_index_factory.hpp"
+#include "tenzir/zone_map.hpp"
 
 #include <caf/attach_continuous_stream_stage.hpp>
 #include <caf/attach_stream_stage.hpp>
@@ -206,8 +207,10 @@ void partition_transformer_state::update_type_ids_and_indexers(
     if (it == typed_indexers.end()) {
       const auto skip
         = should_skip_index_creation(field.type, qf, synopsis_opts.rules);
-      auto idx
-        = skip ? nullptr : factory<value_index>::make(field.type, index_opts);
+      auto idx = skip ? nullptr
+                      : factory<value_index>::make(
+                        field.type, make_value_index_options(
+                                      qf, synopsis_opts.rules, index_opts));
       it = typed_indexers.emplace(qf, std::move(idx)).first;
     }
     auto& idx = it->second;
@@ -476,6 +479,7 @@ auto partition_transformer(
                                                    slice);
           mutable_synopsis.add(slice, self->state.partition_capacity,
                                self->state.synopsis_opts);
+          data.zone_maps.push_back(make_zone_map(slice));
         }
         // Update the synopsis
         // TODO: It would make more sense if the partition
@@ -17,6 +17,7 @@
 #include "tenzir/detail/assert.hpp"
 #include "tenzir/detail/partition_common.hpp"
 #include "tenzir/detail/tracepoint.hpp"
+#include "tenzir/expression.hpp"
 #include "tenzir/fbs/partition.hpp"
 #include "tenzir/fbs/utils.hpp"
 #include "tenzir/fbs/uuid.hpp"
@@ -68,6 +69,24 @@ void deliver_error_to_deferred_requests(passive_partition_state& state,
   }
 }
 
+/// Removes the ids of all table slices whose zone maps rule out a match from
+/// the hits of the evaluator.
+ids prune_with_zone_maps(const passive_partition_state& state,
+                         const expression& expr, ids hits) {
+  // Zone maps refer to columns by their flat index, so we need to tailor the
+  // expression to the schema just like the store does. Partitions are
+  // homogeneous, so the only type name is the name of the schema.
+  if (state.zone_maps.empty() || state.type_ids().size() != 1
+      || !state.combined_schema())
+    return hits;
+  const auto schema
+    = type{state.type_ids().begin()->first, *state.combined_schema()};
+  auto tailored_expr = tailor(expr, schema);
+  if (!tailored_expr)
+    return hits;
+  return prune(state.zone_maps, *tailored_expr, std::move(hits));
+}
+
 caf::expected<tenzir::record_type>
 unpack_schema(const fbs::partition::LegacyPartition& partition) {
   if (auto const* data = partition.combined_schema_caf_0_17()) {
@@ -239,6 +258,14 @@ caf::error unpack(const fbs::partition::LegacyPartition& partition,
   }
   TENZIR_DEBUG("{} restored {} type-to-ids mapping for partition {}",
                state.name, state.type_ids_.size(), state.id);
+  // Partitions written before the introduction of zone maps have none, in
+  // which case we cannot skip any table slices.
+  if (auto const* zone_maps = partition.zone_maps()) {
+    state.zone_maps.resize(zone_maps->size());
+    for (size_t i = 0; i < zone_maps->size(); ++i)
+      if (auto error = unpack(*zone_maps->Get(i), state.zone_maps[i]))
+        return error;
+  }
   return caf::none;
 }
 
@@ -509,14 +536,16 @@ partition_actor::behavior_type passive_partition(
                          {"issuer", query_context.issuer},
                          {"partition-type", "passive"},
                        });
+            auto candidates = prune_with_zone_maps(
+              self->state, query_context.expr, hits);
             // TODO: Use the first path if the expression can be evaluated
             // exactly.
             auto* count = caf::get_if<count_query_context>(&query_context.cmd);
             if (count && count->mode == count_query_context::estimate) {
-              self->send(count->sink, rank(hits));
-              rp.deliver(rank(hits));
+              self->send(count->sink, rank(candidates));
+              rp.deliver(rank(candidates));
             } else {
-              query_context.ids = hits;
+              query_context.ids = std::move(candidates);
               rp.delegate(self->state.store, atom::query_v,
                           std::move(query_context));
             }
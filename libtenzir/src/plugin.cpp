@@ -463,6 +463,10 @@ store_parser_impl(generator<chunk_ptr> loader, operator_control_plane& ctrl,
   for (auto&& slice : store->slices()) {
     co_yield std::move(slice);
   }
+  if (auto err = store->take_error()) {
+    ctrl.abort(caf::make_error(ec::format_error, "{} parser failed to read: {}",
+                               name, std::move(err)));
+  }
 }
 
 class store_parser final : public plugin_parser {
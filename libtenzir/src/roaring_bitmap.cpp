@@ -0,0 +1,806 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/roaring_bitmap.hpp"
+
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/error.hpp"
+#include "tenzir/fbs/bitmap.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+namespace tenzir {
+
+namespace {
+
+using block_type = roaring_bitmap::block_type;
+using size_type = roaring_bitmap::size_type;
+using word_type = roaring_bitmap::word_type;
+using container = roaring_bitmap::container;
+using container_kind = roaring_bitmap::container_kind;
+
+constexpr auto container_width = roaring_bitmap::container_width;
+constexpr auto max_array_size = roaring_bitmap::max_array_size;
+constexpr auto max_run_count = roaring_bitmap::max_run_count;
+constexpr auto bitset_size = roaring_bitmap::bitset_size;
+
+/// Sets the bits *[first,last)* in a bitset.
+void set_range(std::vector<block_type>& blocks, size_t first, size_t last) {
+  while (first < last) {
+    const auto i = first % word_type::width;
+    const auto n = std::min(word_type::width - i, last - first);
+    const auto mask = n == word_type::width ? word_type::all
+                                            : word_type::lsb_mask(n);
+    blocks[first / word_type::width] |= mask << i;
+    first += n;
+  }
+}
+
+/// Finds the next position at or after *i* where a bitset has a given bit.
+/// @returns The position, or `container_width` if there is none.
+auto find_next(const std::vector<block_type>& blocks, size_t i, bool bit)
+  -> size_t {
+  while (i < container_width) {
+    const auto w = i / word_type::width;
+    auto block = bit ? blocks[w] : ~blocks[w];
+    block &= word_type::all << (i % word_type::width);
+    if (block != 0)
+      return w * word_type::width + std::countr_zero(block);
+    i = (w + 1) * word_type::width;
+  }
+  return container_width;
+}
+
+/// Invokes *f* with the half-open interval *[first,last)* of every maximal run
+/// of 1-bits in a container, in ascending order.
+template <class F>
+void for_each_run(const container& c, F f) {
+  switch (c.kind) {
+    case container_kind::array: {
+      auto i = size_t{0};
+      while (i < c.values.size()) {
+        const auto first = size_t{c.values[i]};
+        auto last = first + 1;
+        while (++i < c.values.size() && c.values[i] == last)
+          ++last;
+        f(first, last);
+      }
+      return;
+    }
+    case container_kind::bitset: {
+      auto first = find_next(c.blocks, 0, true);
+      while (first < container_width) {
+        const auto last = find_next(c.blocks, first, false);
+        f(first, last);
+        first = find_next(c.blocks, last, true);
+      }
+      return;
+    }
+    case container_kind::run: {
+      for (auto i = size_t{0}; i < c.values.size(); i += 2) {
+        const auto first = size_t{c.values[i]};
+        f(first, first + c.values[i + 1] + 1);
+      }
+      return;
+    }
+  }
+  __builtin_unreachable();
+}
+
+auto count_runs(const container& c) -> size_t {
+  if (c.kind == container_kind::run)
+    return c.values.size() / 2;
+  auto result = size_t{0};
+  for_each_run(c, [&](size_t, size_t) {
+    ++result;
+  });
+  return result;
+}
+
+auto to_bitset(const container& c) -> std::vector<block_type> {
+  if (c.kind == container_kind::bitset)
+    return c.blocks;
+  auto result = std::vector<block_type>(bitset_size, 0);
+  if (c.kind == container_kind::array) {
+    for (auto value : c.values)
+      result[value / word_type::width] |= word_type::mask(value
+                                                          % word_type::width);
+  } else {
+    for_each_run(c, [&](size_t first, size_t last) {
+      set_range(result, first, last);
+    });
+  }
+  return result;
+}
+
+void convert(container& c, container_kind kind) {
+  if (c.kind == kind)
+    return;
+  auto values = std::vector<uint16_t>{};
+  auto blocks = std::vector<block_type>{};
+  switch (kind) {
+    case container_kind::array:
+      values.reserve(c.cardinality);
+      for_each_run(c, [&](size_t first, size_t last) {
+        for (auto i = first; i < last; ++i)
+          values.push_back(static_cast<uint16_t>(i));
+      });
+      break;
+    case container_kind::bitset:
+      blocks = to_bitset(c);
+      break;
+    case container_kind::run:
+      for_each_run(c, [&](size_t first, size_t last) {
+        values.push_back(static_cast<uint16_t>(first));
+        values.push_back(static_cast<uint16_t>(last - first - 1));
+      });
+      break;
+  }
+  c.kind = kind;
+  c.values = std::move(values);
+  c.blocks = std::move(blocks);
+}
+
+/// Converts a container into the representation that needs the least memory.
+void optimize(container& c) {
+  const auto array_bytes = size_t{c.cardinality} * sizeof(uint16_t);
+  const auto bitset_bytes = bitset_size * sizeof(block_type);
+  const auto run_bytes = count_runs(c) * 2 * sizeof(uint16_t);
+  if (run_bytes < std::min(array_bytes, bitset_bytes))
+    convert(c, container_kind::run);
+  else if (c.cardinality <= max_array_size)
+    convert(c, container_kind::array);
+  else
+    convert(c, container_kind::bitset);
+}
+
+/// Adds a single position that is greater than all positions in a container.
+void add(container& c, uint16_t value) {
+  ++c.cardinality;
+  switch (c.kind) {
+    case container_kind::array:
+      c.values.push_back(value);
+      if (c.values.size() > max_array_size)
+        convert(c, container_kind::bitset);
+      return;
+    case container_kind::bitset:
+      c.blocks[value / word_type::width]
+        |= word_type::mask(value % word_type::width);
+      return;
+    case container_kind::run:
+      if (!c.values.empty()
+          && size_t{c.values.end()[-2]} + c.values.back() + 1 == value) {
+        ++c.values.back();
+        return;
+      }
+      c.values.push_back(value);
+      c.values.push_back(0);
+      if (c.values.size() / 2 > max_run_count)
+        convert(c, container_kind::bitset);
+      return;
+  }
+}
+
+/// Adds the positions *[first,last)* that are greater than all positions in a
+/// container.
+void add(container& c, size_t first, size_t last) {
+  TENZIR_ASSERT(first < last);
+  if (last - first == 1)
+    return add(c, static_cast<uint16_t>(first));
+  // Ranges are cheaper to append as runs; the container gets optimized when
+  // it's complete.
+  if (c.kind == container_kind::array)
+    convert(c, container_kind::run);
+  c.cardinality += last - first;
+  if (c.kind == container_kind::bitset) {
+    set_range(c.blocks, first, last);
+    return;
+  }
+  if (!c.values.empty()
+      && size_t{c.values.end()[-2]} + c.values.back() + 1 == first) {
+    c.values.back() += static_cast<uint16_t>(last - first);
+    return;
+  }
+  c.values.push_back(static_cast<uint16_t>(first));
+  c.values.push_back(static_cast<uint16_t>(last - first - 1));
+  if (c.values.size() / 2 > max_run_count)
+    convert(c, container_kind::bitset);
+}
+
+auto make_container(size_type key, std::vector<block_type> blocks)
+  -> container {
+  auto result = container{};
+  result.key = key;
+  result.kind = container_kind::bitset;
+  for (auto block : blocks)
+    result.cardinality += std::popcount(block);
+  result.blocks = std::move(blocks);
+  return result;
+}
+
+auto make_container(size_type key, std::vector<uint16_t> values,
+                    container_kind kind) -> container {
+  auto result = container{};
+  result.key = key;
+  result.kind = kind;
+  if (kind == container_kind::array) {
+    result.cardinality = values.size();
+  } else {
+    for (auto i = size_t{1}; i < values.size(); i += 2)
+      result.cardinality += size_t{values[i]} + 1;
+  }
+  result.values = std::move(values);
+  return result;
+}
+
+auto contains(const container& c, uint16_t value) -> bool {
+  switch (c.kind) {
+    case container_kind::array:
+      return std::binary_search(c.values.begin(), c.values.end(), value);
+    case container_kind::bitset:
+      return word_type::test(c.blocks[value / word_type::width],
+                             value % word_type::width);
+    case container_kind::run: {
+      // Find the last run that starts at or before the value.
+      auto lo = size_t{0};
+      auto hi = c.values.size() / 2;
+      while (lo < hi) {
+        const auto mid = (lo + hi) / 2;
+        if (c.values[2 * mid] <= value)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      if (lo == 0)
+        return false;
+      const auto start = size_t{c.values[2 * (lo - 1)]};
+      return value <= start + c.values[2 * (lo - 1) + 1];
+    }
+  }
+  __builtin_unreachable();
+}
+
+auto intersect(const container& x, const container& y) -> container {
+  const auto key = x.key;
+  if (x.kind == container_kind::array && y.kind == container_kind::array) {
+    const auto& small = x.values.size() <= y.values.size() ? x : y;
+    const auto& large = &small == &x ? y : x;
+    auto result = std::vector<uint16_t>{};
+    result.reserve(small.values.size());
+    if (small.values.size() * 64 < large.values.size()) {
+      // Gallop through the larger array if the sizes are very different.
+      auto it = large.values.begin();
+      for (auto value : small.values) {
+        it = std::lower_bound(it, large.values.end(), value);
+        if (it == large.values.end())
+          break;
+        if (*it == value)
+          result.push_back(value);
+      }
+    } else {
+      std::set_intersection(small.values.begin(), small.values.end(),
+                            large.values.begin(), large.values.end(),
+                            std::back_inserter(result));
+    }
+    return make_container(key, std::move(result), container_kind::array);
+  }
+  if (x.kind == container_kind::array || y.kind == container_kind::array) {
+    const auto& array = x.kind == container_kind::array ? x : y;
+    const auto& other = &array == &x ? y : x;
+    auto result = std::vector<uint16_t>{};
+    result.reserve(array.values.size());
+    for (auto value : array.values)
+      if (contains(other, value))
+        result.push_back(value);
+    return make_container(key, std::move(result), container_kind::array);
+  }
+  if (x.kind == container_kind::run && y.kind == container_kind::run) {
+    auto result = std::vector<uint16_t>{};
+    auto i = size_t{0};
+    auto j = size_t{0};
+    while (i < x.values.size() && j < y.values.size()) {
+      const auto x_first = size_t{x.values[i]};
+      const auto x_last = x_first + x.values[i + 1] + 1;
+      const auto y_first = size_t{y.values[j]};
+      const auto y_last = y_first + y.values[j + 1] + 1;
+      const auto first = std::max(x_first, y_first);
+      const auto last = std::min(x_last, y_last);
+      if (first < last) {
+        result.push_back(static_cast<uint16_t>(first));
+        result.push_back(static_cast<uint16_t>(last - first - 1));
+      }
+      if (x_last < y_last)
+        i += 2;
+      else
+        j += 2;
+    }
+    return make_container(key, std::move(result), container_kind::run);
+  }
+  // This loop is simple enough for the compiler to auto-vectorize.
+  auto result = to_bitset(x);
+  const auto other = to_bitset(y);
+  for (auto i = size_t{0}; i < bitset_size; ++i)
+    result[i] &= other[i];
+  return make_container(key, std::move(result));
+}
+
+auto unite(const container& x, const container& y) -> container {
+  const auto key = x.key;
+  if (x.kind == container_kind::array && y.kind == container_kind::array
+      && x.values.size() + y.values.size() <= max_array_size) {
+    auto result = std::vector<uint16_t>{};
+    result.reserve(x.values.size() + y.values.size());
+    std::set_union(x.values.begin(), x.values.end(), y.values.begin(),
+                   y.values.end(), std::back_inserter(result));
+    return make_container(key, std::move(result), container_kind::array);
+  }
+  if (x.kind == container_kind::run && y.kind == container_kind::run) {
+    auto result = std::vector<uint16_t>{};
+    auto append = [&](size_t first, size_t last) {
+      if (!result.empty()) {
+        const auto prev_first = size_t{result.end()[-2]};
+        const auto prev_last = prev_first + result.back() + 1;
+        if (first <= prev_last) {
+          if (last > prev_last)
+            result.back() = static_cast<uint16_t>(last - prev_first - 1);
+          return;
+        }
+      }
+      result.push_back(static_cast<uint16_t>(first));
+      result.push_back(static_cast<uint16_t>(last - first - 1));
+    };
+    auto i = size_t{0};
+    auto j = size_t{0};
+    while (i < x.values.size() || j < y.values.size()) {
+      const auto take_x
+        = j == y.values.size()
+          || (i < x.values.size() && x.values[i] <= y.values[j]);
+      const auto& c = take_x ? x : y;
+      auto& k = take_x ? i : j;
+      const auto first = size_t{c.values[k]};
+      append(first, first + c.values[k + 1] + 1);
+      k += 2;
+    }
+    return make_container(key, std::move(result), container_kind::run);
+  }
+  // This loop is simple enough for the compiler to auto-vectorize.
+  auto result = to_bitset(x);
+  const auto other = to_bitset(y);
+  for (auto i = size_t{0}; i < bitset_size; ++i)
+    result[i] |= other[i];
+  return make_container(key, std::move(result));
+}
+
+/// Invokes *f* with the half-open interval *[first,last)* of every maximal run
+/// of 1-bits in a bitmap, in ascending order.
+template <class F>
+void for_each_run(const std::vector<container>& containers, F f) {
+  auto pending_first = size_type{0};
+  auto pending_last = size_type{0};
+  for (const auto& c : containers) {
+    const auto base = c.key * container_width;
+    for_each_run(c, [&](size_t first, size_t last) {
+      if (pending_last != 0 && pending_last == base + first) {
+        pending_last = base + last;
+        return;
+      }
+      if (pending_last != 0)
+        f(pending_first, pending_last);
+      pending_first = base + first;
+      pending_last = base + last;
+    });
+  }
+  if (pending_last != 0)
+    f(pending_first, pending_last);
+}
+
+/// Checks the invariants of a deserialized container.
+/// @returns An error message if the container is invalid.
+auto validate(const container& c) -> const char* {
+  switch (c.kind) {
+    case container_kind::array: {
+      if (c.values.size() != c.cardinality)
+        return "array size does not match cardinality";
+      if (std::adjacent_find(c.values.begin(), c.values.end(),
+                             std::greater_equal<>{})
+          != c.values.end())
+        return "array values are not sorted and unique";
+      return nullptr;
+    }
+    case container_kind::bitset: {
+      if (c.blocks.size() != bitset_size)
+        return "bitset has an invalid size";
+      auto cardinality = size_t{0};
+      for (auto block : c.blocks)
+        cardinality += std::popcount(block);
+      if (cardinality != c.cardinality)
+        return "bitset does not match cardinality";
+      return nullptr;
+    }
+    case container_kind::run: {
+      if (c.values.size() % 2 != 0)
+        return "run has an odd number of values";
+      auto cardinality = size_t{0};
+      auto previous_last = size_t{0};
+      for (size_t i = 0; i < c.values.size(); i += 2) {
+        const auto first = size_t{c.values[i]};
+        const auto last = first + c.values[i + 1] + 1;
+        if (last > container_width)
+          return "run exceeds the container";
+        if (i > 0 && first < previous_last)
+          return "runs are not sorted and disjoint";
+        cardinality += last - first;
+        previous_last = last;
+      }
+      if (cardinality != c.cardinality)
+        return "runs do not match cardinality";
+      return nullptr;
+    }
+  }
+  return "unknown container kind";
+}
+
+} // namespace
+
+bool operator==(const roaring_bitmap::container& x,
+                const roaring_bitmap::container& y) {
+  if (x.key != y.key || x.cardinality != y.cardinality)
+    return false;
+  if (x.kind == y.kind && x.values == y.values && x.blocks == y.blocks)
+    return true;
+  // The same set of bits may have different representations.
+  return to_bitset(x) == to_bitset(y);
+}
+
+roaring_bitmap::roaring_bitmap(size_type n, bool bit) {
+  append_bits(bit, n);
+}
+
+bool roaring_bitmap::empty() const {
+  return num_bits_ == 0;
+}
+
+roaring_bitmap::size_type roaring_bitmap::size() const {
+  return num_bits_;
+}
+
+size_t roaring_bitmap::memusage() const {
+  auto result = containers_.capacity() * sizeof(container);
+  for (const auto& c : containers_)
+    result += c.values.capacity() * sizeof(uint16_t)
+              + c.blocks.capacity() * sizeof(block_type);
+  return result;
+}
+
+roaring_bitmap::size_type roaring_bitmap::cardinality() const {
+  auto result = size_type{0};
+  for (const auto& c : containers_)
+    result += c.cardinality;
+  return result;
+}
+
+const std::vector<roaring_bitmap::container>&
+roaring_bitmap::containers() const {
+  return containers_;
+}
+
+void roaring_bitmap::append_bit(bool bit) {
+  TENZIR_ASSERT(num_bits_ < max_size);
+  if (bit)
+    add(container_for(num_bits_ / container_width),
+        static_cast<uint16_t>(num_bits_ % container_width));
+  ++num_bits_;
+}
+
+void roaring_bitmap::append_bits(bool bit, size_type n) {
+  TENZIR_ASSERT(max_size - num_bits_ >= n);
+  if (!bit) {
+    num_bits_ += n;
+    return;
+  }
+  while (n > 0) {
+    const auto offset = num_bits_ % container_width;
+    const auto k = std::min(n, container_width - offset);
+    add(container_for(num_bits_ / container_width), offset, offset + k);
+    num_bits_ += k;
+    n -= k;
+  }
+}
+
+void roaring_bitmap::append_block(block_type bits, size_type n) {
+  TENZIR_ASSERT(n <= word_type::width);
+  if (n < word_type::width)
+    bits &= word_type::lsb_mask(n);
+  auto consumed = size_type{0};
+  while (bits != 0) {
+    const auto first = static_cast<size_type>(std::countr_zero(bits));
+    const auto length
+      = static_cast<size_type>(std::countr_one(bits >> first));
+    append_bits(false, first - consumed);
+    append_bits(true, length);
+    consumed = first + length;
+    bits = consumed == word_type::width ? 0
+                                        : bits & (word_type::all << consumed);
+  }
+  append_bits(false, n - consumed);
+}
+
+void roaring_bitmap::flip() {
+  auto result = roaring_bitmap{};
+  auto last_one = size_type{0};
+  for_each_run(containers_, [&](size_type first, size_type last) {
+    result.append_bits(true, first - last_one);
+    result.append_bits(false, last - first);
+    last_one = last;
+  });
+  result.append_bits(true, num_bits_ - last_one);
+  result.optimize();
+  *this = std::move(result);
+}
+
+void roaring_bitmap::optimize() {
+  for (auto& c : containers_)
+    tenzir::optimize(c);
+}
+
+bool operator==(const roaring_bitmap& x, const roaring_bitmap& y) {
+  return x.num_bits_ == y.num_bits_ && x.containers_ == y.containers_;
+}
+
+auto binary_and(const roaring_bitmap& lhs, const roaring_bitmap& rhs)
+  -> roaring_bitmap {
+  auto result = roaring_bitmap{};
+  result.num_bits_ = std::max(lhs.num_bits_, rhs.num_bits_);
+  auto x = lhs.containers_.begin();
+  auto y = rhs.containers_.begin();
+  while (x != lhs.containers_.end() && y != rhs.containers_.end()) {
+    if (x->key < y->key) {
+      ++x;
+    } else if (y->key < x->key) {
+      ++y;
+    } else {
+      auto c = intersect(*x++, *y++);
+      if (c.cardinality > 0) {
+        optimize(c);
+        result.containers_.push_back(std::move(c));
+      }
+    }
+  }
+  return result;
+}
+
+auto binary_or(const roaring_bitmap& lhs, const roaring_bitmap& rhs)
+  -> roaring_bitmap {
+  auto result = roaring_bitmap{};
+  result.num_bits_ = std::max(lhs.num_bits_, rhs.num_bits_);
+  result.containers_.reserve(
+    std::max(lhs.containers_.size(), rhs.containers_.size()));
+  auto x = lhs.containers_.begin();
+  auto y = rhs.containers_.begin();
+  while (x != lhs.containers_.end() || y != rhs.containers_.end()) {
+    if (y == rhs.containers_.end()
+        || (x != lhs.containers_.end() && x->key < y->key)) {
+      result.containers_.push_back(*x++);
+    } else if (x == lhs.containers_.end() || y->key < x->key) {
+      result.containers_.push_back(*y++);
+    } else {
+      auto c = unite(*x++, *y++);
+      optimize(c);
+      result.containers_.push_back(std::move(c));
+    }
+  }
+  return result;
+}
+
+auto pack(flatbuffers::FlatBufferBuilder& builder, const roaring_bitmap& from)
+  -> flatbuffers::Offset<fbs::bitmap::RoaringBitmap> {
+  auto container_offsets
+    = std::vector<flatbuffers::Offset<fbs::bitmap::detail::RoaringContainer>>{};
+  container_offsets.reserve(from.containers_.size());
+  for (const auto& c : from.containers_) {
+    const auto kind = static_cast<fbs::bitmap::detail::RoaringContainerKind>(
+      static_cast<uint8_t>(c.kind));
+    container_offsets.emplace_back(
+      fbs::bitmap::detail::CreateRoaringContainerDirect(
+        builder, c.key, kind, c.cardinality, &c.values, &c.blocks));
+  }
+  return fbs::bitmap::CreateRoaringBitmapDirect(builder, &container_offsets,
+                                                from.num_bits_);
+}
+
+auto unpack(const fbs::bitmap::RoaringBitmap& from, roaring_bitmap& to)
+  -> caf::error {
+  to.containers_.clear();
+  to.containers_.reserve(from.containers()->size());
+  to.num_bits_ = from.num_bits();
+  for (const auto* from_container : *from.containers()) {
+    auto& c = to.containers_.emplace_back();
+    c.key = from_container->key();
+    c.kind = static_cast<container_kind>(from_container->kind());
+    c.cardinality = from_container->cardinality();
+    if (const auto* values = from_container->values())
+      c.values.assign(values->begin(), values->end());
+    if (const auto* blocks = from_container->blocks())
+      c.blocks.assign(blocks->begin(), blocks->end());
+    if (const auto* reason = validate(c))
+      return caf::make_error(ec::format_error,
+                             fmt::format("invalid tenzir.fbs.bitmap."
+                                         "RoaringBitmap container {}: {}",
+                                         c.key, reason));
+    if (to.containers_.size() > 1 && to.containers_.end()[-2].key >= c.key)
+      return caf::make_error(ec::format_error,
+                             "unsorted tenzir.fbs.bitmap.RoaringBitmap "
+                             "containers");
+  }
+  return caf::none;
+}
+
+roaring_bitmap::container& roaring_bitmap::container_for(size_type key) {
+  if (containers_.empty() || containers_.back().key != key) {
+    TENZIR_ASSERT(containers_.empty() || containers_.back().key < key);
+    // The previous container is complete, so we can pick its representation.
+    if (!containers_.empty())
+      tenzir::optimize(containers_.back());
+    containers_.emplace_back().key = key;
+  }
+  return containers_.back();
+}
+
+auto select_one(const roaring_bitmap& bm, roaring_bitmap::size_type i)
+  -> roaring_bitmap::size_type {
+  TENZIR_ASSERT(i > 0);
+  const auto& containers = bm.containers();
+  if (i == word_type::npos) {
+    if (containers.empty())
+      return word_type::npos;
+    auto last = size_t{0};
+    for_each_run(containers.back(), [&](size_t, size_t run_last) {
+      last = run_last - 1;
+    });
+    return containers.back().key * container_width + last;
+  }
+  for (const auto& c : containers) {
+    if (i > c.cardinality) {
+      i -= c.cardinality;
+      continue;
+    }
+    const auto base = c.key * container_width;
+    switch (c.kind) {
+      case container_kind::array:
+        return base + c.values[i - 1];
+      case container_kind::bitset:
+        for (auto w = size_t{0}; w < bitset_size; ++w) {
+          auto block = c.blocks[w];
+          const auto count = static_cast<size_type>(std::popcount(block));
+          if (i > count) {
+            i -= count;
+            continue;
+          }
+          while (--i > 0)
+            block &= block - 1;
+          return base + w * word_type::width + std::countr_zero(block);
+        }
+        break;
+      case container_kind::run:
+        for (auto r = size_t{0}; r < c.values.size(); r += 2) {
+          const auto length = size_type{c.values[r + 1]} + 1;
+          if (i > length) {
+            i -= length;
+            continue;
+          }
+          return base + c.values[r] + i - 1;
+        }
+        break;
+    }
+    TENZIR_ASSERT(false, "container cardinality out of sync");
+  }
+  return word_type::npos;
+}
+
+roaring_bitmap_range::roaring_bitmap_range(const roaring_bitmap& bm)
+  : bm_{&bm} {
+  if (!done())
+    scan();
+}
+
+void roaring_bitmap_range::next() {
+  position_ += bits_.size();
+  if (!done())
+    scan();
+}
+
+bool roaring_bitmap_range::done() const {
+  return bm_ == nullptr || position_ >= bm_->num_bits_;
+}
+
+void roaring_bitmap_range::scan() {
+  const auto size = bm_->num_bits_;
+  const auto& containers = bm_->containers_;
+  auto zeros = [&](size_type last) {
+    bits_ = {word_type::none, std::min(last, size) - position_};
+  };
+  auto ones = [&](size_type last) {
+    bits_ = {word_type::all, std::min(last, size) - position_};
+  };
+  // Skip all containers that end before the current position.
+  while (container_ < containers.size()
+         && (containers[container_].key + 1) * container_width <= position_)
+    ++container_;
+  if (container_ == containers.size())
+    return zeros(size);
+  const auto& c = containers[container_];
+  const auto base = c.key * container_width;
+  if (position_ < base)
+    return zeros(base);
+  const auto end = base + container_width;
+  const auto offset = position_ - base;
+  switch (c.kind) {
+    case container_kind::array: {
+      auto it = std::lower_bound(c.values.begin(), c.values.end(), offset);
+      if (it == c.values.end())
+        return zeros(end);
+      const auto word_first = size_type{*it} & ~(word_type::width - 1);
+      if (offset < word_first)
+        return zeros(base + word_first);
+      // Assemble a literal block from all values in the current word.
+      const auto word_last = word_first + word_type::width;
+      auto block = word_type::none;
+      for (; it != c.values.end() && *it < word_last; ++it)
+        block |= word_type::mask(*it - offset);
+      bits_ = {block, std::min(base + word_last, size) - position_};
+      return;
+    }
+    case container_kind::bitset: {
+      auto w = offset / word_type::width;
+      const auto shift = offset % word_type::width;
+      const auto block = c.blocks[w] >> shift;
+      if (shift != 0 || !word_type::all_or_none(block)) {
+        const auto last = base + (w + 1) * word_type::width;
+        bits_ = {block, std::min(last, size) - position_};
+        return;
+      }
+      // Coalesce homogeneous blocks into a single run.
+      while (++w < bitset_size && c.blocks[w] == block)
+        ;
+      const auto last = base + w * word_type::width;
+      return block == word_type::all ? ones(last) : zeros(last);
+    }
+    case container_kind::run: {
+      // Find the first run that ends after the current position.
+      auto run_last = [&](size_t r) {
+        return size_type{c.values[2 * r]} + c.values[2 * r + 1] + 1;
+      };
+      auto lo = size_t{0};
+      auto hi = c.values.size() / 2;
+      while (lo < hi) {
+        const auto mid = (lo + hi) / 2;
+        if (run_last(mid) <= offset)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      if (lo == c.values.size() / 2)
+        return zeros(end);
+      const auto first = size_type{c.values[2 * lo]};
+      if (offset < first)
+        return zeros(base + first);
+      return ones(base + run_last(lo));
+    }
+  }
+  __builtin_unreachable();
+}
+
+roaring_bitmap_range bit_range(const roaring_bitmap& bm) {
+  return roaring_bitmap_range{bm};
+}
+
+} // namespace tenzir
@@ -0,0 +1,107 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/count_min_sketch.hpp"
+
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/error.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+namespace tenzir::sketch {
+
+namespace {
+
+/// The finalizer of MurmurHash3, which derives a second, independent hash
+/// from a digest.
+auto remix(uint64_t x) -> uint64_t {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccd;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53;
+  x ^= x >> 33;
+  return x;
+}
+
+} // namespace
+
+auto count_min_sketch::make(size_t width, size_t depth)
+  -> caf::expected<count_min_sketch> {
+  if (width == 0 || depth == 0)
+    return caf::make_error(ec::invalid_argument,
+                           fmt::format("count-min sketch dimensions must be "
+                                       "positive, got {}x{}",
+                                       width, depth));
+  return count_min_sketch{std::bit_ceil(width), depth};
+}
+
+count_min_sketch::count_min_sketch()
+  : count_min_sketch{default_width, default_depth} {
+  // nop
+}
+
+count_min_sketch::count_min_sketch(size_t width, size_t depth)
+  : width_{width}, depth_{depth}, counters_(width * depth, 0) {
+  TENZIR_ASSERT(std::has_single_bit(width_));
+}
+
+void count_min_sketch::add(uint64_t digest, uint64_t count) {
+  for (size_t row = 0; row < depth_; ++row) {
+    auto& counter = counters_[row * width_ + index(digest, row)];
+    // Saturating keeps the sketch from ever underestimating.
+    counter = counter > std::numeric_limits<uint64_t>::max() - count
+                ? std::numeric_limits<uint64_t>::max()
+                : counter + count;
+  }
+}
+
+auto count_min_sketch::estimate(uint64_t digest) const -> uint64_t {
+  auto result = std::numeric_limits<uint64_t>::max();
+  for (size_t row = 0; row < depth_; ++row)
+    result = std::min(result, counters_[row * width_ + index(digest, row)]);
+  return result;
+}
+
+auto count_min_sketch::merge(const count_min_sketch& other) -> caf::error {
+  if (width_ != other.width_ || depth_ != other.depth_)
+    return caf::make_error(ec::invalid_argument,
+                           fmt::format("cannot merge count-min sketches of "
+                                       "dimensions {}x{} and {}x{}",
+                                       width_, depth_, other.width_,
+                                       other.depth_));
+  for (size_t i = 0; i < counters_.size(); ++i)
+    counters_[i] = counters_[i] > std::numeric_limits<uint64_t>::max()
+                                    - other.counters_[i]
+                     ? std::numeric_limits<uint64_t>::max()
+                     : counters_[i] + other.counters_[i];
+  return {};
+}
+
+auto count_min_sketch::width() const noexcept -> size_t {
+  return width_;
+}
+
+auto count_min_sketch::depth() const noexcept -> size_t {
+  return depth_;
+}
+
+auto count_min_sketch::index(uint64_t digest, size_t row) const -> size_t {
+  // Double hashing with an odd step visits distinct counters for all rows.
+  const auto step = remix(digest) | 1;
+  return (digest + row * step) & (width_ - 1);
+}
+
+auto mem_usage(const count_min_sketch& x) -> size_t {
+  return sizeof(x) + x.counters_.capacity() * sizeof(uint64_t);
+}
+
+} // namespace tenzir::sketch
@@ -0,0 +1,141 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/heavy_hitters.hpp"
+
+#include "tenzir/error.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+namespace tenzir::sketch {
+
+auto heavy_hitters::make(size_t capacity, size_t width, size_t depth)
+  -> caf::expected<heavy_hitters> {
+  if (capacity == 0)
+    return caf::make_error(ec::invalid_argument,
+                           "heavy hitters capacity must be positive");
+  auto counts = count_min_sketch::make(width, depth);
+  if (!counts)
+    return std::move(counts.error());
+  return heavy_hitters{std::move(*counts), capacity};
+}
+
+heavy_hitters::heavy_hitters() = default;
+
+heavy_hitters::heavy_hitters(count_min_sketch counts, size_t capacity)
+  : counts_{std::move(counts)}, capacity_{capacity} {
+  // nop
+}
+
+void heavy_hitters::add(uint64_t digest, data_view value, uint64_t count) {
+  counts_.add(digest, count);
+  const auto estimate = counts_.estimate(digest);
+  if (const auto it = positions_.find(digest); it != positions_.end()) {
+    const auto position = it->second;
+    heap_[position].count = estimate;
+    sift_down(position);
+    return;
+  }
+  if (heap_.size() < capacity_) {
+    positions_.emplace(digest, heap_.size());
+    heap_.push_back({digest, materialize(value), estimate});
+    sift_up(heap_.size() - 1);
+    return;
+  }
+  // The value replaces the least frequent tracked value only if it is more
+  // frequent, which keeps rare values from evicting each other.
+  if (estimate <= heap_.front().count)
+    return;
+  positions_.erase(heap_.front().digest);
+  heap_.front() = {digest, materialize(value), estimate};
+  positions_.emplace(digest, 0);
+  sift_down(0);
+}
+
+auto heavy_hitters::merge(const heavy_hitters& other) -> caf::error {
+  if (auto err = counts_.merge(other.counts_))
+    return err;
+  // We re-rank the union of both sets of tracked values with the merged
+  // frequencies, and keep the most frequent ones.
+  auto candidates = std::move(heap_);
+  for (const auto& x : other.heap_)
+    if (!positions_.contains(x.digest))
+      candidates.push_back(x);
+  for (auto& x : candidates)
+    x.count = counts_.estimate(x.digest);
+  std::sort(candidates.begin(), candidates.end(),
+            [](const entry& lhs, const entry& rhs) {
+              return lhs.count > rhs.count;
+            });
+  if (candidates.size() > capacity_)
+    candidates.resize(capacity_);
+  // Ascending order satisfies the heap property.
+  std::reverse(candidates.begin(), candidates.end());
+  heap_ = std::move(candidates);
+  positions_.clear();
+  for (size_t i = 0; i < heap_.size(); ++i)
+    positions_.emplace(heap_[i].digest, i);
+  return {};
+}
+
+auto heavy_hitters::top() const -> std::vector<entry> {
+  auto result = heap_;
+  // The counts in the heap are as of the last time a value was added, so we
+  // refresh them with the latest estimates.
+  for (auto& x : result)
+    x.count = counts_.estimate(x.digest);
+  std::sort(result.begin(), result.end(),
+            [](const entry& lhs, const entry& rhs) {
+              return lhs.count > rhs.count;
+            });
+  return result;
+}
+
+auto heavy_hitters::capacity() const noexcept -> size_t {
+  return capacity_;
+}
+
+void heavy_hitters::sift_up(size_t position) {
+  while (position > 0) {
+    const auto parent = (position - 1) / 2;
+    if (heap_[parent].count <= heap_[position].count)
+      return;
+    swap_entries(parent, position);
+    position = parent;
+  }
+}
+
+void heavy_hitters::sift_down(size_t position) {
+  while (true) {
+    auto smallest = position;
+    for (auto child : {2 * position + 1, 2 * position + 2})
+      if (child < heap_.size() && heap_[child].count < heap_[smallest].count)
+        smallest = child;
+    if (smallest == position)
+      return;
+    swap_entries(position, smallest);
+    position = smallest;
+  }
+}
+
+void heavy_hitters::swap_entries(size_t lhs, size_t rhs) {
+  std::swap(heap_[lhs], heap_[rhs]);
+  positions_[heap_[lhs].digest] = lhs;
+  positions_[heap_[rhs].digest] = rhs;
+}
+
+auto mem_usage(const heavy_hitters& x) -> size_t {
+  // We don't account for the heap memory of the tracked values themselves.
+  return sizeof(x) + mem_usage(x.counts_) - sizeof(x.counts_)
+         + x.heap_.capacity() * sizeof(heavy_hitters::entry)
+         + x.positions_.size() * (sizeof(uint64_t) + sizeof(size_t));
+}
+
+} // namespace tenzir::sketch
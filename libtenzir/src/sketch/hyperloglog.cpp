@@ -0,0 +1,151 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/hyperloglog.hpp"
+
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/error.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+namespace tenzir::sketch {
+
+namespace {
+
+/// The sigma function of the improved estimator, which corrects for registers
+/// that are still zero.
+auto sigma(double x) -> double {
+  if (x == 1.0)
+    return std::numeric_limits<double>::infinity();
+  auto y = 1.0;
+  auto z = x;
+  while (true) {
+    x *= x;
+    const auto previous = z;
+    z += x * y;
+    y += y;
+    if (z == previous)
+      return z;
+  }
+}
+
+/// The tau function of the improved estimator, which corrects for registers
+/// that reached the maximum value.
+auto tau(double x) -> double {
+  if (x == 0.0 || x == 1.0)
+    return 0.0;
+  auto y = 1.0;
+  auto z = 1.0 - x;
+  while (true) {
+    x = std::sqrt(x);
+    const auto previous = z;
+    y *= 0.5;
+    z -= (1.0 - x) * (1.0 - x) * y;
+    if (z == previous)
+      return z / 3.0;
+  }
+}
+
+} // namespace
+
+auto hyperloglog::make(uint8_t precision) -> caf::expected<hyperloglog> {
+  if (precision < 4 || precision > 18)
+    return caf::make_error(ec::invalid_argument,
+                           fmt::format("HyperLogLog precision must be in [4, "
+                                       "18], got {}",
+                                       precision));
+  return hyperloglog{precision};
+}
+
+hyperloglog::hyperloglog() noexcept = default;
+
+hyperloglog::hyperloglog(uint8_t precision) noexcept : precision_{precision} {
+  // nop
+}
+
+void hyperloglog::add(uint64_t digest) {
+  if (!registers_.empty()) {
+    add_dense(digest);
+    return;
+  }
+  const auto it = std::lower_bound(sparse_.begin(), sparse_.end(), digest);
+  if (it != sparse_.end() && *it == digest)
+    return;
+  sparse_.insert(it, digest);
+  if (sparse_.size() * sizeof(uint64_t) > (size_t{1} << precision_))
+    densify();
+}
+
+auto hyperloglog::merge(const hyperloglog& other) -> caf::error {
+  if (precision_ != other.precision_)
+    return caf::make_error(ec::invalid_argument,
+                           fmt::format("cannot merge HyperLogLog sketches with "
+                                       "precisions {} and {}",
+                                       precision_, other.precision_));
+  if (other.registers_.empty()) {
+    for (auto digest : other.sparse_)
+      add(digest);
+    return {};
+  }
+  if (registers_.empty())
+    densify();
+  for (size_t i = 0; i < registers_.size(); ++i)
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  return {};
+}
+
+auto hyperloglog::estimate() const -> double {
+  if (registers_.empty())
+    return static_cast<double>(sparse_.size());
+  // The number of registers with value k, for all possible values.
+  const auto q = 64 - precision_;
+  auto histogram = std::vector<uint64_t>(q + 2, 0);
+  for (auto value : registers_)
+    ++histogram[value];
+  const auto m = static_cast<double>(registers_.size());
+  auto z = m * tau(1.0 - static_cast<double>(histogram[q + 1]) / m);
+  for (auto k = q; k >= 1; --k)
+    z = 0.5 * (z + static_cast<double>(histogram[k]));
+  z += m * sigma(static_cast<double>(histogram[0]) / m);
+  constexpr auto alpha = 0.5 / std::numbers::ln2;
+  return alpha * m * m / z;
+}
+
+auto hyperloglog::precision() const noexcept -> uint8_t {
+  return precision_;
+}
+
+void hyperloglog::densify() {
+  TENZIR_ASSERT(registers_.empty());
+  registers_.resize(size_t{1} << precision_, 0);
+  for (auto digest : sparse_)
+    add_dense(digest);
+  sparse_.clear();
+  sparse_.shrink_to_fit();
+}
+
+void hyperloglog::add_dense(uint64_t digest) {
+  const auto index = digest >> (64 - precision_);
+  // We append a one bit so that the rank is at most 64 - precision + 1.
+  const auto rest = (digest << precision_) | (uint64_t{1} << (precision_ - 1));
+  const auto rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+  registers_[index] = std::max(registers_[index], rank);
+}
+
+auto mem_usage(const hyperloglog& x) -> size_t {
+  return sizeof(x) + x.sparse_.capacity() * sizeof(uint64_t)
+         + x.registers_.capacity();
+}
+
+} // namespace tenzir::sketch
@@ -0,0 +1,155 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/t_digest.hpp"
+
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/error.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace tenzir::sketch {
+
+auto t_digest::make(double compression) -> caf::expected<t_digest> {
+  if (!(compression >= 10.0))
+    return caf::make_error(ec::invalid_argument,
+                           fmt::format("t-digest compression must be at least "
+                                       "10, got {}",
+                                       compression));
+  return t_digest{compression};
+}
+
+t_digest::t_digest() noexcept = default;
+
+t_digest::t_digest(double compression) noexcept : compression_{compression} {
+  // nop
+}
+
+void t_digest::add(double x, double weight) {
+  TENZIR_ASSERT(!std::isnan(x));
+  if (weight <= 0.0)
+    return;
+  if (total_ == 0.0) {
+    min_ = x;
+    max_ = x;
+  } else {
+    min_ = std::min(min_, x);
+    max_ = std::max(max_, x);
+  }
+  total_ += weight;
+  buffer_.push_back({x, weight});
+  // Merging is linear in the number of centroids, so we amortize it over a
+  // buffer that is a small multiple of the compression.
+  if (static_cast<double>(buffer_.size()) >= 2.0 * compression_)
+    compress();
+}
+
+void t_digest::merge(const t_digest& other) {
+  other.compress();
+  for (const auto& x : other.centroids_) {
+    buffer_.push_back(x);
+    if (static_cast<double>(buffer_.size()) >= 2.0 * compression_)
+      compress();
+  }
+  if (other.total_ > 0.0) {
+    min_ = total_ == 0.0 ? other.min_ : std::min(min_, other.min_);
+    max_ = total_ == 0.0 ? other.max_ : std::max(max_, other.max_);
+    total_ += other.total_;
+  }
+}
+
+auto t_digest::quantile(double q) const -> std::optional<double> {
+  compress();
+  if (centroids_.empty())
+    return std::nullopt;
+  if (q <= 0.0)
+    return min_;
+  if (q >= 1.0)
+    return max_;
+  if (centroids_.size() == 1)
+    return centroids_.front().mean;
+  // We treat every centroid as if its values were centered around its mean,
+  // and interpolate linearly between neighboring centers. Beyond the outermost
+  // centers, we interpolate towards the smallest and largest values.
+  const auto target = q * total_;
+  const auto& first = centroids_.front();
+  if (target < first.weight / 2.0)
+    return min_ + (first.mean - min_) * target / (first.weight / 2.0);
+  auto position = first.weight / 2.0;
+  for (size_t i = 0; i + 1 < centroids_.size(); ++i) {
+    const auto& lhs = centroids_[i];
+    const auto& rhs = centroids_[i + 1];
+    const auto gap = (lhs.weight + rhs.weight) / 2.0;
+    if (target < position + gap)
+      return lhs.mean + (rhs.mean - lhs.mean) * (target - position) / gap;
+    position += gap;
+  }
+  const auto& last = centroids_.back();
+  const auto remainder = total_ - position;
+  if (remainder <= 0.0)
+    return last.mean;
+  return last.mean
+         + (max_ - last.mean) * std::min(1.0, (target - position) / remainder);
+}
+
+auto t_digest::count() const noexcept -> double {
+  return total_;
+}
+
+void t_digest::compress() const {
+  if (buffer_.empty())
+    return;
+  buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+  std::sort(buffer_.begin(), buffer_.end(), [](const auto& x, const auto& y) {
+    return x.mean < y.mean;
+  });
+  // The arcsine scale function maps quantiles to an index space in which every
+  // centroid may span at most one unit.
+  const auto normalizer = compression_ / (2.0 * std::numbers::pi);
+  auto k = [&](double q) {
+    return normalizer * std::asin(std::clamp(2.0 * q - 1.0, -1.0, 1.0));
+  };
+  auto q_of_k = [&](double k) {
+    return (std::sin(std::min(k / normalizer, std::numbers::pi / 2.0)) + 1.0)
+           / 2.0;
+  };
+  auto total = 0.0;
+  for (const auto& x : buffer_)
+    total += x.weight;
+  centroids_.clear();
+  auto current = buffer_.front();
+  auto q0 = 0.0;
+  auto q_limit = q_of_k(k(q0) + 1.0);
+  for (size_t i = 1; i < buffer_.size(); ++i) {
+    const auto& next = buffer_[i];
+    const auto q = q0 + (current.weight + next.weight) / total;
+    if (q <= q_limit) {
+      current.weight += next.weight;
+      current.mean += (next.mean - current.mean) * next.weight / current.weight;
+      continue;
+    }
+    centroids_.push_back(current);
+    q0 += current.weight / total;
+    q_limit = q_of_k(k(q0) + 1.0);
+    current = next;
+  }
+  centroids_.push_back(current);
+  buffer_.clear();
+}
+
+auto mem_usage(const t_digest& x) -> size_t {
+  return sizeof(x)
+         + (x.centroids_.capacity() + x.buffer_.capacity())
+             * sizeof(t_digest::centroid);
+}
+
+} // namespace tenzir::sketch
@@ -9,8 +9,10 @@
 #include "tenzir/store.hpp"
 
 #include "tenzir/atoms.hpp"
+#include "tenzir/bitmap_algorithms.hpp"
 #include "tenzir/detail/narrow.hpp"
 #include "tenzir/error.hpp"
+#include "tenzir/id_range.hpp"
 #include "tenzir/ids.hpp"
 #include "tenzir/query_context.hpp"
 #include "tenzir/report.hpp"
@@ -19,6 +21,9 @@
 #include <caf/attach_stream_sink.hpp>
 #include <caf/typed_event_based_actor.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace tenzir {
 
 namespace {
@@ -79,6 +84,14 @@ handle_query(const auto& self, const query_context& query_context) {
       state->second.result_generator
         = self->state.store->count(*tailored_expr, query_context.ids);
       state->second.result_iterator = state->second.result_generator.begin();
+      if (auto err = self->state.store->take_error()) {
+        self->state.running_counts.erase(state);
+        rp.deliver(caf::make_error(
+          ec::unspecified,
+          fmt::format("{} failed to start count query '{}': {}", *self,
+                      query_context.expr, std::move(err))));
+        return;
+      }
       state->second.sink = count.sink;
       state->second.start = start;
       self // schedule query processing beginning at the first table slice
@@ -142,6 +155,14 @@ handle_query(const auto& self, const query_context& query_context) {
       state->second.result_generator
         = self->state.store->extract(*tailored_expr, query_context.ids);
       state->second.result_iterator = state->second.result_generator.begin();
+      if (auto err = self->state.store->take_error()) {
+        self->state.running_extractions.erase(state);
+        rp.deliver(caf::make_error(
+          ec::unspecified,
+          fmt::format("{} failed to start extract query '{}': {}", *self,
+                      query_context.expr, std::move(err))));
+        return;
+      }
       state->second.sink = extract.sink;
       state->second.start = start;
       self
@@ -213,6 +234,36 @@ auto remove_down_source(auto* self, const caf::down_msg& down_msg) {
   }
 }
 
+/// Collects the runs of 1-bits of a selection for use with `selects`.
+auto selected_runs(const ids& selection) -> std::vector<id_range> {
+  auto result = std::vector<id_range>{};
+  if (selection.empty())
+    return result;
+  for (auto run : select_runs(selection))
+    result.push_back(run);
+  return result;
+}
+
+/// Checks whether a selection contains any id of a table slice. This allows
+/// for skipping table slices entirely when the partition already ruled them
+/// out, e.g., through its zone maps.
+/// @param selection The selection, where an empty selection selects all ids.
+/// @param runs The runs of the selection as returned by `selected_runs`.
+/// @param slice The table slice to check.
+auto selects(const ids& selection, const std::vector<id_range>& runs,
+             const table_slice& slice) -> bool {
+  if (selection.empty())
+    return true;
+  const auto first = slice.offset() == invalid_id ? id{0} : slice.offset();
+  const auto last = first + slice.rows();
+  // Find the first run that ends after the beginning of the slice.
+  const auto it = std::upper_bound(runs.begin(), runs.end(), first,
+                                   [](id x, const id_range& run) {
+                                     return x < run.last;
+                                   });
+  return it != runs.end() && it->first < last;
+}
+
 } // namespace
 
 type base_store::schema() const {
@@ -223,19 +274,29 @@ type base_store::schema() const {
 }
 
 generator<uint64_t> base_store::count(expression expr, ids selection) const {
+  const auto runs = selected_runs(selection);
   for (const auto& slice : slices()) {
+    if (!selects(selection, runs, slice))
+      continue;
     co_yield count_matching(slice, expr, selection);
   }
 }
 
 generator<table_slice>
 base_store::extract(expression expr, ids selection) const {
+  const auto runs = selected_runs(selection);
   for (const auto& slice : slices()) {
+    if (!selects(selection, runs, slice))
+      continue;
     if (auto filtered_slice = filter(slice, expr, selection))
       co_yield std::move(*filtered_slice);
   }
 }
 
+caf::error base_store::take_error() {
+  return {};
+}
+
 default_passive_store_actor::behavior_type default_passive_store(
   default_passive_store_actor::stateful_pointer<default_passive_store_state>
     self,
@@ -318,7 +379,7 @@ default_passive_store_actor::behavior_type default_passive_store(
       state.num_hits += slice.rows();
       self->send(state.sink, std::move(slice));
       if (++state.result_iterator == state.result_generator.end()) {
-        return {};
+        return self->state.store->take_error();
       }
       return self->delegate(static_cast<default_passive_store_actor>(self),
                             atom::internal_v, atom::extract_v, query_id);
@@ -338,7 +399,7 @@ default_passive_store_actor::behavior_type default_passive_store(
       }
       state.num_hits += *state.result_iterator;
       if (++state.result_iterator == state.result_generator.end()) {
-        return {};
+        return self->state.store->take_error();
       }
       return self->delegate(static_cast<default_passive_store_actor>(self),
                             atom::internal_v, atom::count_v, query_id);
@@ -464,7 +525,7 @@ default_active_store_actor::behavior_type default_active_store(
       state.num_hits += slice.rows();
       self->send(state.sink, std::move(slice));
       if (++state.result_iterator == state.result_generator.end()) {
-        return {};
+        return self->state.store->take_error();
       }
       return self->delegate(static_cast<default_active_store_actor>(self),
                             atom::internal_v, atom::extract_v, query_id);
@@ -484,7 +545,7 @@ default_active_store_actor::behavior_type default_active_store(
       }
       state.num_hits += *state.result_iterator;
       if (++state.result_iterator == state.result_generator.end()) {
-        return {};
+        return self->state.store->take_error();
       }
       return self->delegate(static_cast<default_active_store_actor>(self),
                             atom::internal_v, atom::count_v, query_id);
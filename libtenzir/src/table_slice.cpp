@@ -102,84 +102,6 @@ state([[maybe_unused]] Slice&& encoded, State&& state) noexcept {
   return std::forward<State>(state).arrow_v2;
 }
 
-// A helper struct for unflatten function.
-struct unflatten_field {
-  unflatten_field(std::string_view field_name,
-                  std::shared_ptr<arrow::Array> array = nullptr)
-    : field_name_{field_name}, array_{std::move(array)} {
-  }
-
-  unflatten_field() = default;
-
-  // Add a child nested field with
-  auto add(std::string_view nested_field, std::string_view separator,
-           std::shared_ptr<arrow::Array> array) -> void {
-    auto separator_pos = nested_field.find_first_of(separator);
-    if (separator_pos == std::string::npos) {
-      nested_fields_[nested_field]
-        = unflatten_field{nested_field, std::move(array)};
-      return;
-    }
-    auto new_field_name = nested_field.substr(0, separator_pos);
-    auto& nested = nested_fields_[new_field_name];
-    nested.field_name_ = new_field_name;
-    nested.add(nested_field.substr(separator_pos + 1), separator,
-               std::move(array));
-  }
-
-  auto to_arrow() const -> std::shared_ptr<arrow::Array> {
-    if (array_)
-      return array_;
-    std::vector<std::shared_ptr<arrow::Array>> children;
-    children.reserve(nested_fields_.size());
-    std::vector<std::string> children_field_names;
-    children_field_names.reserve(nested_fields_.size());
-    for (auto& [_, f] : nested_fields_) {
-      children.push_back(f.to_arrow());
-      children_field_names.push_back(std::string{f.field_name_});
-    }
-    return arrow::StructArray::Make(children, children_field_names).ValueOrDie();
-  }
-
-  std::string_view field_name_;
-  detail::stable_map<std::string_view, unflatten_field> nested_fields_;
-  std::shared_ptr<arrow::Array> array_;
-};
-
-auto count_substring_occurrences(std::string_view input,
-                                 std::string_view substring) {
-  auto separator_count = std::size_t{0};
-  for (auto pos = input.find_first_of(substring); pos != std::string_view::npos;
-       pos = input.find_first_of(substring, pos + 1)) {
-    ++separator_count;
-  }
-  return separator_count;
-}
-
-auto make_unflattened_struct_array(
-  const arrow::FieldVector& fields,
-  const std::unordered_map<std::string_view, unflatten_field*>&
-    original_field_name_to_new_field_map) {
-  std::vector<std::shared_ptr<arrow::Array>> new_columns;
-  std::vector<std::string> new_field_names;
-  // Fields that were unflattened may have the same parent field. E.g foo.bar
-  // and foo.baz will have the same parent field (foo). foo.bar and foo.baz map
-  // to the same unflatten_field that already handles nested children fields.
-  // This means we can only use to_arrow method only once as it will produce a
-  // foo struct array with bar and baz as children
-  std::unordered_set<unflatten_field*> handled_fields;
-  for (const auto& field : fields) {
-    TENZIR_ASSERT(original_field_name_to_new_field_map.contains(field->name()));
-    auto* f = original_field_name_to_new_field_map.at(field->name());
-    if (not handled_fields.contains(f)) {
-      new_columns.push_back(f->to_arrow());
-      new_field_names.push_back(std::string{f->field_name_});
-      handled_fields.insert(f);
-    }
-  }
-  return arrow::StructArray::Make(new_columns, new_field_names).ValueOrDie();
-}
-
 auto append_columns(const record_type& schema,
                     const type_to_arrow_array_t<record_type>& array,
                     type_to_arrow_builder_t<record_type>& builder) -> void {
@@ -1099,31 +1021,50 @@ auto make_rename_transformation(std::string new_name)
 
 } // namespace
 
-auto flatten(table_slice slice, std::string_view separator) -> flatten_result {
+struct flattener::plan {
+  /// Flattens the nested records and lists of all columns.
+  std::vector<indexed_transformation> flatten = {};
+
+  /// Renames columns whose flattened names conflict with earlier columns.
+  std::vector<indexed_transformation> rename = {};
+
+  /// A description of the renamed columns.
+  std::vector<std::string> renamed_fields = {};
+};
+
+flattener::flattener(std::string separator) : separator_{std::move(separator)} {
+}
+
+auto flattener::operator()(table_slice slice) -> flatten_result {
   if (slice.rows() == 0)
     return {std::move(slice), {}};
+  if (auto it = plans_.find(slice.schema()); it != plans_.end()) {
+    const auto& plan = *it->second;
+    slice = transform_columns(slice, plan.flatten);
+    slice = transform_columns(slice, plan.rename);
+    return {std::move(slice), plan.renamed_fields};
+  }
+  auto schema = slice.schema();
+  auto plan = std::make_shared<struct plan>();
   // We cannot use arrow::StructArray::Flatten here because that does not
   // work recursively, see apache/arrow#20683. Hence, we roll our own version
   // here.
-  auto renamed_fields = std::vector<std::string>{};
-  auto transformations = std::vector<indexed_transformation>{};
   auto num_fields = caf::get<record_type>(slice.schema()).num_fields();
-  transformations.reserve(num_fields);
+  plan->flatten.reserve(num_fields);
   for (size_t i = 0; i < num_fields; ++i) {
-    transformations.push_back(
-      {offset{i}, make_flatten_transformation(separator, "", {})});
+    plan->flatten.push_back(
+      {offset{i}, make_flatten_transformation(separator_, "", {})});
   }
-  slice = transform_columns(slice, transformations);
+  slice = transform_columns(slice, plan->flatten);
   // Flattening cannot fail.
   TENZIR_ASSERT(slice.rows() > 0);
   // The slice may contain duplicate field name here, so we perform an
   // additional transformation to rename them in case we detect any.
-  transformations.clear();
   const auto& layout = caf::get<record_type>(slice.schema());
   TENZIR_ASSERT(layout.num_fields() == layout.num_leaves());
   for (const auto& leaf : layout.leaves()) {
     size_t num_occurences = 0;
-    if (std::any_of(transformations.begin(), transformations.end(),
+    if (std::any_of(plan->rename.begin(), plan->rename.end(),
                     [&](const auto& t) {
                       return t.index == leaf.index;
                     }))
@@ -1148,98 +1089,142 @@ auto flatten(table_slice slice, std::string_view separator) -> flatten_result {
             // incrementing until we find a non-conflicting name.
             continue;
           }
-          renamed_fields.push_back(
+          plan->renamed_fields.push_back(
             fmt::format("{} -> {}", leaf.field.name, new_name));
-          transformations.push_back(
+          plan->rename.push_back(
             {index, make_rename_transformation(std::move(new_name))});
         }
         break;
       }
     }
   }
-  TENZIR_ASSERT(std::is_sorted(transformations.begin(), transformations.end()));
-  slice = transform_columns(slice, transformations);
+  TENZIR_ASSERT(std::is_sorted(plan->rename.begin(), plan->rename.end()));
+  slice = transform_columns(slice, plan->rename);
   // Renaming cannot fail.
   TENZIR_ASSERT(slice.rows() > 0);
+  auto renamed_fields = plan->renamed_fields;
+  plans_.emplace(std::move(schema), std::move(plan));
   return {
     std::move(slice),
     std::move(renamed_fields),
   };
 }
 
-auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
-                            std::string_view nested_field_separator)
-  -> std::shared_ptr<arrow::StructArray>;
-
-auto unflatten_list(unflatten_field& f, std::string_view nested_field_separator)
-  -> void {
-  auto field_array = f.to_arrow();
-  auto field_type = type::from_arrow(*field_array->type());
-  auto arrow_list_type = caf::get<list_type>(field_type);
-  auto list_value_type = arrow_list_type.value_type();
-  auto field_list = std::static_pointer_cast<arrow::ListArray>(field_array);
-  auto builder = std::shared_ptr<arrow::ListBuilder>{};
-  if (caf::holds_alternative<list_type>(list_value_type)) {
-    for (auto i = 0; i < field_list->length(); ++i) {
-      if (field_list->IsValid(i)) {
-        auto new_f = unflatten_field{f.field_name_, field_list->value_slice(i)};
-        unflatten_list(new_f, nested_field_separator);
-        if (not builder) {
-          builder = list_type{type::from_arrow(*new_f.array_->type())}
-                      .make_arrow_builder(arrow::default_memory_pool());
-        }
-        auto status = builder->Append();
-        TENZIR_ASSERT(status.ok());
-        status = builder->value_builder()->AppendArraySlice(
-          *new_f.array_->data(), 0, new_f.array_->length());
-        TENZIR_ASSERT(status.ok());
-      }
-    }
-  } else if (caf::holds_alternative<record_type>(list_value_type)) {
-    for (auto i = 0; i < field_list->length(); ++i) {
-      if (field_list->IsValid(i)) {
-        auto struct_array = std::static_pointer_cast<arrow::StructArray>(
-          field_list->value_slice(i));
-        auto unflattened
-          = unflatten_struct_array(struct_array, nested_field_separator);
-        auto record_builder
-          = caf::get<record_type>(type::from_arrow(*unflattened->type()))
-              .make_arrow_builder(arrow::default_memory_pool());
-        auto unflattened_type = type::from_arrow(*unflattened->type());
-        append_columns(
-          caf::get<record_type>(type::from_arrow(*unflattened->type())),
-          *unflattened, *record_builder);
-        const auto array = record_builder->Finish().ValueOrDie();
-        if (not builder) {
-          builder = list_type{unflattened_type}.make_arrow_builder(
-            arrow::default_memory_pool());
-        }
-        auto status = builder->Append();
-        TENZIR_ASSERT(status.ok());
-        status = builder->value_builder()->AppendArraySlice(*array->data(), 0,
-                                                            array->length());
-        TENZIR_ASSERT(status.ok());
-      }
+auto flatten(table_slice slice, std::string_view separator) -> flatten_result {
+  return flattener{std::string{separator}}(std::move(slice));
+}
+
+struct unflattener::plan {
+  /// A field of the unflattened record.
+  struct field {
+    /// The name of the field.
+    std::string name = {};
+
+    /// The index of the flattened column that the field consists of, or
+    /// nothing if the field is a record that unflattening introduces.
+    std::optional<size_t> index = {};
+
+    /// The plan for unflattening the records within the column, if any.
+    std::shared_ptr<const plan> nested = {};
+
+    /// The fields of a record that unflattening introduces.
+    std::vector<field> children = {};
+  };
+
+  /// The fields of the unflattened record.
+  std::vector<field> fields = {};
+
+  /// The schema of unflattened table slices. Unset for nested plans.
+  type schema = {};
+
+  /// The Arrow schema of unflattened table slices. Unset for nested plans.
+  std::shared_ptr<arrow::Schema> arrow_schema = {};
+};
+
+namespace {
+
+auto count_substring_occurrences(std::string_view input,
+                                 std::string_view substring) {
+  auto separator_count = std::size_t{0};
+  for (auto pos = input.find_first_of(substring); pos != std::string_view::npos;
+       pos = input.find_first_of(substring, pos + 1)) {
+    ++separator_count;
+  }
+  return separator_count;
+}
+
+// A field of the unflattened record while we build an unflatten plan. Its name
+// points into the schema that the plan is built for.
+struct unflatten_field {
+  // Adds a child field, introducing nested records for every separator that
+  // remains in the child's name.
+  auto add(std::string_view nested_field, std::string_view separator,
+           unflatten_field field) -> void {
+    auto separator_pos = nested_field.find_first_of(separator);
+    if (separator_pos == std::string::npos) {
+      field.name = nested_field;
+      nested_fields[nested_field] = std::move(field);
+      return;
     }
+    auto new_field_name = nested_field.substr(0, separator_pos);
+    auto& nested = nested_fields[new_field_name];
+    nested.name = new_field_name;
+    nested.add(nested_field.substr(separator_pos + 1), separator,
+               std::move(field));
   }
-  if (builder) {
-    f.array_ = builder->Finish().ValueOrDie();
+
+  auto finish() const -> unflattener::plan::field {
+    auto result = unflattener::plan::field{
+      .name = std::string{name},
+      .index = index,
+      .nested = nested,
+    };
+    if (not index) {
+      result.children.reserve(nested_fields.size());
+      for (const auto& [_, field] : nested_fields)
+        result.children.push_back(field.finish());
+    }
+    return result;
   }
+
+  std::string_view name = {};
+  std::optional<size_t> index = {};
+  std::shared_ptr<const unflattener::plan> nested = {};
+  detail::stable_map<std::string_view, unflatten_field> nested_fields = {};
+};
+
+auto make_unflatten_plan(const record_type& schema,
+                         std::string_view nested_field_separator)
+  -> unflattener::plan;
+
+// Returns the plan for unflattening the records in a column of the given type,
+// which may be nested in lists, or nothing if the column contains no records.
+auto make_nested_unflatten_plan(const type& type,
+                                std::string_view nested_field_separator)
+  -> std::shared_ptr<const unflattener::plan> {
+  if (const auto* rt = caf::get_if<record_type>(&type))
+    return std::make_shared<const unflattener::plan>(
+      make_unflatten_plan(*rt, nested_field_separator));
+  if (const auto* lt = caf::get_if<list_type>(&type))
+    return make_nested_unflatten_plan(lt->value_type(), nested_field_separator);
+  return nullptr;
 }
 
-auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
-                            std::string_view nested_field_separator)
-  -> std::shared_ptr<arrow::StructArray> {
+auto make_unflatten_plan(const record_type& schema,
+                         std::string_view nested_field_separator)
+  -> unflattener::plan {
   // Used to map parent fields to its children for unflattening purposes.
   // Given foo.bar and foo.baz as fields of input slice the algorithm will
   // first create an instance of unflattened_field for 'foo' key. The created
-  // instance will combine 'bar' and 'baz' fields into a struct array. All the
+  // instance will combine 'bar' and 'baz' fields into a record. All the
   // fields that should be combined under the 'foo' key will use this map to
   // find the appropriate object which should aggregate it.
   std::unordered_map<std::string_view, unflatten_field> unflattened_field_map;
   std::unordered_map<std::string_view, unflatten_field> unflattened_children;
   std::unordered_map<std::string_view, unflatten_field*>
     original_field_name_to_new_field_map;
+  std::unordered_map<std::string_view, size_t> field_indices;
+  std::vector<std::string_view> field_names;
   // Aggregates all flattened field names under the key that represents the
   // count of nested_field_separator occurrences. The algorithm starts
   // iterating over this map so that it can distinguish if a separator
@@ -1253,10 +1238,14 @@ auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
   // such cases the cpu.logger must itself be a field that cannot be
   // unflattened.
   std::map<std::size_t, std::vector<std::string_view>> fields_to_resolve;
-  for (const auto& k : slice_array->struct_type()->fields()) {
-    const auto& field_name = k->name();
-    unflattened_field_map[field_name]
-      = unflatten_field{field_name, slice_array->GetFieldByName(field_name)};
+  for (size_t i = 0; i < schema.num_fields(); ++i) {
+    const auto field_name = schema.field(i).name;
+    field_names.push_back(field_name);
+    field_indices[field_name] = i;
+    unflattened_field_map[field_name] = unflatten_field{
+      .name = field_name,
+      .index = i,
+    };
     if (field_name.starts_with(nested_field_separator)
         or field_name.ends_with(nested_field_separator)) {
       TENZIR_DEBUG("retaining original field {} during unflattening: "
@@ -1266,25 +1255,21 @@ auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
     }
     auto separator_count
       = count_substring_occurrences(field_name, nested_field_separator);
-
     fields_to_resolve[separator_count].push_back(field_name);
   }
   for (auto& [field_name, field] : unflattened_field_map) {
-    // Unflatten children recursively.
-    auto field_array = field.to_arrow();
-    auto field_type = type::from_arrow(*field_array->type());
-    if (caf::holds_alternative<record_type>(field_type)) {
-      auto field_struct
-        = std::static_pointer_cast<arrow::StructArray>(field_array);
-      unflattened_children[field_name]
-        = unflatten_field{field_name, unflatten_struct_array(
-                                        field_struct, nested_field_separator)};
-    } else if (caf::holds_alternative<list_type>(field_type)) {
-      unflatten_list(field, nested_field_separator);
-      unflattened_children[field_name] = field;
+    // Unflatten children recursively. Lists are unflattened even if we retain
+    // the field under its original name.
+    const auto field_type = schema.field(*field.index).type;
+    if (auto nested
+        = make_nested_unflatten_plan(field_type, nested_field_separator)) {
+      if (caf::holds_alternative<list_type>(field_type))
+        field.nested = nested;
+      auto child = field;
+      child.nested = std::move(nested);
+      unflattened_children[field_name] = std::move(child);
     }
-    original_field_name_to_new_field_map[field_name]
-      = std::addressof(unflattened_field_map[field_name]);
+    original_field_name_to_new_field_map[field_name] = std::addressof(field);
   }
   for (const auto& [_, fields] : fields_to_resolve) {
     for (const auto& field : fields) {
@@ -1295,7 +1280,9 @@ auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
         // field so it is an unflattend field itself.
         if (original_field_name_to_new_field_map.contains(prefix)) {
           unflattened_field_map[field] = unflatten_field{
-            field, slice_array->GetFieldByName(std::string{field})};
+            .name = field,
+            .index = field_indices.at(field),
+          };
           original_field_name_to_new_field_map[field]
             = std::addressof(unflattened_field_map[field]);
           TENZIR_DEBUG("retaining original field {} during unflattening: "
@@ -1324,14 +1311,15 @@ auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
         if (not original_field_name_to_new_field_map.contains(
               parent_field_name)) {
           auto& struct_field = unflattened_field_map[parent_field_name];
-          struct_field.field_name_ = parent_field_name;
-          auto child_field_array
-            = slice_array->GetFieldByName(std::string{field});
-          if (unflattened_children.contains(field)) {
-            child_field_array = unflattened_children[field].to_arrow();
-          }
+          struct_field.name = parent_field_name;
+          auto child_field = unflattened_children.contains(field)
+                               ? unflattened_children[field]
+                               : unflatten_field{
+                                 .name = field,
+                                 .index = field_indices.at(field),
+                               };
           struct_field.add(field.substr(current_pos + 1),
-                           nested_field_separator, child_field_array);
+                           nested_field_separator, std::move(child_field));
           original_field_name_to_new_field_map[field]
             = std::addressof(unflattened_field_map[parent_field_name]);
           break;
@@ -1342,30 +1330,127 @@ auto unflatten_struct_array(std::shared_ptr<arrow::StructArray> slice_array,
         auto& struct_field = unflattened_children.contains(field)
                                ? unflattened_children[field]
                                : unflattened_field_map[field];
-        struct_field.field_name_ = field;
+        struct_field.name = field;
         original_field_name_to_new_field_map[field]
           = std::addressof(struct_field);
       }
     }
   }
-  return make_unflattened_struct_array(slice_array->struct_type()->fields(),
-                                       original_field_name_to_new_field_map);
+  // Fields that were unflattened may have the same parent field. E.g foo.bar
+  // and foo.baz will have the same parent field (foo), so we must add the
+  // parent field only once.
+  auto result = unflattener::plan{};
+  auto handled_fields = std::unordered_set<const unflatten_field*>{};
+  for (const auto& field_name : field_names) {
+    TENZIR_ASSERT(original_field_name_to_new_field_map.contains(field_name));
+    const auto* field = original_field_name_to_new_field_map.at(field_name);
+    if (handled_fields.insert(field).second)
+      result.fields.push_back(field->finish());
+  }
+  return result;
 }
 
-auto unflatten(const table_slice& slice,
-               std::string_view nested_field_separator) -> table_slice {
+auto unflatten_array(const unflattener::plan& plan,
+                     const std::shared_ptr<arrow::ArrayData>& array)
+  -> std::shared_ptr<arrow::ArrayData>;
+
+// Assembles the columns of an unflattened record from the columns of the
+// flattened record. This only rewraps the existing arrays, and never touches
+// their buffers.
+auto unflatten_fields(const std::vector<unflattener::plan::field>& fields,
+                      const arrow::ArrayDataVector& columns, int64_t length,
+                      arrow::FieldVector& output_fields,
+                      arrow::ArrayDataVector& output_columns) -> void {
+  for (const auto& field : fields) {
+    if (field.index) {
+      auto column = columns[*field.index];
+      if (field.nested)
+        column = unflatten_array(*field.nested, column);
+      output_fields.push_back(arrow::field(field.name, column->type));
+      output_columns.push_back(std::move(column));
+      continue;
+    }
+    auto record_fields = arrow::FieldVector{};
+    auto record_columns = arrow::ArrayDataVector{};
+    unflatten_fields(field.children, columns, length, record_fields,
+                     record_columns);
+    auto record_type = arrow::struct_(std::move(record_fields));
+    output_fields.push_back(arrow::field(field.name, record_type));
+    output_columns.push_back(arrow::ArrayData::Make(
+      std::move(record_type), length, {nullptr}, std::move(record_columns), 0));
+  }
+}
+
+// Unflattens the records in a column, which may be nested in lists.
+auto unflatten_array(const unflattener::plan& plan,
+                     const std::shared_ptr<arrow::ArrayData>& array)
+  -> std::shared_ptr<arrow::ArrayData> {
+  auto result = array->Copy();
+  if (array->type->id() == arrow::Type::LIST) {
+    const auto& list_type = static_cast<const arrow::ListType&>(*array->type);
+    result->child_data = {unflatten_array(plan, array->child_data[0])};
+    result->type = arrow::list(
+      list_type.value_field()->WithType(result->child_data[0]->type));
+    return result;
+  }
+  TENZIR_ASSERT(array->type->id() == arrow::Type::STRUCT);
+  // The children of a struct array are not sliced, so records that we
+  // introduce must span the struct's offset as well.
+  auto fields = arrow::FieldVector{};
+  auto columns = arrow::ArrayDataVector{};
+  unflatten_fields(plan.fields, array->child_data,
+                   array->offset + array->length, fields, columns);
+  result->type = arrow::struct_(std::move(fields));
+  result->child_data = std::move(columns);
+  return result;
+}
+
+} // namespace
+
+unflattener::unflattener(std::string nested_field_separator)
+  : separator_{std::move(nested_field_separator)} {
+}
+
+auto unflattener::operator()(const table_slice& slice) -> table_slice {
   if (slice.rows() == 0u)
     return slice;
-  auto slice_array = to_record_batch(slice)->ToStructArray().ValueOrDie();
-  auto new_arr = unflatten_struct_array(slice_array, nested_field_separator);
-  auto schema
-    = tenzir::type{slice.schema().name(), type::from_arrow(*new_arr->type())};
+  auto it = plans_.find(slice.schema());
+  if (it == plans_.end()) {
+    auto plan = make_unflatten_plan(caf::get<record_type>(slice.schema()),
+                                    separator_);
+    // We derive the schema of the unflattened table slices by unflattening an
+    // empty record batch once.
+    const auto empty
+      = arrow::RecordBatch::MakeEmpty(slice.schema().to_arrow_schema())
+          .ValueOrDie();
+    auto fields = arrow::FieldVector{};
+    auto columns = arrow::ArrayDataVector{};
+    unflatten_fields(plan.fields, empty->column_data(), 0, fields, columns);
+    plan.schema = type{slice.schema().name(),
+                       type::from_arrow(*arrow::struct_(std::move(fields)))};
+    plan.arrow_schema = plan.schema.to_arrow_schema();
+    it = plans_
+           .emplace(slice.schema(),
+                    std::make_shared<const struct plan>(std::move(plan)))
+           .first;
+  }
+  const auto& plan = *it->second;
+  const auto batch = to_record_batch(slice);
+  auto fields = arrow::FieldVector{};
+  auto columns = arrow::ArrayDataVector{};
+  unflatten_fields(plan.fields, batch->column_data(), batch->num_rows(), fields,
+                   columns);
   const auto new_batch = arrow::RecordBatch::Make(
-    schema.to_arrow_schema(), new_arr->length(), new_arr->fields());
-  auto ret = table_slice{new_batch, std::move(schema)};
+    plan.arrow_schema, batch->num_rows(), std::move(columns));
+  auto ret = table_slice{new_batch, plan.schema};
   ret.import_time(slice.import_time());
   ret.offset(slice.offset());
   return ret;
 }
 
+auto unflatten(const table_slice& slice,
+               std::string_view nested_field_separator) -> table_slice {
+  return unflattener{std::string{nested_field_separator}}(slice);
+}
+
 } // namespace tenzir
@@ -0,0 +1,308 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/table_slice_transport.hpp"
+
+#include "tenzir/defaults.hpp"
+#include "tenzir/detail/narrow.hpp"
+#include "tenzir/die.hpp"
+#include "tenzir/error.hpp"
+#include "tenzir/logger.hpp"
+
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/record_batch.h>
+#include <arrow/util/compression.h>
+#include <caf/settings.hpp>
+#include <fmt/format.h>
+
+#include <iterator>
+
+namespace tenzir {
+
+auto table_slice_transport_options::make(const caf::settings& options)
+  -> caf::expected<table_slice_transport_options> {
+  auto result = table_slice_transport_options{};
+  const auto compression = caf::get_or(
+    options, "tenzir.pipeline-transport.compression",
+    std::string{defaults::pipeline_transport::compression});
+  if (compression == "none") {
+    result.compression = arrow::Compression::UNCOMPRESSED;
+  } else {
+    // The Arrow IPC format only supports LZ4 frames and Zstd for compressing
+    // buffers.
+    auto compression_type
+      = arrow::util::Codec::GetCompressionType(compression);
+    if (not compression_type.ok()
+        or (*compression_type != arrow::Compression::LZ4_FRAME
+            and *compression_type != arrow::Compression::ZSTD)) {
+      return caf::make_error(
+        ec::invalid_configuration,
+        fmt::format("invalid tenzir.pipeline-transport.compression `{}`; must "
+                    "be one of `none`, `lz4`, `zstd`",
+                    compression));
+    }
+    if (not arrow::util::Codec::IsAvailable(*compression_type)) {
+      return caf::make_error(
+        ec::invalid_configuration,
+        fmt::format("invalid tenzir.pipeline-transport.compression `{}`: "
+                    "codec is unavailable in this build",
+                    compression));
+    }
+    result.compression = *compression_type;
+  }
+  result.coalesce_rows
+    = caf::get_or(options, "tenzir.pipeline-transport.coalesce-rows",
+                  defaults::pipeline_transport::coalesce_rows);
+  result.max_streams
+    = caf::get_or(options, "tenzir.pipeline-transport.max-streams",
+                  defaults::pipeline_transport::max_streams);
+  if (result.max_streams == 0) {
+    return caf::make_error(ec::invalid_configuration,
+                           "invalid tenzir.pipeline-transport.max-streams `0`: "
+                           "must be positive");
+  }
+  return result;
+}
+
+// -- encoder ------------------------------------------------------------------
+
+struct table_slice_encoder::stream {
+  uint64_t id = {};
+  std::shared_ptr<arrow::io::BufferOutputStream> sink = {};
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer = {};
+};
+
+auto table_slice_encoder::no_stream::operator()(const type&) const
+  -> std::unique_ptr<stream> {
+  die("unreachable");
+}
+
+table_slice_encoder::table_slice_encoder(table_slice_transport_options options)
+  : options_{options},
+    streams_{detail::narrow_cast<size_t>(options.max_streams), no_stream{}} {
+  // nop
+}
+
+table_slice_encoder::table_slice_encoder(table_slice_encoder&&) noexcept
+  = default;
+
+auto table_slice_encoder::operator=(table_slice_encoder&&) noexcept
+  -> table_slice_encoder& = default;
+
+table_slice_encoder::~table_slice_encoder() noexcept = default;
+
+auto table_slice_encoder::encode(std::vector<table_slice> slices)
+  -> caf::expected<std::vector<table_slice_frame>> {
+  auto result = std::vector<table_slice_frame>{};
+  result.reserve(slices.size());
+  // Small batches are merged before encoding them, which amortizes the
+  // per-message overhead of the IPC format for the common case of operators
+  // yielding many tiny batches.
+  auto pending = std::vector<table_slice>{};
+  auto pending_rows = uint64_t{};
+  auto flush = [&]() -> caf::error {
+    if (pending.empty()) {
+      return {};
+    }
+    auto frame = encode_one(concatenate(std::exchange(pending, {})));
+    pending_rows = 0;
+    if (not frame) {
+      return std::move(frame.error());
+    }
+    result.push_back(std::move(*frame));
+    return {};
+  };
+  for (auto& slice : slices) {
+    if (slice.rows() == 0) {
+      continue;
+    }
+    // Coalesced slices share their metadata, so we only merge slices with the
+    // same import time.
+    if (not pending.empty()
+        and (pending.front().schema() != slice.schema()
+             or pending.front().import_time() != slice.import_time()
+             or pending_rows + slice.rows() > options_.coalesce_rows)) {
+      if (auto err = flush()) {
+        return err;
+      }
+    }
+    pending_rows += slice.rows();
+    pending.push_back(std::move(slice));
+  }
+  if (auto err = flush()) {
+    return err;
+  }
+  return result;
+}
+
+auto table_slice_encoder::reset() -> void {
+  streams_.clear();
+}
+
+auto table_slice_encoder::encode_one(const table_slice& slice)
+  -> caf::expected<table_slice_frame> {
+  auto result = table_slice_frame{};
+  result.import_time = slice.import_time();
+  result.offset = slice.offset();
+  const auto batch = to_record_batch(slice);
+  TENZIR_ASSERT(batch);
+  if (not streams_.contains(slice.schema())) {
+    auto new_stream = std::make_unique<stream>();
+    new_stream->id = next_stream_++;
+    auto sink = arrow::io::BufferOutputStream::Create();
+    if (not sink.ok()) {
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to create IPC output stream: "
+                                         "{}",
+                                         sink.status().ToString()));
+    }
+    new_stream->sink = sink.MoveValueUnsafe();
+    auto write_options = arrow::ipc::IpcWriteOptions::Defaults();
+    write_options.emit_dictionary_deltas = true;
+    if (options_.compression != arrow::Compression::UNCOMPRESSED) {
+      auto codec = arrow::util::Codec::Create(options_.compression);
+      if (not codec.ok()) {
+        return caf::make_error(ec::system_error,
+                               fmt::format("failed to create codec: {}",
+                                           codec.status().ToString()));
+      }
+      write_options.codec = codec.MoveValueUnsafe();
+    }
+    auto writer = arrow::ipc::MakeStreamWriter(new_stream->sink,
+                                               batch->schema(), write_options);
+    if (not writer.ok()) {
+      return caf::make_error(ec::system_error,
+                             fmt::format("failed to create IPC stream writer: "
+                                         "{}",
+                                         writer.status().ToString()));
+    }
+    new_stream->writer = writer.MoveValueUnsafe();
+    if (streams_.size() >= options_.max_streams) {
+      // Close the least recently used stream and tell the decoder to do the
+      // same, which keeps both sides bounded by the same limit.
+      const auto& [evicted_schema, evicted_stream]
+        = *std::prev(streams_.end());
+      result.evicted_stream = evicted_stream->id;
+      streams_.drop(type{evicted_schema});
+    }
+    result.schema = slice.schema();
+    streams_.put(slice.schema(), std::move(new_stream));
+  }
+  // Looking up the stream also marks it as the most recently used one.
+  auto& stream = *streams_.get_or_load(slice.schema());
+  result.stream = stream.id;
+  // Writing the first batch of a stream implicitly writes the schema message
+  // as well. Afterwards, only record batches and dictionary deltas follow.
+  if (auto status = stream.writer->WriteRecordBatch(*batch); not status.ok()) {
+    streams_.drop(slice.schema());
+    return caf::make_error(ec::system_error,
+                           fmt::format("failed to write record batch: {}",
+                                       status.ToString()));
+  }
+  auto buffer = stream.sink->Finish();
+  if (not buffer.ok()) {
+    streams_.drop(slice.schema());
+    return caf::make_error(ec::system_error,
+                           fmt::format("failed to finish IPC output stream: {}",
+                                       buffer.status().ToString()));
+  }
+  // Re-open the output stream for the next frame. The writer keeps its state
+  // so that it does not repeat the schema.
+  if (auto status = stream.sink->Reset(); not status.ok()) {
+    streams_.drop(slice.schema());
+    return caf::make_error(ec::system_error,
+                           fmt::format("failed to reset IPC output stream: {}",
+                                       status.ToString()));
+  }
+  result.payload = chunk::make(buffer.MoveValueUnsafe());
+  return result;
+}
+
+// -- decoder ------------------------------------------------------------------
+
+namespace {
+
+class record_batch_collector final : public arrow::ipc::Listener {
+public:
+  auto OnRecordBatchDecoded(std::shared_ptr<arrow::RecordBatch> batch)
+    -> arrow::Status override {
+    batches.push_back(std::move(batch));
+    return arrow::Status::OK();
+  }
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches = {};
+};
+
+} // namespace
+
+struct table_slice_decoder::stream {
+  type schema = {};
+  std::shared_ptr<record_batch_collector> collector = {};
+  std::unique_ptr<arrow::ipc::StreamDecoder> decoder = {};
+};
+
+table_slice_decoder::table_slice_decoder() = default;
+
+table_slice_decoder::table_slice_decoder(table_slice_decoder&&) noexcept
+  = default;
+
+auto table_slice_decoder::operator=(table_slice_decoder&&) noexcept
+  -> table_slice_decoder& = default;
+
+table_slice_decoder::~table_slice_decoder() noexcept = default;
+
+auto table_slice_decoder::decode(std::vector<table_slice_frame> frames)
+  -> caf::expected<std::vector<table_slice>> {
+  auto result = std::vector<table_slice>{};
+  result.reserve(frames.size());
+  for (auto& frame : frames) {
+    if (frame.evicted_stream) {
+      streams_.erase(*frame.evicted_stream);
+    }
+    if (frame.schema) {
+      auto new_stream = std::make_unique<stream>();
+      new_stream->schema = std::move(frame.schema);
+      new_stream->collector = std::make_shared<record_batch_collector>();
+      new_stream->decoder
+        = std::make_unique<arrow::ipc::StreamDecoder>(new_stream->collector);
+      streams_.insert_or_assign(frame.stream, std::move(new_stream));
+    }
+    auto it = streams_.find(frame.stream);
+    if (it == streams_.end()) {
+      return caf::make_error(ec::logic_error,
+                             fmt::format("received frame for unknown IPC "
+                                         "stream {}",
+                                         frame.stream));
+    }
+    auto& stream = *it->second;
+    if (auto status
+        = stream.decoder->Consume(as_arrow_buffer(std::move(frame.payload)));
+        not status.ok()) {
+      streams_.erase(it);
+      return caf::make_error(ec::format_error,
+                             fmt::format("failed to decode IPC stream: {}",
+                                         status.ToString()));
+    }
+    if (stream.collector->batches.size() != 1) {
+      return caf::make_error(ec::format_error,
+                             fmt::format("expected one record batch per frame, "
+                                         "got {}",
+                                         stream.collector->batches.size()));
+    }
+    auto& slice = result.emplace_back(
+      std::move(stream.collector->batches.front()), stream.schema);
+    stream.collector->batches.clear();
+    slice.import_time(frame.import_time);
+    slice.offset(frame.offset);
+  }
+  return result;
+}
+
+} // namespace tenzir
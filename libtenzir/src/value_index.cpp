@@ -164,6 +164,8 @@ caf::error unpack(const fbs::ValueIndex& from, value_index_ptr& to) {
       return do_unpack(*from.value_index_as_subnet()->base());
     case fbs::value_index::ValueIndex::string:
       return do_unpack(*from.value_index_as_string()->base());
+    case fbs::value_index::ValueIndex::ngram:
+      return do_unpack(*from.value_index_as_ngram()->base());
   }
   return caf::make_error(ec::format_error, "unexpected value index type");
 }
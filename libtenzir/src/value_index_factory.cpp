@@ -17,6 +17,7 @@
 #include "tenzir/index/hash_index.hpp"
 #include "tenzir/index/ip_index.hpp"
 #include "tenzir/index/list_index.hpp"
+#include "tenzir/index/ngram_index.hpp"
 #include "tenzir/index/string_index.hpp"
 #include "tenzir/index/subnet_index.hpp"
 #include "tenzir/logger.hpp"
@@ -120,6 +121,25 @@ value_index_ptr make(type x, caf::settings opts) {
   return std::make_unique<T>(std::move(x), std::move(opts));
 }
 
+value_index_ptr make_string_index(type x, caf::settings opts) {
+  // The n-gram index is opt-in via the index configuration, which forwards
+  // the selected index as option.
+  if (auto i = opts.find("index"); i != opts.end()) {
+    const auto* index = caf::get_if<caf::config_value::string>(&i->second);
+    if (!index) {
+      TENZIR_ERROR("{} invalid index type (string type needed)", __func__);
+      return nullptr;
+    }
+    if (*index == "ngram")
+      return std::make_unique<ngram_index>(std::move(x), std::move(opts));
+    if (*index != "default") {
+      TENZIR_ERROR("{} unknown string index {}", __func__, *index);
+      return nullptr;
+    }
+  }
+  return make<string_index>(std::move(x), std::move(opts));
+}
+
 template <concrete_type T, class Index>
 auto add_value_index_factory(T&& x = {}) {
   return factory<value_index>::add(type{std::forward<T>(x)}, make<Index>);
@@ -144,7 +164,7 @@ void factory_traits<value_index>::initialize() {
   add_arithmetic_index_factory<time_type>();
   add_value_index_factory<ip_type, ip_index>();
   add_value_index_factory<subnet_type, subnet_index>();
-  add_value_index_factory<string_type, string_index>();
+  factory<value_index>::add(type{string_type{}}, make_string_index);
   // List and enumeration types are not default-constructible, but their
   // contents dont matter here. We should refactor this at some point to just
   // need a template type.
@@ -0,0 +1,283 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/zone_map.hpp"
+
+#include "tenzir/arrow_table_slice.hpp"
+#include "tenzir/detail/assert.hpp"
+#include "tenzir/detail/narrow.hpp"
+#include "tenzir/detail/overload.hpp"
+#include "tenzir/detail/type_traits.hpp"
+#include "tenzir/expression.hpp"
+#include "tenzir/offset.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/type.hpp"
+
+#include <arrow/record_batch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <compare>
+#include <optional>
+#include <utility>
+
+namespace tenzir {
+
+namespace {
+
+/// The types of columns that zone maps describe.
+template <class Type>
+concept zone_map_type = detail::is_any_v<Type, int64_type, uint64_type,
+                                         double_type, duration_type, time_type>;
+
+/// Computes the statistics of a single column, or nothing if the column
+/// contains values that are not ordered.
+template <zone_map_type Type>
+std::optional<zone_map_column>
+make_zone_map_column(const Type& type, size_t column,
+                     const arrow::Array& array) {
+  const auto& values
+    = static_cast<const type_to_arrow_array_storage_t<Type>&>(array);
+  auto result = zone_map_column{
+    .column = column,
+    .null_count = detail::narrow_cast<uint64_t>(array.null_count()),
+  };
+  auto min = std::optional<view<type_to_data_t<Type>>>{};
+  auto max = std::optional<view<type_to_data_t<Type>>>{};
+  for (auto row = int64_t{0}; row < values.length(); ++row) {
+    if (values.IsNull(row))
+      continue;
+    const auto value = value_at(type, values, row);
+    // NaN is unordered, so we cannot describe columns containing it with a
+    // range.
+    if constexpr (std::is_same_v<Type, double_type>) {
+      if (std::isnan(value))
+        return std::nullopt;
+    }
+    if (!min || value < *min)
+      min = value;
+    if (!max || value > *max)
+      max = value;
+  }
+  if (min) {
+    result.min = data{*min};
+    result.max = data{*max};
+  }
+  return result;
+}
+
+/// Orders two values like the expression evaluator compares them, i.e.,
+/// integral values of mixed signedness compare by value and mixed arithmetic
+/// values compare as floating-point numbers.
+/// @returns The ordering of *lhs* and *rhs*, or nothing if they are not
+/// comparable.
+std::optional<std::partial_ordering> order(const data& lhs, const data& rhs) {
+  auto f = []<class Lhs, class Rhs>(
+             const Lhs& x,
+             const Rhs& y) -> std::optional<std::partial_ordering> {
+    if constexpr (detail::is_any_v<bool, Lhs, Rhs>) {
+      return std::nullopt;
+    } else if constexpr (std::is_integral_v<Lhs> && std::is_integral_v<Rhs>) {
+      if (std::cmp_less(x, y))
+        return std::partial_ordering::less;
+      if (std::cmp_greater(x, y))
+        return std::partial_ordering::greater;
+      return std::partial_ordering::equivalent;
+    } else if constexpr (std::is_arithmetic_v<Lhs>
+                         && std::is_arithmetic_v<Rhs>) {
+      return static_cast<double>(x) <=> static_cast<double>(y);
+    } else if constexpr (std::is_same_v<Lhs, Rhs>
+                         && detail::is_any_v<Lhs, duration, time>) {
+      if (x < y)
+        return std::partial_ordering::less;
+      if (y < x)
+        return std::partial_ordering::greater;
+      return std::partial_ordering::equivalent;
+    } else {
+      return std::nullopt;
+    }
+  };
+  return caf::visit(f, lhs, rhs);
+}
+
+/// Checks whether any value of a column may satisfy a predicate.
+bool may_match(const zone_map_column& column, uint64_t rows,
+               relational_operator op, const data& rhs) {
+  if (caf::holds_alternative<caf::none_t>(rhs)) {
+    switch (op) {
+      case relational_operator::equal:
+        return column.null_count > 0;
+      case relational_operator::not_equal:
+        return column.null_count < rows;
+      default:
+        return true;
+    }
+  }
+  // The evaluator never considers nulls when comparing with a value.
+  if (caf::holds_alternative<caf::none_t>(column.min))
+    return false;
+  // Incomparable values yield no information, so we must assume a match.
+  auto is = [&](const data& bound, auto... orderings) {
+    const auto result = order(bound, rhs);
+    return !result || ((*result == orderings) || ...);
+  };
+  const auto less = std::partial_ordering::less;
+  const auto equivalent = std::partial_ordering::equivalent;
+  const auto greater = std::partial_ordering::greater;
+  switch (op) {
+    case relational_operator::less:
+      return is(column.min, less);
+    case relational_operator::less_equal:
+      return is(column.min, less, equivalent);
+    case relational_operator::greater:
+      return is(column.max, greater);
+    case relational_operator::greater_equal:
+      return is(column.max, greater, equivalent);
+    case relational_operator::equal:
+      return is(column.min, less, equivalent)
+             && is(column.max, greater, equivalent);
+    case relational_operator::not_equal:
+      return order(column.min, rhs) != equivalent
+             || order(column.max, rhs) != equivalent;
+    case relational_operator::in:
+      if (const auto* xs = caf::get_if<list>(&rhs))
+        return std::any_of(xs->begin(), xs->end(), [&](const data& x) {
+          return !caf::holds_alternative<caf::none_t>(x)
+                 && may_match(column, rows, relational_operator::equal, x);
+        });
+      return true;
+    default:
+      return true;
+  }
+}
+
+} // namespace
+
+bool zone_map::may_match(const expression& expr) const {
+  auto f = detail::overload{
+    [](caf::none_t) {
+      return false;
+    },
+    [&](const conjunction& xs) {
+      return std::all_of(xs.begin(), xs.end(), [&](const expression& x) {
+        return may_match(x);
+      });
+    },
+    [&](const disjunction& xs) {
+      return std::any_of(xs.begin(), xs.end(), [&](const expression& x) {
+        return may_match(x);
+      });
+    },
+    [](const negation&) {
+      // Negating a range yields no range, so we don't attempt to reason about
+      // negations.
+      return true;
+    },
+    [&](const predicate& x) {
+      const auto* lhs = caf::get_if<data_extractor>(&x.lhs);
+      const auto* rhs = caf::get_if<data>(&x.rhs);
+      if (!lhs || !rhs)
+        return true;
+      const auto it = std::lower_bound(columns.begin(), columns.end(),
+                                       lhs->column,
+                                       [](const zone_map_column& column,
+                                          size_t index) {
+                                         return column.column < index;
+                                       });
+      if (it == columns.end() || it->column != lhs->column)
+        return true;
+      return tenzir::may_match(*it, rows, x.op, *rhs);
+    },
+  };
+  return caf::visit(f, expr);
+}
+
+zone_map make_zone_map(const table_slice& slice) {
+  TENZIR_ASSERT(slice.offset() != invalid_id);
+  auto result = zone_map{
+    .offset = slice.offset(),
+    .rows = slice.rows(),
+  };
+  const auto batch = to_record_batch(slice);
+  auto column = size_t{0};
+  for (const auto& leaf : caf::get<record_type>(slice.schema()).leaves()) {
+    auto f = [&]<concrete_type Type>(
+               const Type& type) -> std::optional<zone_map_column> {
+      if constexpr (zone_map_type<Type>)
+        return make_zone_map_column(type, column, *leaf.index.get(*batch));
+      else
+        return std::nullopt;
+    };
+    if (auto x = caf::visit(f, leaf.field.type))
+      result.columns.push_back(std::move(*x));
+    ++column;
+  }
+  return result;
+}
+
+ids prune(std::span<const zone_map> zone_maps, const expression& expr,
+          ids selection) {
+  auto mask = ids{};
+  for (const auto& zone_map : zone_maps) {
+    if (zone_map.may_match(expr))
+      continue;
+    TENZIR_ASSERT(zone_map.offset >= mask.size());
+    mask.append_bits(true, zone_map.offset - mask.size());
+    mask.append_bits(false, zone_map.rows);
+  }
+  if (mask.empty())
+    return selection;
+  // An empty selection stands for all ids, so we must make the mask cover all
+  // table slices before we can use it as the selection.
+  const auto size = selection.empty()
+                      ? zone_maps.back().offset + zone_maps.back().rows
+                      : selection.size();
+  if (size > mask.size())
+    mask.append_bits(true, size - mask.size());
+  if (selection.empty())
+    return mask;
+  return selection & mask;
+}
+
+flatbuffers::Offset<fbs::partition::detail::ZoneMap>
+pack(flatbuffers::FlatBufferBuilder& builder, const zone_map& x) {
+  auto columns
+    = std::vector<flatbuffers::Offset<fbs::partition::detail::ZoneMapColumn>>{};
+  columns.reserve(x.columns.size());
+  for (const auto& column : x.columns) {
+    const auto min_offset = pack(builder, column.min);
+    const auto max_offset = pack(builder, column.max);
+    columns.push_back(fbs::partition::detail::CreateZoneMapColumn(
+      builder, column.column, column.null_count, min_offset, max_offset));
+  }
+  return fbs::partition::detail::CreateZoneMapDirect(builder, x.offset, x.rows,
+                                                     &columns);
+}
+
+caf::error unpack(const fbs::partition::detail::ZoneMap& from, zone_map& to) {
+  to.offset = from.offset();
+  to.rows = from.rows();
+  to.columns.clear();
+  if (!from.columns())
+    return caf::none;
+  to.columns.reserve(from.columns()->size());
+  for (const auto* column : *from.columns()) {
+    auto& result = to.columns.emplace_back();
+    result.column = column->column();
+    result.null_count = column->null_count();
+    if (column->min())
+      if (auto err = unpack(*column->min(), result.min))
+        return err;
+    if (column->max())
+      if (auto err = unpack(*column->max(), result.max))
+        return err;
+  }
+  return caf::none;
+}
+
+} // namespace tenzir
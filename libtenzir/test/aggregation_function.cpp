@@ -0,0 +1,187 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/aggregation_function.hpp"
+
+#include "tenzir/data.hpp"
+#include "tenzir/plugin.hpp"
+#include "tenzir/series_builder.hpp"
+#include "tenzir/test/test.hpp"
+#include "tenzir/type.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+using namespace tenzir;
+using namespace std::string_literals;
+
+namespace {
+
+/// The values of a single array, where `caf::none` stands for null.
+using batch = std::vector<data>;
+
+struct fixture {
+  static auto make_function(std::string_view name, const type& input_type)
+    -> std::unique_ptr<aggregation_function> {
+    const auto* plugin = plugins::find<aggregation_function_plugin>(name);
+    REQUIRE(plugin);
+    return unbox(plugin->make_aggregation_function(input_type));
+  }
+
+  static auto make_array(const type& input_type, const batch& values)
+    -> typed_array {
+    auto b = series_builder{input_type};
+    for (const auto& value : values) {
+      b.data(value);
+    }
+    auto result = b.finish();
+    REQUIRE_EQUAL(result.size(), 1u);
+    return std::move(result[0]);
+  }
+
+  /// Aggregates the batches like `summarize` does, one array at a time.
+  static auto aggregate_arrays(std::string_view name, const type& input_type,
+                               const std::vector<batch>& batches) -> data {
+    auto function = make_function(name, input_type);
+    for (const auto& values : batches) {
+      function->add(*make_array(input_type, values).array);
+    }
+    return unbox(std::move(*function).finish());
+  }
+
+  /// Aggregates the batches one value at a time.
+  static auto aggregate_values(std::string_view name, const type& input_type,
+                               const std::vector<batch>& batches) -> data {
+    auto function = make_function(name, input_type);
+    for (const auto& values : batches) {
+      for (const auto& value : values) {
+        function->add(make_view(value));
+      }
+    }
+    return unbox(std::move(*function).finish());
+  }
+
+  /// Checks that both paths agree on the result, and returns it.
+  static auto aggregate(std::string_view name, const type& input_type,
+                        const std::vector<batch>& batches) -> data {
+    auto result = aggregate_arrays(name, input_type, batches);
+    CHECK_EQUAL(result, aggregate_values(name, input_type, batches));
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(aggregation_function_tests, fixture)
+
+TEST(sum with nulls across arrays) {
+  const auto input_type = type{int64_type{}};
+  CHECK_EQUAL(aggregate("sum", input_type,
+                        {{int64_t{1}, caf::none, int64_t{2}},
+                         {caf::none},
+                         {int64_t{-4}, int64_t{10}}}),
+              data{int64_t{9}});
+  CHECK_EQUAL(aggregate("sum", input_type, {{caf::none}, {caf::none}}),
+              data{});
+  CHECK_EQUAL(aggregate("sum", input_type, {}), data{});
+}
+
+TEST(sum overflow wraps around) {
+  const auto max = std::numeric_limits<uint64_t>::max();
+  CHECK_EQUAL(aggregate("sum", type{uint64_type{}},
+                        {{max, caf::none}, {uint64_t{2}}}),
+              data{uint64_t{1}});
+}
+
+TEST(sum of durations and bools) {
+  CHECK_EQUAL(aggregate("sum", type{duration_type{}},
+                        {{duration{1}, caf::none}, {duration{2}}}),
+              data{duration{3}});
+  CHECK_EQUAL(aggregate("sum", type{bool_type{}},
+                        {{true, caf::none}, {false, true}}),
+              data{true});
+}
+
+TEST(min and max of strings) {
+  const auto input_type = type{string_type{}};
+  const auto batches = std::vector<batch>{
+    {"foo"s, caf::none, "bar"s},
+    {caf::none},
+    {"qux"s, "baz"s},
+  };
+  CHECK_EQUAL(aggregate("min", input_type, batches), data{"bar"s});
+  CHECK_EQUAL(aggregate("max", input_type, batches), data{"qux"s});
+}
+
+TEST(min and max of ips) {
+  const auto input_type = type{ip_type{}};
+  const auto a = ip::v4(uint32_t{0x0a'00'00'01});
+  const auto b = ip::v4(uint32_t{0x0a'00'00'02});
+  const auto c = ip::v4(uint32_t{0xc0'a8'00'01});
+  const auto batches = std::vector<batch>{{b, caf::none}, {c, a}, {caf::none}};
+  CHECK_EQUAL(aggregate("min", input_type, batches), data{a});
+  CHECK_EQUAL(aggregate("max", input_type, batches), data{c});
+}
+
+TEST(min and max of subnets) {
+  const auto input_type = type{subnet_type{}};
+  const auto a = subnet{ip::v4(uint32_t{0x0a'00'00'00}), 8};
+  const auto b = subnet{ip::v4(uint32_t{0x0a'00'00'00}), 16};
+  const auto c = subnet{ip::v4(uint32_t{0xc0'a8'00'00}), 16};
+  const auto batches = std::vector<batch>{{c}, {caf::none, b}, {a}};
+  CHECK_EQUAL(aggregate("min", input_type, batches), data{a});
+  CHECK_EQUAL(aggregate("max", input_type, batches), data{c});
+}
+
+TEST(min and max of all nulls) {
+  const auto input_type = type{ip_type{}};
+  CHECK_EQUAL(aggregate("min", input_type, {{caf::none}, {caf::none}}),
+              data{});
+  CHECK_EQUAL(aggregate("max", input_type, {{caf::none}, {caf::none}}),
+              data{});
+}
+
+TEST(distinct and count distinct across arrays) {
+  const auto input_type = type{ip_type{}};
+  const auto a = ip::v4(uint32_t{0x0a'00'00'01});
+  const auto b = ip::v4(uint32_t{0x0a'00'00'02});
+  const auto batches = std::vector<batch>{{a, caf::none, b}, {b, a}, {a}};
+  CHECK_EQUAL(aggregate("distinct", input_type, batches), (data{list{a, b}}));
+  CHECK_EQUAL(aggregate("count_distinct", input_type, batches),
+              data{uint64_t{2}});
+}
+
+TEST(any and all across arrays) {
+  const auto input_type = type{bool_type{}};
+  CHECK_EQUAL(aggregate("any", input_type, {{false, caf::none}, {true}}),
+              data{true});
+  CHECK_EQUAL(aggregate("any", input_type, {{false}, {caf::none, false}}),
+              data{false});
+  CHECK_EQUAL(aggregate("all", input_type, {{true, caf::none}, {false}}),
+              data{false});
+  CHECK_EQUAL(aggregate("all", input_type, {{true}, {caf::none, true}}),
+              data{true});
+}
+
+TEST(any and all of arrays with only nulls) {
+  // An array without values has no true and no false values, which makes the
+  // result of `any` false and the result of `all` true.
+  const auto input_type = type{bool_type{}};
+  CHECK_EQUAL(aggregate_arrays("any", input_type, {{caf::none, caf::none}}),
+              data{false});
+  CHECK_EQUAL(aggregate_arrays("all", input_type, {{caf::none, caf::none}}),
+              data{true});
+  CHECK_EQUAL(aggregate_arrays("any", input_type, {{true}, {caf::none}}),
+              data{true});
+  CHECK_EQUAL(aggregate_arrays("all", input_type, {{false}, {caf::none}}),
+              data{false});
+}
+
+FIXTURE_SCOPE_END()
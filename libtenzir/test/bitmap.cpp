@@ -10,14 +10,23 @@
 
 #include "tenzir/concept/printable/tenzir/bitmap.hpp"
 #include "tenzir/concept/printable/to_string.hpp"
+#include "tenzir/error.hpp"
 #include "tenzir/ewah_bitmap.hpp"
 #include "tenzir/fbs/bitmap.hpp"
 #include "tenzir/flatbuffer.hpp"
 #include "tenzir/ids.hpp"
 #include "tenzir/null_bitmap.hpp"
+#include "tenzir/roaring_bitmap.hpp"
 #include "tenzir/test/test.hpp"
 
 #include <caf/test/dsl.hpp>
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string_view>
 
 using namespace tenzir;
 using namespace std::string_literals;
@@ -486,6 +495,14 @@ TEST(wah_bitmap) {
 
 FIXTURE_SCOPE_END()
 
+FIXTURE_SCOPE(roaring_bitmap_tests, bitmap_test_harness<roaring_bitmap>)
+
+TEST(roaring_bitmap) {
+  execute();
+}
+
+FIXTURE_SCOPE_END()
+
 FIXTURE_SCOPE(bitmap_tests, bitmap_test_harness<bitmap>)
 
 TEST(bitmap) {
@@ -913,3 +930,260 @@ TEST(EWAH RLE print 2) {
   // CHECK_EQUAL(str, "1F1T421F2T");
   CHECK_EQUAL(str, "1F1T62F320F39F2T");
 }
+
+TEST(Roaring container selection) {
+  using container_kind = roaring_bitmap::container_kind;
+  roaring_bitmap bm;
+  // A sparse chunk, a dense chunk, and a chunk consisting of a single run.
+  for (auto i = 0u; i < roaring_bitmap::container_width; ++i)
+    bm.append_bit(i % 1000 == 0);
+  for (auto i = 0u; i < roaring_bitmap::container_width; ++i)
+    bm.append_bit(i % 3 != 0);
+  bm.append_bits(false, 100);
+  bm.append_bits(true, 10'000);
+  bm.optimize();
+  const auto& containers = bm.containers();
+  REQUIRE_EQUAL(containers.size(), 3u);
+  CHECK_EQUAL(containers[0].kind, container_kind::array);
+  CHECK_EQUAL(containers[1].kind, container_kind::bitset);
+  CHECK_EQUAL(containers[2].kind, container_kind::run);
+  CHECK_EQUAL(containers[2].values.size(), 2u);
+  CHECK_EQUAL(bm.cardinality(), rank<1>(bm));
+  MESSAGE("all-zero chunks have no container");
+  auto zeros = roaring_bitmap{10 * roaring_bitmap::container_width, false};
+  CHECK(zeros.containers().empty());
+  zeros.append_bit(true);
+  CHECK_EQUAL(zeros.containers().size(), 1u);
+  CHECK_EQUAL(select<1>(zeros, 1), zeros.size() - 1);
+}
+
+namespace {
+
+/// Unpacks a Roaring bitmap that consists of a single container.
+auto unpack_container(uint8_t kind, uint32_t cardinality,
+                      std::vector<uint16_t> values,
+                      std::vector<roaring_bitmap::block_type> blocks = {})
+  -> caf::error {
+  auto builder = flatbuffers::FlatBufferBuilder{};
+  auto containers
+    = std::vector<flatbuffers::Offset<fbs::bitmap::detail::RoaringContainer>>{
+      fbs::bitmap::detail::CreateRoaringContainerDirect(
+        builder, 0, static_cast<fbs::bitmap::detail::RoaringContainerKind>(kind),
+        cardinality, &values, &blocks),
+    };
+  builder.Finish(fbs::bitmap::CreateRoaringBitmapDirect(
+    builder, &containers, roaring_bitmap::container_width));
+  auto result = roaring_bitmap{};
+  return unpack(*flatbuffers::GetRoot<fbs::bitmap::RoaringBitmap>(
+                  builder.GetBufferPointer()),
+                result);
+}
+
+} // namespace
+
+TEST(Roaring rejects invalid containers) {
+  constexpr auto array = uint8_t{0};
+  constexpr auto bitset = uint8_t{1};
+  constexpr auto run = uint8_t{2};
+  CHECK_EQUAL(unpack_container(array, 2, {1, 5}), caf::none);
+  CHECK_EQUAL(unpack_container(array, 2, {5, 1}), ec::format_error);
+  CHECK_EQUAL(unpack_container(array, 2, {1, 1}), ec::format_error);
+  CHECK_EQUAL(unpack_container(array, 3, {1, 5}), ec::format_error);
+  auto blocks = std::vector<roaring_bitmap::block_type>(
+    roaring_bitmap::bitset_size, 0);
+  blocks[3] = 0b101;
+  CHECK_EQUAL(unpack_container(bitset, 2, {}, blocks), caf::none);
+  CHECK_EQUAL(unpack_container(bitset, 3, {}, blocks), ec::format_error);
+  blocks.pop_back();
+  CHECK_EQUAL(unpack_container(bitset, 2, {}, blocks), ec::format_error);
+  // Runs are pairs of start and length minus one.
+  CHECK_EQUAL(unpack_container(run, 11, {0, 4, 65530, 5}), caf::none);
+  CHECK_EQUAL(unpack_container(run, 12, {0, 4, 65530, 6}), ec::format_error);
+  CHECK_EQUAL(unpack_container(run, 10, {0, 4, 65530, 5}), ec::format_error);
+  CHECK_EQUAL(unpack_container(run, 20, {0, 9, 5, 9}), ec::format_error);
+  CHECK_EQUAL(unpack_container(run, 10, {10, 4, 0, 4}), ec::format_error);
+  CHECK_EQUAL(unpack_container(run, 1, {0}), ec::format_error);
+  CHECK_EQUAL(unpack_container(42, 0, {}), ec::format_error);
+}
+
+namespace {
+
+/// Fills an EWAH and a Roaring bitmap with the same bits, produced by a
+/// generator that models a density profile of real-world ID sets.
+template <class Generator>
+auto make_profile(roaring_bitmap::size_type n, Generator gen) {
+  auto result = std::pair<ewah_bitmap, roaring_bitmap>{};
+  for (auto i = roaring_bitmap::size_type{0}; i < n; ++i) {
+    const auto bit = gen(i);
+    result.first.append_bit(bit);
+    result.second.append_bit(bit);
+  }
+  return result;
+}
+
+/// The names of the density profiles, in the order of `make_profiles`.
+constexpr auto profile_names = std::array{
+  "sparse", "dense", "clustered", "random", "short",
+};
+
+auto make_profiles(roaring_bitmap::size_type n
+                   = 3 * roaring_bitmap::container_width + 4242) {
+  auto engine = std::mt19937_64{42};
+  auto coin = [&](double p) {
+    return std::bernoulli_distribution{p}(engine);
+  };
+  return std::vector{
+    // Sparse hits, e.g., for a rare value of a high-cardinality field.
+    make_profile(n,
+                 [&](auto) {
+                   return coin(0.001);
+                 }),
+    // Dense hits, e.g., the complement of a rare value.
+    make_profile(n,
+                 [&](auto) {
+                   return coin(0.95);
+                 }),
+    // Clustered hits, e.g., a value that is common in a few batches only.
+    make_profile(n,
+                 [&](auto i) {
+                   return (i / 10'000) % 3 == 1;
+                 }),
+    // Uniformly random hits.
+    make_profile(n,
+                 [&](auto) {
+                   return coin(0.5);
+                 }),
+    // Hits that end early, leaving bitmaps of different sizes.
+    make_profile(n / 2,
+                 [&](auto i) {
+                   return i % 7 == 0;
+                 }),
+  };
+}
+
+} // namespace
+
+TEST(Roaring versus EWAH across density profiles) {
+  // This compares the results of all bitmap algorithms on Roaring bitmaps to
+  // their results on EWAH bitmaps for various densities, which exercises all
+  // combinations of container types.
+  const auto profiles = make_profiles();
+  for (const auto& [ewah, roaring] : profiles) {
+    REQUIRE_EQUAL(to_string(roaring), to_string(ewah));
+    CHECK_EQUAL(rank<1>(roaring), rank<1>(ewah));
+    CHECK_EQUAL(rank<0>(roaring), rank<0>(ewah));
+    CHECK_EQUAL(to_string(~roaring), to_string(~ewah));
+    for (auto i : {roaring_bitmap::size_type{1}, roaring_bitmap::size_type{2},
+                   roaring_bitmap::size_type{1000},
+                   roaring_bitmap::size_type{100'000},
+                   roaring_bitmap::word_type::npos})
+      CHECK_EQUAL(select<1>(roaring, i), select<1>(ewah, i));
+    CHECK_EQUAL(select<0>(roaring, 7), select<0>(ewah, 7));
+    const auto partial = roaring.size() / 3;
+    CHECK_EQUAL(rank<1>(roaring, partial), rank<1>(ewah, partial));
+    auto builder = flatbuffers::FlatBufferBuilder{};
+    builder.Finish(pack(builder, bitmap{roaring}));
+    auto fb = unbox(flatbuffer<fbs::Bitmap>::make(builder.Release()));
+    auto unpacked = bitmap{};
+    REQUIRE_EQUAL(unpack(*fb, unpacked), caf::none);
+    CHECK_EQUAL(bitmap{roaring}, unpacked);
+  }
+  for (const auto& [lhs_ewah, lhs_roaring] : profiles) {
+    for (const auto& [rhs_ewah, rhs_roaring] : profiles) {
+      CHECK_EQUAL(to_string(lhs_roaring & rhs_roaring),
+                  to_string(lhs_ewah & rhs_ewah));
+      CHECK_EQUAL(to_string(lhs_roaring | rhs_roaring),
+                  to_string(lhs_ewah | rhs_ewah));
+      CHECK_EQUAL(to_string(lhs_roaring ^ rhs_roaring),
+                  to_string(lhs_ewah ^ rhs_ewah));
+      CHECK_EQUAL(to_string(lhs_roaring - rhs_roaring),
+                  to_string(lhs_ewah - rhs_ewah));
+      const auto lhs = ids{lhs_roaring};
+      CHECK_EQUAL(to_string(lhs & ids{rhs_roaring}),
+                  to_string(lhs_ewah & rhs_ewah));
+      CHECK_EQUAL(to_string(lhs | ids{rhs_ewah}),
+                  to_string(lhs_ewah | rhs_ewah));
+    }
+  }
+}
+
+namespace {
+
+/// Returns the fastest of several runs of a function in microseconds.
+template <class F>
+auto fastest(int runs, F f) -> double {
+  auto result = std::chrono::steady_clock::duration::max();
+  for (auto i = 0; i < runs; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    result = std::min(result, std::chrono::steady_clock::now() - start);
+  }
+  return std::chrono::duration<double, std::micro>{result}.count();
+}
+
+/// Measures the serialized size and the bitmap algorithms for one bitmap
+/// representation across all density profiles, and prints one row per
+/// profile.
+template <class Bitmap>
+auto benchmark(std::string_view name, const std::vector<Bitmap>& bitmaps,
+               int runs) -> size_t {
+  // We accumulate all results so that the compiler cannot drop them.
+  auto checksum = size_t{0};
+  for (size_t i = 0; i < bitmaps.size(); ++i) {
+    const auto& x = bitmaps[i];
+    auto packed = flatbuffers::FlatBufferBuilder{};
+    packed.Finish(pack(packed, bitmap{x}));
+    const auto pack_us = fastest(runs, [&] {
+      auto builder = flatbuffers::FlatBufferBuilder{};
+      builder.Finish(pack(builder, bitmap{x}));
+      checksum += builder.GetSize();
+    });
+    const auto rank_us = fastest(runs, [&] {
+      checksum += rank<1>(x);
+    });
+    const auto half = std::max(rank<1>(x) / 2, typename Bitmap::size_type{1});
+    const auto select_us = fastest(runs, [&] {
+      checksum += select<1>(x, half);
+    });
+    const auto and_us = fastest(runs, [&] {
+      for (const auto& y : bitmaps)
+        checksum += (x & y).size();
+    });
+    const auto or_us = fastest(runs, [&] {
+      for (const auto& y : bitmaps)
+        checksum += (x | y).size();
+    });
+    fmt::print("{:<10} {:<8} {:>10} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} "
+               "{:>10.1f}\n",
+               profile_names[i], name, packed.GetSize(), pack_us, rank_us,
+               select_us, and_us / bitmaps.size(), or_us / bitmaps.size());
+  }
+  return checksum;
+}
+
+} // namespace
+
+TEST(Roaring versus EWAH benchmark) {
+  // This is a benchmark rather than a test, which scripts/benchmark-bitmaps
+  // runs with TENZIR_BITMAP_BENCHMARK_RUNS set. Otherwise, it does nothing.
+  const auto* runs_env = std::getenv("TENZIR_BITMAP_BENCHMARK_RUNS");
+  if (runs_env == nullptr)
+    return;
+  const auto runs = std::max(1, std::atoi(runs_env));
+  auto bits = roaring_bitmap::size_type{10'000'000};
+  if (const auto* bits_env = std::getenv("TENZIR_BITMAP_BENCHMARK_BITS"))
+    bits = std::strtoull(bits_env, nullptr, 10);
+  auto ewahs = std::vector<ewah_bitmap>{};
+  auto roarings = std::vector<roaring_bitmap>{};
+  for (auto& [ewah, roaring] : make_profiles(bits)) {
+    ewahs.push_back(std::move(ewah));
+    roarings.push_back(std::move(roaring));
+  }
+  fmt::print("{:<10} {:<8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+             "profile", "bitmap", "bytes", "pack/us", "rank/us", "select/us",
+             "and/us", "or/us");
+  const auto ewah_checksum = benchmark("ewah", ewahs, runs);
+  const auto roaring_checksum = benchmark("roaring", roarings, runs);
+  CHECK_NOT_EQUAL(ewah_checksum, 0u);
+  CHECK_NOT_EQUAL(roaring_checksum, 0u);
+}
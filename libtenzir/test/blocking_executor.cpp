@@ -0,0 +1,149 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/blocking_executor.hpp"
+
+#include "tenzir/test/test.hpp"
+
+#include <caf/settings.hpp>
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+using namespace tenzir;
+using namespace std::chrono_literals;
+
+namespace {
+
+auto make_options(uint64_t max_threads,
+                  duration overflow_after = std::chrono::hours{1})
+  -> blocking_executor_options {
+  auto result = blocking_executor_options{};
+  result.max_threads = max_threads;
+  result.keep_alive = 100ms;
+  result.overflow_after = overflow_after;
+  return result;
+}
+
+} // namespace
+
+TEST(blocking executor runs all tasks) {
+  auto executed = std::atomic<int>{};
+  {
+    auto executor = blocking_executor{make_options(4)};
+    for (auto i = 0; i < 100; ++i) {
+      executor.submit([&] {
+        ++executed;
+      });
+    }
+    // The destructor waits for all tasks.
+  }
+  CHECK_EQUAL(executed.load(), 100);
+}
+
+TEST(blocking executor does not wait behind blocked tasks) {
+  auto executor = blocking_executor{make_options(2)};
+  auto inner = std::promise<void>{};
+  auto outer = std::promise<void>{};
+  // The outer task blocks until the inner task, which it submits to its own
+  // queue, finished. This only works if another thread takes the inner task.
+  executor.submit([&] {
+    auto done = inner.get_future();
+    executor.submit([&] {
+      inner.set_value();
+    });
+    done.wait();
+    outer.set_value();
+  });
+  REQUIRE(outer.get_future().wait_for(10s) == std::future_status::ready);
+  const auto statistics = executor.statistics();
+  CHECK_LESS_EQUAL(statistics.threads, 2u);
+  CHECK_EQUAL(statistics.stolen_tasks, 1u);
+}
+
+TEST(blocking executor is bounded) {
+  auto executor = blocking_executor{make_options(3)};
+  auto release = std::promise<void>{};
+  auto released = release.get_future().share();
+  auto started = std::atomic<int>{};
+  for (auto i = 0; i < 10; ++i) {
+    executor.submit([&, released] {
+      ++started;
+      released.wait();
+    });
+  }
+  while (started.load() < 3) {
+    std::this_thread::sleep_for(1ms);
+  }
+  auto statistics = executor.statistics();
+  CHECK_EQUAL(statistics.threads, 3u);
+  CHECK_EQUAL(statistics.queued_tasks, 7u);
+  release.set_value();
+  while (executor.statistics().executed_tasks < 10) {
+    std::this_thread::sleep_for(1ms);
+  }
+  // Idle threads exit after the keep-alive time.
+  while (executor.statistics().threads > 0) {
+    std::this_thread::sleep_for(10ms);
+  }
+  CHECK_EQUAL(started.load(), 10);
+}
+
+TEST(blocking executor does not starve tasks behind blocked threads) {
+  // More tasks than threads block until all of them started, like loaders
+  // that wait for input that never arrives. Without overflow threads, the
+  // tasks beyond the maximum would wait forever.
+  constexpr auto max_threads = 3;
+  constexpr auto num_tasks = 8;
+  auto executor = blocking_executor{make_options(max_threads, 50ms)};
+  auto release = std::promise<void>{};
+  auto released = release.get_future().share();
+  auto started = std::atomic<int>{};
+  for (auto i = 0; i < num_tasks; ++i) {
+    executor.submit([&, released] {
+      ++started;
+      released.wait();
+    });
+  }
+  const auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (started.load() < num_tasks
+         and std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  REQUIRE_EQUAL(started.load(), num_tasks);
+  auto statistics = executor.statistics();
+  CHECK_EQUAL(statistics.threads, uint64_t{max_threads});
+  CHECK_EQUAL(statistics.overflow_threads, uint64_t{num_tasks - max_threads});
+  CHECK_EQUAL(statistics.queued_tasks, 0u);
+  release.set_value();
+  // Overflow threads exit as soon as no tasks are left.
+  while (executor.statistics().overflow_threads > 0) {
+    std::this_thread::sleep_for(1ms);
+  }
+  CHECK_EQUAL(executor.statistics().executed_tasks, uint64_t{num_tasks});
+}
+
+TEST(blocking executor options) {
+  auto settings = caf::settings{};
+  auto options = blocking_executor_options::make(settings);
+  REQUIRE_NOERROR(options);
+  CHECK_EQUAL(options->max_threads, 64u);
+  CHECK_EQUAL(options->keep_alive, duration{10s});
+  CHECK_EQUAL(options->overflow_after, duration{1s});
+  caf::put(settings, "tenzir.blocking-executor.max-threads", 8);
+  caf::put(settings, "tenzir.blocking-executor.keep-alive", "1min");
+  caf::put(settings, "tenzir.blocking-executor.overflow-after", "5s");
+  options = blocking_executor_options::make(settings);
+  REQUIRE_NOERROR(options);
+  CHECK_EQUAL(options->max_threads, 8u);
+  CHECK_EQUAL(options->keep_alive, duration{1min});
+  CHECK_EQUAL(options->overflow_after, duration{5s});
+  caf::put(settings, "tenzir.blocking-executor.max-threads", 0);
+  CHECK(not blocking_executor_options::make(settings));
+}
@@ -0,0 +1,182 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/bloom_filter_slices.hpp"
+
+#include "tenzir/bloom_filter.hpp"
+#include "tenzir/hash/xxhash.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace tenzir;
+
+namespace {
+
+using filter_type = bloom_filter<xxh64>;
+
+struct fixture {
+  fixture() {
+    // Filters of different shapes, so that the slices need several groups of
+    // blocks, and more than 64 filters per shape, so that a group needs more
+    // than one block.
+    for (auto i = 0u; i < 300; ++i) {
+      auto params = bloom_filter_parameters{};
+      params.n = i % 3 == 0 ? 16 : 256;
+      params.p = i % 2 == 0 ? 0.1 : 0.01;
+      auto& filter = filters.emplace_back(
+        unbox(make_bloom_filter<xxh64>(std::move(params))));
+      for (auto j = 0u; j < 10; ++j) {
+        filter.add(fmt::format("{}-{}", i, j));
+      }
+      ids.push_back(uuid::random());
+      slices.add(ids.back(), filter);
+    }
+  }
+
+  /// Computes the expected lookup result by probing every filter.
+  auto expected(const std::string& x) const {
+    auto result = std::vector<uuid>{};
+    for (size_t i = 0; i < filters.size(); ++i) {
+      if (slices.contains(ids[i]) and filters[i].lookup(x)) {
+        result.push_back(ids[i]);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  auto lookup(const std::string& x) const {
+    auto result = std::vector<uuid>{};
+    slices.lookup(x, result);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  std::vector<filter_type> filters;
+  std::vector<uuid> ids;
+  bloom_filter_slices<xxh64> slices;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(bloom_filter_slices_tests, fixture)
+
+TEST(bloom filter slices - lookup) {
+  CHECK_EQUAL(slices.size(), 300u);
+  for (auto i = 0u; i < 300; i += 7) {
+    const auto x = fmt::format("{}-{}", i, i % 10);
+    const auto result = lookup(x);
+    CHECK(std::binary_search(result.begin(), result.end(), ids[i]));
+    CHECK_EQUAL(result, expected(x));
+  }
+  for (const auto* x : {"foo", "bar", "baz"}) {
+    CHECK_EQUAL(lookup(x), expected(x));
+  }
+}
+
+TEST(bloom filter slices - erase) {
+  // Erase most filters, which empties and removes some of the blocks and
+  // moves others into their place.
+  for (auto i = 0u; i < 300; ++i) {
+    if (i % 5 != 0) {
+      CHECK(slices.erase(ids[i]));
+    }
+  }
+  CHECK(not slices.erase(ids[1]));
+  CHECK_EQUAL(slices.size(), 60u);
+  for (auto i = 0u; i < 300; i += 3) {
+    const auto x = fmt::format("{}-{}", i, 0);
+    const auto result = lookup(x);
+    CHECK_EQUAL(result, expected(x));
+    CHECK_EQUAL(std::binary_search(result.begin(), result.end(), ids[i]),
+                i % 5 == 0);
+  }
+  // Erased slots are reused.
+  for (auto i = 0u; i < 300; ++i) {
+    if (i % 5 != 0) {
+      slices.add(ids[i], filters[i]);
+    }
+  }
+  CHECK_EQUAL(slices.size(), 300u);
+  for (auto i = 0u; i < 300; i += 11) {
+    const auto x = fmt::format("{}-{}", i, 9);
+    CHECK_EQUAL(lookup(x), expected(x));
+  }
+}
+
+TEST(bloom filter slices - memusage) {
+  // A lone large filter must not cost a word per cell.
+  auto make = [](uint64_t n, double p, size_t values) {
+    auto params = bloom_filter_parameters{};
+    params.n = n;
+    params.p = p;
+    auto filter = unbox(make_bloom_filter<xxh64>(std::move(params)));
+    for (auto i = 0u; i < values; ++i) {
+      filter.add(fmt::format("{}-{}", n, i));
+    }
+    return filter;
+  };
+  const auto lone = make(1'000'000, 0.01, 1'000);
+  auto lone_slices = bloom_filter_slices<xxh64>{};
+  lone_slices.add(uuid::random(), lone);
+  CHECK_LESS(lone_slices.memusage(), 2 * lone.memusage());
+  // Mixed shapes: a full block of one shape that is sliced, a few more filters
+  // of that shape, and shapes with a single and a few filters.
+  auto mixed = bloom_filter_slices<xxh64>{};
+  auto mixed_filters = std::vector<filter_type>{};
+  auto mixed_ids = std::vector<uuid>{};
+  auto add = [&](filter_type filter) {
+    mixed_ids.push_back(uuid::random());
+    mixed.add(mixed_ids.back(), filter);
+    mixed_filters.push_back(std::move(filter));
+  };
+  for (auto i = 0u; i < 70; ++i) {
+    add(make(10'000, 0.01, 100));
+  }
+  add(make(100'000, 0.01, 100));
+  for (auto i = 0u; i < 3; ++i) {
+    add(make(1'000, 0.1, 100));
+  }
+  auto memusage = [&] {
+    auto result = size_t{};
+    for (size_t i = 0; i < mixed_filters.size(); ++i) {
+      if (mixed.contains(mixed_ids[i])) {
+        result += mixed_filters[i].memusage();
+      }
+    }
+    return result;
+  };
+  CHECK_LESS(mixed.memusage(), 2 * memusage());
+  // Erasing most filters of a sliced block keeps the bound.
+  for (auto i = 0u; i < 60; ++i) {
+    CHECK(mixed.erase(mixed_ids[i]));
+  }
+  CHECK_LESS(mixed.memusage(), 2 * memusage());
+  for (auto i = 0u; i < 100; i += 9) {
+    const auto x = fmt::format("10000-{}", i);
+    auto result = std::vector<uuid>{};
+    mixed.lookup(x, result);
+    std::sort(result.begin(), result.end());
+    auto expected = std::vector<uuid>{};
+    for (size_t j = 0; j < mixed_filters.size(); ++j) {
+      if (mixed.contains(mixed_ids[j]) and mixed_filters[j].lookup(x)) {
+        expected.push_back(mixed_ids[j]);
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+    CHECK_EQUAL(result, expected);
+    CHECK(not result.empty());
+  }
+}
+
+FIXTURE_SCOPE_END()
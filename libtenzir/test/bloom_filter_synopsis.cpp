@@ -15,6 +15,11 @@
 #include "tenzir/test/test.hpp"
 
 #include <caf/test/dsl.hpp>
+#include <fmt/format.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
 
 using namespace tenzir;
 using namespace si_literals;
@@ -59,3 +64,31 @@ TEST(bloom filter synopsis - wrong lookup type) {
     = synopsis.lookup(relational_operator::equal, make_data_view(int64_t{17}));
   CHECK_EQUAL(r2, false);
 }
+
+TEST(bloom filter synopsis - batch probe) {
+  // Synopses with different sizes and numbers of hash functions, so that the
+  // probe needs to compute digests for more than one hasher.
+  using synopsis_type = bloom_filter_synopsis<std::string, xxh64>;
+  auto synopses = std::vector<std::unique_ptr<synopsis_type>>{};
+  for (auto n : {10u, 100u, 1000u}) {
+    for (auto p : {0.1, 0.001}) {
+      bloom_filter_parameters xs;
+      xs.n = n;
+      xs.p = p;
+      auto bf = unbox(make_bloom_filter<xxh64>(std::move(xs)));
+      auto& synopsis = synopses.emplace_back(
+        std::make_unique<synopsis_type>(type{string_type{}}, std::move(bf)));
+      for (auto i = 0u; i < n; ++i)
+        synopsis->add(make_data_view(fmt::format("{}-{}", n, i)));
+    }
+  }
+  for (const auto* value : {"10-1", "100-99", "1000-999", "foo", "bar"}) {
+    const auto needle = std::string_view{value};
+    auto probe = bloom_filter_synopsis_probe<std::string, xxh64>{needle};
+    for (const auto& synopsis : synopses) {
+      auto expected
+        = synopsis->lookup(relational_operator::equal, make_data_view(needle));
+      CHECK_EQUAL(std::optional<bool>{probe(*synopsis)}, expected);
+    }
+  }
+}
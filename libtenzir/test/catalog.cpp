@@ -31,6 +31,7 @@
 
 #include <caf/make_copy_on_write.hpp>
 
+#include <algorithm>
 #include <optional>
 
 using namespace tenzir;
@@ -406,6 +407,88 @@ TEST(catalog with bool synopsis) {
   CHECK_EQUAL(lookup_("y != true"), none);
 }
 
+TEST(catalog with sliced bloom filters) {
+  auto schema = type{
+    "test",
+    record_type{
+      {"x", string_type{}},
+      {"y", ip_type{}},
+    },
+  };
+  auto state = catalog_state{};
+  auto partition_ids = std::vector<uuid>{};
+  auto synopses = std::vector<partition_synopsis_ptr>{};
+  auto add = [&](std::string_view x, std::string_view y, bool shrink) {
+    const auto address = unbox(to<data>(y));
+    auto builder = std::make_shared<table_slice_builder>(schema);
+    REQUIRE(builder->add(make_data_view(x), make_view(address)));
+    auto ps = make_partition_synopsis(builder->finish());
+    if (shrink) {
+      ps.shrink();
+    }
+    partition_ids.push_back(uuid::random());
+    synopses.push_back(
+      caf::make_copy_on_write<partition_synopsis>(std::move(ps)));
+    state.merge(partition_ids.back(), synopses.back());
+  };
+  auto candidates_for = [&](std::string_view expr) {
+    auto result = std::vector<uuid>{};
+    auto candidates = unbox(state.lookup(unbox(to<expression>(expr))));
+    for (const auto& [_, candidate] : candidates.candidate_infos) {
+      for (const auto& partition : candidate.partition_infos) {
+        result.push_back(partition.uuid);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  // Probes the type synopsis of every partition on its own.
+  auto expected = [&](const data& x) {
+    auto result = std::vector<uuid>{};
+    for (size_t i = 0; i < partition_ids.size(); ++i) {
+      const auto& syn = synopses[i]->type_synopses_.at(type::infer(x));
+      REQUIRE(syn);
+      auto opt = syn->lookup(relational_operator::equal, make_view(x));
+      if (!opt || *opt)
+        result.push_back(partition_ids[i]);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  add("foo", "10.0.0.1", true);
+  add("bar", "10.0.0.2", true);
+  add("baz", "10.0.0.3", true);
+  MESSAGE("all synopses are sliced");
+  const auto& bloom_index = state.bloom_indexes.at(schema);
+  CHECK_EQUAL(bloom_index.num_partitions, 3u);
+  CHECK_EQUAL(bloom_index.types.at(type{string_type{}}).strings.size(), 3u);
+  CHECK_EQUAL(bloom_index.types.at(type{ip_type{}}).ips.size(), 3u);
+  auto foo = candidates_for("x == \"foo\"");
+  CHECK(std::binary_search(foo.begin(), foo.end(), partition_ids[0]));
+  CHECK_EQUAL(foo, expected(data{"foo"s}));
+  auto address = candidates_for(":ip == 10.0.0.2");
+  CHECK(std::binary_search(address.begin(), address.end(), partition_ids[1]));
+  CHECK_EQUAL(address, expected(unbox(to<data>("10.0.0.2"))));
+  CHECK_EQUAL(candidates_for("x == \"qux\""), expected(data{"qux"s}));
+  MESSAGE("a buffered synopsis requires probing one by one");
+  add("qux", "10.0.0.4", false);
+  CHECK_EQUAL(bloom_index.types.at(type{string_type{}}).num_other, 1u);
+  auto qux = candidates_for("x == \"qux\"");
+  CHECK(std::binary_search(qux.begin(), qux.end(), partition_ids[3]));
+  CHECK_EQUAL(qux, expected(data{"qux"s}));
+  MESSAGE("erasing the buffered synopsis slices all synopses again");
+  state.erase(partition_ids[3]);
+  partition_ids.pop_back();
+  synopses.pop_back();
+  CHECK_EQUAL(bloom_index.num_partitions, 3u);
+  CHECK_EQUAL(bloom_index.types.at(type{string_type{}}).num_other, 0u);
+  CHECK_EQUAL(candidates_for("x == \"foo\""), foo);
+  for (const auto& id : partition_ids) {
+    state.erase(id);
+  }
+  CHECK(state.bloom_indexes.empty());
+}
+
 TEST(catalog messages) {
   // All of the pregenerated data has "foo" as content and its id as timestamp,
   // so this selects everything but the first partition.
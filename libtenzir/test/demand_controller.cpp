@@ -0,0 +1,104 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/demand_controller.hpp"
+
+#include "tenzir/test/test.hpp"
+
+#include <caf/settings.hpp>
+
+using namespace tenzir;
+using namespace std::chrono_literals;
+
+namespace {
+
+auto make_bounds() -> demand_bounds {
+  return {
+    .min_batch_size = 1,
+    .max_batch_size = 1024,
+    .min_batch_timeout = 10ms,
+    .max_batch_timeout = 2s,
+  };
+}
+
+auto make_options(bool adaptive, duration latency_target) -> demand_options {
+  auto result = demand_options{};
+  result.adaptive = adaptive;
+  result.latency_target = latency_target;
+  return result;
+}
+
+} // namespace
+
+TEST(static demand) {
+  auto demand = demand_controller{make_bounds(), make_options(false, 1s)};
+  CHECK_EQUAL(demand.batch_size(), 1024u);
+  CHECK_EQUAL(demand.batch_timeout(), duration{10ms});
+  // Partial batches only back off with the timeout, up to the upper bound.
+  for (auto i = 0; i < 10; ++i) {
+    demand.finish_request(1024, 1, 0);
+  }
+  CHECK_EQUAL(demand.batch_size(), 1024u);
+  CHECK_EQUAL(demand.batch_timeout(), duration{2s});
+  demand.finish_request(1024, 1024, 0);
+  CHECK_EQUAL(demand.batch_timeout(), duration{10ms});
+}
+
+TEST(adaptive demand follows the input rate) {
+  auto demand = demand_controller{make_bounds(), make_options(true, 500ms)};
+  CHECK_EQUAL(demand.batch_size(), 1024u);
+  // A slow input shrinks the batch size to about what arrives, and the
+  // timeout never exceeds the latency target.
+  demand.finish_request(1024, 3, 0);
+  CHECK_EQUAL(demand.batch_size(), 4u);
+  for (auto i = 0; i < 10; ++i) {
+    demand.finish_request(demand.batch_size(), 0, 0);
+  }
+  CHECK_EQUAL(demand.batch_size(), 1u);
+  CHECK_EQUAL(demand.batch_timeout(), duration{500ms});
+  // A fast input grows the batch size again.
+  for (auto i = 0; i < 20; ++i) {
+    demand.finish_request(demand.batch_size(), demand.batch_size(), 0);
+  }
+  CHECK_EQUAL(demand.batch_size(), 1024u);
+  CHECK_EQUAL(demand.batch_timeout(), duration{10ms});
+  // A backlog counts as a fast input.
+  demand.finish_request(1024, 1, 0);
+  CHECK_EQUAL(demand.batch_size(), 1u);
+  demand.finish_request(1, 0, 1);
+  CHECK_EQUAL(demand.batch_size(), 2u);
+}
+
+TEST(adaptive demand is bounded by the processing cost) {
+  auto demand = demand_controller{make_bounds(), make_options(true, 100ms)};
+  // At 1ms per element, we can afford 100 elements per batch.
+  demand.add_processing(10, 10ms);
+  demand.finish_request(1024, 1024, 0);
+  CHECK_EQUAL(demand.batch_size(), 100u);
+  // Without adapting, the cost does not matter.
+  auto fixed = demand_controller{make_bounds(), make_options(false, 100ms)};
+  fixed.add_processing(10, 10ms);
+  fixed.finish_request(1024, 1024, 0);
+  CHECK_EQUAL(fixed.batch_size(), 1024u);
+}
+
+TEST(demand options) {
+  auto settings = caf::settings{};
+  auto options = demand_options::make(settings);
+  REQUIRE_NOERROR(options);
+  CHECK(options->adaptive);
+  CHECK_EQUAL(options->latency_target, duration{1s});
+  caf::put(settings, "tenzir.pipeline-batching.adaptive", false);
+  caf::put(settings, "tenzir.pipeline-batching.latency-target", "50ms");
+  options = demand_options::make(settings);
+  REQUIRE_NOERROR(options);
+  CHECK(not options->adaptive);
+  CHECK_EQUAL(options->latency_target, duration{50ms});
+  caf::put(settings, "tenzir.pipeline-batching.latency-target", "0s");
+  CHECK(not demand_options::make(settings));
+}
@@ -0,0 +1,217 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/detail/compressed_frames.hpp"
+
+#include "tenzir/test/test.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+using namespace tenzir::detail;
+
+namespace {
+
+using bytes = std::vector<uint8_t>;
+
+auto concat(std::initializer_list<bytes> xs) -> bytes {
+  auto result = bytes{};
+  for (const auto& x : xs) {
+    result.insert(result.end(), x.begin(), x.end());
+  }
+  return result;
+}
+
+auto prefix(const bytes& x, size_t n) -> bytes {
+  return {x.begin(), x.begin() + static_cast<std::ptrdiff_t>(n)};
+}
+
+auto is_complete(frame_info x, int64_t size, bool skippable = false) -> bool {
+  return x.status == frame_status::complete and x.size == size
+         and x.skippable == skippable;
+}
+
+auto is_incomplete(frame_info x) -> bool {
+  return x.status == frame_status::incomplete;
+}
+
+auto is_unsplittable(frame_info x) -> bool {
+  return x.status == frame_status::unsplittable;
+}
+
+// A zstd frame with a single-segment header, a one-byte content size, a
+// non-last RLE block, a last raw block, and a checksum.
+const auto zstd_frame = bytes{
+  0x28, 0xB5, 0x2F, 0xFD, // magic number
+  0x24,                   // single segment, checksum
+  0x08,                   // content size
+  0x2A, 0x00, 0x00,       // RLE block of 5 bytes
+  'x',                    //
+  0x19, 0x00, 0x00,       // last raw block of 3 bytes
+  'a',  'b',  'c',        //
+  0x01, 0x02, 0x03, 0x04, // checksum
+};
+
+// A zstd frame with a window descriptor, a one-byte dictionary ID, and a
+// two-byte content size, and without a checksum.
+const auto zstd_frame_with_dictionary = bytes{
+  0x28, 0xB5, 0x2F, 0xFD, // magic number
+  0x41,                   // two-byte content size, one-byte dictionary ID
+  0x00,                   // window descriptor
+  0x07,                   // dictionary ID
+  0x02, 0x00,             // content size
+  0x11, 0x00, 0x00,       // last raw block of 2 bytes
+  'a',  'b',              //
+};
+
+const auto zstd_skippable_frame = bytes{
+  0x5F, 0x2A, 0x4D, 0x18, // skippable magic number
+  0x03, 0x00, 0x00, 0x00, // size
+  0x00, 0x00, 0x00,       // user data
+};
+
+// An LZ4 frame with independent blocks, an uncompressed block, and a content
+// checksum.
+const auto lz4_frame = bytes{
+  0x04, 0x22, 0x4D, 0x18, // magic number
+  0x64,                   // version 1, independent blocks, content checksum
+  0x40,                   // block maximum size
+  0x00,                   // header checksum
+  0x03, 0x00, 0x00, 0x80, // uncompressed block of 3 bytes
+  'a',  'b',  'c',        //
+  0x00, 0x00, 0x00, 0x00, // end mark
+  0x01, 0x02, 0x03, 0x04, // content checksum
+};
+
+// An LZ4 frame with block checksums and a content size.
+const auto lz4_frame_with_block_checksums = bytes{
+  0x04, 0x22, 0x4D, 0x18, // magic number
+  0x78, // version 1, independent blocks, block checksums, content size
+  0x40, // block maximum size
+  0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // content size
+  0x00,                                           // header checksum
+  0x03, 0x00, 0x00, 0x80,                         // uncompressed block
+  'a',  'b',  'c',                                //
+  0x01, 0x02, 0x03, 0x04,                         // block checksum
+  0x00, 0x00, 0x00, 0x00,                         // end mark
+};
+
+// The empty BGZF block that bgzip appends as end-of-file marker.
+const auto bgzf_block = bytes{
+  0x1F, 0x8B, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF,
+  0x06, 0x00, 0x42, 0x43, 0x02, 0x00, 0x1B, 0x00, 0x03, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+} // namespace
+
+TEST(zstd frames) {
+  CHECK(is_complete(scan_zstd_frame(zstd_frame), 20));
+  CHECK(is_complete(scan_zstd_frame(zstd_frame_with_dictionary), 14));
+  // Only the first of multiple frames counts.
+  const auto frames = concat({zstd_frame, zstd_frame_with_dictionary});
+  CHECK(is_complete(scan_zstd_frame(frames), 20));
+  CHECK(is_complete(scan_zstd_frame(std::span{frames}.subspan(20)), 14));
+}
+
+TEST(zstd skippable frames) {
+  CHECK(is_complete(scan_zstd_frame(zstd_skippable_frame), 11, true));
+  CHECK(is_complete(
+    scan_zstd_frame(concat({zstd_skippable_frame, zstd_frame})), 11, true));
+  CHECK(is_incomplete(scan_zstd_frame(prefix(zstd_skippable_frame, 6))));
+  CHECK(is_incomplete(scan_zstd_frame(prefix(zstd_skippable_frame, 10))));
+}
+
+TEST(truncated zstd frames) {
+  for (size_t n = 0; n < zstd_frame.size(); ++n) {
+    CHECK(is_incomplete(scan_zstd_frame(prefix(zstd_frame, n))));
+  }
+  for (size_t n = 0; n < zstd_frame_with_dictionary.size(); ++n) {
+    CHECK(
+      is_incomplete(scan_zstd_frame(prefix(zstd_frame_with_dictionary, n))));
+  }
+}
+
+TEST(corrupt zstd frames) {
+  auto frame = zstd_frame;
+  frame[0] = 0x29;
+  CHECK(is_unsplittable(scan_zstd_frame(frame)));
+  // The reserved bit of the frame header descriptor is set.
+  frame = zstd_frame;
+  frame[4] |= 0x08;
+  CHECK(is_unsplittable(scan_zstd_frame(frame)));
+  // The last block has the reserved block type.
+  frame = zstd_frame;
+  frame[10] |= 0x06;
+  CHECK(is_unsplittable(scan_zstd_frame(frame)));
+}
+
+TEST(lz4 frames) {
+  CHECK(is_complete(scan_lz4_frame(lz4_frame), 22));
+  CHECK(is_complete(scan_lz4_frame(lz4_frame_with_block_checksums), 30));
+  const auto frames = concat({lz4_frame_with_block_checksums, lz4_frame});
+  CHECK(is_complete(scan_lz4_frame(frames), 30));
+  CHECK(is_complete(scan_lz4_frame(std::span{frames}.subspan(30)), 22));
+  // LZ4 shares its skippable frames with zstd.
+  CHECK(is_complete(scan_lz4_frame(concat({zstd_skippable_frame, lz4_frame})),
+                    11, true));
+}
+
+TEST(truncated lz4 frames) {
+  for (size_t n = 0; n < lz4_frame.size(); ++n) {
+    CHECK(is_incomplete(scan_lz4_frame(prefix(lz4_frame, n))));
+  }
+  for (size_t n = 0; n < lz4_frame_with_block_checksums.size(); ++n) {
+    CHECK(
+      is_incomplete(scan_lz4_frame(prefix(lz4_frame_with_block_checksums, n))));
+  }
+}
+
+TEST(corrupt lz4 frames) {
+  auto frame = lz4_frame;
+  frame[3] = 0x19;
+  CHECK(is_unsplittable(scan_lz4_frame(frame)));
+  // Only version 1 of the frame format exists.
+  frame = lz4_frame;
+  frame[4] = 0xA4;
+  CHECK(is_unsplittable(scan_lz4_frame(frame)));
+}
+
+TEST(bgzf blocks) {
+  CHECK(is_complete(scan_bgzf_block(bgzf_block), 28));
+  CHECK(is_complete(scan_bgzf_block(concat({bgzf_block, bgzf_block})), 28));
+  // Another subfield may precede the BGZF subfield.
+  auto block = concat({prefix(bgzf_block, 12),
+                       bytes{'X', 'Y', 0x01, 0x00, 0x00},
+                       bytes{bgzf_block.begin() + 12, bgzf_block.end()}});
+  block[10] = 0x0B; // XLEN
+  block[21] = 0x20; // BSIZE
+  CHECK(is_complete(scan_bgzf_block(block), 33));
+}
+
+TEST(truncated bgzf blocks) {
+  for (size_t n = 0; n < bgzf_block.size(); ++n) {
+    CHECK(is_incomplete(scan_bgzf_block(prefix(bgzf_block, n))));
+  }
+}
+
+TEST(unsplittable gzip members) {
+  // A plain gzip member has no extra field.
+  auto block = bgzf_block;
+  block[3] = 0x00;
+  CHECK(is_unsplittable(scan_bgzf_block(block)));
+  // The extra field has no BGZF subfield.
+  block = bgzf_block;
+  block[12] = 'X';
+  CHECK(is_unsplittable(scan_bgzf_block(block)));
+  // Not gzip at all.
+  block = bgzf_block;
+  block[1] = 0x00;
+  CHECK(is_unsplittable(scan_bgzf_block(block)));
+}
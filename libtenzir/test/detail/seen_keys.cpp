@@ -0,0 +1,93 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/detail/seen_keys.hpp"
+
+#include "tenzir/test/test.hpp"
+
+#include <chrono>
+
+using namespace tenzir;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct fixture {
+  /// Inserts a key with a single value, using the value as its digest.
+  auto insert(detail::seen_keys& keys, int64_t x, time now) -> bool {
+    auto key = detail::seen_keys::key_view{&schema, {data_view{x}}};
+    return keys.insert(key, static_cast<size_t>(x), now);
+  }
+
+  /// Returns a point in time relative to an arbitrary epoch.
+  static auto at(duration since_start) -> time {
+    return time{} + since_start;
+  }
+
+  type schema = {};
+};
+
+} // namespace
+
+FIXTURE_SCOPE(seen_keys_tests, fixture)
+
+TEST(unbounded) {
+  auto keys = detail::seen_keys{std::nullopt, std::nullopt};
+  CHECK(insert(keys, 1, at(0s)));
+  CHECK(insert(keys, 2, at(0s)));
+  CHECK(not insert(keys, 1, at(1h)));
+  keys.expire(at(24h));
+  CHECK(not insert(keys, 2, at(24h)));
+  CHECK_EQUAL(keys.size(), 2u);
+}
+
+TEST(keys of different schemas) {
+  auto keys = detail::seen_keys{std::nullopt, std::nullopt};
+  auto other = type{int64_type{}};
+  CHECK(insert(keys, 1, at(0s)));
+  auto key = detail::seen_keys::key_view{&other, {data_view{int64_t{1}}}};
+  CHECK(keys.insert(key, 1, at(0s)));
+  CHECK(not keys.insert(key, 1, at(0s)));
+}
+
+TEST(max size evicts the least recently seen key) {
+  auto keys = detail::seen_keys{2, std::nullopt};
+  CHECK(insert(keys, 1, at(0s)));
+  CHECK(insert(keys, 2, at(1s)));
+  // Seeing 1 again makes 2 the least recently seen key.
+  CHECK(not insert(keys, 1, at(2s)));
+  CHECK(insert(keys, 3, at(3s)));
+  CHECK_EQUAL(keys.size(), 2u);
+  CHECK(not insert(keys, 1, at(4s)));
+  CHECK(not insert(keys, 3, at(5s)));
+  CHECK(insert(keys, 2, at(6s)));
+}
+
+TEST(ttl expires keys) {
+  auto keys = detail::seen_keys{std::nullopt, 10s};
+  CHECK(insert(keys, 1, at(0s)));
+  CHECK(insert(keys, 2, at(5s)));
+  // Seeing a key within the TTL extends it.
+  CHECK(not insert(keys, 1, at(9s)));
+  keys.expire(at(15s));
+  CHECK_EQUAL(keys.size(), 1u);
+  CHECK(not insert(keys, 1, at(18s)));
+  CHECK(insert(keys, 2, at(18s)));
+}
+
+TEST(ttl applies without expiring first) {
+  // The operator expires keys once per batch, so a key can expire in the
+  // middle of a batch.
+  auto keys = detail::seen_keys{std::nullopt, 10s};
+  CHECK(insert(keys, 1, at(0s)));
+  CHECK(not insert(keys, 1, at(9s)));
+  CHECK(insert(keys, 1, at(19s)));
+  CHECK(not insert(keys, 1, at(20s)));
+}
+
+FIXTURE_SCOPE_END()
@@ -86,6 +86,20 @@ TEST(evaluation - field extractor - service + orig_h) {
   REQUIRE_EQUAL(rank(ids), 2u);
 }
 
+TEST(evaluation - field extractor - service pattern) {
+  // The evaluator caches pattern matches per distinct value, which must not
+  // change the result compared to evaluating every row.
+  auto equal = evaluate(make_conn_expr("service == \"http\""),
+                        zeek_conn_log_slice, {});
+  REQUIRE_GREATER(rank(equal), 0u);
+  auto expr = make_conn_expr("service == /h.*p/");
+  CHECK_EQUAL(evaluate(expr, zeek_conn_log_slice, {}), equal);
+  auto not_equal = evaluate(make_conn_expr("service != \"http\""),
+                            zeek_conn_log_slice, {});
+  expr = make_conn_expr("service != /h.*p/");
+  CHECK_EQUAL(evaluate(expr, zeek_conn_log_slice, {}), not_equal);
+}
+
 TEST(evaluation - empty expression) {
   auto expr = expression{};
   auto ids = evaluate(expr, zeek_conn_log_slice, {});
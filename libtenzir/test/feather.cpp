@@ -320,6 +320,31 @@ TEST(passive feather store fetchall query) {
   compare_table_slices(slice, results[0]);
 }
 
+TEST(passive feather store roundtrip of sliced nested data) {
+  auto f = table_slice_fixture();
+  // Slices that do not start at the first row of their batch have offsets in
+  // the nested record and list arrays, which the store must handle.
+  auto slices = std::vector<table_slice>{subslice(f.slice, 1, 4),
+                                         subslice(f.slice, 0, 2), f.slice};
+  const auto* plugin
+    = tenzir::plugins::find<tenzir::store_actor_plugin>("feather");
+  REQUIRE(plugin);
+  auto builder_and_header = plugin->make_store_builder(accountant, filesystem,
+                                                       tenzir::uuid::random());
+  REQUIRE_NOERROR(builder_and_header);
+  auto& [builder, header] = *builder_and_header;
+  tenzir::detail::spawn_container_source(sys, slices, builder);
+  run();
+  auto store = plugin->make_store(accountant, filesystem, as_bytes(header));
+  REQUIRE_NOERROR(store);
+  run();
+  auto results = query(*store, tenzir::ids{});
+  run();
+  REQUIRE(not results.empty());
+  CHECK_EQUAL(rows(results), rows(slices));
+  compare_table_slices(concatenate(results), concatenate(slices));
+}
+
 TEST(passive feather store selective count query) {
   auto f = table_slice_fixture();
   auto slice = f.slice;
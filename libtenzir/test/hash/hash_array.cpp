@@ -0,0 +1,74 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/hash/hash_array.hpp"
+
+#include "tenzir/arrow_table_slice.hpp"
+#include "tenzir/detail/narrow.hpp"
+#include "tenzir/hash/hash.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/test/fixtures/events.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <arrow/array.h>
+#include <arrow/record_batch.h>
+#include <fmt/format.h>
+
+#include <limits>
+
+using namespace tenzir;
+
+FIXTURE_SCOPE(hash_array_tests, fixtures::events)
+
+TEST(digests equal hashing data views) {
+  for (const auto& slice : take(zeek_conn_log, 4)) {
+    const auto batch = to_record_batch(slice);
+    const auto& schema = caf::get<record_type>(slice.schema());
+    for (auto column = 0; column < batch->num_columns(); ++column) {
+      const auto& type = schema.field(column).type;
+      const auto& array = *batch->column(column);
+      const auto digests = hash_array(type, array);
+      const auto salted_digests = hash_array(type, array, "pepper");
+      REQUIRE_EQUAL(digests.size(), slice.rows());
+      REQUIRE_EQUAL(salted_digests.size(), slice.rows());
+      auto row = size_t{0};
+      for (const auto& value : values(type, array)) {
+        CHECK_EQUAL(digests[row], hash(value));
+        CHECK_EQUAL(salted_digests[row], hash(value, std::string{"pepper"}));
+        ++row;
+      }
+    }
+  }
+}
+
+TEST(digests of single values) {
+  CHECK_EQUAL(hash_as_data_view(int64_t{42}), hash(data_view{int64_t{42}}));
+  CHECK_EQUAL(hash_as_data_view(std::string_view{"foo"}),
+              hash(data_view{std::string_view{"foo"}}));
+  CHECK_EQUAL(hash_as_data_view(true), hash(data_view{true}));
+}
+
+TEST(hex digests) {
+  const auto digests = std::vector<array_digest>{
+    0,
+    1,
+    0xf,
+    0x10,
+    0xdeadbeef,
+    std::numeric_limits<array_digest>::max(),
+  };
+  const auto array = make_hex_digest_array(digests);
+  REQUIRE_EQUAL(array->length(), detail::narrow<int64_t>(digests.size()));
+  CHECK_EQUAL(array->null_count(), 0);
+  for (auto i = size_t{0}; i < digests.size(); ++i) {
+    CHECK_EQUAL(array->GetView(detail::narrow<int64_t>(i)),
+                fmt::format("{:x}", digests[i]));
+  }
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,127 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/index/ngram_index.hpp"
+
+#include "tenzir/concept/printable/tenzir/bitmap.hpp"
+#include "tenzir/concept/printable/to_string.hpp"
+#include "tenzir/detail/legacy_deserialize.hpp"
+#include "tenzir/detail/serialize.hpp"
+#include "tenzir/fbs/value_index.hpp"
+#include "tenzir/flatbuffer.hpp"
+#include "tenzir/pattern.hpp"
+#include "tenzir/test/test.hpp"
+#include "tenzir/value_index_factory.hpp"
+
+using namespace tenzir;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    factory<value_index>::initialize();
+  }
+
+  auto make_index(caf::settings opts = {}) -> value_index_ptr {
+    opts["index"] = "ngram";
+    auto result = factory<value_index>::make(type{string_type{}}, opts);
+    REQUIRE(dynamic_cast<ngram_index*>(result.get()));
+    for (auto x : {"/index.html", "/wp-admin/login.php", "", "/wp", "/admin"})
+      REQUIRE(result->append(make_data_view(x)));
+    REQUIRE(result->append(make_data_view(caf::none)));
+    REQUIRE(result->append(make_data_view("/wp-admin")));
+    return result;
+  }
+
+  static auto lookup(const value_index_ptr& idx, relational_operator op,
+                     data_view x) -> std::string {
+    return to_string(unbox(idx->lookup(op, x)));
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(ngram_index_tests, fixture)
+
+TEST(ngram index - substring lookup) {
+  auto idx = make_index();
+  auto ni = relational_operator::ni;
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("wp-admin")), "0100001");
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("admin")), "0100101");
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("html")), "1000000");
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("xyz")), "0000000");
+  MESSAGE("strings shorter than an n-gram yield all values as candidates");
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("wp")), "1111101");
+  MESSAGE("equality yields a superset of the exact result");
+  auto eq = relational_operator::equal;
+  CHECK_EQUAL(lookup(idx, eq, make_data_view("/wp-admin")), "0100001");
+  CHECK_EQUAL(lookup(idx, relational_operator::not_ni,
+                     make_data_view("admin")),
+              "1111101");
+  CHECK_EQUAL(lookup(idx, eq, make_data_view(caf::none)), "0000010");
+}
+
+TEST(ngram index - pattern lookup) {
+  auto idx = make_index();
+  auto eq = relational_operator::equal;
+  auto pat = unbox(pattern::make("^/wp-admin/.*\\.php$"));
+  CHECK_EQUAL(lookup(idx, eq, make_data_view(pat)), "0100000");
+  pat = unbox(pattern::make("-adm(in)?"));
+  CHECK_EQUAL(lookup(idx, eq, make_data_view(pat)), "0100001");
+  pat = unbox(pattern::make("/admin|/index"));
+  CHECK_EQUAL(lookup(idx, eq, make_data_view(pat)), "1111101");
+  pat = unbox(pattern::make("/ADMIN", {.case_insensitive = true}));
+  CHECK_EQUAL(lookup(idx, eq, make_data_view(pat)), "1111101");
+}
+
+TEST(ngram index - literal prefix) {
+  CHECK_EQUAL(ngram_index::literal_prefix("^foo.*bar"), "foo");
+  CHECK_EQUAL(ngram_index::literal_prefix("foo\\.exe"), "foo.exe");
+  CHECK_EQUAL(ngram_index::literal_prefix("foo\\d+"), "foo");
+  CHECK_EQUAL(ngram_index::literal_prefix("fooo?"), "foo");
+  CHECK_EQUAL(ngram_index::literal_prefix("foo+"), "foo");
+  CHECK_EQUAL(ngram_index::literal_prefix("foo|bar"), "");
+  CHECK_EQUAL(ngram_index::literal_prefix("(?i)foo"), "");
+}
+
+TEST(ngram index - bounded memory) {
+  auto opts = caf::settings{};
+  opts["max-ngrams"] = 9;
+  opts["max-size"] = 16;
+  auto idx = make_index(opts);
+  // Only the n-grams of the first value fit into the index. All other values
+  // that contain additional n-grams, as well as the second value that exceeds
+  // the maximum size, are candidates for every query.
+  auto ni = relational_operator::ni;
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("index")), "1101101");
+  CHECK_EQUAL(lookup(idx, ni, make_data_view("xyz")), "0101101");
+}
+
+TEST(ngram index - serialization) {
+  auto idx = make_index();
+  auto ni = relational_operator::ni;
+  MESSAGE("flatbuffers");
+  auto builder = flatbuffers::FlatBufferBuilder{};
+  const auto idx_offset = pack(builder, idx);
+  builder.Finish(idx_offset);
+  auto fb = unbox(flatbuffer<fbs::ValueIndex>::make(builder.Release()));
+  auto idx2 = value_index_ptr{};
+  REQUIRE_EQUAL(unpack(*fb, idx2), caf::none);
+  REQUIRE(dynamic_cast<ngram_index*>(idx2.get()));
+  CHECK_EQUAL(idx->options(), idx2->options());
+  CHECK_EQUAL(lookup(idx2, ni, make_data_view("admin")), "0100101");
+  CHECK_EQUAL(lookup(idx2, ni, make_data_view("html")), "1000000");
+  MESSAGE("legacy serialization");
+  caf::byte_buffer buf;
+  CHECK(detail::serialize(buf, idx));
+  auto idx3 = value_index_ptr{};
+  REQUIRE(detail::legacy_deserialize(buf, idx3));
+  CHECK_EQUAL(lookup(idx3, ni, make_data_view("admin")), "0100101");
+}
+
+FIXTURE_SCOPE_END()
@@ -15,6 +15,7 @@
 #include "tenzir/test/test.hpp"
 
 #include <unordered_map>
+#include <vector>
 
 using namespace tenzir;
 using namespace std::string_literals;
@@ -44,6 +45,14 @@ void check_address_pseudonymization(
     REQUIRE_EQUAL(pseudonymized_adress_actual,
                   pseudonymized_address_expectation);
   }
+  // The batch pseudonymizer must produce identical results, both with a cold
+  // and with a warm cache.
+  auto pseudonymizer = ip_pseudonymizer{seed};
+  for (auto i = 0; i < 2; ++i) {
+    for (const auto& [original, pseudonymized] : addresses) {
+      CHECK_EQUAL(pseudonymizer(*to<ip>(original)), *to<ip>(pseudonymized));
+    }
+  }
 }
 
 } // namespace
@@ -322,3 +331,21 @@ TEST(IPv6 pseudonymization - seed 3) {
   };
   check_address_pseudonymization(addresses, seed_3);
 }
+
+TEST(pseudonymization with prefix cache) {
+  // Pseudonymize addresses that share prefixes with caches of different
+  // sizes, including one that is smaller than the number of prefixes and
+  // thus gets flushed repeatedly.
+  auto addresses = std::vector<ip>{};
+  for (auto i = uint32_t{0}; i < 512; ++i) {
+    addresses.push_back(ip::v4((uint32_t{10} << 24) | (i * 0x10203)));
+    auto v6 = std::array<uint32_t, 4>{0x20010db8, 0, i >> 4, i * 0x9e3779b9};
+    addresses.push_back(ip::v6(std::span{v6}));
+  }
+  for (auto cache_capacity : {size_t{0}, size_t{7}, size_t{1} << 16}) {
+    auto pseudonymizer = ip_pseudonymizer{seed_1, cache_capacity};
+    for (const auto& address : addresses) {
+      REQUIRE_EQUAL(pseudonymizer(address), ip::pseudonymize(address, seed_1));
+    }
+  }
+}
@@ -507,6 +507,18 @@ TEST(parse_potpourri) {
   REQUIRE_NOERROR(pipeline::internal_parse(potpourri_pipeline));
 }
 
+TEST(parse windowed summarize) {
+  const auto windowed
+    = "summarize count(.) by src_ip window 5min slide 1min on ts delay 10s";
+  REQUIRE_NOERROR(pipeline::internal_parse(windowed));
+  check_binary_serialization(unbox(pipeline::internal_parse(windowed)));
+  CHECK_ERROR(pipeline::internal_parse("summarize count(.) window 5min slide "
+                                       "2min"));
+  CHECK_ERROR(pipeline::internal_parse("summarize count(.) window 5min delay "
+                                       "10s"));
+  CHECK_ERROR(pipeline::internal_parse("summarize count(.) slide 1min"));
+}
+
 TEST(pipeline serialization) {
   check_binary_serialization(unbox(pipeline::internal_parse("pass")));
   check_binary_serialization(
@@ -0,0 +1,95 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/heavy_hitters.hpp"
+
+#include "tenzir/detail/legacy_deserialize.hpp"
+#include "tenzir/detail/serialize.hpp"
+#include "tenzir/hash/hash.hpp"
+#include "tenzir/sketch/count_min_sketch.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <caf/test/dsl.hpp>
+
+#include <random>
+
+using namespace tenzir;
+using namespace tenzir::sketch;
+
+namespace {
+
+void add(heavy_hitters& sketch, int64_t x, uint64_t count = 1) {
+  sketch.add(hash(x), data_view{x}, count);
+}
+
+} // namespace
+
+TEST(count - min sketch) {
+  CHECK(!count_min_sketch::make(0, 4));
+  auto sketch = unbox(count_min_sketch::make(1000, 4));
+  CHECK_EQUAL(sketch.width(), 1024u);
+  sketch.add(hash(1), 10);
+  sketch.add(hash(2), 3);
+  CHECK_GREATER_EQUAL(sketch.estimate(hash(1)), 10u);
+  CHECK_GREATER_EQUAL(sketch.estimate(hash(2)), 3u);
+  auto other = unbox(count_min_sketch::make(1024, 4));
+  other.add(hash(1), 5);
+  REQUIRE(!sketch.merge(other));
+  CHECK_GREATER_EQUAL(sketch.estimate(hash(1)), 15u);
+  auto smaller = unbox(count_min_sketch::make(512, 4));
+  CHECK(sketch.merge(smaller));
+}
+
+TEST(heavy hitters top values) {
+  auto sketch = unbox(heavy_hitters::make(3));
+  std::mt19937_64 r{0};
+  // Three frequent values amid a lot of noise.
+  for (auto i = 0; i < 10'000; ++i) {
+    add(sketch, 1);
+    if (i % 2 == 0)
+      add(sketch, 2);
+    if (i % 4 == 0)
+      add(sketch, 3);
+    add(sketch, static_cast<int64_t>(r() % 100'000) + 100);
+  }
+  const auto top = sketch.top();
+  REQUIRE_EQUAL(top.size(), 3u);
+  CHECK_EQUAL(top[0].value, data{int64_t{1}});
+  CHECK_EQUAL(top[1].value, data{int64_t{2}});
+  CHECK_EQUAL(top[2].value, data{int64_t{3}});
+  CHECK_GREATER_EQUAL(top[0].count, 10'000u);
+}
+
+TEST(heavy hitters merge) {
+  auto x = unbox(heavy_hitters::make(2));
+  auto y = unbox(heavy_hitters::make(2));
+  add(x, 1, 100);
+  add(x, 2, 50);
+  add(y, 3, 120);
+  add(y, 2, 60);
+  REQUIRE(!x.merge(y));
+  const auto top = x.top();
+  REQUIRE_EQUAL(top.size(), 2u);
+  CHECK_EQUAL(top[0].value, data{int64_t{3}});
+  CHECK_EQUAL(top[1].value, data{int64_t{2}});
+  CHECK_GREATER_EQUAL(top[1].count, 110u);
+}
+
+TEST(heavy hitters serialization) {
+  auto x = unbox(heavy_hitters::make(2));
+  add(x, 1, 10);
+  add(x, 2, 20);
+  caf::byte_buffer buf;
+  REQUIRE(detail::serialize(buf, x));
+  auto y = heavy_hitters{};
+  REQUIRE(detail::legacy_deserialize(buf, y));
+  CHECK_EQUAL(x.top(), y.top());
+  // The positions of the deserialized heap must be intact.
+  add(y, 1, 15);
+  CHECK_EQUAL(y.top().front().value, data{int64_t{1}});
+}
@@ -0,0 +1,79 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/hyperloglog.hpp"
+
+#include "tenzir/detail/legacy_deserialize.hpp"
+#include "tenzir/detail/serialize.hpp"
+#include "tenzir/hash/hash.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <caf/test/dsl.hpp>
+
+#include <cmath>
+#include <random>
+
+using namespace tenzir;
+using namespace tenzir::sketch;
+
+namespace {
+
+auto relative_error(double estimate, double expected) -> double {
+  return std::abs(estimate - expected) / expected;
+}
+
+} // namespace
+
+TEST(hyperloglog invalid precision) {
+  CHECK(!hyperloglog::make(3));
+  CHECK(!hyperloglog::make(19));
+  CHECK(hyperloglog::make(4));
+}
+
+TEST(hyperloglog small cardinalities are exact) {
+  auto sketch = unbox(hyperloglog::make());
+  CHECK_EQUAL(sketch.estimate(), 0.0);
+  for (auto i = 0; i < 100; ++i) {
+    sketch.add(hash(i));
+    sketch.add(hash(i));
+  }
+  CHECK_EQUAL(std::round(sketch.estimate()), 100.0);
+}
+
+TEST(hyperloglog large cardinalities) {
+  auto sketch = unbox(hyperloglog::make());
+  std::mt19937_64 r{0};
+  for (auto i = 0; i < 1'000'000; ++i)
+    sketch.add(hash(r()));
+  // The standard error at precision 12 is about 1.6%.
+  CHECK_LESS(relative_error(sketch.estimate(), 1'000'000.0), 0.05);
+}
+
+TEST(hyperloglog merge) {
+  auto x = unbox(hyperloglog::make());
+  auto y = unbox(hyperloglog::make());
+  for (auto i = 0; i < 50'000; ++i)
+    x.add(hash(i));
+  for (auto i = 25'000; i < 75'000; ++i)
+    y.add(hash(i));
+  REQUIRE(!x.merge(y));
+  CHECK_LESS(relative_error(x.estimate(), 75'000.0), 0.05);
+  auto z = unbox(hyperloglog::make(10));
+  CHECK(x.merge(z));
+}
+
+TEST(hyperloglog serialization) {
+  auto x = unbox(hyperloglog::make());
+  for (auto i = 0; i < 10'000; ++i)
+    x.add(hash(i));
+  caf::byte_buffer buf;
+  REQUIRE(detail::serialize(buf, x));
+  auto y = hyperloglog{};
+  REQUIRE(detail::legacy_deserialize(buf, y));
+  CHECK_EQUAL(x.estimate(), y.estimate());
+}
@@ -0,0 +1,75 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/sketch/t_digest.hpp"
+
+#include "tenzir/detail/legacy_deserialize.hpp"
+#include "tenzir/detail/serialize.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <caf/test/dsl.hpp>
+
+#include <cmath>
+#include <random>
+
+using namespace tenzir;
+using namespace tenzir::sketch;
+
+TEST(t - digest invalid compression) {
+  CHECK(!t_digest::make(5.0));
+  CHECK(t_digest::make(10.0));
+}
+
+TEST(t - digest empty) {
+  auto digest = unbox(t_digest::make());
+  CHECK(!digest.quantile(0.5));
+  CHECK_EQUAL(digest.count(), 0.0);
+}
+
+TEST(t - digest uniform quantiles) {
+  auto digest = unbox(t_digest::make());
+  std::mt19937_64 r{0};
+  auto dist = std::uniform_real_distribution<double>{0.0, 1000.0};
+  for (auto i = 0; i < 100'000; ++i)
+    digest.add(dist(r));
+  CHECK_EQUAL(digest.count(), 100'000.0);
+  for (auto q : {0.01, 0.1, 0.5, 0.9, 0.99}) {
+    MESSAGE("quantile " << q);
+    const auto estimate = unbox(digest.quantile(q));
+    CHECK_LESS(std::abs(estimate - q * 1000.0), 10.0);
+  }
+  CHECK_LESS_EQUAL(unbox(digest.quantile(0.0)), unbox(digest.quantile(0.01)));
+  CHECK_GREATER_EQUAL(unbox(digest.quantile(1.0)),
+                      unbox(digest.quantile(0.99)));
+}
+
+TEST(t - digest merge) {
+  auto x = unbox(t_digest::make());
+  auto y = unbox(t_digest::make());
+  for (auto i = 0; i < 5'000; ++i)
+    x.add(i);
+  for (auto i = 5'000; i < 10'000; ++i)
+    y.add(i);
+  x.merge(y);
+  CHECK_EQUAL(x.count(), 10'000.0);
+  CHECK_LESS(std::abs(unbox(x.quantile(0.5)) - 5'000.0), 100.0);
+  CHECK_EQUAL(unbox(x.quantile(0.0)), 0.0);
+  CHECK_EQUAL(unbox(x.quantile(1.0)), 9'999.0);
+}
+
+TEST(t - digest serialization) {
+  auto x = unbox(t_digest::make());
+  for (auto i = 0; i < 1'000; ++i)
+    x.add(i);
+  caf::byte_buffer buf;
+  REQUIRE(detail::serialize(buf, x));
+  auto y = t_digest{};
+  REQUIRE(detail::legacy_deserialize(buf, y));
+  CHECK_EQUAL(x.count(), y.count());
+  CHECK_EQUAL(x.quantile(0.5), y.quantile(0.5));
+}
@@ -18,6 +18,7 @@
 #include "tenzir/expression.hpp"
 #include "tenzir/ids.hpp"
 #include "tenzir/project.hpp"
+#include "tenzir/series_builder.hpp"
 #include "tenzir/table_slice_column.hpp"
 #include "tenzir/table_slice_row.hpp"
 #include "tenzir/test/fixtures/table_slices.hpp"
@@ -623,4 +624,35 @@ TEST(unflatten - invalid field names) {
   CHECK_EQUAL(materialize(input.at(0, 3)), materialize(output.at(0, 3)));
 }
 
+TEST(unflatten - records in lists) {
+  auto b = series_builder{};
+  for (auto i = int64_t{0}; i < 2; ++i) {
+    auto row = b.record();
+    auto xs = row.field("xs").list();
+    xs.record().field("a.b").data(i);
+    xs.record().field("a.b").data(i + 10);
+    row.field("c.d").data(i + 20);
+  }
+  auto slices = b.finish_as_table_slice("test.unflatten");
+  REQUIRE_EQUAL(slices.size(), 1u);
+  auto unflatten = unflattener{"."};
+  auto output = unflatten(slices[0]);
+  REQUIRE_EQUAL(
+    output.schema(),
+    (type{"test.unflatten",
+          record_type{
+            {"xs", list_type{record_type{
+                     {"a", record_type{{"b", int64_type{}}}},
+                   }}},
+            {"c", record_type{{"d", int64_type{}}}},
+          }}));
+  REQUIRE_EQUAL(output.rows(), 2u);
+  CHECK_EQUAL(materialize(output.at(1, 0)),
+              (list{record{{"a", record{{"b", int64_t{1}}}}},
+                    record{{"a", record{{"b", int64_t{11}}}}}}));
+  CHECK_EQUAL(materialize(output.at(1, 1)), int64_t{21});
+  MESSAGE("subsequent table slices reuse the plan");
+  CHECK_EQUAL(unflatten(slices[0]), output);
+}
+
 FIXTURE_SCOPE_END()
@@ -0,0 +1,172 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/table_slice_transport.hpp"
+
+#include "tenzir/defaults.hpp"
+#include "tenzir/detail/legacy_deserialize.hpp"
+#include "tenzir/detail/serialize.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/test/fixtures/events.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <arrow/util/compression.h>
+
+using namespace tenzir;
+
+namespace {
+
+auto make_options(arrow::Compression::type compression, uint64_t coalesce_rows,
+                  uint64_t max_streams
+                  = defaults::pipeline_transport::max_streams)
+  -> table_slice_transport_options {
+  auto result = table_slice_transport_options{};
+  result.compression = compression;
+  result.coalesce_rows = coalesce_rows;
+  result.max_streams = max_streams;
+  return result;
+}
+
+auto roundtrip(table_slice_encoder& encoder, table_slice_decoder& decoder,
+               std::vector<table_slice> slices) -> std::vector<table_slice> {
+  auto frames = encoder.encode(std::move(slices));
+  REQUIRE_NOERROR(frames);
+  // Send the frames through CAF's serialization, just like it happens when
+  // pushing to an execution node in a different process.
+  auto buffer = caf::byte_buffer{};
+  REQUIRE(detail::serialize(buffer, *frames));
+  auto deserialized = std::vector<table_slice_frame>{};
+  REQUIRE(detail::legacy_deserialize(buffer, deserialized));
+  auto result = decoder.decode(std::move(deserialized));
+  REQUIRE_NOERROR(result);
+  return std::move(*result);
+}
+
+} // namespace
+
+FIXTURE_SCOPE(table_slice_transport_tests, fixtures::events)
+
+TEST(roundtrip without coalescing) {
+  auto encoder
+    = table_slice_encoder{make_options(arrow::Compression::UNCOMPRESSED, 0)};
+  auto decoder = table_slice_decoder{};
+  for (auto i = size_t{0}; i < 3; ++i) {
+    auto slices = std::vector<table_slice>{
+      zeek_conn_log[i],
+      zeek_dns_log[i],
+      zeek_http_log[i],
+    };
+    auto frames = encoder.encode(slices);
+    REQUIRE_NOERROR(frames);
+    REQUIRE_EQUAL(frames->size(), 3u);
+    for (const auto& frame : *frames) {
+      // The schema is only part of the first frame of every stream.
+      CHECK_EQUAL(static_cast<bool>(frame.schema), i == 0);
+    }
+    auto result = decoder.decode(std::move(*frames));
+    REQUIRE_NOERROR(result);
+    REQUIRE_EQUAL(result->size(), slices.size());
+    for (auto j = size_t{0}; j < slices.size(); ++j) {
+      CHECK_EQUAL((*result)[j].schema(), slices[j].schema());
+      CHECK_EQUAL((*result)[j], slices[j]);
+    }
+  }
+}
+
+TEST(roundtrip with coalescing and compression) {
+  for (auto compression :
+       {arrow::Compression::LZ4_FRAME, arrow::Compression::ZSTD}) {
+    if (not arrow::util::Codec::IsAvailable(compression)) {
+      continue;
+    }
+    auto encoder = table_slice_encoder{make_options(compression, 1'000)};
+    auto decoder = table_slice_decoder{};
+    auto slices = take(zeek_conn_log_full, 10);
+    auto result = roundtrip(encoder, decoder, slices);
+    CHECK_LESS(result.size(), slices.size());
+    CHECK_EQUAL(rows(result), rows(slices));
+    CHECK_EQUAL(concatenate(result), concatenate(slices));
+  }
+}
+
+TEST(coalescing keeps import times) {
+  auto encoder = table_slice_encoder{
+    make_options(arrow::Compression::UNCOMPRESSED, 1'000)};
+  auto decoder = table_slice_decoder{};
+  auto slices = take(zeek_conn_log_full, 4);
+  const auto t0 = time{} + std::chrono::seconds{1};
+  const auto t1 = time{} + std::chrono::seconds{2};
+  slices[0].import_time(t0);
+  slices[1].import_time(t0);
+  slices[2].import_time(t1);
+  slices[3].import_time(t0);
+  auto result = roundtrip(encoder, decoder, slices);
+  REQUIRE_EQUAL(result.size(), 3u);
+  CHECK_EQUAL(result[0].rows(), slices[0].rows() + slices[1].rows());
+  CHECK_EQUAL(result[0].import_time(), t0);
+  CHECK_EQUAL(result[1].import_time(), t1);
+  CHECK_EQUAL(result[2].import_time(), t0);
+  CHECK_EQUAL(concatenate(result), concatenate(slices));
+}
+
+TEST(max streams) {
+  auto encoder = table_slice_encoder{
+    make_options(arrow::Compression::UNCOMPRESSED, 0, 2)};
+  auto decoder = table_slice_decoder{};
+  const auto slices = std::vector<table_slice>{
+    zeek_conn_log[0], zeek_dns_log[0], zeek_conn_log[1],
+    zeek_http_log[0], zeek_dns_log[1], zeek_conn_log[2],
+  };
+  auto frames = encoder.encode(slices);
+  REQUIRE_NOERROR(frames);
+  REQUIRE_EQUAL(frames->size(), slices.size());
+  const auto& xs = *frames;
+  CHECK(not xs[0].evicted_stream);
+  CHECK(not xs[1].evicted_stream);
+  CHECK(not xs[2].schema);
+  MESSAGE("the http stream replaces the least recently used dns stream");
+  CHECK(xs[3].schema);
+  CHECK(xs[3].evicted_stream == xs[1].stream);
+  MESSAGE("the dns stream starts over and replaces the conn stream");
+  CHECK(xs[4].schema);
+  CHECK_NOT_EQUAL(xs[4].stream, xs[1].stream);
+  CHECK(xs[4].evicted_stream == xs[0].stream);
+  CHECK(xs[5].schema);
+  CHECK(xs[5].evicted_stream == xs[3].stream);
+  auto result = decoder.decode(std::move(*frames));
+  REQUIRE_NOERROR(result);
+  CHECK(*result == slices);
+  MESSAGE("the decoder closes evicted streams as well");
+  auto stale = table_slice_frame{};
+  stale.stream = xs[0].stream;
+  CHECK(not decoder.decode({stale}));
+}
+
+TEST(reset) {
+  auto encoder
+    = table_slice_encoder{make_options(arrow::Compression::UNCOMPRESSED, 0)};
+  auto decoder = table_slice_decoder{};
+  auto slices = take(zeek_conn_log, 2);
+  CHECK(roundtrip(encoder, decoder, slices) == slices);
+  encoder.reset();
+  auto frames = encoder.encode(slices);
+  REQUIRE_NOERROR(frames);
+  REQUIRE_EQUAL(frames->size(), 2u);
+  CHECK(frames->front().schema);
+  CHECK(not frames->back().schema);
+  auto result = decoder.decode(std::move(*frames));
+  REQUIRE_NOERROR(result);
+  CHECK(*result == slices);
+  MESSAGE("decoding a frame of an unknown stream fails");
+  auto fresh_decoder = table_slice_decoder{};
+  auto more_frames = encoder.encode(slices);
+  REQUIRE_NOERROR(more_frames);
+  CHECK(not fresh_decoder.decode(std::move(*more_frames)));
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,223 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/diagnostics.hpp"
+#include "tenzir/generator.hpp"
+#include "tenzir/operator_control_plane.hpp"
+#include "tenzir/pipeline.hpp"
+#include "tenzir/series_builder.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/test/test.hpp"
+
+#include <string_view>
+#include <vector>
+
+using namespace tenzir;
+using namespace std::string_literals;
+
+namespace {
+
+struct fixture {
+  struct mock_control_plane final : operator_control_plane {
+    auto self() noexcept -> exec_node_actor::base& override {
+      FAIL("no mock implementation available");
+    }
+
+    auto node() noexcept -> node_actor override {
+      FAIL("no mock implementation available");
+    }
+
+    auto abort(caf::error error) noexcept -> void override {
+      FAIL("unexpected abort: " << error);
+    }
+
+    auto warn(caf::error) noexcept -> void override {
+      FAIL("no mock implementation available");
+    }
+
+    auto emit(table_slice) noexcept -> void override {
+      FAIL("no mock implementation available");
+    }
+
+    [[nodiscard]] auto schemas() const noexcept
+      -> const std::vector<type>& override {
+      FAIL("no mock implementation available");
+    }
+
+    [[nodiscard]] auto concepts() const noexcept
+      -> const concepts_map& override {
+      FAIL("no mock implementation available");
+    }
+
+    auto diagnostics() noexcept -> diagnostic_handler& override {
+      return diag;
+    }
+
+    auto allow_unsafe_pipelines() const noexcept -> bool override {
+      return false;
+    }
+
+    auto has_terminal() const noexcept -> bool override {
+      return false;
+    }
+
+    collecting_diagnostic_handler diag;
+  };
+
+  /// Creates a slice with a given schema name from rows with equal fields.
+  static auto make_slice(std::string_view name, const std::vector<record>& rows)
+    -> table_slice {
+    auto b = series_builder{};
+    for (const auto& row : rows) {
+      b.data(row);
+    }
+    auto result = b.finish_as_table_slice(name);
+    REQUIRE_EQUAL(result.size(), 1u);
+    return result[0];
+  }
+
+  /// Creates rows with a single field `x`.
+  static auto xs(std::vector<int64_t> values) -> std::vector<record> {
+    auto result = std::vector<record>{};
+    for (auto value : values) {
+      result.push_back(record{{"x", value}});
+    }
+    return result;
+  }
+
+  static auto from(std::vector<table_slice> slices) -> generator<table_slice> {
+    for (auto& slice : slices) {
+      co_yield std::move(slice);
+    }
+  }
+
+  /// Runs the input through a `unique` operator and returns all non-empty
+  /// output slices.
+  auto run(std::string_view definition, generator<table_slice> input)
+    -> std::vector<table_slice> {
+    auto op = unbox(pipeline::internal_parse_as_operator(definition));
+    auto output = unbox(op->instantiate(std::move(input), control_plane));
+    auto* slices = std::get_if<generator<table_slice>>(&output);
+    REQUIRE(slices);
+    auto result = std::vector<table_slice>{};
+    for (auto&& slice : *slices) {
+      if (slice.rows() > 0) {
+        result.push_back(std::move(slice));
+      }
+    }
+    return result;
+  }
+
+  /// Returns the values of a field across all slices, or null for slices that
+  /// do not have the field.
+  static auto column(const std::vector<table_slice>& slices,
+                     std::string_view field) -> std::vector<data> {
+    auto result = std::vector<data>{};
+    for (const auto& slice : slices) {
+      const auto& schema = caf::get<record_type>(slice.schema());
+      const auto index = schema.resolve_key(field);
+      for (size_t row = 0; row < slice.rows(); ++row) {
+        result.push_back(
+          index ? materialize(slice.at(row, schema.flat_index(*index)))
+                : data{});
+      }
+    }
+    return result;
+  }
+
+  auto num_warnings() -> size_t {
+    return std::move(control_plane.diag).collect().size();
+  }
+
+  mock_control_plane control_plane;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(unique_tests, fixture)
+
+TEST(global removes all duplicates) {
+  const auto output = run("unique --global",
+                          from({
+                            make_slice("a", xs({1, 1})),
+                            make_slice("a", xs({2, 1})),
+                            make_slice("a", xs({2, 3})),
+                          }));
+  CHECK_EQUAL(column(output, "x"),
+              (std::vector<data>{int64_t{1}, int64_t{2}, int64_t{3}}));
+}
+
+TEST(global compares pruned schemas) {
+  // The schema name does not matter, but the field types do.
+  const auto output = run("unique --global",
+                          from({
+                            make_slice("a", xs({1})),
+                            make_slice("b", xs({1, 2})),
+                            make_slice("c", {record{{"x", "1"s}}}),
+                          }));
+  CHECK_EQUAL(column(output, "x"),
+              (std::vector<data>{int64_t{1}, int64_t{2}, "1"s}));
+}
+
+TEST(global merges runs of new rows) {
+  const auto output = run("unique --global",
+                          from({
+                            make_slice("a", xs({1, 1, 2, 1, 3})),
+                            make_slice("a", xs({4, 5})),
+                          }));
+  // The new rows of the first slice form a single output slice, and the
+  // second slice passes through unchanged.
+  REQUIRE_EQUAL(output.size(), 2u);
+  CHECK_EQUAL(output[0].rows(), 3u);
+  CHECK_EQUAL(output[1].rows(), 2u);
+  CHECK_EQUAL(column(output, "x"),
+              (std::vector<data>{int64_t{1}, int64_t{2}, int64_t{3},
+                                 int64_t{4}, int64_t{5}}));
+}
+
+TEST(fields across schemas) {
+  // A missing field counts as null, so keys match across schemas.
+  const auto a = make_slice("a", {
+                                   record{{"x", int64_t{1}}, {"y", caf::none}},
+                                   record{{"x", int64_t{2}}, {"y", "foo"s}},
+                                 });
+  const auto output = run("unique --global --fields x,y",
+                          from({
+                            a,
+                            make_slice("b", xs({1, 2, 3})),
+                            make_slice("b", xs({3})),
+                          }));
+  CHECK_EQUAL(column(output, "x"),
+              (std::vector<data>{int64_t{1}, int64_t{2}, int64_t{2},
+                                 int64_t{3}}));
+  CHECK_EQUAL(column(output, "y"),
+              (std::vector<data>{caf::none, "foo"s, caf::none, caf::none}));
+  // We warn once per schema that lacks a field.
+  CHECK_EQUAL(num_warnings(), 1u);
+}
+
+TEST(max size evicts the least recently seen key) {
+  const auto output = run("unique --global --max-size 2",
+                          from({
+                            make_slice("a", xs({1, 2, 3, 1})),
+                            make_slice("a", xs({3, 2})),
+                          }));
+  CHECK_EQUAL(column(output, "x"),
+              (std::vector<data>{int64_t{1}, int64_t{2}, int64_t{3},
+                                 int64_t{1}, int64_t{2}}));
+}
+
+TEST(options require global) {
+  CHECK_ERROR(pipeline::internal_parse("unique --fields x"));
+  CHECK_ERROR(pipeline::internal_parse("unique --max-size 1"));
+  CHECK_ERROR(pipeline::internal_parse("unique --ttl 1s"));
+  CHECK_ERROR(pipeline::internal_parse("unique --global --max-size 0"));
+  CHECK_ERROR(pipeline::internal_parse("unique --global --fields x,,y"));
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,211 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/concept/parseable/tenzir/time.hpp"
+#include "tenzir/concept/parseable/to.hpp"
+#include "tenzir/diagnostics.hpp"
+#include "tenzir/operator_control_plane.hpp"
+#include "tenzir/plugin.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/test/test.hpp"
+#include "tenzir/tql/parser.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace tenzir;
+using namespace std::string_literals;
+
+namespace {
+
+struct fixture {
+  struct mock_control_plane final : operator_control_plane {
+    auto self() noexcept -> exec_node_actor::base& override {
+      FAIL("no mock implementation available");
+    }
+
+    auto node() noexcept -> node_actor override {
+      FAIL("no mock implementation available");
+    }
+
+    auto abort(caf::error error) noexcept -> void override {
+      FAIL("unexpected abort: " << error);
+    }
+
+    auto warn(caf::error) noexcept -> void override {
+      ++warnings;
+    }
+
+    auto emit(table_slice) noexcept -> void override {
+      FAIL("no mock implementation available");
+    }
+
+    [[nodiscard]] auto schemas() const noexcept
+      -> const std::vector<type>& override {
+      FAIL("no mock implementation available");
+    }
+
+    [[nodiscard]] auto concepts() const noexcept
+      -> const concepts_map& override {
+      FAIL("no mock implementation available");
+    }
+
+    auto diagnostics() noexcept -> diagnostic_handler& override {
+      static auto diag = null_diagnostic_handler{};
+      return diag;
+    }
+
+    auto allow_unsafe_pipelines() const noexcept -> bool override {
+      return false;
+    }
+
+    auto has_terminal() const noexcept -> bool override {
+      return false;
+    }
+
+    size_t warnings = 0;
+  };
+
+  /// Parses CSV input and returns all events.
+  auto parse(std::string input) -> std::vector<table_slice> {
+    const auto* plugin = plugins::find<parser_parser_plugin>("csv");
+    REQUIRE(plugin);
+    auto diag = null_diagnostic_handler{};
+    auto p = tql::make_parser_interface("", diag);
+    auto parser = plugin->parse_parser(*p);
+    auto gen = parser->instantiate(
+      [](std::string input) -> generator<chunk_ptr> {
+        co_yield chunk::copy(input);
+      }(std::move(input)),
+      control_plane);
+    REQUIRE(gen);
+    auto result = std::vector<table_slice>{};
+    for (auto&& slice : *gen) {
+      if (slice.rows() > 0) {
+        result.push_back(std::move(slice));
+      }
+    }
+    return result;
+  }
+
+  /// Returns the values of a column across all slices.
+  static auto column(const std::vector<table_slice>& slices, size_t index)
+    -> std::vector<data> {
+    auto result = std::vector<data>{};
+    for (const auto& slice : slices) {
+      for (size_t row = 0; row < slice.rows(); ++row) {
+        result.push_back(materialize(slice.at(row, index)));
+      }
+    }
+    return result;
+  }
+
+  mock_control_plane control_plane;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(xsv_parser_tests, fixture)
+
+TEST(quoted fields) {
+  const auto slices = parse("a,b\n"
+                            "\"x,y\",1\n"
+                            "\"say \\\"hi\\\"\",2\n"
+                            "\"1\",3\n"
+                            "z\"quoted\",4\n");
+  CHECK_EQUAL(column(slices, 0),
+              (std::vector<data>{"x,y"s, "say \"hi\""s, uint64_t{1},
+                                 "z\"quoted\""s}));
+  CHECK_EQUAL(column(slices, 1),
+              (std::vector<data>{uint64_t{1}, uint64_t{2}, uint64_t{3},
+                                 uint64_t{4}}));
+  CHECK_EQUAL(control_plane.warnings, 0u);
+}
+
+TEST(invalid lines) {
+  // Empty fields and a wrong number of fields skip the line with a warning.
+  // An unterminated quote is part of an unquoted field.
+  const auto slices = parse("a,b\n"
+                            "1,\n"
+                            ",2\n"
+                            "\"x,3\n"
+                            "4,5,6\n"
+                            "7,8\n");
+  CHECK_EQUAL(column(slices, 0), (std::vector<data>{"\"x"s, uint64_t{7}}));
+  CHECK_EQUAL(column(slices, 1), (std::vector<data>{uint64_t{3}, uint64_t{8}}));
+  CHECK_EQUAL(control_plane.warnings, 3u);
+}
+
+TEST(typed columns) {
+  const auto slices = parse("b,u,i,r,d,t,a,n\n"
+                            "true,1,-1,1.5,5s,2023-01-01,10.0.0.1,10.0.0.0/8\n"
+                            "false,2,-2,-0.5,1h,2023-01-02,::1,::/0\n");
+  REQUIRE_EQUAL(slices.size(), 1u);
+  const auto& layout = caf::get<record_type>(slices[0].schema());
+  CHECK_EQUAL(layout.field(0).type, type{bool_type{}});
+  CHECK_EQUAL(layout.field(1).type, type{uint64_type{}});
+  CHECK_EQUAL(layout.field(2).type, type{int64_type{}});
+  CHECK_EQUAL(layout.field(3).type, type{double_type{}});
+  CHECK_EQUAL(layout.field(4).type, type{duration_type{}});
+  CHECK_EQUAL(layout.field(5).type, type{time_type{}});
+  CHECK_EQUAL(layout.field(6).type, type{ip_type{}});
+  CHECK_EQUAL(layout.field(7).type, type{subnet_type{}});
+  CHECK_EQUAL(column(slices, 3), (std::vector<data>{1.5, -0.5}));
+  CHECK_EQUAL(column(slices, 5),
+              (std::vector<data>{unbox(to<time>("2023-01-01")),
+                                 unbox(to<time>("2023-01-02"))}));
+}
+
+TEST(mixed columns) {
+  // Every value gets the type that the generic data parser infers for it,
+  // regardless of the type of the previous value in the column.
+  const auto slices = parse("x\n"
+                            "5\n"
+                            "-1\n"
+                            "6\n"
+                            "1.5\n"
+                            "2\n"
+                            "1e5\n"
+                            "-3\n"
+                            "-3.5\n"
+                            "true\n"
+                            "7\n");
+  CHECK_EQUAL(column(slices, 0),
+              (std::vector<data>{uint64_t{5}, int64_t{-1}, uint64_t{6}, 1.5,
+                                 uint64_t{2}, "1e5"s, int64_t{-3}, -3.5,
+                                 true, uint64_t{7}}));
+  CHECK_EQUAL(control_plane.warnings, 0u);
+}
+
+TEST(type change after a string) {
+  // A value that is not of any other type does not turn the rest of the
+  // column into strings.
+  const auto slices = parse("x,y\n"
+                            "1,foo\n"
+                            "n/a,bar\n"
+                            "2,3\n"
+                            "3,baz\n");
+  CHECK_EQUAL(column(slices, 0), (std::vector<data>{uint64_t{1}, "n/a"s,
+                                                    uint64_t{2}, uint64_t{3}}));
+  CHECK_EQUAL(column(slices, 1),
+              (std::vector<data>{"foo"s, "bar"s, uint64_t{3}, "baz"s}));
+  CHECK_EQUAL(control_plane.warnings, 0u);
+}
+
+TEST(null values) {
+  // Nulls leave the type of the column unchanged.
+  const auto slices = parse("x\n"
+                            "-1\n"
+                            "null\n"
+                            "-2\n");
+  CHECK_EQUAL(column(slices, 0),
+              (std::vector<data>{int64_t{-1}, caf::none, int64_t{-2}}));
+}
+
+FIXTURE_SCOPE_END()
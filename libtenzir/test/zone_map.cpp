@@ -0,0 +1,139 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tenzir/zone_map.hpp"
+
+#include "tenzir/concept/parseable/tenzir/expression.hpp"
+#include "tenzir/concept/parseable/tenzir/time.hpp"
+#include "tenzir/concept/parseable/to.hpp"
+#include "tenzir/expression.hpp"
+#include "tenzir/ids.hpp"
+#include "tenzir/table_slice.hpp"
+#include "tenzir/table_slice_builder.hpp"
+#include "tenzir/test/test.hpp"
+#include "tenzir/type.hpp"
+
+#include <flatbuffers/flatbuffers.h>
+
+using namespace tenzir;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    using namespace std::string_view_literals;
+    // The first slice contains small numbers and timestamps in 1970, the
+    // second slice contains large numbers, only nulls for y, and timestamps
+    // in 2023.
+    auto early = time{} + std::chrono::hours{1};
+    auto late = unbox(to<time>("2023-01-01"));
+    auto builder = table_slice_builder{schema};
+    REQUIRE(builder.add(int64_t{1}, 1.0, early, "foo"sv));
+    REQUIRE(builder.add(int64_t{5}, 2.0, early, "bar"sv));
+    REQUIRE(builder.add(int64_t{3}, caf::none, early, "baz"sv));
+    slices.push_back(builder.finish());
+    slices.back().offset(0);
+    REQUIRE(builder.add(int64_t{10}, caf::none, late, "foo"sv));
+    REQUIRE(builder.add(int64_t{20}, caf::none, late, "bar"sv));
+    REQUIRE(builder.add(caf::none, caf::none, late, "baz"sv));
+    slices.push_back(builder.finish());
+    slices.back().offset(3);
+    for (const auto& slice : slices)
+      zone_maps.push_back(make_zone_map(slice));
+  }
+
+  expression make_expr(std::string_view str) const {
+    return unbox(tailor(unbox(to<expression>(str)), schema));
+  }
+
+  std::string may_match(std::string_view str) const {
+    auto expr = make_expr(str);
+    auto result = std::string{};
+    for (const auto& zone_map : zone_maps)
+      result += zone_map.may_match(expr) ? '1' : '0';
+    return result;
+  }
+
+  type schema = type{
+    "test.zone",
+    record_type{
+      {"x", int64_type{}},
+      {"y", double_type{}},
+      {"ts", time_type{}},
+      {"s", string_type{}},
+    },
+  };
+  std::vector<table_slice> slices;
+  std::vector<zone_map> zone_maps;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(zone_map_tests, fixture)
+
+TEST(zone map construction) {
+  const auto& zm = zone_maps[0];
+  CHECK_EQUAL(zm.offset, 0u);
+  CHECK_EQUAL(zm.rows, 3u);
+  // Strings have no zone map.
+  REQUIRE_EQUAL(zm.columns.size(), 3u);
+  CHECK_EQUAL(zm.columns[0].column, 0u);
+  CHECK_EQUAL(zm.columns[0].min, data{int64_t{1}});
+  CHECK_EQUAL(zm.columns[0].max, data{int64_t{5}});
+  CHECK_EQUAL(zm.columns[0].null_count, 0u);
+  CHECK_EQUAL(zm.columns[1].min, data{1.0});
+  CHECK_EQUAL(zm.columns[1].max, data{2.0});
+  CHECK_EQUAL(zm.columns[1].null_count, 1u);
+  MESSAGE("columns with only nulls have no range");
+  CHECK_EQUAL(zone_maps[1].columns[1].min, data{});
+  CHECK_EQUAL(zone_maps[1].columns[1].null_count, 3u);
+}
+
+TEST(zone map lookup) {
+  CHECK_EQUAL(may_match("x > 5"), "01");
+  CHECK_EQUAL(may_match("x >= 5"), "11");
+  CHECK_EQUAL(may_match("x == 2"), "10");
+  CHECK_EQUAL(may_match("x < -1"), "00");
+  CHECK_EQUAL(may_match("x > 5.5"), "01");
+  CHECK_EQUAL(may_match("x in [4, 30]"), "10");
+  CHECK_EQUAL(may_match("x == null"), "01");
+  CHECK_EQUAL(may_match("x != null"), "11");
+  CHECK_EQUAL(may_match("y > 0.0"), "10");
+  CHECK_EQUAL(may_match("ts < 2018-07-04"), "10");
+  CHECK_EQUAL(may_match("x > 5 && ts < 2018-07-04"), "00");
+  CHECK_EQUAL(may_match("x > 5 || ts < 2018-07-04"), "11");
+  MESSAGE("predicates without zone maps always match");
+  CHECK_EQUAL(may_match("s == \"qux\""), "11");
+  CHECK_EQUAL(may_match("#schema == \"test.zone\""), "11");
+}
+
+TEST(zone map pruning) {
+  auto expr = make_expr("x > 5");
+  CHECK_EQUAL(prune(zone_maps, expr, ids{}), make_ids({{3, 6}}));
+  auto selection = make_ids({{1, 2}, {4, 5}}, 6);
+  CHECK_EQUAL(prune(zone_maps, expr, selection), make_ids({{4, 5}}, 6));
+  MESSAGE("selections remain untouched if no table slice is ruled out");
+  expr = make_expr("x > 0");
+  CHECK_EQUAL(prune(zone_maps, expr, ids{}), ids{});
+  CHECK_EQUAL(prune(zone_maps, expr, selection), selection);
+}
+
+TEST(zone map serialization) {
+  for (const auto& zm : zone_maps) {
+    auto builder = flatbuffers::FlatBufferBuilder{};
+    builder.Finish(pack(builder, zm));
+    const auto* fb = flatbuffers::GetRoot<fbs::partition::detail::ZoneMap>(
+      builder.GetBufferPointer());
+    REQUIRE(fb);
+    auto result = zone_map{};
+    REQUIRE_EQUAL(unpack(*fb, result), caf::none);
+    CHECK(result == zm);
+  }
+}
+
+FIXTURE_SCOPE_END()
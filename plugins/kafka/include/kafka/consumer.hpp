@@ -34,6 +34,16 @@ public:
   /// Consumes a message, blocking for a given maximum timeout.
   auto consume(std::chrono::milliseconds timeout) -> caf::expected<chunk_ptr>;
 
+  /// Consumes a message, blocking for a given maximum timeout. Unlike
+  /// `consume`, this returns the message itself, which also carries the topic
+  /// partition it originates from, and does not translate errors.
+  auto consume_message(std::chrono::milliseconds timeout)
+    -> std::unique_ptr<RdKafka::Message>;
+
+  /// Returns the number of topic partitions currently assigned to the
+  /// consumer.
+  auto num_assigned_partitions() const -> caf::expected<size_t>;
+
 private:
   consumer() = default;
 
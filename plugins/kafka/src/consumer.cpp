@@ -56,4 +56,22 @@ auto consumer::consume(std::chrono::milliseconds timeout)
   return result;
 }
 
+auto consumer::consume_message(std::chrono::milliseconds timeout)
+  -> std::unique_ptr<RdKafka::Message> {
+  auto ms = detail::narrow_cast<int>(timeout.count());
+  return std::unique_ptr<RdKafka::Message>{consumer_->consume(ms)};
+}
+
+auto consumer::num_assigned_partitions() const -> caf::expected<size_t> {
+  auto partitions = std::vector<RdKafka::TopicPartition*>{};
+  auto result = consumer_->assignment(partitions);
+  auto num_partitions = partitions.size();
+  RdKafka::TopicPartition::destroy(partitions);
+  if (result != RdKafka::ERR_NO_ERROR)
+    return caf::make_error(ec::unspecified,
+                           fmt::format("failed to get partition assignment: {}",
+                                       RdKafka::err2str(result)));
+  return num_partitions;
+}
+
 } // namespace tenzir::plugins::kafka
@@ -28,6 +28,10 @@
 #include <charconv>
 #include <chrono>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -38,6 +42,12 @@ namespace {
 // Default topic if the user doesn't provide one.
 constexpr auto default_topic = "tenzir";
 
+// The size at which the loader hands out coalesced messages.
+constexpr auto max_chunk_size = size_t{1} << 20;
+
+// The maximum time the loader coalesces messages before handing them out.
+constexpr auto max_chunk_delay = 100ms;
+
 // Valid values:
 // - beginning | end | stored
 // - <value>  (absolute offset)
@@ -66,6 +76,33 @@ auto offset_parser() {
   return beginning | end | stored | value;
 }
 
+// Applies a comma-separated list of librdkafka options of the form
+// `key=value`, as passed via `-X`, to a configuration.
+auto set_options(configuration& cfg, std::string_view options) -> caf::error {
+  auto kvps = std::vector<std::pair<std::string, std::string>>{};
+  if (!parsers::kvp_list(options, kvps))
+    return caf::make_error(ec::parse_error, "invalid list of key=value pairs");
+  for (const auto& [key, value] : kvps) {
+    TENZIR_INFO("providing librdkafka option {}={}", key, value);
+    if (auto err = cfg.set(key, value))
+      return caf::make_error(ec::invalid_configuration,
+                             fmt::format("failed to set librdkafka option "
+                                         "{}={}: {}",
+                                         key, value, err));
+  }
+  return {};
+}
+
+// Checks the `-X` argument of the loader and the saver at parse time.
+auto check_options(const std::optional<located<std::string>>& options)
+  -> void {
+  auto kvps = std::vector<std::pair<std::string, std::string>>{};
+  if (options && !parsers::kvp_list(options->inner, kvps))
+    diagnostic::error("invalid list of key=value pairs")
+      .primary(options->source)
+      .throw_();
+}
+
 struct loader_args {
   std::optional<located<std::string>> topic;
   std::optional<located<size_t>> count;
@@ -126,25 +163,12 @@ public:
     }
     // Override configuration with arguments.
     if (args_.options) {
-      std::vector<std::pair<std::string, std::string>> options;
-      if (!parsers::kvp_list(args_.options->inner, options)) {
-        ctrl.diagnostics().emit(
-          diagnostic::error("invalid list of key=value pairs")
-            .primary(args_.options->source)
-            .done());
+      if (auto err = set_options(*cfg, args_.options->inner)) {
+        ctrl.diagnostics().emit(diagnostic::error("{}", err)
+                                  .primary(args_.options->source)
+                                  .done());
         return {};
       }
-      for (const auto& [key, value] : options) {
-        TENZIR_INFO("providing librdkafka option {}={}", key, value);
-        if (auto err = cfg->set(key, value)) {
-          ctrl.diagnostics().emit(
-            diagnostic::error("failed to set librdkafka option {}={}: {}", key,
-                              value, err)
-              .primary(args_.options->source)
-              .done());
-          return {};
-        }
-      }
     }
     // Create the consumer.
     if (auto value = cfg->get("bootstrap.servers")) {
@@ -168,23 +192,65 @@ public:
     auto make
       = [](loader_args args, consumer client) mutable -> generator<chunk_ptr> {
       auto num_messages = size_t{0};
+      // Kafka messages tend to be small, so we coalesce all messages that are
+      // readily available into larger chunks instead of yielding one chunk
+      // per message. We pass on the payloads as they are and leave the framing
+      // to the parser, which may also read binary formats.
+      auto buffer = std::string{};
+      auto buffer_start = std::chrono::steady_clock::time_point{};
+      auto flush = [&] {
+        return chunk::make(std::exchange(buffer, {}));
+      };
+      // The partitions that reached their end. We can only exit once all
+      // assigned partitions are exhausted.
+      auto eof_partitions = std::unordered_set<int32_t>{};
       while (true) {
-        auto msg = client.consume(500ms);
-        if (!msg) {
-          co_yield {};
-          if (msg.error() == ec::timeout)
+        // Only block for new messages if we have nothing to hand out.
+        auto msg = client.consume_message(buffer.empty() ? 500ms : 0ms);
+        switch (msg->err()) {
+          case RdKafka::ERR_NO_ERROR:
+            break;
+          case RdKafka::ERR__TIMED_OUT:
+            co_yield buffer.empty() ? chunk_ptr{} : flush();
             continue;
-          if (msg.error() == ec::end_of_input)
-            // FIXME: currently doesn't work for N partitions with N > 1.
-            // Upgrade to a counter and only break out of the loop once this
-            // signal has been received N times.
+          case RdKafka::ERR__PARTITION_EOF: {
+            eof_partitions.insert(msg->partition());
+            auto num_partitions = client.num_assigned_partitions();
+            if (!num_partitions) {
+              TENZIR_ERROR(num_partitions.error());
+              break;
+            }
+            if (eof_partitions.size() < *num_partitions) {
+              co_yield buffer.empty() ? chunk_ptr{} : flush();
+              continue;
+            }
+            TENZIR_DEBUG("kafka reached the end of all {} partitions",
+                         *num_partitions);
+            break;
+          }
+          default:
+            TENZIR_ERROR("failed to consume message: {} ({})", msg->errstr(),
+                         static_cast<int>(msg->err()));
             break;
-          TENZIR_ERROR(msg.error());
-          break;
         }
-        co_yield *msg;
-        if (args.count && args.count->inner == ++num_messages)
-          break;
+        if (msg->err() != RdKafka::ERR_NO_ERROR) {
+          if (!buffer.empty())
+            co_yield flush();
+          co_return;
+        }
+        eof_partitions.erase(msg->partition());
+        if (buffer.empty())
+          buffer_start = std::chrono::steady_clock::now();
+        buffer.append(static_cast<const char*>(msg->payload()), msg->len());
+        if (args.count && args.count->inner == ++num_messages) {
+          if (!buffer.empty())
+            co_yield flush();
+          co_return;
+        }
+        if (buffer.size() >= max_chunk_size
+            || std::chrono::steady_clock::now() - buffer_start
+                 >= max_chunk_delay)
+          co_yield flush();
       }
     };
     return make(args_, std::move(*client));
@@ -227,13 +293,15 @@ struct saver_args {
   std::optional<located<std::string>> topic;
   std::optional<located<std::string>> key;
   std::optional<located<std::string>> timestamp;
+  std::optional<located<std::string>> options;
 
   template <class Inspector>
   friend auto inspect(Inspector& f, saver_args& x) -> bool {
     return f.object(x)
       .pretty_name("saver_args")
       .fields(f.field("topic", x.topic), f.field("key", x.key),
-              f.field("timestamp", x.timestamp));
+              f.field("timestamp", x.timestamp),
+              f.field("options", x.options));
   }
 };
 
@@ -252,6 +320,13 @@ public:
       TENZIR_ERROR("kafka failed to create configuration: {}", cfg.error());
       return cfg.error();
     };
+    // Override configuration with arguments. This is where users tune the
+    // batching of the producer, e.g., via `linger.ms`, `batch.size`, and
+    // `compression.type`.
+    if (args_.options) {
+      if (auto err = set_options(*cfg, args_.options->inner))
+        return err;
+    }
     if (auto value = cfg->get("bootstrap.servers")) {
       TENZIR_INFO("kafka connects to broker: {}", *value);
     }
@@ -346,6 +421,7 @@ public:
     // We use -X because that's standard in Kafka applications, cf. kcat.
     parser.add("-X,--set", args.options, "<key=value>,...");
     parser.parse(p);
+    check_options(args.options);
     if (args.offset) {
       if (!offset_parser()(args.offset->inner))
         diagnostic::error("invalid `--offset` value")
@@ -366,7 +442,9 @@ public:
     parser.add("-t,--topic", args.topic, "<topic>");
     parser.add("-k,--key", args.key, "<key>");
     parser.add("-T,--timestamp", args.timestamp, "<time>");
+    parser.add("-X,--set", args.options, "<key=value>,...");
     parser.parse(p);
+    check_options(args.options);
     if (args.timestamp)
       if (!parsers::time(args.timestamp->inner))
         diagnostic::error("could not parse `--timestamp` as time")
@@ -0,0 +1,205 @@
+//    _   _____   __________
+//   | | / / _ | / __/_  __/     Visibility
+//   | |/ / __ |_\ \  / /          Across
+//   |___/_/ |_/___/ /_/       Space and Time
+//
+// SPDX-FileCopyrightText: (c) 2023 The Tenzir Contributors
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <tenzir/chunk.hpp>
+#include <tenzir/diagnostics.hpp>
+#include <tenzir/plugin.hpp>
+#include <tenzir/test/test.hpp>
+#include <tenzir/tql/parser.hpp>
+
+#include <fmt/format.h>
+#include <librdkafka/rdkafka.h>
+#include <librdkafka/rdkafka_mock.h>
+
+#include <string>
+#include <string_view>
+
+using namespace tenzir;
+using namespace std::string_literals;
+
+namespace {
+
+// The tests run against the mock cluster of librdkafka, which lives inside of
+// a client handle and needs no running broker.
+struct fixture {
+  struct mock_control_plane final : operator_control_plane {
+    auto self() noexcept -> exec_node_actor::base& override {
+      FAIL("no mock implementation available");
+    }
+
+    auto node() noexcept -> node_actor override {
+      FAIL("no mock implementation available");
+    }
+
+    auto abort(caf::error error) noexcept -> void override {
+      FAIL("unexpected abort: " << error);
+    }
+
+    auto warn([[maybe_unused]] caf::error warning) noexcept -> void override {
+      FAIL("no mock implementation available");
+    }
+
+    auto emit([[maybe_unused]] table_slice metrics) noexcept -> void override {
+      FAIL("no mock implementation available");
+    }
+
+    [[nodiscard]] auto schemas() const noexcept
+      -> const std::vector<type>& override {
+      FAIL("no mock implementation available");
+    }
+
+    [[nodiscard]] auto concepts() const noexcept
+      -> const concepts_map& override {
+      FAIL("no mock implementation available");
+    }
+
+    auto diagnostics() noexcept -> diagnostic_handler& override {
+      static auto diag = null_diagnostic_handler{};
+      return diag;
+    }
+
+    auto allow_unsafe_pipelines() const noexcept -> bool override {
+      return false;
+    }
+
+    auto has_terminal() const noexcept -> bool override {
+      return false;
+    }
+  };
+
+  static constexpr auto topic = "test";
+  static constexpr auto num_partitions = 3;
+
+  fixture() {
+    auto* conf = rd_kafka_conf_new();
+    char error[512];
+    REQUIRE(rd_kafka_conf_set(conf, "test.mock.num.brokers", "1", error,
+                              sizeof(error))
+            == RD_KAFKA_CONF_OK);
+    producer = rd_kafka_new(RD_KAFKA_PRODUCER, conf, error, sizeof(error));
+    REQUIRE(producer);
+    auto* cluster = rd_kafka_handle_mock_cluster(producer);
+    REQUIRE(cluster);
+    bootstrap_servers = rd_kafka_mock_cluster_bootstraps(cluster);
+    REQUIRE(rd_kafka_mock_topic_create(cluster, topic, num_partitions, 1)
+            == RD_KAFKA_RESP_ERR_NO_ERROR);
+  }
+
+  ~fixture() {
+    rd_kafka_destroy(producer);
+  }
+
+  /// Writes a message to a given partition of the test topic.
+  void produce(int32_t partition, std::string_view payload) {
+    auto err = rd_kafka_producev(
+      producer, RD_KAFKA_V_TOPIC(topic), RD_KAFKA_V_PARTITION(partition),
+      RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY),
+      RD_KAFKA_V_VALUE(const_cast<char*>(payload.data()), payload.size()),
+      RD_KAFKA_V_END);
+    REQUIRE(err == RD_KAFKA_RESP_ERR_NO_ERROR);
+    REQUIRE(rd_kafka_flush(producer, 10'000) == RD_KAFKA_RESP_ERR_NO_ERROR);
+  }
+
+  /// Returns the arguments that connect the connector to the mock cluster.
+  auto connect(std::string_view options, std::string_view args = {})
+    -> std::string {
+    return fmt::format("-t {} -X bootstrap.servers={}{} {}", topic,
+                       bootstrap_servers, options, args);
+  }
+
+  /// Runs the loader and concatenates everything it yields.
+  auto load(std::string_view args) -> std::string {
+    const auto* plugin = plugins::find<loader_parser_plugin>("kafka");
+    REQUIRE(plugin);
+    auto diag = null_diagnostic_handler{};
+    // Every load uses its own consumer group, so that no committed offsets of
+    // a previous load interfere.
+    auto p = tql::make_parser_interface(
+      connect(fmt::format(",group.id=test-{}", ++num_groups), args), diag);
+    auto loader = plugin->parse_loader(*p);
+    auto gen = loader->instantiate(control_plane);
+    REQUIRE(gen);
+    auto result = std::string{};
+    for (auto&& chunk : *gen) {
+      if (chunk) {
+        result.append(reinterpret_cast<const char*>(chunk->data()),
+                      chunk->size());
+      }
+    }
+    return result;
+  }
+
+  rd_kafka_t* producer = nullptr;
+  std::string bootstrap_servers;
+  int num_groups = 0;
+  mock_control_plane control_plane;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(kafka_tests, fixture)
+
+TEST(loader passes on payloads unchanged) {
+  const auto binary = "\x00\x01\xff\n\x02"s;
+  produce(0, binary);
+  produce(0, "foo");
+  produce(0, "bar\n");
+  CHECK_EQUAL(load("-e -o beginning"), binary + "foobar\n");
+}
+
+TEST(loader exits after the end of all partitions) {
+  // Only the last partition has more than one message, so the loader sees the
+  // end of the other partitions first.
+  produce(0, "a\n");
+  produce(1, "b\n");
+  produce(2, "c\n");
+  produce(2, "d\n");
+  const auto result = load("-e -o beginning");
+  CHECK_EQUAL(result.size(), 8u);
+  for (const auto* x : {"a\n", "b\n", "c\nd\n"}) {
+    CHECK_NOT_EQUAL(result.find(x), std::string::npos);
+  }
+}
+
+TEST(loader stops after count) {
+  for (const auto* x : {"1\n", "2\n", "3\n", "4\n", "5\n"}) {
+    produce(1, x);
+  }
+  CHECK_EQUAL(load("-c 3 -o beginning"), "1\n2\n3\n");
+}
+
+TEST(saver applies options) {
+  const auto* plugin = plugins::find<saver_parser_plugin>("kafka");
+  REQUIRE(plugin);
+  auto diag = null_diagnostic_handler{};
+  auto p = tql::make_parser_interface(connect(",linger.ms=0", "-k key"), diag);
+  {
+    auto saver = plugin->parse_saver(*p);
+    auto write = saver->instantiate(control_plane, std::nullopt);
+    REQUIRE_NOERROR(write);
+    (*write)(chunk::copy("{\"foo\": 42}\n"s));
+    // Destroying the function flushes the producer.
+  }
+  CHECK_EQUAL(load("-c 1 -o beginning"), "{\"foo\": 42}\n");
+}
+
+TEST(invalid options) {
+  const auto* plugin = plugins::find<loader_parser_plugin>("kafka");
+  REQUIRE(plugin);
+  auto diag = null_diagnostic_handler{};
+  auto p = tql::make_parser_interface("-X foo", diag);
+  auto failed = false;
+  try {
+    plugin->parse_loader(*p);
+  } catch (const diagnostic&) {
+    failed = true;
+  }
+  CHECK(failed);
+}
+
+FIXTURE_SCOPE_END()
@@ -7,11 +7,15 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <tenzir/arrow_table_slice.hpp>
+#include <tenzir/bitmap_algorithms.hpp>
 #include <tenzir/concept/convertible/data.hpp>
 #include <tenzir/detail/base64.hpp>
 #include <tenzir/detail/inspection_common.hpp>
+#include <tenzir/detail/overload.hpp>
+#include <tenzir/ids.hpp>
 #include <tenzir/plugin.hpp>
 #include <tenzir/store.hpp>
+#include <tenzir/zone_map.hpp>
 
 #include <arrow/array.h>
 #include <arrow/compute/cast.h>
@@ -22,25 +26,56 @@
 #include <caf/expected.hpp>
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/writer.h>
+#include <parquet/exception.h>
+#include <parquet/statistics.h>
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace tenzir::plugins::parquet {
 
 /// Configuration for the Parquet plugin.
 struct configuration {
+  /// The maximum number of rows per row group, which is also the granularity
+  /// at which queries skip data.
   uint64_t row_group_size{defaults::import::table_slice_size};
   int64_t zstd_compression_level{
     arrow::util::Codec::DefaultCompressionLevel(arrow::Compression::ZSTD)
       .ValueOrDie()};
+  /// Whether to dictionary-encode columns, and the fields to exclude.
+  bool dictionary{true};
+  std::vector<std::string> no_dictionary_fields{};
+  /// Whether to write column statistics, and the fields to exclude.
+  bool statistics{true};
+  std::vector<std::string> no_statistics_fields{};
+  /// Whether to write the page index, i.e., statistics per data page.
+  bool page_index{true};
+  /// Whether to encode and decode columns on multiple threads.
+  bool threads{true};
 
   template <class Inspector>
   friend auto inspect(Inspector& f, configuration& x) {
-    return detail::apply_all(f, x.row_group_size, x.zstd_compression_level);
+    return detail::apply_all(f, x.row_group_size, x.zstd_compression_level,
+                             x.dictionary, x.no_dictionary_fields,
+                             x.statistics, x.no_statistics_fields,
+                             x.page_index, x.threads);
   }
 
   static const record_type& schema() noexcept {
     static auto result = record_type{
       {"row-group-size", uint64_type{}},
       {"zstd-compression-level", int64_type{}},
+      {"dictionary", bool_type{}},
+      {"no-dictionary-fields", list_type{string_type{}}},
+      {"statistics", bool_type{}},
+      {"no-statistics-fields", list_type{string_type{}}},
+      {"page-index", bool_type{}},
+      {"threads", bool_type{}},
     };
     return result;
   }
@@ -259,9 +294,10 @@ unwrap_record_batch(const std::shared_ptr<arrow::RecordBatch>& rb) {
 }
 
 /// Create multiple table slices for a record batch, splitting at `max_slice_size`
+/// and assigning consecutive offsets starting at `first`.
 std::vector<table_slice>
 create_table_slices(const std::shared_ptr<arrow::RecordBatch>& rb,
-                    int64_t max_slice_size) {
+                    int64_t max_slice_size, id first) {
   auto final_rb = unwrap_record_batch(rb);
   auto time_col = rb->GetColumnByName("import_time");
   auto slices = std::vector<table_slice>{};
@@ -272,7 +308,7 @@ create_table_slices(const std::shared_ptr<arrow::RecordBatch>& rb,
     auto& slice = slices.emplace_back(rb_sliced, schema);
     slice.import_time(
       derive_import_time(time_col->Slice(offset, max_slice_size)));
-    slice.offset(detail::narrow_cast<id>(offset));
+    slice.offset(first + detail::narrow_cast<id>(offset));
   }
   return slices;
 }
@@ -295,39 +331,139 @@ std::shared_ptr<arrow::Schema> parse_arrow_schema_from_metadata(
   return *arrow_schema;
 }
 
-caf::expected<std::shared_ptr<arrow::Table>>
-read_parquet_buffer(const chunk_ptr& chunk) {
-  TENZIR_ASSERT(chunk);
-  auto bufr = std::make_shared<arrow::io::BufferReader>(as_arrow_buffer(chunk));
-  const auto options = ::parquet::default_reader_properties();
-  auto parquet_reader = ::parquet::ParquetFileReader::Open(bufr, options);
-  auto arrow_schema
-    = parse_arrow_schema_from_metadata(parquet_reader->metadata());
-  std::unique_ptr<::parquet::arrow::FileReader> file_reader{};
-  if (auto st = ::parquet::arrow::OpenFile(bufr, arrow::default_memory_pool(),
-                                           &file_reader);
-      !st.ok())
-    return caf::make_error(ec::parse_error, st.ToString());
-  std::shared_ptr<arrow::Table> table{};
-  if (auto st = file_reader->ReadTable(&table); !st.ok())
-    return caf::make_error(ec::parse_error, st.ToString());
-  return align_table_to_schema(arrow_schema, table);
+/// Returns the Tenzir schema of the events in the message envelope.
+type event_schema(const arrow::Schema& arrow_schema) {
+  const auto event_field = arrow_schema.GetFieldByName("event");
+  TENZIR_ASSERT(event_field);
+  return type::from_arrow(*arrow::schema(event_field->type()->fields(),
+                                         event_field->metadata()));
+}
+
+/// Returns the path of the Parquet column that stores a field of the events.
+std::string column_path(std::string_view field) {
+  return fmt::format("event.{}", field);
+}
+
+/// Converts the statistics of a column chunk into a zone map column, or nothing
+/// if the statistics do not describe all values of the column. Floating-point
+/// columns are left out because Parquet statistics ignore NaN values.
+std::optional<zone_map_column>
+make_zone_map_column(const type& type, size_t column,
+                     const ::parquet::Statistics& statistics) {
+  const auto* typed
+    = dynamic_cast<const ::parquet::Int64Statistics*>(&statistics);
+  if (!typed || !statistics.HasNullCount())
+    return std::nullopt;
+  auto result = zone_map_column{
+    .column = column,
+    .null_count = detail::narrow_cast<uint64_t>(statistics.null_count()),
+  };
+  if (!typed->HasMinMax())
+    return statistics.num_values() == 0 ? std::optional{result} : std::nullopt;
+  auto f = detail::overload{
+    [](const int64_type&, int64_t x) -> std::optional<data> {
+      return data{x};
+    },
+    // Parquet stores unsigned integers in signed physical columns but orders
+    // them as unsigned values.
+    [](const uint64_type&, int64_t x) -> std::optional<data> {
+      return data{static_cast<uint64_t>(x)};
+    },
+    [](const duration_type&, int64_t x) -> std::optional<data> {
+      return data{duration{x}};
+    },
+    [](const time_type&, int64_t x) -> std::optional<data> {
+      return data{time{duration{x}}};
+    },
+    [](const auto&, int64_t) -> std::optional<data> {
+      return std::nullopt;
+    },
+  };
+  auto min = caf::visit(
+    [&](const auto& t) {
+      return f(t, typed->min());
+    },
+    type);
+  auto max = caf::visit(
+    [&](const auto& t) {
+      return f(t, typed->max());
+    },
+    type);
+  if (!min || !max)
+    return std::nullopt;
+  result.min = std::move(*min);
+  result.max = std::move(*max);
+  return result;
+}
+
+/// Creates one zone map per row group from the statistics in the metadata of a
+/// Parquet file, allowing for skipping row groups without decoding them.
+std::vector<zone_map> make_zone_maps(const ::parquet::FileMetaData& metadata,
+                                     const type& schema) {
+  const auto& rt = caf::get<record_type>(schema);
+  // Map the flat indices of all leaves to their Parquet columns once. Leaves
+  // nested in lists or maps have no column of their own.
+  auto columns = std::vector<std::tuple<size_t, int, type>>{};
+  auto flat_index = size_t{0};
+  for (const auto& leaf : rt.leaves()) {
+    const auto column
+      = metadata.schema()->ColumnIndex(column_path(rt.key(leaf.index)));
+    if (column >= 0)
+      columns.emplace_back(flat_index, column, leaf.field.type);
+    ++flat_index;
+  }
+  auto result = std::vector<zone_map>{};
+  result.reserve(metadata.num_row_groups());
+  auto offset = id{0};
+  for (int i = 0; i < metadata.num_row_groups(); ++i) {
+    const auto row_group = metadata.RowGroup(i);
+    auto& zm = result.emplace_back();
+    zm.offset = offset;
+    zm.rows = detail::narrow_cast<uint64_t>(row_group->num_rows());
+    offset += zm.rows;
+    for (const auto& [index, column, field_type] : columns) {
+      const auto chunk = row_group->ColumnChunk(column);
+      if (!chunk->is_stats_set())
+        continue;
+      const auto statistics = chunk->statistics();
+      if (!statistics)
+        continue;
+      if (auto x = make_zone_map_column(field_type, index, *statistics))
+        zm.columns.push_back(std::move(*x));
+    }
+  }
+  return result;
 }
 
 std::shared_ptr<::parquet::WriterProperties>
 writer_properties(const configuration& config) {
   auto builder = ::parquet::WriterProperties::Builder{};
   builder.created_by("Tenzir")
-    ->enable_dictionary()
     ->compression(::parquet::Compression::ZSTD)
     ->compression_level(detail::narrow_cast<int>(config.zstd_compression_level))
     ->version(::parquet::ParquetVersion::PARQUET_2_6);
+  if (config.dictionary)
+    builder.enable_dictionary();
+  else
+    builder.disable_dictionary();
+  for (const auto& field : config.no_dictionary_fields)
+    builder.disable_dictionary(column_path(field));
+  if (config.statistics)
+    builder.enable_statistics();
+  else
+    builder.disable_statistics();
+  for (const auto& field : config.no_statistics_fields)
+    builder.disable_statistics(column_path(field));
+  if (config.page_index)
+    builder.enable_write_page_index();
   return builder.build();
 }
 
-std::shared_ptr<::parquet::ArrowWriterProperties> arrow_writer_properties() {
+std::shared_ptr<::parquet::ArrowWriterProperties>
+arrow_writer_properties(const configuration& config) {
   auto builder = ::parquet::ArrowWriterProperties::Builder{};
   builder.store_schema(); // serialize arrow schema into parquet meta data
+  builder.set_use_threads(config.threads);
   return builder.build();
 }
 
@@ -368,10 +504,13 @@ auto write_parquet_buffer(const std::vector<table_slice>& slices,
     batches.push_back(wrap_record_batch(slice));
   auto table = arrow::Table::FromRecordBatches(batches).ValueOrDie();
   auto writer_props = writer_properties(config);
-  auto arrow_writer_props = arrow_writer_properties();
-  auto status
-    = ::parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), sink,
-                                   1 << 24, writer_props, arrow_writer_props);
+  auto arrow_writer_props = arrow_writer_properties(config);
+  // Row groups are the unit at which readers skip data, so we keep them as
+  // small as the table slices we read them back as.
+  auto status = ::parquet::arrow::WriteTable(
+    *table, arrow::default_memory_pool(), sink,
+    detail::narrow_cast<int64_t>(config.row_group_size), writer_props,
+    arrow_writer_props);
   TENZIR_ASSERT(status.ok(), status.ToString().c_str());
   return sink->Finish().ValueOrDie();
 }
@@ -382,47 +521,164 @@ public:
     : parquet_config_{config} {
   }
 
-  /// Load the store contents from the given chunk.
+  /// Load the store contents from the given chunk. This only reads the
+  /// metadata of the file; row groups are decoded when a query needs them.
   /// @param chunk The chunk pointing to the store's persisted data.
   /// @returns An error on failure.
   [[nodiscard]] caf::error load(chunk_ptr chunk) override {
-    auto table = read_parquet_buffer(chunk);
-    if (!table)
-      return table.error();
-    for (const auto& rb : arrow::TableBatchReader(*table)) {
-      if (!rb.ok())
-        return caf::make_error(ec::system_error,
-                               fmt::format("unable to read record batch: {}",
-                                           rb.status().ToString()));
-      auto slices_for_batch = create_table_slices(
-        *rb, detail::narrow_cast<int64_t>(parquet_config_.row_group_size));
-      slices_.reserve(slices_for_batch.size() + slices_.size());
-      slices_.insert(slices_.end(),
-                     std::make_move_iterator(slices_for_batch.begin()),
-                     std::make_move_iterator(slices_for_batch.end()));
-      num_rows_ += (*rb)->num_rows();
+    TENZIR_ASSERT(chunk);
+    auto input
+      = std::make_shared<arrow::io::BufferReader>(as_arrow_buffer(chunk));
+    auto parquet_reader = std::unique_ptr<::parquet::ParquetFileReader>{};
+    try {
+      parquet_reader = ::parquet::ParquetFileReader::Open(
+        input, ::parquet::default_reader_properties());
+    } catch (const ::parquet::ParquetException& e) {
+      return caf::make_error(ec::parse_error, e.what());
     }
+    const auto metadata = parquet_reader->metadata();
+    arrow_schema_ = parse_arrow_schema_from_metadata(metadata);
+    if (!arrow_schema_)
+      return caf::make_error(ec::parse_error,
+                             "failed to read Arrow schema from Parquet file");
+    if (auto st = ::parquet::arrow::FileReader::Make(
+          arrow::default_memory_pool(), std::move(parquet_reader),
+          &file_reader_);
+        !st.ok())
+      return caf::make_error(ec::parse_error, st.ToString());
+    file_reader_->set_use_threads(parquet_config_.threads);
+    schema_ = event_schema(*arrow_schema_);
+    zone_maps_ = make_zone_maps(*metadata, schema_);
+    row_groups_.assign(zone_maps_.size(), std::nullopt);
+    num_rows_ = detail::narrow_cast<uint64_t>(metadata->num_rows());
     return {};
   }
 
   /// Retrieve all of the store's slices.
   /// @returns The store's slices.
   [[nodiscard]] generator<table_slice> slices() const override {
-    // We need to make a copy of the slices here because the slices_ vector may
-    // get invalidated while we iterate over it.
-    auto slices = slices_;
-    for (auto& slice : slices)
-      co_yield std::move(slice);
+    for (size_t i = 0; i < row_groups_.size(); ++i) {
+      auto slices = read_row_group(i);
+      if (!slices) {
+        error_ = std::move(slices.error());
+        co_return;
+      }
+      for (auto& slice : *slices)
+        co_yield std::move(slice);
+    }
+  }
+
+  [[nodiscard]] type schema() const override {
+    return schema_;
+  }
+
+  [[nodiscard]] generator<uint64_t>
+  count(expression expr, ids selection) const override {
+    for (auto i : select_row_groups(expr, selection)) {
+      auto slices = read_row_group(i);
+      if (!slices) {
+        error_ = std::move(slices.error());
+        co_return;
+      }
+      for (const auto& slice : *slices)
+        co_yield count_matching(slice, expr, selection);
+    }
+  }
+
+  [[nodiscard]] generator<table_slice>
+  extract(expression expr, ids selection) const override {
+    for (auto i : select_row_groups(expr, selection)) {
+      auto slices = read_row_group(i);
+      if (!slices) {
+        error_ = std::move(slices.error());
+        co_return;
+      }
+      for (const auto& slice : *slices)
+        if (auto filtered_slice = filter(slice, expr, selection))
+          co_yield std::move(*filtered_slice);
+    }
   }
 
   [[nodiscard]] uint64_t num_events() const override {
     return num_rows_;
   }
 
+  [[nodiscard]] caf::error take_error() override {
+    return std::exchange(error_, {});
+  }
+
 private:
-  std::vector<table_slice> slices_ = {};
+  /// Removes the ids of all row groups whose statistics rule out a match from
+  /// a selection, and returns the indices of the remaining row groups.
+  std::vector<size_t>
+  select_row_groups(const expression& expr, ids& selection) const {
+    selection = prune(zone_maps_, expr, std::move(selection));
+    auto result = std::vector<size_t>{};
+    if (selection.empty()) {
+      result.resize(zone_maps_.size());
+      std::iota(result.begin(), result.end(), size_t{0});
+      return result;
+    }
+    auto runs = std::vector<id_range>{};
+    for (auto run : select_runs(selection))
+      runs.push_back(run);
+    for (size_t i = 0; i < zone_maps_.size(); ++i) {
+      const auto first = zone_maps_[i].offset;
+      const auto last = first + zone_maps_[i].rows;
+      const auto it = std::upper_bound(runs.begin(), runs.end(), first,
+                                       [](id x, const id_range& run) {
+                                         return x < run.last;
+                                       });
+      if (it != runs.end() && it->first < last)
+        result.push_back(i);
+    }
+    return result;
+  }
+
+  /// Decodes a row group into table slices, or returns the previously decoded
+  /// slices. We return a copy because the cache may change while the caller
+  /// iterates over the slices. Failures are not cached.
+  caf::expected<std::vector<table_slice>> read_row_group(size_t index) const {
+    auto& row_group = row_groups_[index];
+    if (row_group)
+      return *row_group;
+    auto table = std::shared_ptr<arrow::Table>{};
+    if (auto st
+        = file_reader_->ReadRowGroup(detail::narrow_cast<int>(index), &table);
+        !st.ok())
+      return caf::make_error(ec::format_error,
+                             fmt::format("failed to read row group {}: {}",
+                                         index, st.ToString()));
+    table = align_table_to_schema(arrow_schema_, table);
+    auto slices = std::vector<table_slice>{};
+    auto offset = zone_maps_[index].offset;
+    for (const auto& rb : arrow::TableBatchReader(*table)) {
+      if (!rb.ok())
+        return caf::make_error(ec::format_error,
+                               fmt::format("failed to read record batch of "
+                                           "row group {}: {}",
+                                           index, rb.status().ToString()));
+      auto slices_for_batch = create_table_slices(
+        *rb, detail::narrow_cast<int64_t>(parquet_config_.row_group_size),
+        offset);
+      slices.insert(slices.end(),
+                    std::make_move_iterator(slices_for_batch.begin()),
+                    std::make_move_iterator(slices_for_batch.end()));
+      offset += (*rb)->num_rows();
+    }
+    row_group = std::move(slices);
+    return *row_group;
+  }
+
+  std::unique_ptr<::parquet::arrow::FileReader> file_reader_ = {};
+  std::shared_ptr<arrow::Schema> arrow_schema_ = {};
+  type schema_ = {};
+  std::vector<zone_map> zone_maps_ = {};
+  mutable std::vector<std::optional<std::vector<table_slice>>> row_groups_
+    = {};
   configuration parquet_config_ = {};
   uint64_t num_rows_ = {};
+  mutable caf::error error_ = {};
 };
 
 class active_parquet_store final : public active_store {
@@ -502,8 +758,9 @@ class plugin final : public virtual store_plugin {
 
   auto make_active_store() const
     -> caf::expected<std::unique_ptr<active_store>> override {
-    return std::make_unique<active_parquet_store>(
-      configuration{parquet_config_.row_group_size, zstd_compression_level_});
+    auto config = parquet_config_;
+    config.zstd_compression_level = zstd_compression_level_;
+    return std::make_unique<active_parquet_store>(std::move(config));
   }
 
 private:
@@ -26,6 +26,7 @@
 #include <tenzir/test/test.hpp>
 
 #include <chrono>
+#include <cstring>
 
 namespace tenzir::plugins::parquet {
 
@@ -404,6 +405,69 @@ TEST(passive parquet store selective query) {
   compare_table_slices(*expected_slice, results[0]);
 }
 
+TEST(passive parquet store skips row groups) {
+  const auto* plugin
+    = tenzir::plugins::find<tenzir::store_actor_plugin>("parquet");
+  REQUIRE(plugin);
+  auto _
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    = const_cast<store_actor_plugin*>(plugin)->initialize(
+      record{{"row-group-size", 512u}}, {});
+  // Two row groups with the values [0, 512) and [1000, 1512).
+  auto slices = std::vector<table_slice>{};
+  for (auto first : {int64_t{0}, int64_t{1000}}) {
+    auto builder = table_slice_builder{
+      type{"test.numbers", record_type{{"x", int64_type{}}}}};
+    for (auto x = first; x < first + 512; ++x)
+      CHECK(builder.add(x));
+    slices.push_back(builder.finish());
+    slices.back().import_time(std::chrono::system_clock::now());
+  }
+  auto builder_and_header = plugin->make_store_builder(accountant, filesystem,
+                                                       tenzir::uuid::random());
+  REQUIRE_NOERROR(builder_and_header);
+  auto& [builder, header] = *builder_and_header;
+  tenzir::detail::spawn_container_source(sys, slices, builder);
+  run();
+  auto store = plugin->make_store(accountant, filesystem, as_bytes(header));
+  REQUIRE_NOERROR(store);
+  run();
+  auto make_expr = [](std::string_view str) {
+    return unbox(to<expression>(str));
+  };
+  CHECK_EQUAL(count(*store, tenzir::ids{}, make_expr("x >= 1000")), 512ull);
+  auto results = query(*store, tenzir::ids{}, make_expr("x < 10"));
+  REQUIRE_EQUAL(results.size(), 1ull);
+  CHECK_EQUAL(results[0].rows(), 10ull);
+  MESSAGE("selections outside of the row group ranges yield nothing");
+  results = query(*store, make_ids({{0, 10}}, 1024), make_expr("x >= 1000"));
+  CHECK(results.empty());
+}
+
+TEST(passive parquet store reports corrupt row groups) {
+  const auto* plugin = tenzir::plugins::find<tenzir::store_plugin>("parquet");
+  REQUIRE(plugin);
+  auto active = unbox(plugin->make_active_store());
+  REQUIRE_SUCCESS(active->add({table_slice_fixture().slice}));
+  auto chunk = unbox(active->finish());
+  // Overwrite everything between the leading magic bytes and the footer, so
+  // that the metadata remains readable but the row groups do not.
+  auto bytes = std::vector<std::byte>{chunk->begin(), chunk->end()};
+  REQUIRE_GREATER(bytes.size(), 12u);
+  auto footer_size = uint32_t{};
+  std::memcpy(&footer_size, bytes.data() + bytes.size() - 8, 4);
+  REQUIRE_GREATER(bytes.size(), 12u + footer_size);
+  std::fill(bytes.begin() + 4, bytes.end() - 8 - footer_size, std::byte{0xff});
+  auto passive = unbox(plugin->make_passive_store());
+  REQUIRE_SUCCESS(passive->load(chunk::make(std::move(bytes))));
+  CHECK(collect(passive->slices()).empty());
+  CHECK_EQUAL(passive->take_error(), ec::format_error);
+  MESSAGE("the error is reported only once");
+  CHECK_EQUAL(passive->take_error(), caf::none);
+  CHECK(collect(passive->count(expression{}, tenzir::ids{})).empty());
+  CHECK_EQUAL(passive->take_error(), ec::format_error);
+}
+
 TEST(passive parquet store erase) {
   auto f = table_slice_fixture();
   auto slice = f.slice;
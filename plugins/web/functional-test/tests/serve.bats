@@ -49,3 +49,16 @@ wait_for_http() {
     assert jq -nec "(${third_result} | .events | length) == 0"
   fi
 }
+
+@test "serve endpoint with streaming" {
+  wait_for_http
+
+  tenzir 'show version | repeat 5 | serve version' &
+  sleep 3
+
+  # Fetch all events in a single streamed response with up to 2 events per
+  # chunk, where every chunk is a JSON document on its own line.
+  result="$(curl -XPOST -H "Content-Type: application/json" -d '{"serve_id": "version", "timeout": "5s", "max_events": 2, "stream": true}' http://127.0.0.1:5160/api/v0/serve)"
+
+  check jq -sc 'map(.events | length) | add' <<<"${result}"
+}
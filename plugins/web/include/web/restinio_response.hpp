@@ -16,6 +16,12 @@
 #include <restinio/request_handler.hpp>
 #include <restinio/router/express.hpp>
 
+#include <functional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
 namespace tenzir::plugins::web {
 
 // Note: If desired, `restinio` provides users to embed arbitrary `extra_data`
@@ -24,6 +30,8 @@ using request_handle_t
   = restinio::generic_request_handle_t<restinio::no_extra_data_factory_t::data_t>;
 using response_t
   = restinio::response_builder_t<restinio::user_controlled_output_t>;
+using chunked_response_t
+  = restinio::response_builder_t<restinio::chunked_output_t>;
 using route_params_t = restinio::router::route_params_t;
 
 class restinio_response final {
@@ -45,6 +53,19 @@ public:
   // Add a custom response header.
   void add_header(std::string field, std::string value);
 
+  // Override the content type of the endpoint. Has no effect once the first
+  // part of the response was written.
+  void set_content_type(http_content_type content_type);
+
+  // Write a chunk of a streamed response, which switches the response to
+  // chunked transfer encoding. The callback is invoked with `true` once the
+  // chunk was written, and with `false` if writing failed, e.g., because the
+  // client disconnected.
+  void append_chunk(std::string chunk, std::function<void(bool)> on_written);
+
+  // Returns whether the response uses chunked transfer encoding.
+  [[nodiscard]] bool is_chunked() const;
+
   // Get a handle to the original request.
   [[nodiscard]] const request_handle_t& request() const;
 
@@ -52,10 +73,19 @@ public:
   [[nodiscard]] const route_params_t& route_params() const;
 
 private:
+  // Returns the builder for a response with a known content length, creating
+  // it on first use.
+  auto output() -> response_t&;
+
   request_handle_t request_;
   route_params_t route_params_;
   bool enable_detailed_errors_ = false;
-  response_t response_;
+  http_content_type content_type_ = {};
+  // The headers added before the response builder was created.
+  std::vector<std::pair<std::string, std::string>> headers_ = {};
+  // We can only decide on the kind of response builder once we know whether
+  // the response is streamed, so we create it lazily.
+  std::variant<std::monostate, response_t, chunked_response_t> response_ = {};
   size_t body_size_ = {};
 };
 
@@ -8,6 +8,8 @@
 
 #include "web/restinio_response.hpp"
 
+#include <tenzir/detail/assert.hpp>
+
 namespace tenzir::plugins::web {
 
 static std::string content_type_to_string(tenzir::http_content_type type) {
@@ -16,6 +18,8 @@ static std::string content_type_to_string(tenzir::http_content_type type) {
       return "application/json; charset=utf-8";
     case http_content_type::ldjson:
       return "application/ld+json; charset=utf-8";
+    case http_content_type::arrow_ipc:
+      return "application/vnd.apache.arrow.stream";
   }
   // Unreachable
   return "application/octet-stream";
@@ -28,48 +32,117 @@ restinio_response::restinio_response(request_handle_t&& handle,
   : request_(std::move(handle)),
     route_params_(std::move(route_params)),
     enable_detailed_errors_(enable_detailed_errors),
-    // Note that ownership of the `connection` is transferred when creating a
-    // response.
-    response_(request_->create_response<restinio::user_controlled_output_t>()) {
-  response_.append_header(restinio::http_field::content_type,
-                          content_type_to_string(endpoint.content_type));
-  response_.header().status_code(
-    restinio::http_status_code_t{restinio::status_code::internal_server_error});
+    content_type_(endpoint.content_type) {
 }
 
 restinio_response::~restinio_response() {
   // `done()` must only be called exactly once.
-  response_.append_header_date_field().set_content_length(body_size_).done();
+  if (auto* chunked = std::get_if<chunked_response_t>(&response_)) {
+    chunked->done();
+    return;
+  }
+  output().append_header_date_field().set_content_length(body_size_).done();
 }
 
 void restinio_response::append(std::string body) {
+  if (is_chunked())
+    return append_chunk(std::move(body), {});
   body_size_ += body.size();
-  response_.append_body(std::move(body));
+  output().append_body(std::move(body));
 }
 
 void restinio_response::finish(caf::expected<std::string> body) {
-  response_.header().status_code(
-    restinio::http_status_code_t{restinio::status_code::ok});
   auto text = body ? *body : fmt::format("{}", body.error());
+  if (is_chunked())
+    return append_chunk(std::move(text), {});
+  auto& response = output();
+  response.header().status_code(
+    restinio::http_status_code_t{restinio::status_code::ok});
   body_size_ += text.size();
-  response_.append_body(std::move(text));
+  response.append_body(std::move(text));
 }
 
 void restinio_response::abort(uint16_t error_code, std::string message,
                               caf::error detail) {
-  response_.header().status_code(restinio::http_status_code_t{error_code});
   std::string body;
   if (enable_detailed_errors_)
     message = fmt::format("{}{}", message, detail);
   body = fmt::format(R"_({{"error": {}}})_", detail::json_escape(message));
+  // The status line of a streamed response is already on the wire, so all we
+  // can do is to end the stream with the error.
+  if (is_chunked())
+    return append_chunk(std::move(body), {});
+  auto& response = output();
+  response.header().status_code(restinio::http_status_code_t{error_code});
   body_size_ = body.size();
-  response_.set_body(std::move(body));
+  response.set_body(std::move(body));
   // TODO: Proactively call `done()` here, and add some flag to prevent
   // it from being called multiple times.
 }
 
 void restinio_response::add_header(std::string field, std::string value) {
-  response_.append_header(std::move(field), std::move(value));
+  if (auto* response = std::get_if<response_t>(&response_))
+    response->append_header(std::move(field), std::move(value));
+  else if (auto* chunked = std::get_if<chunked_response_t>(&response_))
+    chunked->append_header(std::move(field), std::move(value));
+  else
+    headers_.emplace_back(std::move(field), std::move(value));
+}
+
+void restinio_response::set_content_type(http_content_type content_type) {
+  content_type_ = content_type;
+}
+
+void restinio_response::append_chunk(std::string chunk,
+                                     std::function<void(bool)> on_written) {
+  TENZIR_ASSERT(not std::holds_alternative<response_t>(response_));
+  if (std::holds_alternative<std::monostate>(response_)) {
+    // Note that ownership of the `connection` is transferred when creating a
+    // response.
+    auto& response = response_.emplace<chunked_response_t>(
+      request_->create_response<restinio::chunked_output_t>());
+    response.append_header(restinio::http_field::content_type,
+                           content_type_to_string(content_type_));
+    for (auto& [field, value] : headers_)
+      response.append_header(std::move(field), std::move(value));
+    headers_.clear();
+    response.append_header_date_field();
+  }
+  auto& response = std::get<chunked_response_t>(response_);
+  // An empty chunk marks the end of the body in the chunked transfer
+  // encoding, so we must not write it.
+  if (not chunk.empty())
+    response.append_chunk(std::move(chunk));
+  if (not on_written) {
+    response.flush();
+    return;
+  }
+  response.flush([on_written = std::move(on_written)](
+                   const restinio::asio_ns::error_code& ec) {
+    on_written(not ec);
+  });
+}
+
+bool restinio_response::is_chunked() const {
+  return std::holds_alternative<chunked_response_t>(response_);
+}
+
+auto restinio_response::output() -> response_t& {
+  if (auto* response = std::get_if<response_t>(&response_))
+    return *response;
+  TENZIR_ASSERT(std::holds_alternative<std::monostate>(response_));
+  // Note that ownership of the `connection` is transferred when creating a
+  // response.
+  auto& response = response_.emplace<response_t>(
+    request_->create_response<restinio::user_controlled_output_t>());
+  response.append_header(restinio::http_field::content_type,
+                         content_type_to_string(content_type_));
+  for (auto& [field, value] : headers_)
+    response.append_header(std::move(field), std::move(value));
+  headers_.clear();
+  response.header().status_code(
+    restinio::http_status_code_t{restinio::status_code::internal_server_error});
+  return response;
 }
 
 auto restinio_response::request() const -> const request_handle_t& {
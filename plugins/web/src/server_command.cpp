@@ -50,6 +50,10 @@ using request_dispatcher_actor = typed_actor_fwd<
   // INTERNAL: Continue handling a requet.
   auto(atom::internal, atom::request, restinio_response_ptr, rest_endpoint,
        rest_handler_actor)
+    ->caf::result<void>,
+  // INTERNAL: Request the next chunk of a streamed response.
+  auto(atom::internal, atom::resume, restinio_response_ptr, uint64_t,
+       tenzir::record, rest_handler_actor)
     ->caf::result<void>>::unwrap;
 
 namespace {
@@ -95,6 +99,55 @@ struct request_dispatcher_state {
   authenticator_actor authenticator;
 };
 
+/// Forwards a request to the handler of an endpoint, and writes the response
+/// of the handler. For streamed responses, this writes the response as a chunk
+/// and requests the next chunk once the client received it.
+void forward_request(
+  request_dispatcher_actor::stateful_pointer<request_dispatcher_state> self,
+  restinio_response_ptr response, uint64_t endpoint_id, tenzir::record params,
+  rest_handler_actor handler) {
+  // Note that the handler should return a valid "error" response by itself
+  // if possible (ie. invalid arguments), the error handler is to catch
+  // timeouts and real internal errors.
+  self
+    ->request(handler, caf::infinite, atom::http_request_v, endpoint_id,
+              std::move(params))
+    .then(
+      [self, response, endpoint_id, handler](rest_response& rsp) {
+        if (not response->is_chunked()) {
+          if (const auto& content_type = rsp.content_type())
+            response->set_content_type(*content_type);
+          for (const auto& [field, value] : rsp.headers())
+            response->add_header(field, value);
+        }
+        if (not rsp.follow_up()) {
+          auto&& body = std::move(rsp).release();
+          response->finish(std::move(body));
+          return;
+        }
+        // Waiting for the chunk to be written before requesting the next one
+        // ties the pace of the handler to the pace of the client.
+        auto dispatcher = caf::actor_cast<request_dispatcher_actor>(self);
+        auto follow_up = *rsp.follow_up();
+        auto on_written = [dispatcher, response, endpoint_id, handler,
+                           follow_up = std::move(follow_up)](bool ok) mutable {
+          if (not ok) {
+            TENZIR_DEBUG("stopping streamed response after failed write");
+            return;
+          }
+          caf::anon_send(dispatcher, atom::internal_v, atom::resume_v,
+                         std::move(response), endpoint_id,
+                         std::move(follow_up), std::move(handler));
+        };
+        response->append_chunk(std::move(rsp).release(),
+                               std::move(on_written));
+      },
+      [response](const caf::error& e) {
+        TENZIR_WARN("internal server error while handling request: {}", e);
+        response->abort(500, "internal server error", e);
+      });
+}
+
 request_dispatcher_actor::behavior_type request_dispatcher(
   request_dispatcher_actor::stateful_pointer<request_dispatcher_state> self,
   server_config config, authenticator_actor authenticator) {
@@ -197,21 +250,14 @@ request_dispatcher_actor::behavior_type request_dispatcher(
       if (!params)
         return response->abort(
           422, "failed to parse endpoint parameters: ", params.error());
-      // Note that the handler should return a valid "error" response by itself
-      // if possible (ie. invalid arguments), the error handler is to catch
-      // timeouts and real internal errors.
-      self
-        ->request(handler, caf::infinite, atom::http_request_v,
-                  endpoint.endpoint_id, std::move(*params))
-        .then(
-          [response](rest_response& rsp) {
-            auto&& body = std::move(rsp).release();
-            response->finish(std::move(body));
-          },
-          [response](const caf::error& e) {
-            TENZIR_WARN("internal server error while handling request: {}", e);
-            response->abort(500, "internal server error", e);
-          });
+      forward_request(self, std::move(response), endpoint.endpoint_id,
+                      std::move(*params), std::move(handler));
+    },
+    [self](atom::internal, atom::resume, restinio_response_ptr& response,
+           uint64_t endpoint_id, tenzir::record& params,
+           rest_handler_actor& handler) {
+      forward_request(self, std::move(response), endpoint_id,
+                      std::move(params), std::move(handler));
     },
   };
 }
@@ -0,0 +1,15 @@
+#!/bin/sh
+
+# Prints the files that the directory saver reports on stdout together with
+# their contents. Schema fingerprints in file names are masked, and the files
+# are sorted by their masked names to make the output deterministic.
+
+set -eu
+
+while read -r path; do
+  masked="$(echo "$path" | sed -E 's/\.[0-9a-f]+\.(([0-9]+\.)?[a-z]+)$/.<fingerprint>.\1/')"
+  printf '%s\t%s\n' "$masked" "$path"
+done | LC_ALL=C sort | while IFS="$(printf '\t')" read -r masked path; do
+  echo "$masked"
+  cat "$path"
+done